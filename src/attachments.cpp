@@ -0,0 +1,295 @@
+#include "attachments.hpp"
+#include "lib.hpp"
+#include <fpdf_attachment.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace pdfv
+{
+	/**
+	 * @brief Writable view of a whole output file
+	 * 
+	 */
+	struct FileView
+	{
+		HANDLE mapping{ nullptr };
+		void * view{ nullptr };
+		u64 size{ 0 };
+
+		FileView() noexcept = default;
+		FileView(const FileView & other) = delete;
+		FileView(FileView && other) noexcept = delete;
+		FileView & operator=(const FileView & other) = delete;
+		FileView & operator=(FileView && other) noexcept = delete;
+		~FileView() noexcept
+		{
+			this->close();
+		}
+
+		/**
+		 * @brief Grows the file to size bytes and maps all of it
+		 * 
+		 */
+		[[nodiscard]] bool map(HANDLE file, u64 size) noexcept
+		{
+			this->close();
+			this->mapping = ::CreateFileMappingW(file, nullptr, PAGE_READWRITE, DWORD(size >> 32), DWORD(size), nullptr);
+			this->view    = (this->mapping != nullptr) ? ::MapViewOfFile(this->mapping, FILE_MAP_WRITE, 0, 0, SIZE_T(size)) : nullptr;
+			this->size    = (this->view != nullptr) ? size : 0;
+			return this->view != nullptr;
+		}
+		/**
+		 * @brief Flushes and unmaps the view, the file keeps its size
+		 * 
+		 * @return false The view couldn't be written back
+		 */
+		bool close() noexcept
+		{
+			bool ok{ true };
+			if (this->view != nullptr)
+			{
+				ok = ::FlushViewOfFile(this->view, 0);
+				::UnmapViewOfFile(this->view);
+				this->view = nullptr;
+			}
+			if (this->mapping != nullptr)
+			{
+				::CloseHandle(this->mapping);
+				this->mapping = nullptr;
+			}
+			return ok;
+		}
+	};
+
+	/**
+	 * @brief Decoded length the document claims in the parameters of an embedded file
+	 * 
+	 * @return u64 Claimed length, 0 if there is no usable claim
+	 */
+	[[nodiscard]] static u64 lengthHint(FPDF_ATTACHMENT att) noexcept
+	{
+		if (FPDFAttachment_GetValueType(att, "Size") != FPDF_OBJECT_NUMBER)
+		{
+			return 0;
+		}
+		// Numbers come back as text, length is in bytes and includes the terminating null character
+		unsigned short buf[24]{};
+		const auto len{ FPDFAttachment_GetStringValue(att, "Size", buf, ul(sizeof buf)) };
+		if (len < sizeof(unsigned short) || len > sizeof buf)
+		{
+			return 0;
+		}
+		u64 size{ 0 };
+		for (std::size_t i = 0; i < len / sizeof(unsigned short) - 1; ++i)
+		{
+			if (buf[i] < L'0' || buf[i] > L'9' || size > Attachments::s_cMaxLength)
+			{
+				return 0;
+			}
+			size = size * 10 + u64(buf[i] - L'0');
+		}
+		return size;
+	}
+}
+
+pdfv::Attachments::Attachments(DocRef doc) noexcept
+	: m_doc(std::move(doc))
+{
+}
+
+void pdfv::Attachments::load() noexcept
+{
+	if (this->m_loaded)
+	{
+		return;
+	}
+	DEBUGPRINT("pdfv::Attachments::load()\n");
+	this->m_loaded = true;
+
+	try
+	{
+		auto lock{ Pdfium::lock() };
+		if (this->m_doc->get() == nullptr)
+		{
+			return;
+		}
+		const auto count{ std::size_t(std::max(FPDFDoc_GetAttachmentCount(this->m_doc->get()), 0)) };
+		this->m_lengths = std::make_unique<std::atomic<u64>[]>(count);
+		this->m_nameStart.reserve(count + 1);
+
+		std::vector<unsigned short> buf;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			this->m_nameStart.emplace_back(u32(this->m_names.size()));
+			this->m_lengths[i].store(s_cUnknownLength, std::memory_order_relaxed);
+			auto att{ FPDFDoc_GetAttachment(this->m_doc->get(), int(i)) };
+			if (att == nullptr) [[unlikely]]
+			{
+				continue;
+			}
+			// Length is in bytes and includes the terminating null character
+			buf.resize(std::max<std::size_t>(FPDFAttachment_GetName(att, nullptr, 0) / sizeof(unsigned short), 1));
+			FPDFAttachment_GetName(att, buf.data(), ul(buf.size() * sizeof(unsigned short)));
+			this->m_names.append(buf.begin(), buf.end() - 1);
+		}
+		this->m_nameStart.emplace_back(u32(this->m_names.size()));
+		this->m_count = count;
+	}
+	catch (const std::bad_alloc &)
+	{
+		this->m_names.clear();
+		this->m_nameStart.clear();
+		this->m_lengths.reset();
+		this->m_count = 0;
+	}
+	DEBUGPRINT("Attachments: %zu\n", this->m_count);
+}
+
+bool pdfv::Attachments::extract(std::size_t idx, const std::wstring & path, bool overwrite) noexcept
+{
+	DEBUGPRINT("pdfv::Attachments::extract(%zu, %p, %d)\n", idx, static_cast<const void *>(&path), int(overwrite));
+
+	if (idx >= this->m_count || (this->length(idx) != s_cUnknownLength && this->length(idx) > s_cMaxLength))
+	{
+		return false;
+	}
+	// A file that appeared after the user was asked is not replaced either
+	auto file{ ::CreateFileW(
+		path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+		overwrite ? CREATE_ALWAYS : CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr
+	) };
+	if (file == INVALID_HANDLE_VALUE) [[unlikely]]
+	{
+		return false;
+	}
+
+	bool ok{ false };
+	FileView out;
+	ul outLen{ 0 };
+	{
+		auto lock{ Pdfium::lock() };
+		const auto doc{ this->m_doc->get() };
+		auto att{ (doc != nullptr) ? FPDFDoc_GetAttachment(doc, int(idx)) : nullptr };
+		const auto known{ this->length(idx) };
+		if (att != nullptr && known == 0)
+		{
+			ok = true;
+		}
+		else if (att != nullptr) [[likely]]
+		{
+			// Library decodes straight into the file-backed view, the contents never occupy
+			// the heap a second time. The view is sized after the known length or, on the
+			// first extraction, after the length the document claims, so that a truthful
+			// claim gets away with a single decode
+			const auto size{ (known != s_cUnknownLength) ? known : lengthHint(att) };
+			FPDF_BOOL decoded;
+			if (size > 0 && size <= s_cMaxLength && out.map(file, size))
+			{
+				decoded = FPDFAttachment_GetFile(att, out.view, ul(size), &outLen);
+			}
+			else
+			{
+				decoded = FPDFAttachment_GetFile(att, nullptr, 0, &outLen);
+			}
+			if (decoded) [[likely]]
+			{
+				this->m_lengths[idx].store(outLen, std::memory_order_relaxed);
+				if (outLen <= out.size)
+				{
+					ok = true;
+				}
+				else if (outLen <= s_cMaxLength && out.map(file, outLen))
+				{
+					// No claim or a short one, decoded once more into a view that fits
+					ul again{ 0 };
+					ok = FPDFAttachment_GetFile(att, out.view, outLen, &again) && again == outLen;
+				}
+			}
+		}
+	}
+
+	// Written back outside of the library lock, other extractions keep decoding
+	ok = out.close() && ok;
+	if (ok && outLen < out.size)
+	{
+		// Claimed length was too long, the file is cut to what was decoded
+		LARGE_INTEGER pos{};
+		pos.QuadPart = LONGLONG(outLen);
+		ok = ::SetFilePointerEx(file, pos, nullptr, FILE_BEGIN) && ::SetEndOfFile(file);
+	}
+	::CloseHandle(file);
+
+	if (!ok) [[unlikely]]
+	{
+		::DeleteFileW(path.c_str());
+	}
+	return ok;
+}
+std::size_t pdfv::Attachments::extract(const std::vector<JobT> & jobs, bool overwrite, const std::atomic<bool> & cancel) noexcept
+{
+	DEBUGPRINT("pdfv::Attachments::extract(%zu job(s), %d)\n", jobs.size(), int(overwrite));
+
+	std::atomic<std::size_t> next{ 0 }, done{ 0 };
+	auto work = [this, &jobs, overwrite, &cancel, &next, &done]() noexcept
+	{
+		for (auto i{ next++ }; i < jobs.size() && !cancel; i = next++)
+		{
+			if (this->extract(jobs[i].first, jobs[i].second, overwrite))
+			{
+				++done;
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	try
+	{
+		for (auto n{ std::min(jobs.size(), s_cMaxParallel) }; n > 1; --n)
+		{
+			threads.emplace_back(work);
+		}
+	}
+	catch (...)
+	{
+		// Fewer threads, calling thread works too
+	}
+	work();
+	for (auto & thread : threads)
+	{
+		thread.join();
+	}
+	return done;
+}
+[[nodiscard]] std::wstring pdfv::Attachments::s_fileName(std::wstring_view name, std::size_t idx)
+{
+	if (auto slash{ name.find_last_of(L"/\\") }; slash != std::wstring_view::npos)
+	{
+		name.remove_prefix(slash + 1);
+	}
+	std::wstring file;
+	file.reserve(name.size());
+	for (auto ch : name)
+	{
+		constexpr std::wstring_view invalid{ L"<>:\"|?*" };
+		file += (ch < 0x20 || invalid.find(ch) != std::wstring_view::npos) ? L'_' : ch;
+	}
+	// Trailing dots and spaces are dropped by the file system
+	while (!file.empty() && (file.back() == L'.' || file.back() == L' '))
+	{
+		file.pop_back();
+	}
+	if (file.empty())
+	{
+		file = L"attachment" + std::to_wstring(idx + 1);
+	}
+	return file;
+}
+
+[[nodiscard]] std::size_t pdfv::Attachments::bytes() const noexcept
+{
+	return sizeof(Attachments) +
+		this->m_names.capacity() * sizeof(wchar_t) +
+		this->m_nameStart.capacity() * sizeof(u32) +
+		this->m_count * sizeof(std::atomic<u64>);
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "common.hpp"
+#include "borrowed.hpp"
+
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace pdfv
+{
+	/**
+	 * @brief Embedded files of a document. Names are listed without touching file contents,
+	 * which are only decoded when extracted, straight into a file-backed view of the output
+	 * file. Learning a decoded length takes a full decode, so lengths stay unknown until the
+	 * file is extracted. The library hands out a decoded file only as a whole, it can't be
+	 * written in pieces, so files above s_cMaxLength are refused
+	 * 
+	 */
+	class Attachments
+	{
+	public:
+		static constexpr u64 s_cUnknownLength{ std::numeric_limits<u64>::max() };
+		/**
+		 * @brief Longest file that is extracted. The library keeps its own decoded copy while
+		 * the view of the output file is mapped, a 32-bit process has room for both only up
+		 * to a few hundred megabytes
+		 * 
+		 */
+		static constexpr u64 s_cMaxLength{ (sizeof(void *) < 8) ? u64(256) * 1024 * 1024 : u64(std::numeric_limits<ul>::max()) };
+		/**
+		 * @brief Maximum number of files extracted at once, decoding is serialised by the
+		 * library lock, writing back to disk overlaps
+		 * 
+		 */
+		static constexpr std::size_t s_cMaxParallel{ 4 };
+
+		/**
+		 * @brief Attachment index and output path
+		 * 
+		 */
+		using JobT = std::pair<std::size_t, std::wstring>;
+
+	private:
+		DocRef m_doc;
+		std::wstring m_names;
+		/**
+		 * @brief Offset of each name in m_names, followed by the total length
+		 * 
+		 */
+		std::vector<u32> m_nameStart;
+		std::unique_ptr<std::atomic<u64>[]> m_lengths;
+		std::size_t m_count{ 0 };
+		bool m_loaded{ false };
+
+	public:
+		/**
+		 * @param doc Document of the owner, attachments aren't read until load() is called
+		 */
+		explicit Attachments(DocRef doc) noexcept;
+		Attachments(const Attachments & other) = delete;
+		Attachments(Attachments && other) noexcept = delete;
+		Attachments & operator=(const Attachments & other) = delete;
+		Attachments & operator=(Attachments && other) noexcept = delete;
+		~Attachments() noexcept = default;
+
+		/**
+		 * @brief Reads attachment names if they aren't read yet, takes the library lock.
+		 * Has to be called before the attachments are used from other threads
+		 * 
+		 */
+		void load() noexcept;
+		/**
+		 * @return std::size_t Number of attachments, 0 until loaded
+		 */
+		[[nodiscard]] std::size_t count() const noexcept
+		{
+			return this->m_count;
+		}
+		[[nodiscard]] std::wstring_view name(std::size_t idx) const noexcept
+		{
+			return std::wstring_view(this->m_names).substr(this->m_nameStart[idx], this->m_nameStart[idx + 1] - this->m_nameStart[idx]);
+		}
+		/**
+		 * @return u64 Decoded length in bytes, s_cUnknownLength until the file is decoded
+		 */
+		[[nodiscard]] u64 length(std::size_t idx) const noexcept
+		{
+			return this->m_lengths[idx].load(std::memory_order_relaxed);
+		}
+
+		/**
+		 * @brief Writes an attachment to a file, takes the library lock while decoding. The
+		 * contents are decoded once if the length is known or the document states it truthfully,
+		 * otherwise the first decode only learns the length. The file is removed on failure,
+		 * also if it is longer than s_cMaxLength or can't be mapped, the contents are never
+		 * copied to the heap
+		 * 
+		 * @param idx Attachment index
+		 * @param path Output path
+		 * @param overwrite Replaces an existing file, otherwise an existing file fails the
+		 * extraction and is left alone
+		 * @return true Success
+		 */
+		bool extract(std::size_t idx, const std::wstring & path, bool overwrite) noexcept;
+		/**
+		 * @brief Writes several attachments on up to s_cMaxParallel threads, blocks until all
+		 * of them are written
+		 * 
+		 * @param jobs Attachments and their output paths
+		 * @param overwrite Replaces existing files, otherwise they count as not written
+		 * @param cancel Reference to cancellation flag, checked between attachments
+		 * @return std::size_t Number of attachments written
+		 */
+		std::size_t extract(const std::vector<JobT> & jobs, bool overwrite, const std::atomic<bool> & cancel) noexcept;
+		/**
+		 * @brief Makes a file name out of an attachment name, strips directories and
+		 * replaces characters that aren't allowed in file names
+		 * 
+		 * @param name Attachment name
+		 * @param idx Attachment index, used if nothing is left of the name
+		 * @return std::wstring File name
+		 */
+		[[nodiscard]] static std::wstring s_fileName(std::wstring_view name, std::size_t idx);
+
+		/**
+		 * @return std::size_t Approximate memory usage in bytes
+		 */
+		[[nodiscard]] std::size_t bytes() const noexcept;
+	};
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <memory>
+
+namespace pdfv
+{
+	/**
+	 * @brief Document handle shared between a loaded document and the helpers that read it
+	 * in the background. The owner detaches it once under the library lock before closing
+	 * the document, from then on every holder sees nullptr
+	 * 
+	 */
+	class BorrowedDoc
+	{
+	private:
+		/**
+		 * @brief Guarded by the library lock
+		 * 
+		 */
+		FPDF_DOCUMENT m_doc{ nullptr };
+
+	public:
+		explicit BorrowedDoc(FPDF_DOCUMENT doc) noexcept
+			: m_doc(doc)
+		{
+		}
+		BorrowedDoc(const BorrowedDoc & other) = delete;
+		BorrowedDoc(BorrowedDoc && other) noexcept = delete;
+		BorrowedDoc & operator=(const BorrowedDoc & other) = delete;
+		BorrowedDoc & operator=(BorrowedDoc && other) noexcept = delete;
+		~BorrowedDoc() noexcept = default;
+
+		/**
+		 * @return FPDF_DOCUMENT Document handle, nullptr once detached. Caller has to hold
+		 * the library lock
+		 */
+		[[nodiscard]] FPDF_DOCUMENT get() const noexcept
+		{
+			return this->m_doc;
+		}
+		/**
+		 * @brief Stops every holder from using the document handle, caller has to hold the
+		 * library lock
+		 * 
+		 */
+		void detach() noexcept
+		{
+			this->m_doc = nullptr;
+		}
+	};
+
+	/**
+	 * @brief Reference of a helper to the document it reads
+	 * 
+	 */
+	using DocRef = std::shared_ptr<const BorrowedDoc>;
+}
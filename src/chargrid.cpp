@@ -0,0 +1,205 @@
+#include "chargrid.hpp"
+#include "textlayer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+[[nodiscard]] pdfv::u32 pdfv::CharGrid::cellX(f32 x) const noexcept
+{
+	const auto c{ (x - this->m_left) * this->m_invCellW };
+	return c <= 0.0f ? 0 : std::min(u32(c), this->m_cols - 1);
+}
+[[nodiscard]] pdfv::u32 pdfv::CharGrid::cellY(f32 y) const noexcept
+{
+	const auto c{ (y - this->m_bottom) * this->m_invCellH };
+	return c <= 0.0f ? 0 : std::min(u32(c), this->m_rows - 1);
+}
+
+void pdfv::CharGrid::build(const TextLayer & layer)
+{
+	DEBUGPRINT("pdfv::CharGrid::build(%p)\n", static_cast<const void *>(&layer));
+
+	this->m_cellStart.clear();
+	this->m_items.clear();
+	this->m_cols = 0;
+	this->m_rows = 0;
+
+	const auto count{ layer.size() };
+	auto hasBox = [&layer](std::size_t i) noexcept
+	{
+		return layer.right[i] > layer.left[i] && layer.top[i] > layer.bottom[i];
+	};
+
+	// Bounds of all boxes, can exceed the page when text sticks out of it
+	f32 minX{ std::numeric_limits<f32>::max() }, minY{ std::numeric_limits<f32>::max() };
+	f32 maxX{ std::numeric_limits<f32>::lowest() }, maxY{ std::numeric_limits<f32>::lowest() };
+	std::size_t boxes{ 0 };
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (!hasBox(i))
+		{
+			continue;
+		}
+		minX = std::min(minX, layer.left[i]);
+		minY = std::min(minY, layer.bottom[i]);
+		maxX = std::max(maxX, layer.right[i]);
+		maxY = std::max(maxY, layer.top[i]);
+		++boxes;
+	}
+	if (boxes == 0)
+	{
+		return;
+	}
+
+	// Cells follow the aspect ratio of the bounds, so that they're roughly square
+	const auto width { std::max(maxX - minX, 1.0f) };
+	const auto height{ std::max(maxY - minY, 1.0f) };
+	const auto cells { f32(std::max(boxes / s_cCharsPerCell, std::size_t(1))) };
+	const auto cols  { std::sqrt(cells * width / height) };
+	this->m_cols = std::clamp(u32(std::ceil(cols)), u32(1), s_cMaxCells);
+	this->m_rows = std::clamp(u32(std::ceil(cells / std::max(cols, 1.0f))), u32(1), s_cMaxCells);
+
+	this->m_left     = minX;
+	this->m_bottom   = minY;
+	this->m_invCellW = f32(this->m_cols) / width;
+	this->m_invCellH = f32(this->m_rows) / height;
+
+	// Counting pass, prefix sum, then filling pass
+	this->m_cellStart.assign(std::size_t(this->m_cols) * this->m_rows + 1, 0);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (!hasBox(i))
+		{
+			continue;
+		}
+		const auto x0{ this->cellX(layer.left[i])   }, x1{ this->cellX(layer.right[i]) };
+		const auto y0{ this->cellY(layer.bottom[i]) }, y1{ this->cellY(layer.top[i])   };
+		for (auto y = y0; y <= y1; ++y)
+		{
+			for (auto x = x0; x <= x1; ++x)
+			{
+				++this->m_cellStart[std::size_t(y) * this->m_cols + x + 1];
+			}
+		}
+	}
+	for (std::size_t i = 1; i < this->m_cellStart.size(); ++i)
+	{
+		this->m_cellStart[i] += this->m_cellStart[i - 1];
+	}
+
+	this->m_items.resize(this->m_cellStart.back());
+	std::vector<u32> fill(this->m_cellStart.begin(), this->m_cellStart.end() - 1);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (!hasBox(i))
+		{
+			continue;
+		}
+		const auto x0{ this->cellX(layer.left[i])   }, x1{ this->cellX(layer.right[i]) };
+		const auto y0{ this->cellY(layer.bottom[i]) }, y1{ this->cellY(layer.top[i])   };
+		for (auto y = y0; y <= y1; ++y)
+		{
+			for (auto x = x0; x <= x1; ++x)
+			{
+				this->m_items[fill[std::size_t(y) * this->m_cols + x]++] = u32(i);
+			}
+		}
+	}
+}
+
+[[nodiscard]] std::size_t pdfv::CharGrid::bytes() const noexcept
+{
+	return (this->m_cellStart.capacity() + this->m_items.capacity()) * sizeof(u32);
+}
+
+[[nodiscard]] ssize_t pdfv::CharGrid::hitTest(const TextLayer & layer, f32 x, f32 y, f32 tolerance) const noexcept
+{
+	if (this->empty())
+	{
+		return s_cNoHit;
+	}
+
+	// Exact hit, only the cell of the point has to be visited
+	ssize_t best{ s_cNoHit };
+	auto bestArea{ std::numeric_limits<f32>::max() };
+	const auto cell{ std::size_t(this->cellY(y)) * this->m_cols + this->cellX(x) };
+	for (auto k{ this->m_cellStart[cell] }; k < this->m_cellStart[cell + 1]; ++k)
+	{
+		const auto i{ this->m_items[k] };
+		if (x >= layer.left[i] && x <= layer.right[i] && y >= layer.bottom[i] && y <= layer.top[i])
+		{
+			const auto area{ (layer.right[i] - layer.left[i]) * (layer.top[i] - layer.bottom[i]) };
+			if (area < bestArea)
+			{
+				bestArea = area;
+				best     = ssize_t(i);
+			}
+		}
+	}
+	if (best != s_cNoHit || tolerance <= 0.0f)
+	{
+		return best;
+	}
+
+	// Nearest box within tolerance
+	auto bestDist{ tolerance * tolerance };
+	const auto x0{ this->cellX(x - tolerance) }, x1{ this->cellX(x + tolerance) };
+	const auto y0{ this->cellY(y - tolerance) }, y1{ this->cellY(y + tolerance) };
+	for (auto cy = y0; cy <= y1; ++cy)
+	{
+		for (auto cx = x0; cx <= x1; ++cx)
+		{
+			const auto c{ std::size_t(cy) * this->m_cols + cx };
+			for (auto k{ this->m_cellStart[c] }; k < this->m_cellStart[c + 1]; ++k)
+			{
+				const auto i{ this->m_items[k] };
+				const auto dx{ std::max({ layer.left[i] - x, 0.0f, x - layer.right[i] }) };
+				const auto dy{ std::max({ layer.bottom[i] - y, 0.0f, y - layer.top[i] }) };
+				const auto dist{ dx * dx + dy * dy };
+				if (dist <= bestDist)
+				{
+					bestDist = dist;
+					best     = ssize_t(i);
+				}
+			}
+		}
+	}
+	return best;
+}
+void pdfv::CharGrid::query(
+	const TextLayer & layer, f32 left, f32 bottom, f32 right, f32 top,
+	std::vector<u32> & out
+) const
+{
+	out.clear();
+	if (this->empty() || right < left || top < bottom)
+	{
+		return;
+	}
+
+	const auto x0{ this->cellX(left)   }, x1{ this->cellX(right) };
+	const auto y0{ this->cellY(bottom) }, y1{ this->cellY(top)   };
+	for (auto cy = y0; cy <= y1; ++cy)
+	{
+		for (auto cx = x0; cx <= x1; ++cx)
+		{
+			const auto c{ std::size_t(cy) * this->m_cols + cx };
+			for (auto k{ this->m_cellStart[c] }; k < this->m_cellStart[c + 1]; ++k)
+			{
+				const auto i{ this->m_items[k] };
+				if (layer.right[i] < left || layer.left[i] > right || layer.top[i] < bottom || layer.bottom[i] > top)
+				{
+					continue;
+				}
+				// A box spanning several cells is reported only from the first visited cell it overlaps
+				if (std::max(this->cellX(layer.left[i]), x0) != cx || std::max(this->cellY(layer.bottom[i]), y0) != cy)
+				{
+					continue;
+				}
+				out.emplace_back(i);
+			}
+		}
+	}
+	std::sort(out.begin(), out.end());
+}
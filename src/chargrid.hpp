@@ -0,0 +1,89 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <vector>
+
+namespace pdfv
+{
+	struct TextLayer;
+
+	/**
+	 * @brief Uniform grid over the character boxes of a page. Each cell lists the characters
+	 * whose boxes overlap it, stored as one flat index array with per-cell offsets
+	 * 
+	 */
+	class CharGrid
+	{
+	public:
+		/**
+		 * @brief Targeted average number of characters per cell
+		 * 
+		 */
+		static constexpr std::size_t s_cCharsPerCell{ 4 };
+		static constexpr u32 s_cMaxCells{ 256 };
+
+		static constexpr ssize_t s_cNoHit{ -1 };
+
+	private:
+		f32 m_left{ 0.0f }, m_bottom{ 0.0f };
+		f32 m_invCellW{ 0.0f }, m_invCellH{ 0.0f };
+		u32 m_cols{ 0 }, m_rows{ 0 };
+		/**
+		 * @brief Offset of each cell in m_items, followed by the total item count
+		 * 
+		 */
+		std::vector<u32> m_cellStart;
+		std::vector<u32> m_items;
+
+		[[nodiscard]] u32 cellX(f32 x) const noexcept;
+		[[nodiscard]] u32 cellY(f32 y) const noexcept;
+
+	public:
+		/**
+		 * @brief Builds the grid from character boxes of a text layer, characters without
+		 * a box are left out
+		 * 
+		 * @param layer Text layer
+		 */
+		void build(const TextLayer & layer);
+
+		/**
+		 * @return true Grid contains no characters
+		 */
+		[[nodiscard]] bool empty() const noexcept
+		{
+			return this->m_items.empty();
+		}
+		/**
+		 * @return std::size_t Approximate memory usage in bytes, excluding the object itself
+		 */
+		[[nodiscard]] std::size_t bytes() const noexcept;
+
+		/**
+		 * @brief Finds the character at a point. Among overlapping boxes the smallest one
+		 * wins, if no box contains the point, the nearest one within tolerance is returned
+		 * 
+		 * @param layer Text layer the grid was built from
+		 * @param x Horizontal page coordinate
+		 * @param y Vertical page coordinate
+		 * @param tolerance Maximum distance to the nearest box
+		 * @return ssize_t Character index, s_cNoHit if there is none
+		 */
+		[[nodiscard]] ssize_t hitTest(const TextLayer & layer, f32 x, f32 y, f32 tolerance = 0.0f) const noexcept;
+		/**
+		 * @brief Finds all characters, whose boxes intersect a rectangle
+		 * 
+		 * @param layer Text layer the grid was built from
+		 * @param left Left edge of the rectangle
+		 * @param bottom Bottom edge of the rectangle
+		 * @param right Right edge of the rectangle
+		 * @param top Top edge of the rectangle
+		 * @param out Reference to vector, receives ascending character indices
+		 */
+		void query(
+			const TextLayer & layer, f32 left, f32 bottom, f32 right, f32 top,
+			std::vector<u32> & out
+		) const;
+	};
+}
@@ -0,0 +1,128 @@
+#include "extract.hpp"
+#include "../utf.hpp"
+
+#include <fpdfview.h>
+#include <fpdf_text.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace pdfv::cli
+{
+	/**
+	 * @brief Appends UTF-16 text as UTF-8, unpaired surrogates become U+FFFD, line breaks
+	 * are normalised to LF
+	 * 
+	 */
+	static void appendUtf8(const unsigned short * text, std::size_t length, std::string & out)
+	{
+		const auto start{ out.size() };
+		out.resize(start + utf::maxUtf8(length));
+		auto end{ out.data() + start + utf::toUtf8(text, length, out.data() + start, out.size() - start).written };
+
+		// Drop CR of every CRLF pair in place
+		auto dst{ out.data() + start };
+		for (auto src{ dst }; src != end;)
+		{
+			auto cr{ static_cast<char *>(std::memchr(src, '\r', std::size_t(end - src))) };
+			if (cr == nullptr)
+			{
+				cr = end;
+			}
+			std::memmove(dst, src, std::size_t(cr - src));
+			dst += cr - src;
+			src  = cr;
+			if (src != end)
+			{
+				if (src + 1 == end || src[1] != '\n')
+				{
+					*dst++ = '\r';
+				}
+				++src;
+			}
+		}
+		out.resize(std::size_t(dst - out.data()));
+	}
+}
+
+void pdfv::cli::Extractor::s_init() noexcept
+{
+	FPDF_LIBRARY_CONFIG config{};
+	config.version = 2;
+	FPDF_InitLibraryWithConfig(&config);
+}
+void pdfv::cli::Extractor::s_destroy() noexcept
+{
+	FPDF_DestroyLibrary();
+}
+[[nodiscard]] const char * pdfv::cli::Extractor::s_errorText(unsigned long err) noexcept
+{
+	switch (err)
+	{
+	case FPDF_ERR_FILE:
+		return "file not found or could not be opened";
+	case FPDF_ERR_FORMAT:
+		return "not a PDF or corrupted";
+	case FPDF_ERR_PASSWORD:
+		return "password required or incorrect password";
+	case FPDF_ERR_SECURITY:
+		return "unsupported security scheme";
+	case FPDF_ERR_PAGE:
+		return "page not found or content error";
+	default:
+		return "unknown error";
+	}
+}
+
+pdfv::cli::Extractor::Extractor(std::string password)
+	: m_password(std::move(password))
+{
+}
+
+pdfv::cli::Extractor::Result pdfv::cli::Extractor::extract(const std::string & path, const PageSink & sink)
+{
+	Result result;
+
+	// Document is read on demand, never loaded into memory as a whole
+	auto doc{ FPDF_LoadDocument(path.c_str(), this->m_password.empty() ? nullptr : this->m_password.c_str()) };
+	if (doc == nullptr)
+	{
+		result.error = s_errorText(FPDF_GetLastError());
+		return result;
+	}
+
+	const auto numPages{ std::size_t(std::max(FPDF_GetPageCount(doc), 0)) };
+	for (std::size_t i = 0; i < numPages; ++i)
+	{
+		this->m_utf8.clear();
+
+		auto page{ FPDF_LoadPage(doc, int(i)) };
+		if (page == nullptr)
+		{
+			// Damaged page, keep the numbering of the rest
+			if (!sink(i + 1, numPages, this->m_utf8))
+			{
+				break;
+			}
+			continue;
+		}
+		if (auto text{ FPDFText_LoadPage(page) }; text != nullptr)
+		{
+			const auto count{ std::max(FPDFText_CountChars(text), 0) };
+			this->m_utf16.resize(std::size_t(count) + 1);
+			const auto written{ std::max(FPDFText_GetText(text, 0, count, this->m_utf16.data()) - 1, 0) };
+			appendUtf8(this->m_utf16.data(), std::size_t(written), this->m_utf8);
+			FPDFText_ClosePage(text);
+		}
+		FPDF_ClosePage(page);
+
+		++result.pages;
+		if (!sink(i + 1, numPages, this->m_utf8))
+		{
+			break;
+		}
+	}
+
+	FPDF_CloseDocument(doc);
+	return result;
+}
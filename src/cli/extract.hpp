@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pdfv::cli
+{
+	/**
+	 * @brief Extracts text of documents page by page, only one page is held in memory
+	 * at a time
+	 * 
+	 */
+	class Extractor
+	{
+	public:
+		/**
+		 * @brief Receives text of a single page
+		 * 
+		 * @param page Page number, starting from 1
+		 * @param numPages Page count of the document
+		 * @param text UTF-8 text of the page
+		 * @return true Continue with the next page
+		 */
+		using PageSink = std::function<bool(std::size_t page, std::size_t numPages, std::string_view text)>;
+
+		struct Result
+		{
+			std::size_t pages{ 0 };
+			/**
+			 * @brief Error description, empty on success
+			 * 
+			 */
+			std::string error;
+		};
+
+	private:
+		std::string m_password;
+		std::vector<unsigned short> m_utf16;
+		std::string m_utf8;
+
+	public:
+		/**
+		 * @brief Initialises the library, once per process
+		 * 
+		 */
+		static void s_init() noexcept;
+		static void s_destroy() noexcept;
+		/**
+		 * @return const char * Description of a library error code
+		 */
+		[[nodiscard]] static const char * s_errorText(unsigned long err) noexcept;
+
+		/**
+		 * @param password Password used for encrypted documents, UTF-8 or Latin-1
+		 */
+		explicit Extractor(std::string password = {});
+
+		/**
+		 * @brief Extracts all pages of a document
+		 * 
+		 * @param path UTF-8 path of the document
+		 * @param sink Page receiver
+		 * @return Result Number of pages extracted and error description
+		 */
+		Result extract(const std::string & path, const PageSink & sink);
+	};
+}
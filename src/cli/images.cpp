@@ -0,0 +1,279 @@
+#include "images.hpp"
+#include "extract.hpp"
+#include "platform.hpp"
+
+#include <fpdf_edit.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace pdfv::cli
+{
+	/**
+	 * @brief Nesting limit of forms, guards against self-referencing forms
+	 * 
+	 */
+	static constexpr int s_cMaxFormDepth{ 32 };
+
+	/**
+	 * @brief Writes a buffer to a new file
+	 * 
+	 * @return true Success, a partially written file is removed
+	 */
+	[[nodiscard]] static bool writeFile(const std::string & path, const void * data, std::size_t size) noexcept
+	{
+		auto file{ openFile(path, "wb") };
+		if (file == nullptr)
+		{
+			return false;
+		}
+		const bool ok{ std::fwrite(data, 1, size, file) == size };
+		if (std::fclose(file) != 0 || !ok)
+		{
+			std::remove(path.c_str());
+			return false;
+		}
+		return true;
+	}
+	/**
+	 * @brief JPEG 2000 streams are either JP2 files or bare codestreams
+	 * 
+	 */
+	[[nodiscard]] static const char * jpxExtension(const unsigned char * data, std::size_t size) noexcept
+	{
+		constexpr unsigned char codestream[]{ 0xFF, 0x4F, 0xFF, 0x51 };
+		return (size >= sizeof codestream && std::memcmp(data, codestream, sizeof codestream) == 0) ? ".j2k" : ".jp2";
+	}
+}
+
+pdfv::cli::ImageExtractor::ImageExtractor(std::string password)
+	: m_password(std::move(password))
+{
+}
+pdfv::cli::ImageExtractor::~ImageExtractor() noexcept
+{
+	this->close();
+}
+
+const char * pdfv::cli::ImageExtractor::open(const std::string & path) noexcept
+{
+	if (this->m_doc != nullptr && this->m_path == path)
+	{
+		return nullptr;
+	}
+	this->close();
+	this->m_doc = FPDF_LoadDocument(path.c_str(), this->m_password.empty() ? nullptr : this->m_password.c_str());
+	if (this->m_doc == nullptr)
+	{
+		return Extractor::s_errorText(FPDF_GetLastError());
+	}
+	try
+	{
+		this->m_path = path;
+	}
+	catch (...)
+	{
+		this->close();
+		return "out of memory";
+	}
+	return nullptr;
+}
+void pdfv::cli::ImageExtractor::close() noexcept
+{
+	if (this->m_doc != nullptr)
+	{
+		FPDF_CloseDocument(this->m_doc);
+		this->m_doc = nullptr;
+	}
+	this->m_path.clear();
+}
+
+bool pdfv::cli::ImageExtractor::writeRaw(FPDF_PAGEOBJECT obj, const std::string & prefix, Result & result)
+{
+	// Anything stacked on top of the image codec has to be decoded anyway
+	if (FPDFImageObj_GetImageFilterCount(obj) != 1)
+	{
+		return false;
+	}
+	char filter[16]{};
+	if (FPDFImageObj_GetImageFilter(obj, 0, filter, sizeof filter) > sizeof filter)
+	{
+		return false;
+	}
+	const std::string_view name{ filter };
+	const bool jpeg{ name == "DCTDecode" };
+	if (!jpeg && name != "JPXDecode")
+	{
+		return false;
+	}
+
+	const auto size{ FPDFImageObj_GetImageDataRaw(obj, nullptr, 0) };
+	if (size == 0)
+	{
+		return false;
+	}
+	if (this->m_buf.size() < size)
+	{
+		this->m_buf.resize(size);
+	}
+	if (FPDFImageObj_GetImageDataRaw(obj, this->m_buf.data(), size) != size) [[unlikely]]
+	{
+		return false;
+	}
+
+	const auto path{ prefix + (jpeg ? ".jpg" : jpxExtension(this->m_buf.data(), size)) };
+	if (!writeFile(path, this->m_buf.data(), size))
+	{
+		return false;
+	}
+	++result.raw;
+	result.bytes += size;
+	return true;
+}
+bool pdfv::cli::ImageExtractor::writeDecoded(FPDF_PAGEOBJECT obj, const std::string & prefix, Result & result)
+{
+	auto bmp{ FPDFImageObj_GetBitmap(obj) };
+	if (bmp == nullptr)
+	{
+		return false;
+	}
+	const auto format{ FPDFBitmap_GetFormat(bmp) };
+	const auto width{ std::size_t(std::max(FPDFBitmap_GetWidth(bmp), 0)) };
+	const auto height{ std::size_t(std::max(FPDFBitmap_GetHeight(bmp), 0)) };
+	const auto stride{ std::size_t(std::max(FPDFBitmap_GetStride(bmp), 0)) };
+	const auto src{ static_cast<const unsigned char *>(FPDFBitmap_GetBuffer(bmp)) };
+	const std::size_t bpp{ (format == FPDFBitmap_Gray) ? 1U : (format == FPDFBitmap_BGR) ? 3U : (format == FPDFBitmap_BGRx || format == FPDFBitmap_BGRA) ? 4U : 0U };
+	if (src == nullptr || bpp == 0 || width == 0 || height == 0) [[unlikely]]
+	{
+		FPDFBitmap_Destroy(bmp);
+		return false;
+	}
+
+	// Greyscale stays single channel, colour is reordered to RGB, alpha is dropped
+	const std::size_t channels{ (bpp == 1) ? 1U : 3U };
+	char header[48]{};
+	const auto headerLen{ std::size_t(std::snprintf(header, sizeof header, "P%c\n%zu %zu\n255\n", (channels == 1) ? '5' : '6', width, height)) };
+	const auto size{ headerLen + width * height * channels };
+	if (this->m_buf.size() < size)
+	{
+		this->m_buf.resize(size);
+	}
+	std::memcpy(this->m_buf.data(), header, headerLen);
+	auto out{ this->m_buf.data() + headerLen };
+	for (std::size_t y = 0; y < height; ++y)
+	{
+		auto in{ src + y * stride };
+		if (channels == 1)
+		{
+			std::memcpy(out, in, width);
+			out += width;
+			continue;
+		}
+		for (std::size_t x = 0; x < width; ++x, in += bpp)
+		{
+			*out++ = in[2];
+			*out++ = in[1];
+			*out++ = in[0];
+		}
+	}
+	FPDFBitmap_Destroy(bmp);
+
+	if (!writeFile(prefix + ((channels == 1) ? ".pgm" : ".ppm"), this->m_buf.data(), size))
+	{
+		return false;
+	}
+	result.bytes += size;
+	return true;
+}
+void pdfv::cli::ImageExtractor::writeObject(FPDF_PAGEOBJECT obj, const std::string & prefix, std::size_t & num, Result & result)
+{
+	// Forms are walked with an explicit stack, images are numbered in content order
+	std::vector<std::pair<FPDF_PAGEOBJECT, int>> forms;
+	auto visit{ [&](FPDF_PAGEOBJECT cur)
+	{
+		switch (FPDFPageObj_GetType(cur))
+		{
+		case FPDF_PAGEOBJ_IMAGE:
+		{
+			const auto name{ prefix + '_' + std::to_string(num + 1) };
+			if (this->writeRaw(cur, name, result) || this->writeDecoded(cur, name, result))
+			{
+				++num;
+				++result.images;
+			}
+			else
+			{
+				++result.skipped;
+			}
+			break;
+		}
+		case FPDF_PAGEOBJ_FORM:
+			if (forms.size() < std::size_t(s_cMaxFormDepth))
+			{
+				forms.emplace_back(cur, 0);
+			}
+			break;
+		}
+	} };
+
+	visit(obj);
+	while (!forms.empty())
+	{
+		auto & [form, idx]{ forms.back() };
+		if (idx >= FPDFFormObj_CountObjects(form))
+		{
+			forms.pop_back();
+			continue;
+		}
+		// Visiting may grow the stack, the child is fetched first
+		auto child{ FPDFFormObj_GetObject(form, static_cast<unsigned long>(idx++)) };
+		visit(child);
+	}
+}
+
+std::size_t pdfv::cli::ImageExtractor::pageCount(const std::string & path, std::string & error)
+{
+	if (auto err{ this->open(path) }; err != nullptr)
+	{
+		error = err;
+		return 0;
+	}
+	return std::size_t(std::max(FPDF_GetPageCount(this->m_doc), 0));
+}
+pdfv::cli::ImageExtractor::Result pdfv::cli::ImageExtractor::extract(
+	const std::string & path, std::size_t first, std::size_t last, const std::string & prefix
+)
+{
+	Result result;
+	if (auto err{ this->open(path) }; err != nullptr)
+	{
+		result.error = err;
+		return result;
+	}
+
+	last = std::min(last, std::size_t(std::max(FPDF_GetPageCount(this->m_doc), 0)));
+	char pageName[24]{};
+	for (auto i{ std::max<std::size_t>(first, 1) }; i <= last; ++i)
+	{
+		auto page{ FPDF_LoadPage(this->m_doc, int(i - 1)) };
+		if (page == nullptr)
+		{
+			// Damaged page, keep going with the rest of the range
+			result.error = "page " + std::to_string(i) + ": " + Extractor::s_errorText(FPDF_ERR_PAGE);
+			continue;
+		}
+		std::snprintf(pageName, sizeof pageName, "p%05zu", i);
+		const auto pagePrefix{ prefix + pageName };
+
+		std::size_t num{ 0 };
+		const auto count{ std::max(FPDFPage_CountObjects(page), 0) };
+		for (int j = 0; j < count; ++j)
+		{
+			this->writeObject(FPDFPage_GetObject(page, j), pagePrefix, num, result);
+		}
+		FPDF_ClosePage(page);
+		++result.pages;
+	}
+	return result;
+}
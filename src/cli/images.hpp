@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fpdfview.h>
+
+namespace pdfv::cli
+{
+	/**
+	 * @brief Writes images of page ranges to files. JPEG and JPEG 2000 streams are copied
+	 * byte for byte as they are stored in the document, other images are decoded and written
+	 * as PNM. The last document stays open, so consecutive ranges of it don't parse it again
+	 * 
+	 */
+	class ImageExtractor
+	{
+	public:
+		struct Result
+		{
+			std::size_t pages{ 0 };
+			std::size_t images{ 0 };
+			/**
+			 * @brief Images copied without decoding
+			 * 
+			 */
+			std::size_t raw{ 0 };
+			/**
+			 * @brief Images in formats that can't be written or that failed to write
+			 * 
+			 */
+			std::size_t skipped{ 0 };
+			std::uint64_t bytes{ 0 };
+			/**
+			 * @brief Error description, empty on success
+			 * 
+			 */
+			std::string error;
+		};
+
+	private:
+		std::string m_password;
+		std::string m_path;
+		FPDF_DOCUMENT m_doc{ nullptr };
+		std::vector<unsigned char> m_buf;
+
+		/**
+		 * @brief Opens a document unless it is already open
+		 * 
+		 * @return const char * Error description, nullptr on success
+		 */
+		const char * open(const std::string & path) noexcept;
+		/**
+		 * @brief Writes an image object, images inside forms are written too
+		 * 
+		 * @param obj Page object, ignored if it isn't an image or a form
+		 * @param prefix Output path without image number and extension
+		 * @param num Reference to number of images written of the page
+		 * @param result Reference to running result
+		 */
+		void writeObject(FPDF_PAGEOBJECT obj, const std::string & prefix, std::size_t & num, Result & result);
+		/**
+		 * @brief Copies the stored stream of a JPEG or JPEG 2000 image
+		 * 
+		 * @return true Image was written, false if it has other filters or writing failed
+		 */
+		bool writeRaw(FPDF_PAGEOBJECT obj, const std::string & prefix, Result & result);
+		/**
+		 * @brief Decodes an image and writes it as PGM or PPM
+		 * 
+		 * @return true Image was written
+		 */
+		bool writeDecoded(FPDF_PAGEOBJECT obj, const std::string & prefix, Result & result);
+
+	public:
+		/**
+		 * @param password Password used for encrypted documents, UTF-8 or Latin-1
+		 */
+		explicit ImageExtractor(std::string password = {});
+		ImageExtractor(const ImageExtractor & other) = delete;
+		ImageExtractor(ImageExtractor && other) noexcept = delete;
+		ImageExtractor & operator=(const ImageExtractor & other) = delete;
+		ImageExtractor & operator=(ImageExtractor && other) noexcept = delete;
+		~ImageExtractor() noexcept;
+
+		/**
+		 * @brief Counts pages of a document without loading any of them
+		 * 
+		 * @param path UTF-8 path of the document
+		 * @param error Reference to error description, set on failure
+		 * @return std::size_t Page count, 0 on failure
+		 */
+		std::size_t pageCount(const std::string & path, std::string & error);
+		/**
+		 * @brief Writes images of a page range to "<prefix>p<page>_<n>.<ext>"
+		 * 
+		 * @param path UTF-8 path of the document
+		 * @param first First page, starting from 1
+		 * @param last Last page, inclusive
+		 * @param prefix Output path prefix
+		 * @return Result Number of pages and images written and error description
+		 */
+		Result extract(const std::string & path, std::size_t first, std::size_t last, const std::string & prefix);
+		/**
+		 * @brief Closes the open document
+		 * 
+		 */
+		void close() noexcept;
+	};
+}
@@ -0,0 +1,246 @@
+#include "extract.hpp"
+#include "tool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+
+namespace pdfv::cli
+{
+	static constexpr const char * s_cName{ "pdftext" };
+
+	static constexpr const char * s_cUsage{
+		"Usage: pdftext [options] [files...]\n"
+		"Extracts UTF-8 text of PDF documents page by page.\n\n"
+		"  -l FILE  Read document paths from FILE, one per line, \"-\" for standard input\n"
+		"  -o DIR   Write every document to DIR/<n>_<name>.txt, pages are separated\n"
+		"           by form feeds. Without it pages are written to standard output,\n"
+		"           each preceded by a form feed and a \"<path>\\t<page>/<pages>\" line\n"
+		"  -j N     Number of worker processes, number of CPUs by default\n"
+		"  -p PASS  Password for encrypted documents\n"
+		"  -h       Show this help\n"
+	};
+
+	struct Stats
+	{
+		std::atomic<std::size_t> docs{ 0 }, failed{ 0 }, pages{ 0 };
+	};
+
+	/**
+	 * @brief Receives finished chunks of output, page records or document results
+	 * 
+	 */
+	using Emit = std::function<void(std::string_view)>;
+
+	[[nodiscard]] static std::string pageRecord(std::string_view path, std::size_t page, std::size_t numPages, std::string_view text)
+	{
+		std::string record;
+		record.reserve(path.size() + text.size() + 32);
+		record.push_back('\f');
+		record.append(path);
+		record += '\t' + std::to_string(page) + '/' + std::to_string(numPages) + '\n';
+		record.append(text);
+		if (record.back() != '\n')
+		{
+			record.push_back('\n');
+		}
+		return record;
+	}
+
+	/**
+	 * @brief Extracts a single document, either into its own file or as page records
+	 * 
+	 * @param extractor Extractor of the process
+	 * @param outDir Output directory, empty for page records
+	 * @param index Position of the document in the list, starting from 1
+	 * @param path Document path
+	 * @param emit Page record receiver
+	 * @return Extractor::Result Result of the extraction
+	 */
+	static Extractor::Result processDocument(
+		Extractor & extractor, const std::string & outDir,
+		std::size_t index, const std::string & path, const Emit & emit
+	)
+	{
+		if (outDir.empty())
+		{
+			return extractor.extract(path, [&path, &emit](std::size_t page, std::size_t numPages, std::string_view text)
+			{
+				emit(pageRecord(path, page, numPages, text));
+				return true;
+			});
+		}
+
+		const auto outPath{ outputPath(outDir, index, path) + ".txt" };
+		auto file{ openFile(outPath, "wb") };
+		if (file == nullptr)
+		{
+			return { .pages = 0, .error = "cannot create " + outPath };
+		}
+		bool writeFailed{ false };
+		auto result{ extractor.extract(path, [file, &writeFailed](std::size_t, std::size_t, std::string_view text)
+		{
+			writeFailed = std::fwrite(text.data(), 1, text.size(), file) != text.size() || std::fputc('\f', file) == EOF;
+			return !writeFailed;
+		}) };
+		if (std::fclose(file) != 0 || writeFailed)
+		{
+			result.error = "cannot write " + outPath;
+		}
+		return result;
+	}
+
+	static void report(const Stats & stats, std::chrono::steady_clock::time_point start, bool final)
+	{
+		const auto secs{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+		const auto pages{ stats.pages.load() };
+		std::fprintf(
+			stderr, "%s: %s%zu document(s), %zu failed, %zu page(s) in %.2f s, %.1f pages/s\n",
+			s_cName, final ? "" : "progress: ",
+			stats.docs.load(), stats.failed.load(), pages, secs, secs > 0.0 ? double(pages) / secs : 0.0
+		);
+	}
+	static void account(Stats & stats, const std::string & path, const Extractor::Result & result)
+	{
+		++stats.docs;
+		stats.pages += result.pages;
+		if (!result.error.empty())
+		{
+			++stats.failed;
+			std::fprintf(stderr, "%s: %s: %s\n", s_cName, path.c_str(), result.error.c_str());
+		}
+	}
+
+	/**
+	 * @brief Entry point of a worker process. Reads "<index>\t<path>" lines from standard
+	 * input. Writes frames to standard output: "T <length>\n<page record>" and, after every
+	 * document, "D <pages> <length>\n<error>"
+	 * 
+	 */
+	static int runWorker(const Options & opts)
+	{
+		Extractor::s_init();
+		Extractor extractor{ opts.password };
+		for (std::string line; std::getline(std::cin, line);)
+		{
+			auto tab{ line.find('\t') };
+			if (tab == std::string::npos)
+			{
+				continue;
+			}
+			std::size_t index{ 0 };
+			std::from_chars(line.data(), line.data() + tab, index);
+			const auto path{ line.substr(tab + 1) };
+
+			auto result{ processDocument(extractor, opts.outDir, index, path, [](std::string_view record)
+			{
+				writeFrame('T', {}, record);
+			}) };
+			writeFrame('D', { result.pages }, result.error);
+		}
+		Extractor::s_destroy();
+		return 0;
+	}
+
+	/**
+	 * @brief Hands documents one by one to a worker process, forwards its page records
+	 * 
+	 */
+	static void driveWorker(
+		Child & child, const Options & opts, std::atomic<std::size_t> & next,
+		Stats & stats, std::mutex & outMutex
+	)
+	{
+		std::size_t current{ 0 };
+		auto feed{ [&]
+		{
+			current = next++;
+			if (current >= opts.files.size())
+			{
+				child.closeInput();
+				return false;
+			}
+			return child.write(std::to_string(current + 1) + '\t' + opts.files[current] + '\n');
+		} };
+		if (!feed())
+		{
+			child.closeInput();
+			return;
+		}
+
+		readFrames(child, [&](const Frame & frame)
+		{
+			if (frame.type == 'T')
+			{
+				std::lock_guard lock{ outMutex };
+				std::fwrite(frame.payload.data(), 1, frame.payload.size(), stdout);
+			}
+			else if (frame.type == 'D')
+			{
+				const auto pages{ (frame.numValues > 0) ? std::size_t(frame.values[0]) : 0 };
+				account(stats, opts.files[current], { .pages = pages, .error = std::string(frame.payload) });
+				feed();
+			}
+		});
+
+		// Worker died, the document it was working on is lost
+		if (current < opts.files.size())
+		{
+			account(stats, opts.files[current], { .pages = 0, .error = "worker process failed" });
+		}
+	}
+
+	static int run(Options & opts, const char * argv0)
+	{
+		opts.jobs = unsigned(std::min<std::size_t>(opts.jobs, opts.files.size()));
+
+		Stats stats;
+		const auto start{ std::chrono::steady_clock::now() };
+		Progress progress{ [&stats, start] { report(stats, start, false); } };
+
+		if (opts.jobs <= 1)
+		{
+			// No point in a worker process for a single runner
+			Extractor::s_init();
+			Extractor extractor{ opts.password };
+			for (std::size_t i = 0; i < opts.files.size(); ++i)
+			{
+				auto result{ processDocument(extractor, opts.outDir, i + 1, opts.files[i], [](std::string_view record)
+				{
+					std::fwrite(record.data(), 1, record.size(), stdout);
+				}) };
+				account(stats, opts.files[i], result);
+			}
+			Extractor::s_destroy();
+		}
+		else
+		{
+			std::atomic<std::size_t> next{ 0 };
+			std::mutex outMutex;
+			runWorkers(s_cName, argv0, opts, [&](Child & child)
+			{
+				driveWorker(child, opts, next, stats, outMutex);
+			});
+		}
+		std::fflush(stdout);
+		progress.stop();
+
+		report(stats, start, true);
+		return (stats.failed > 0 || stats.docs < opts.files.size()) ? 1 : 0;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	const pdfv::cli::Tool tool{
+		.name   = pdfv::cli::s_cName,
+		.usage  = pdfv::cli::s_cUsage,
+		.worker = pdfv::cli::runWorker,
+		.run    = pdfv::cli::run
+	};
+	return pdfv::cli::runTool(tool, argc, argv);
+}
@@ -0,0 +1,281 @@
+#include "extract.hpp"
+#include "images.hpp"
+#include "tool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+
+namespace pdfv::cli
+{
+	static constexpr const char * s_cName{ "pdfimages" };
+	/**
+	 * @brief Pages handed to a worker at once, small enough to balance a single large document
+	 * 
+	 */
+	static constexpr std::size_t s_cPagesPerJob{ 8 };
+
+	static constexpr const char * s_cUsage{
+		"Usage: pdfimages [options] [files...]\n"
+		"Writes images of PDF documents to DIR/<n>_<name>_p<page>_<i>.<ext>.\n"
+		"JPEG and JPEG 2000 images are copied as stored (.jpg, .jp2, .j2k),\n"
+		"other images are decoded to .pgm or .ppm.\n\n"
+		"  -l FILE  Read document paths from FILE, one per line, \"-\" for standard input\n"
+		"  -o DIR   Output directory, the current directory by default\n"
+		"  -j N     Number of worker processes, number of CPUs by default\n"
+		"  -p PASS  Password for encrypted documents\n"
+		"  -h       Show this help\n"
+	};
+
+	struct Stats
+	{
+		std::atomic<std::size_t> docs{ 0 }, failed{ 0 }, pages{ 0 }, images{ 0 }, raw{ 0 }, skipped{ 0 };
+		std::atomic<std::uint64_t> bytes{ 0 };
+	};
+
+	/**
+	 * @brief Page range of a document
+	 * 
+	 */
+	struct Job
+	{
+		std::size_t doc{ 0 };
+		std::size_t first{ 0 }, last{ 0 };
+	};
+
+	/**
+	 * @brief Splits documents into page ranges as workers ask for them, a document is
+	 * opened only when its turn comes
+	 * 
+	 */
+	class JobQueue
+	{
+	private:
+		const Options & m_opts;
+		Stats & m_stats;
+		ImageExtractor m_counter;
+		std::mutex m_mutex;
+		std::size_t m_doc{ 0 };
+		std::size_t m_nextPage{ 1 }, m_numPages{ 0 };
+
+	public:
+		JobQueue(const Options & opts, Stats & stats)
+			: m_opts(opts), m_stats(stats), m_counter(opts.password)
+		{
+		}
+
+		/**
+		 * @return true Job was taken, false if there are no more
+		 */
+		bool next(Job & job)
+		{
+			std::lock_guard lock{ this->m_mutex };
+			while (this->m_nextPage > this->m_numPages)
+			{
+				if (this->m_doc >= this->m_opts.files.size())
+				{
+					this->m_counter.close();
+					return false;
+				}
+				if (this->m_numPages > 0)
+				{
+					++this->m_doc;
+				}
+				if (this->m_doc >= this->m_opts.files.size())
+				{
+					continue;
+				}
+
+				const auto & path{ this->m_opts.files[this->m_doc] };
+				std::string error;
+				this->m_nextPage = 1;
+				this->m_numPages = this->m_counter.pageCount(path, error);
+				this->m_counter.close();
+				++this->m_stats.docs;
+				if (!error.empty())
+				{
+					++this->m_stats.failed;
+					std::fprintf(stderr, "%s: %s: %s\n", s_cName, path.c_str(), error.c_str());
+				}
+				if (this->m_numPages == 0)
+				{
+					// Move past empty and broken documents
+					++this->m_doc;
+				}
+			}
+			job.doc   = this->m_doc;
+			job.first = this->m_nextPage;
+			job.last  = std::min(this->m_nextPage + s_cPagesPerJob - 1, this->m_numPages);
+			this->m_nextPage = job.last + 1;
+			return true;
+		}
+	};
+
+	[[nodiscard]] static std::string outputPrefix(const std::string & dir, std::size_t index, std::string_view path)
+	{
+		return outputPath(dir, index, path) + '_';
+	}
+
+	static void report(const Stats & stats, std::chrono::steady_clock::time_point start, bool final)
+	{
+		const auto secs{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+		const auto images{ stats.images.load() };
+		const auto mib{ double(stats.bytes.load()) / (1024.0 * 1024.0) };
+		std::fprintf(
+			stderr, "%s: %s%zu document(s), %zu failed, %zu page(s), %zu image(s) (%zu copied, %zu skipped), "
+			"%.1f MiB in %.2f s, %.1f images/s, %.1f MiB/s\n",
+			s_cName, final ? "" : "progress: ",
+			stats.docs.load(), stats.failed.load(), stats.pages.load(), images, stats.raw.load(), stats.skipped.load(),
+			mib, secs, secs > 0.0 ? double(images) / secs : 0.0, secs > 0.0 ? mib / secs : 0.0
+		);
+	}
+	static void account(Stats & stats, const std::string & path, const Job & job, const ImageExtractor::Result & result)
+	{
+		stats.pages   += result.pages;
+		stats.images  += result.images;
+		stats.raw     += result.raw;
+		stats.skipped += result.skipped;
+		stats.bytes   += result.bytes;
+		if (!result.error.empty())
+		{
+			++stats.failed;
+			std::fprintf(stderr, "%s: %s (pages %zu-%zu): %s\n", s_cName, path.c_str(), job.first, job.last, result.error.c_str());
+		}
+	}
+
+	/**
+	 * @brief Entry point of a worker process. Reads "<index>\t<first>\t<last>\t<path>" lines
+	 * from standard input. Writes a frame "D <pages> <images> <raw> <skipped> <bytes> <length>\n<error>"
+	 * to standard output after every page range
+	 * 
+	 */
+	static int runWorker(const Options & opts)
+	{
+		Extractor::s_init();
+		{
+			ImageExtractor extractor{ opts.password };
+			for (std::string line; std::getline(std::cin, line);)
+			{
+				std::size_t fields[3]{};
+				const char * ptr{ line.data() }, * end{ line.data() + line.size() };
+				for (auto & field : fields)
+				{
+					ptr = std::from_chars(ptr, end, field).ptr;
+					ptr += (ptr != end && *ptr == '\t') ? 1 : 0;
+				}
+				const std::string path(ptr, end);
+
+				auto result{ extractor.extract(path, fields[1], fields[2], outputPrefix(opts.outDir, fields[0], path)) };
+				writeFrame('D', { result.pages, result.images, result.raw, result.skipped, result.bytes }, result.error);
+			}
+		}
+		Extractor::s_destroy();
+		return 0;
+	}
+
+	/**
+	 * @brief Hands page ranges one by one to a worker process, collects its results
+	 * 
+	 */
+	static void driveWorker(Child & child, const Options & opts, JobQueue & queue, Stats & stats)
+	{
+		Job job;
+		bool busy{ false };
+		auto feed{ [&]
+		{
+			busy = queue.next(job);
+			if (!busy)
+			{
+				child.closeInput();
+				return false;
+			}
+			return child.write(
+				std::to_string(job.doc + 1) + '\t' + std::to_string(job.first) + '\t' +
+				std::to_string(job.last) + '\t' + opts.files[job.doc] + '\n'
+			);
+		} };
+		if (!feed())
+		{
+			child.closeInput();
+			if (busy)
+			{
+				account(stats, opts.files[job.doc], job, { .error = "worker process failed" });
+			}
+			return;
+		}
+
+		readFrames(child, [&](const Frame & frame)
+		{
+			if (frame.type != 'D' || frame.numValues < 5)
+			{
+				return;
+			}
+			const ImageExtractor::Result result{
+				.pages   = std::size_t(frame.values[0]),
+				.images  = std::size_t(frame.values[1]),
+				.raw     = std::size_t(frame.values[2]),
+				.skipped = std::size_t(frame.values[3]),
+				.bytes   = frame.values[4],
+				.error   = std::string(frame.payload)
+			};
+			account(stats, opts.files[job.doc], job, result);
+			feed();
+		});
+
+		// Worker died, the pages it was working on are lost
+		if (busy)
+		{
+			account(stats, opts.files[job.doc], job, { .error = "worker process failed" });
+		}
+	}
+
+	static int run(Options & opts, const char * argv0)
+	{
+		Stats stats;
+		const auto start{ std::chrono::steady_clock::now() };
+		Progress progress{ [&stats, start] { report(stats, start, false); } };
+
+		// Parent only counts pages, workers share the pages of every document
+		Extractor::s_init();
+		{
+			JobQueue queue{ opts, stats };
+			if (opts.jobs <= 1)
+			{
+				// No point in a worker process for a single runner
+				ImageExtractor extractor{ opts.password };
+				for (Job job; queue.next(job);)
+				{
+					const auto & path{ opts.files[job.doc] };
+					account(stats, path, job, extractor.extract(path, job.first, job.last, outputPrefix(opts.outDir, job.doc + 1, path)));
+				}
+			}
+			else
+			{
+				runWorkers(s_cName, argv0, opts, [&](Child & child)
+				{
+					driveWorker(child, opts, queue, stats);
+				});
+			}
+		}
+		Extractor::s_destroy();
+		progress.stop();
+
+		report(stats, start, true);
+		return (stats.failed > 0 || stats.docs < opts.files.size()) ? 1 : 0;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	const pdfv::cli::Tool tool{
+		.name   = pdfv::cli::s_cName,
+		.usage  = pdfv::cli::s_cUsage,
+		.worker = pdfv::cli::runWorker,
+		.run    = pdfv::cli::run
+	};
+	return pdfv::cli::runTool(tool, argc, argv);
+}
@@ -0,0 +1,355 @@
+#include "platform.hpp"
+
+#include <csignal>
+
+#ifdef _WIN32
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+	#include <shellapi.h>
+	#include <fcntl.h>
+	#include <io.h>
+#else
+	#include <fcntl.h>
+	#include <spawn.h>
+	#include <sys/wait.h>
+	#include <unistd.h>
+	#include <climits>
+
+	extern char ** environ;
+#endif
+
+#ifdef _WIN32
+
+namespace pdfv::cli
+{
+	[[nodiscard]] static std::wstring widen(std::string_view str)
+	{
+		if (str.empty())
+		{
+			return {};
+		}
+		std::wstring out(std::size_t(::MultiByteToWideChar(CP_UTF8, 0, str.data(), int(str.size()), nullptr, 0)), L'\0');
+		::MultiByteToWideChar(CP_UTF8, 0, str.data(), int(str.size()), out.data(), int(out.size()));
+		return out;
+	}
+	[[nodiscard]] static std::string narrow(std::wstring_view str)
+	{
+		if (str.empty())
+		{
+			return {};
+		}
+		std::string out(std::size_t(::WideCharToMultiByte(CP_UTF8, 0, str.data(), int(str.size()), nullptr, 0, nullptr, nullptr)), '\0');
+		::WideCharToMultiByte(CP_UTF8, 0, str.data(), int(str.size()), out.data(), int(out.size()), nullptr, nullptr);
+		return out;
+	}
+}
+
+pdfv::cli::Child::Child(Child && other) noexcept
+	: m_process(other.m_process), m_in(other.m_in), m_out(other.m_out)
+{
+	other.m_process = nullptr;
+	other.m_in      = nullptr;
+	other.m_out     = nullptr;
+}
+pdfv::cli::Child::~Child() noexcept
+{
+	this->closeInput();
+	if (this->m_out != nullptr)
+	{
+		::CloseHandle(this->m_out);
+	}
+	if (this->m_process != nullptr)
+	{
+		::CloseHandle(this->m_process);
+	}
+}
+
+bool pdfv::cli::Child::spawn(const std::string & exe, const std::vector<std::string> & args) noexcept
+{
+	try
+	{
+		auto wexe{ widen(exe) };
+		std::wstring cmd{ L"\"" + wexe + L"\"" };
+		for (const auto & arg : args)
+		{
+			cmd += L" \"" + widen(arg) + L"\"";
+		}
+
+		SECURITY_ATTRIBUTES sa{ .nLength = sizeof sa, .lpSecurityDescriptor = nullptr, .bInheritHandle = TRUE };
+		HANDLE outRead{ nullptr }, outWrite{ nullptr }, inRead{ nullptr }, inWrite{ nullptr };
+		if (!::CreatePipe(&outRead, &outWrite, &sa, 0)) [[unlikely]]
+		{
+			return false;
+		}
+		if (!::CreatePipe(&inRead, &inWrite, &sa, 0)) [[unlikely]]
+		{
+			::CloseHandle(outRead);
+			::CloseHandle(outWrite);
+			return false;
+		}
+		// Only the child's ends are inherited
+		::SetHandleInformation(outRead, HANDLE_FLAG_INHERIT, 0);
+		::SetHandleInformation(inWrite, HANDLE_FLAG_INHERIT, 0);
+
+		STARTUPINFOW si{};
+		si.cb         = sizeof si;
+		si.dwFlags    = STARTF_USESTDHANDLES;
+		si.hStdInput  = inRead;
+		si.hStdOutput = outWrite;
+		si.hStdError  = ::GetStdHandle(STD_ERROR_HANDLE);
+
+		PROCESS_INFORMATION pi{};
+		auto ok{ ::CreateProcessW(wexe.c_str(), cmd.data(), nullptr, nullptr, TRUE, 0, nullptr, nullptr, &si, &pi) };
+		::CloseHandle(outWrite);
+		::CloseHandle(inRead);
+		if (!ok) [[unlikely]]
+		{
+			::CloseHandle(outRead);
+			::CloseHandle(inWrite);
+			return false;
+		}
+		::CloseHandle(pi.hThread);
+
+		this->m_process = pi.hProcess;
+		this->m_in      = inWrite;
+		this->m_out     = outRead;
+		return true;
+	}
+	catch (...)
+	{
+		return false;
+	}
+}
+bool pdfv::cli::Child::write(std::string_view data) noexcept
+{
+	while (!data.empty())
+	{
+		DWORD written{ 0 };
+		if (this->m_in == nullptr || !::WriteFile(this->m_in, data.data(), DWORD(data.size()), &written, nullptr) || written == 0) [[unlikely]]
+		{
+			return false;
+		}
+		data.remove_prefix(written);
+	}
+	return true;
+}
+void pdfv::cli::Child::closeInput() noexcept
+{
+	if (this->m_in != nullptr)
+	{
+		::CloseHandle(this->m_in);
+		this->m_in = nullptr;
+	}
+}
+std::size_t pdfv::cli::Child::read(char * buf, std::size_t size) noexcept
+{
+	DWORD read{ 0 };
+	if (this->m_out == nullptr || !::ReadFile(this->m_out, buf, DWORD(size), &read, nullptr))
+	{
+		return 0;
+	}
+	return read;
+}
+int pdfv::cli::Child::wait() noexcept
+{
+	if (this->m_process == nullptr)
+	{
+		return -1;
+	}
+	::WaitForSingleObject(this->m_process, INFINITE);
+	DWORD code{ 0 };
+	return ::GetExitCodeProcess(this->m_process, &code) ? int(code) : -1;
+}
+
+void pdfv::cli::init() noexcept
+{
+	::_setmode(::_fileno(stdin),  _O_BINARY);
+	::_setmode(::_fileno(stdout), _O_BINARY);
+}
+[[nodiscard]] std::vector<std::string> pdfv::cli::args(int, char **)
+{
+	std::vector<std::string> out;
+	int argc{ 0 };
+	auto argv{ ::CommandLineToArgvW(::GetCommandLineW(), &argc) };
+	if (argv == nullptr) [[unlikely]]
+	{
+		return out;
+	}
+	for (int i = 1; i < argc; ++i)
+	{
+		out.emplace_back(narrow(argv[i]));
+	}
+	::LocalFree(argv);
+	return out;
+}
+[[nodiscard]] std::string pdfv::cli::selfPath(const char * argv0)
+{
+	wchar_t exe[MAX_PATH]{};
+	if (::GetModuleFileNameW(nullptr, exe, MAX_PATH) == 0) [[unlikely]]
+	{
+		return argv0;
+	}
+	return narrow(exe);
+}
+[[nodiscard]] std::FILE * pdfv::cli::openFile(const std::string & path, const char * mode) noexcept
+{
+	try
+	{
+		return ::_wfopen(widen(path).c_str(), widen(mode).c_str());
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+
+#else
+
+pdfv::cli::Child::Child(Child && other) noexcept
+	: m_pid(other.m_pid), m_in(other.m_in), m_out(other.m_out)
+{
+	other.m_pid = -1;
+	other.m_in  = -1;
+	other.m_out = -1;
+}
+pdfv::cli::Child::~Child() noexcept
+{
+	this->closeInput();
+	if (this->m_out != -1)
+	{
+		::close(this->m_out);
+	}
+}
+
+bool pdfv::cli::Child::spawn(const std::string & exe, const std::vector<std::string> & args) noexcept
+{
+	int in[2], out[2];
+	if (::pipe(in) != 0) [[unlikely]]
+	{
+		return false;
+	}
+	if (::pipe(out) != 0) [[unlikely]]
+	{
+		::close(in[0]);
+		::close(in[1]);
+		return false;
+	}
+	// Pipes of one child must not leak into its siblings, otherwise they never see end of file
+	for (auto fd : { in[0], in[1], out[0], out[1] })
+	{
+		::fcntl(fd, F_SETFD, FD_CLOEXEC);
+	}
+
+	posix_spawn_file_actions_t actions;
+	::posix_spawn_file_actions_init(&actions);
+	::posix_spawn_file_actions_adddup2(&actions, in[0],  STDIN_FILENO);
+	::posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+
+	int ret{ -1 };
+	try
+	{
+		std::vector<char *> argv;
+		argv.emplace_back(const_cast<char *>(exe.c_str()));
+		for (const auto & arg : args)
+		{
+			argv.emplace_back(const_cast<char *>(arg.c_str()));
+		}
+		argv.emplace_back(nullptr);
+
+		ret = ::posix_spawn(&this->m_pid, exe.c_str(), &actions, nullptr, argv.data(), environ);
+	}
+	catch (...)
+	{
+	}
+	::posix_spawn_file_actions_destroy(&actions);
+	::close(in[0]);
+	::close(out[1]);
+
+	if (ret != 0) [[unlikely]]
+	{
+		this->m_pid = -1;
+		::close(in[1]);
+		::close(out[0]);
+		return false;
+	}
+	this->m_in  = in[1];
+	this->m_out = out[0];
+	return true;
+}
+bool pdfv::cli::Child::write(std::string_view data) noexcept
+{
+	while (!data.empty())
+	{
+		auto written{ ::write(this->m_in, data.data(), data.size()) };
+		if (written <= 0) [[unlikely]]
+		{
+			return false;
+		}
+		data.remove_prefix(std::size_t(written));
+	}
+	return true;
+}
+void pdfv::cli::Child::closeInput() noexcept
+{
+	if (this->m_in != -1)
+	{
+		::close(this->m_in);
+		this->m_in = -1;
+	}
+}
+std::size_t pdfv::cli::Child::read(char * buf, std::size_t size) noexcept
+{
+	for (;;)
+	{
+		auto got{ ::read(this->m_out, buf, size) };
+		if (got >= 0)
+		{
+			return std::size_t(got);
+		}
+		if (errno != EINTR)
+		{
+			return 0;
+		}
+	}
+}
+int pdfv::cli::Child::wait() noexcept
+{
+	if (this->m_pid == -1)
+	{
+		return -1;
+	}
+	int status{ 0 };
+	while (::waitpid(this->m_pid, &status, 0) == -1)
+	{
+		if (errno != EINTR)
+		{
+			return -1;
+		}
+	}
+	this->m_pid = -1;
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+void pdfv::cli::init() noexcept
+{
+	// Failed writes to a finished child are reported as errors instead
+	std::signal(SIGPIPE, SIG_IGN);
+}
+[[nodiscard]] std::vector<std::string> pdfv::cli::args(int argc, char ** argv)
+{
+	return std::vector<std::string>(argv + std::min(argc, 1), argv + argc);
+}
+[[nodiscard]] std::string pdfv::cli::selfPath(const char * argv0)
+{
+	char exe[PATH_MAX]{};
+	auto len{ ::readlink("/proc/self/exe", exe, sizeof exe - 1) };
+	return (len > 0) ? std::string(exe, std::size_t(len)) : std::string(argv0);
+}
+[[nodiscard]] std::FILE * pdfv::cli::openFile(const std::string & path, const char * mode) noexcept
+{
+	return std::fopen(path.c_str(), mode);
+}
+
+#endif
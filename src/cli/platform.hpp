@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pdfv::cli
+{
+	/**
+	 * @brief Child process, connected to the parent through its standard input and output
+	 * 
+	 */
+	class Child
+	{
+	private:
+#ifdef _WIN32
+		void * m_process{ nullptr };
+		void * m_in{ nullptr }, * m_out{ nullptr };
+#else
+		int m_pid{ -1 };
+		int m_in{ -1 }, m_out{ -1 };
+#endif
+
+	public:
+		Child() noexcept = default;
+		Child(const Child & other) = delete;
+		Child(Child && other) noexcept;
+		Child & operator=(const Child & other) = delete;
+		Child & operator=(Child && other) noexcept = delete;
+		~Child() noexcept;
+
+		/**
+		 * @brief Starts the child process
+		 * 
+		 * @param exe UTF-8 path of the executable
+		 * @param args Arguments, excluding the program name
+		 * @return true Success
+		 */
+		bool spawn(const std::string & exe, const std::vector<std::string> & args) noexcept;
+		/**
+		 * @brief Writes the whole buffer to child's standard input
+		 * 
+		 * @return true Success
+		 */
+		bool write(std::string_view data) noexcept;
+		/**
+		 * @brief Closes child's standard input, the child sees end of file
+		 * 
+		 */
+		void closeInput() noexcept;
+		/**
+		 * @brief Reads from child's standard output, blocks until some data is available
+		 * 
+		 * @return std::size_t Number of bytes read, 0 on end of file or error
+		 */
+		std::size_t read(char * buf, std::size_t size) noexcept;
+		/**
+		 * @brief Waits for the child to exit
+		 * 
+		 * @return int Exit code, -1 on failure
+		 */
+		int wait() noexcept;
+	};
+
+	/**
+	 * @brief Prepares standard streams for binary output, ignores broken pipe signals
+	 * 
+	 */
+	void init() noexcept;
+	/**
+	 * @return std::vector<std::string> UTF-8 command line arguments, excluding the program name
+	 */
+	[[nodiscard]] std::vector<std::string> args(int argc, char ** argv);
+	/**
+	 * @return std::string UTF-8 path of the running executable
+	 */
+	[[nodiscard]] std::string selfPath(const char * argv0);
+	/**
+	 * @brief Opens a file by UTF-8 path
+	 * 
+	 */
+	[[nodiscard]] std::FILE * openFile(const std::string & path, const char * mode) noexcept;
+}
@@ -0,0 +1,242 @@
+#include "tool.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iostream>
+
+namespace pdfv::cli
+{
+	[[nodiscard]] static bool readList(const std::string & listPath, Options & opts)
+	{
+		std::ifstream file;
+		if (listPath != "-")
+		{
+			file.open(listPath, std::ios::binary);
+			if (!file)
+			{
+				return false;
+			}
+		}
+		auto & in{ (listPath == "-") ? std::cin : file };
+		for (std::string line; std::getline(in, line);)
+		{
+			if (!line.empty() && line.back() == '\r')
+			{
+				line.pop_back();
+			}
+			if (!line.empty())
+			{
+				opts.files.emplace_back(std::move(line));
+			}
+		}
+		return true;
+	}
+	[[nodiscard]] static bool parseArgs(const char * name, const std::vector<std::string> & args, Options & opts)
+	{
+		for (std::size_t i = 0; i < args.size(); ++i)
+		{
+			const auto & arg{ args[i] };
+			const bool hasValue{ i + 1 < args.size() };
+			if (arg == "-h" || arg == "--help")
+			{
+				return false;
+			}
+			else if (arg == "-l" && hasValue)
+			{
+				if (!readList(args[++i], opts))
+				{
+					std::fprintf(stderr, "%s: cannot read list %s\n", name, args[i].c_str());
+					return false;
+				}
+			}
+			else if (arg == "-o" && hasValue)
+			{
+				opts.outDir = args[++i];
+			}
+			else if (arg == "-j" && hasValue)
+			{
+				++i;
+				std::from_chars(args[i].data(), args[i].data() + args[i].size(), opts.jobs);
+			}
+			else if (arg == "-p" && hasValue)
+			{
+				opts.password = args[++i];
+			}
+			else if (!arg.empty() && arg.front() == '-' && arg != "-")
+			{
+				std::fprintf(stderr, "%s: unknown option %s\n", name, arg.c_str());
+				return false;
+			}
+			else
+			{
+				opts.files.emplace_back(arg);
+			}
+		}
+		return !opts.files.empty();
+	}
+}
+
+pdfv::cli::Progress::Progress(std::function<void ()> report)
+	: m_thread([this, report = std::move(report)]
+	{
+		std::unique_lock lock{ this->m_mutex };
+		while (!this->m_cv.wait_for(lock, s_cInterval, [this] { return this->m_done; }))
+		{
+			report();
+		}
+	})
+{
+}
+pdfv::cli::Progress::~Progress() noexcept
+{
+	this->stop();
+}
+void pdfv::cli::Progress::stop() noexcept
+{
+	{
+		std::lock_guard lock{ this->m_mutex };
+		this->m_done = true;
+	}
+	this->m_cv.notify_one();
+	if (this->m_thread.joinable())
+	{
+		this->m_thread.join();
+	}
+}
+
+int pdfv::cli::runTool(const Tool & tool, int argc, char ** argv)
+{
+	try
+	{
+		init();
+		const auto args{ cli::args(argc, argv) };
+		Options opts;
+		if (args.size() == 1 && args.front() == s_cWorkerArg)
+		{
+			if (!std::getline(std::cin, opts.password) || !std::getline(std::cin, opts.outDir))
+			{
+				return 1;
+			}
+			return tool.worker(opts);
+		}
+
+		if (!parseArgs(tool.name, args, opts))
+		{
+			std::fputs(tool.usage, stderr);
+			return 2;
+		}
+		if (opts.jobs == 0)
+		{
+			opts.jobs = std::max(std::thread::hardware_concurrency(), 1U);
+		}
+		return tool.run(opts, argv[0]);
+	}
+	catch (const std::exception & e)
+	{
+		std::fprintf(stderr, "%s: %s\n", tool.name, e.what());
+		return 1;
+	}
+}
+[[nodiscard]] std::string pdfv::cli::outputPath(const std::string & dir, std::size_t index, std::string_view path)
+{
+	auto name{ path.substr(std::min(path.find_last_of("/\\") + 1, path.size())) };
+	if (auto dot{ name.rfind('.') }; dot != std::string_view::npos && dot > 0)
+	{
+		name = name.substr(0, dot);
+	}
+
+	char prefix[24]{};
+	std::snprintf(prefix, sizeof prefix, "%06zu_", index);
+
+	auto out{ dir };
+	if (!out.empty() && out.back() != '/' && out.back() != '\\')
+	{
+		out.push_back('/');
+	}
+	return out + prefix + std::string(name);
+}
+
+void pdfv::cli::runWorkers(const char * name, const char * argv0, const Options & opts, const std::function<void (Child & child)> & drive)
+{
+	const auto self{ selfPath(argv0) };
+	std::vector<Child> children(opts.jobs);
+	std::vector<std::thread> drivers;
+	for (auto & child : children)
+	{
+		if (!child.spawn(self, { std::string(s_cWorkerArg) }))
+		{
+			std::fprintf(stderr, "%s: cannot start a worker process\n", name);
+			continue;
+		}
+		if (!child.write(opts.password + '\n' + opts.outDir + '\n'))
+		{
+			child.closeInput();
+			continue;
+		}
+		drivers.emplace_back(drive, std::ref(child));
+	}
+	for (auto & driver : drivers)
+	{
+		driver.join();
+	}
+	for (auto & child : children)
+	{
+		child.wait();
+	}
+}
+void pdfv::cli::writeFrame(char type, std::initializer_list<std::uint64_t> values, std::string_view payload)
+{
+	std::string header{ type };
+	for (auto value : values)
+	{
+		header += ' ' + std::to_string(value);
+	}
+	header += ' ' + std::to_string(payload.size()) + '\n';
+	std::fwrite(header.data(), 1, header.size(), stdout);
+	std::fwrite(payload.data(), 1, payload.size(), stdout);
+	std::fflush(stdout);
+}
+void pdfv::cli::readFrames(Child & child, const std::function<void (const Frame & frame)> & handler)
+{
+	std::string buf;
+	char chunk[64 * 1024];
+	for (std::size_t got; (got = child.read(chunk, sizeof chunk)) > 0;)
+	{
+		buf.append(chunk, got);
+
+		std::size_t pos{ 0 };
+		for (;;)
+		{
+			auto nl{ buf.find('\n', pos) };
+			if (nl == std::string::npos || nl < pos + 2)
+			{
+				break;
+			}
+
+			// Values are followed by the payload length
+			Frame frame;
+			frame.type = buf[pos];
+			std::uint64_t values[Frame::s_cMaxValues + 1]{};
+			std::size_t count{ 0 };
+			for (const char * ptr{ buf.data() + pos + 1 }, * end{ buf.data() + nl }; ptr < end && count < std::size(values); ++count)
+			{
+				ptr = std::from_chars(ptr + 1, end, values[count]).ptr;
+			}
+			const auto length{ (count > 0) ? std::size_t(values[count - 1]) : 0 };
+			if (buf.size() - (nl + 1) < length)
+			{
+				break;
+			}
+
+			frame.numValues = (count > 0) ? count - 1 : 0;
+			std::copy(values, values + frame.numValues, frame.values);
+			frame.payload = std::string_view{ buf.data() + nl + 1, length };
+			handler(frame);
+			pos = nl + 1 + length;
+		}
+		buf.erase(0, pos);
+	}
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "platform.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace pdfv::cli
+{
+	/**
+	 * @brief Only argument of a worker process started by the tool itself
+	 * 
+	 */
+	inline constexpr std::string_view s_cWorkerArg{ "--worker" };
+
+	/**
+	 * @brief Command line of a tool, the option set is shared by all of them
+	 * 
+	 */
+	struct Options
+	{
+		std::vector<std::string> files;
+		std::string outDir;
+		std::string password;
+		/**
+		 * @brief Number of worker processes, at least 1 once parsed
+		 * 
+		 */
+		unsigned jobs{ 0 };
+	};
+
+	/**
+	 * @brief A batch tool that hands documents to worker processes, copies of its own
+	 * executable, and talks to them in frames
+	 * 
+	 */
+	struct Tool
+	{
+		const char * name;
+		const char * usage;
+		/**
+		 * @brief Entry point of a worker process, the password and the output directory
+		 * are already read from standard input
+		 * 
+		 */
+		std::function<int (const Options & opts)> worker;
+		/**
+		 * @brief Entry point of the parent process
+		 * 
+		 */
+		std::function<int (Options & opts, const char * argv0)> run;
+	};
+
+	/**
+	 * @brief Result frame of a worker: "<type> <values...> <length>\n<payload>"
+	 * 
+	 */
+	struct Frame
+	{
+		static constexpr std::size_t s_cMaxValues{ 8 };
+
+		char type{ '\0' };
+		std::uint64_t values[s_cMaxValues]{};
+		std::size_t numValues{ 0 };
+		std::string_view payload;
+	};
+
+	/**
+	 * @brief Reports progress on its own thread at fixed intervals until stopped
+	 * 
+	 */
+	class Progress
+	{
+	public:
+		static constexpr auto s_cInterval{ std::chrono::seconds(10) };
+
+	private:
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		bool m_done{ false };
+		std::thread m_thread;
+
+	public:
+		explicit Progress(std::function<void ()> report);
+		Progress(const Progress & other) = delete;
+		Progress(Progress && other) noexcept = delete;
+		Progress & operator=(const Progress & other) = delete;
+		Progress & operator=(Progress && other) noexcept = delete;
+		~Progress() noexcept;
+
+		/**
+		 * @brief Stops reporting, returns once the thread has exited
+		 * 
+		 */
+		void stop() noexcept;
+	};
+
+	/**
+	 * @brief Parses the command line and either runs the tool or, with s_cWorkerArg, its
+	 * worker. Exceptions are reported on standard error
+	 * 
+	 * @return int Exit code
+	 */
+	int runTool(const Tool & tool, int argc, char ** argv);
+	/**
+	 * @brief Makes an output path out of a document path, the list position keeps
+	 * documents with the same name apart
+	 * 
+	 * @param dir Output directory, empty for the current one
+	 * @param index Position of the document in the list, starting from 1
+	 * @param path Document path
+	 * @return std::string "<dir>/<index>_<name>" without the extension of the document
+	 */
+	[[nodiscard]] std::string outputPath(const std::string & dir, std::size_t index, std::string_view path);
+
+	/**
+	 * @brief Starts opts.jobs worker processes and drives each of them on its own thread,
+	 * returns once every worker has exited
+	 * 
+	 * @param name Tool name for error messages
+	 * @param argv0 Program name the tool was started with
+	 * @param opts Options, the password and the output directory are sent to the workers
+	 * @param drive Feeds a worker and collects its frames
+	 */
+	void runWorkers(const char * name, const char * argv0, const Options & opts, const std::function<void (Child & child)> & drive);
+	/**
+	 * @brief Writes a frame to standard output, called by the worker
+	 * 
+	 */
+	void writeFrame(char type, std::initializer_list<std::uint64_t> values, std::string_view payload);
+	/**
+	 * @brief Reads frames of a worker until it closes its output
+	 * 
+	 * @param child Worker process
+	 * @param handler Called for every complete frame, the payload is only valid during the call
+	 */
+	void readFrames(Child & child, const std::function<void (const Frame & frame)> & handler);
+}
@@ -0,0 +1,204 @@
+#include "../utf.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pdfv::cli
+{
+	static constexpr const char * s_cName{ "utfbench" };
+
+	static constexpr const char * s_cUsage{
+		"Usage: utfbench [options]\n"
+		"Measures throughput of the UTF-8 <-> UTF-16 transcoder on generated text.\n\n"
+		"  -s MIB   Size of every sample in MiB of UTF-16, 16 by default\n"
+		"  -n N     Number of timed runs, the fastest one is reported, 10 by default\n"
+		"  -h       Show this help\n"
+	};
+
+	struct Options
+	{
+		std::size_t size{ 16 };
+		unsigned runs{ 10 };
+	};
+
+	/**
+	 * @brief Generated input, the same text in both encodings
+	 *
+	 */
+	struct Sample
+	{
+		const char * name;
+		std::u16string utf16;
+		std::string utf8;
+	};
+
+	/**
+	 * @brief Generates text of given length from code points in [first, last], words of
+	 * 3 to 10 characters separated by spaces, with fixed seed so runs are comparable
+	 *
+	 */
+	[[nodiscard]] static std::u16string generate(std::size_t length, char32_t first, char32_t last)
+	{
+		std::mt19937 rng{ 0x5EED };
+		std::uniform_int_distribution<std::uint32_t> chars{ std::uint32_t(first), std::uint32_t(last) };
+		std::uniform_int_distribution<int> words{ 3, 10 };
+
+		std::u16string text;
+		text.reserve(length + 1);
+		while (text.size() < length)
+		{
+			for (auto n{ words(rng) }; n > 0 && text.size() < length; --n)
+			{
+				const auto cp{ chars(rng) };
+				if (cp >= 0x10000)
+				{
+					text.push_back(char16_t(0xD800 + ((cp - 0x10000) >> 10)));
+					text.push_back(char16_t(0xDC00 + ((cp - 0x10000) & 0x3FF)));
+				}
+				else
+				{
+					text.push_back(char16_t(cp));
+				}
+			}
+			text.push_back(u' ');
+		}
+		return text;
+	}
+	[[nodiscard]] static Sample makeSample(const char * name, std::size_t length, char32_t first, char32_t last)
+	{
+		Sample sample{ .name = name, .utf16 = generate(length, first, last), .utf8 = {} };
+		sample.utf8.resize(utf::maxUtf8(sample.utf16.size()));
+		const auto result{ utf::toUtf8(sample.utf16.data(), sample.utf16.size(), sample.utf8.data(), sample.utf8.size()) };
+		sample.utf8.resize(result.written);
+		return sample;
+	}
+
+	/**
+	 * @brief Runs fn given number of times
+	 *
+	 * @return double Throughput of the fastest run in GB/s of input
+	 */
+	template<typename Fn>
+	[[nodiscard]] static double measure(unsigned runs, std::size_t bytes, Fn && fn)
+	{
+		double best{ 0.0 };
+		for (unsigned i = 0; i < runs; ++i)
+		{
+			const auto start{ std::chrono::steady_clock::now() };
+			fn();
+			const auto secs{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+			if (secs > 0.0)
+			{
+				best = std::max(best, double(bytes) / secs / 1e9);
+			}
+		}
+		return best;
+	}
+
+	[[nodiscard]] static bool parseArgs(int argc, char ** argv, Options & opts)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string_view arg{ argv[i] };
+			const bool hasValue{ i + 1 < argc };
+			if ((arg == "-s" || arg == "-n") && hasValue)
+			{
+				const std::string_view value{ argv[++i] };
+				const auto r{ arg == "-s" ?
+					std::from_chars(value.data(), value.data() + value.size(), opts.size) :
+					std::from_chars(value.data(), value.data() + value.size(), opts.runs)
+				};
+				if (r.ec != std::errc{} || opts.size == 0 || opts.runs == 0)
+				{
+					return false;
+				}
+			}
+			else
+			{
+				if (arg != "-h" && arg != "--help")
+				{
+					std::fprintf(stderr, "%s: unknown option %s\n", s_cName, argv[i]);
+				}
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static int run(int argc, char ** argv)
+	{
+		Options opts;
+		if (!parseArgs(argc, argv, opts))
+		{
+			std::fputs(s_cUsage, stderr);
+			return 2;
+		}
+
+#if defined(PDFV_UTF_SCALAR) || !defined(__GNUC__) || !(defined(__i386__) || defined(__x86_64__))
+		const char * path{ "SWAR" };
+#else
+		const char * path{ __builtin_cpu_supports("sse2") ? "SSE2" : "SWAR" };
+#endif
+		std::printf("%s: %s path, %zu MiB samples, best of %u run(s)\n\n", s_cName, path, opts.size, opts.runs);
+
+		const auto length{ opts.size * 1024 * 1024 / sizeof(char16_t) };
+		const Sample samples[]{
+			makeSample("ASCII", length, 0x21, 0x7E),
+			makeSample("Latin", length, 0xA0, 0x24F),
+			makeSample("CJK",   length, 0x4E00, 0x9FFF),
+			makeSample("Emoji", length, 0x1F300, 0x1F64F)
+		};
+
+		std::u16string wide;
+		std::string narrow;
+		std::size_t sink{ 0 };
+		std::printf("%-8s %12s %12s %12s %12s\n", "GB/s", "UTF-16->8", "UTF-8->16", "valid", "utf16Length");
+		for (const auto & sample : samples)
+		{
+			narrow.resize(utf::maxUtf8(sample.utf16.size()));
+			wide.resize(utf::maxUtf16(sample.utf8.size()));
+			const auto bytes16{ sample.utf16.size() * sizeof(char16_t) }, bytes8{ sample.utf8.size() };
+
+			const auto to8{ measure(opts.runs, bytes16, [&]
+			{
+				sink += utf::toUtf8(sample.utf16.data(), sample.utf16.size(), narrow.data(), narrow.size()).written;
+			}) };
+			const auto to16{ measure(opts.runs, bytes8, [&]
+			{
+				sink += utf::toUtf16(sample.utf8, wide.data(), wide.size()).written;
+			}) };
+			const auto valid{ measure(opts.runs, bytes8, [&]
+			{
+				sink += utf::valid(sample.utf8);
+			}) };
+			const auto length16{ measure(opts.runs, bytes8, [&]
+			{
+				sink += utf::utf16Length(sample.utf8);
+			}) };
+			std::printf("%-8s %12.2f %12.2f %12.2f %12.2f\n", sample.name, to8, to16, valid, length16);
+		}
+
+		// Keeps the results alive
+		return sink == 0 ? 1 : 0;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	try
+	{
+		return pdfv::cli::run(argc, argv);
+	}
+	catch (const std::exception & e)
+	{
+		std::fprintf(stderr, "%s: %s\n", pdfv::cli::s_cName, e.what());
+		return 1;
+	}
+}
@@ -2,6 +2,9 @@
 #include "mainwindow.hpp"
 
 #include <shellapi.h>
+#include <cstring>
+#include <algorithm>
+#include <vector>
 
 [[nodiscard]] RECT pdfv::w::getCliR(HWND hwnd, RECT def) noexcept
 {
@@ -104,6 +107,31 @@ bool pdfv::w::resize(HWND hwnd, int x, int y, bool redraw) noexcept
 {
 	return ::SetWindowPos(hwnd, nullptr, 0, 0, x, y, SWP_NOMOVE | SWP_NOZORDER | SWP_NOOWNERZORDER | (SWP_NOREDRAW * (!redraw))) ? true : false;
 }
+bool pdfv::w::setClipboardText(HWND owner, std::wstring_view text) noexcept
+{
+	if (!::OpenClipboard(owner)) [[unlikely]]
+	{
+		return false;
+	}
+	::EmptyClipboard();
+
+	bool ret{ false };
+	const auto bytes{ (text.size() + 1) * sizeof(wchar_t) };
+	if (auto mem{ ::GlobalAlloc(GMEM_MOVEABLE, bytes) }; mem != nullptr) [[likely]]
+	{
+		auto dst{ static_cast<wchar_t *>(::GlobalLock(mem)) };
+		std::memcpy(dst, text.data(), text.size() * sizeof(wchar_t));
+		dst[text.size()] = L'\0';
+		::GlobalUnlock(mem);
+		ret = ::SetClipboardData(CF_UNICODETEXT, mem) != nullptr;
+		if (!ret) [[unlikely]]
+		{
+			::GlobalFree(mem);
+		}
+	}
+	::CloseClipboard();
+	return ret;
+}
 
 void pdfv::w::openWeb(LPCWSTR url) noexcept
 {
@@ -152,6 +180,105 @@ void pdfv::ArgVecFree::operator()(wchar_t ** obj) noexcept
 	return ArgVecT(argv);
 }
 
+[[nodiscard]] std::wstring pdfv::getCacheDir(std::wstring_view subdir)
+{
+	DEBUGPRINT("pdfv::getCacheDir(%p)\n", static_cast<const void *>(subdir.data()));
+
+	wchar_t base[MAX_PATH]{};
+	auto len{ ::GetEnvironmentVariableW(L"LOCALAPPDATA", base, MAX_PATH) };
+	if (len == 0 || len >= MAX_PATH) [[unlikely]]
+	{
+		return {};
+	}
+
+	std::wstring dir{ base };
+	dir += L"\\" PRODUCT_NAME L"\\";
+	::CreateDirectoryW(dir.c_str(), nullptr);
+	if (!subdir.empty())
+	{
+		dir += subdir;
+		dir += L'\\';
+		::CreateDirectoryW(dir.c_str(), nullptr);
+	}
+
+	if (auto attr{ ::GetFileAttributesW(dir.c_str()) };
+		attr == INVALID_FILE_ATTRIBUTES || !(attr & FILE_ATTRIBUTE_DIRECTORY)) [[unlikely]]
+	{
+		return {};
+	}
+	return dir;
+}
+bool pdfv::writeCacheFile(const std::wstring & path, const void * data, std::size_t size) noexcept
+{
+	DEBUGPRINT("pdfv::writeCacheFile(%p, %p, %zu)\n", static_cast<const void *>(path.c_str()), data, size);
+
+	try
+	{
+		auto temp{ path + L".tmp" };
+		auto handle{ ::CreateFileW(temp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr) };
+		if (handle == INVALID_HANDLE_VALUE) [[unlikely]]
+		{
+			return false;
+		}
+		auto bytes{ static_cast<const u8 *>(data) };
+		bool written{ true };
+		for (std::size_t pos = 0; pos < size && written;)
+		{
+			DWORD chunk{ 0 };
+			written = ::WriteFile(handle, bytes + pos, DWORD(std::min<std::size_t>(size - pos, 1 << 24)), &chunk, nullptr) && chunk > 0;
+			pos += chunk;
+		}
+		::CloseHandle(handle);
+		if (!written || !::MoveFileExW(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) [[unlikely]]
+		{
+			::DeleteFileW(temp.c_str());
+			return false;
+		}
+		return true;
+	}
+	catch (...)
+	{
+		return false;
+	}
+}
+void pdfv::pruneCacheDir(const std::wstring & dir, std::wstring_view pattern, std::size_t maxFiles) noexcept
+{
+	DEBUGPRINT("pdfv::pruneCacheDir(%p, %zu)\n", static_cast<const void *>(dir.c_str()), maxFiles);
+
+	try
+	{
+		std::vector<std::pair<u64, std::wstring>> files;
+
+		WIN32_FIND_DATAW fd{};
+		auto find{ ::FindFirstFileW((dir + std::wstring(pattern)).c_str(), &fd) };
+		if (find == INVALID_HANDLE_VALUE)
+		{
+			return;
+		}
+		do
+		{
+			files.emplace_back(
+				(u64(fd.ftLastWriteTime.dwHighDateTime) << 32) | u64(fd.ftLastWriteTime.dwLowDateTime),
+				fd.cFileName
+			);
+		} while (::FindNextFileW(find, &fd));
+		::FindClose(find);
+
+		if (files.size() <= maxFiles)
+		{
+			return;
+		}
+		std::sort(files.begin(), files.end());
+		for (std::size_t i = 0, n = files.size() - maxFiles; i < n; ++i)
+		{
+			::DeleteFileW((dir + files[i].second).c_str());
+		}
+	}
+	catch (...)
+	{
+	}
+}
+
 [[nodiscard]] bool pdfv::initCC() noexcept
 {
 	INITCOMMONCONTROLSEX iccex{};
@@ -401,58 +528,16 @@ namespace pdfv
 [[nodiscard]] std::wstring pdfv::utf::conv(std::string_view str)
 {
 	DEBUGPRINT("pdfv::utf::conv(string_view %p)\n", static_cast<const void *>(str.data()));
-	
-	auto len{ ::MultiByteToWideChar(
-		CP_UTF8,
-		MB_PRECOMPOSED,
-		str.data(),
-		int(str.size()) + 1,
-		nullptr,
-		0
-	) };
-
-	std::wstring wstr;
-	wstr.resize(len);
-
-	::MultiByteToWideChar(
-		CP_UTF8,
-		MB_PRECOMPOSED,
-		str.data(),
-		int(str.size()) + 1,
-		wstr.data(),
-		len
-	);
 
+	std::wstring wstr(maxUtf16(str.size()), L'\0');
+	wstr.resize(toUtf16(str, wstr.data(), wstr.size()).written);
 	return wstr;
 }
 [[nodiscard]] std::string pdfv::utf::conv(std::wstring_view wstr)
 {
 	DEBUGPRINT("pdfv::utf::conv(wstring_view %p)\n", static_cast<const void *>(wstr.data()));
 
-	auto len{ ::WideCharToMultiByte(
-		CP_UTF8,
-		0,
-		wstr.data(),
-		int(wstr.size()) + 1,
-		nullptr,
-		0,
-		nullptr,
-		nullptr
-	) };
-
-	std::string str;
-	str.resize(len);
-
-	::WideCharToMultiByte(
-		CP_UTF8,
-		0,
-		wstr.data(),
-		int(wstr.size()) + 1,
-		str.data(),
-		len,
-		nullptr,
-		nullptr
-	);
-
+	std::string str(maxUtf8(wstr.size()), '\0');
+	str.resize(toUtf8(wstr.data(), wstr.size(), str.data(), str.size()).written);
 	return str;
 }
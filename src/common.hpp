@@ -19,12 +19,14 @@
 #include <memory>
 #include <functional>
 
+#include "types.hpp"
 #include "concepts.hpp"
 #include "errors.hpp"
 #include "version.hpp"
 #include "resource.hpp"
 #include "safeptr.hpp"
 #include "enumhelper.hpp"
+#include "utf.hpp"
 
 #define APP_DEFSIZE_X 350
 #define APP_DEFSIZE_Y 200
@@ -44,28 +46,6 @@ namespace pdfv
 	// Forward-declare MainWindow class
 	class MainWindow;
 
-	// Some type aliases
-	using ssize_t = std::intptr_t;
-	using uchar   = unsigned char;
-	using ushort  = unsigned short;
-	using uint    = unsigned int;
-	using l       = long;
-	using ul      = unsigned long;
-	using ll      = long long;
-	using ull     = unsigned long long;
-	using f32     = float;
-	using f64     = double;
-	using f128    = long double;
-
-	using i8  = std::int8_t;
-	using u8  = std::uint8_t;
-	using i16 = std::int16_t;
-	using u16 = std::uint16_t;
-	using i32 = std::int32_t;
-	using u32 = std::uint32_t;
-	using i64 = std::int64_t;
-	using u64 = std::uint64_t;
-	
 	namespace w
 	{
 		/**
@@ -207,6 +187,15 @@ namespace pdfv
 		 * @return false Failure
 		 */
 		bool resize(HWND hwnd, int x, int y, bool redraw = false) noexcept;
+		/**
+		 * @brief Replaces clipboard contents with text
+		 * 
+		 * @param owner Window handle to own the clipboard
+		 * @param text Text to copy
+		 * @return true Success
+		 * @return false Failure
+		 */
+		bool setClipboardText(HWND owner, std::wstring_view text) noexcept;
 
 		void openWeb(LPCWSTR url) noexcept;
 
@@ -304,6 +293,31 @@ namespace pdfv
 	 * @return std::Safeptr<wchar_t **, ArgVecFree> Argument vector
 	 */
 	[[nodiscard]] ArgVecT getArgs(int & argc) noexcept;
+
+	/**
+	 * @brief Get the per-user cache directory of the program, creates it if it doesn't exist
+	 * 
+	 * @param subdir Subdirectory name
+	 * @return std::wstring Directory path with a trailing backslash, empty on failure
+	 */
+	[[nodiscard]] std::wstring getCacheDir(std::wstring_view subdir);
+	/**
+	 * @brief Writes a cache file through a temporary file, so that readers never see a partial file
+	 * 
+	 * @param path File path
+	 * @param data Pointer to file contents
+	 * @param size Size of the contents in bytes
+	 * @return true Success
+	 */
+	bool writeCacheFile(const std::wstring & path, const void * data, std::size_t size) noexcept;
+	/**
+	 * @brief Removes the least recently written files matching a pattern above the limit
+	 * 
+	 * @param dir Directory with a trailing backslash
+	 * @param pattern File name pattern, e.g. "*.idx"
+	 * @param maxFiles Number of files kept
+	 */
+	void pruneCacheDir(const std::wstring & dir, std::wstring_view pattern, std::size_t maxFiles) noexcept;
 	
 	/**
 	 * @brief Initialise common controls
@@ -748,14 +762,14 @@ namespace pdfv
 	namespace utf
 	{
 		/**
-		 * @brief Converts UTF-8 string to UTF-16 string
+		 * @brief Converts UTF-8 string to UTF-16 string, ill-formed sequences become U+FFFD
 		 * 
 		 * @param str UTF-8 string
 		 * @return std::wstring UTF-16 string
 		 */
 		[[nodiscard]] std::wstring conv(std::string_view str);
 		/**
-		 * @brief Converts UTF-16 string to UTF-8 string
+		 * @brief Converts UTF-16 string to UTF-8 string, unpaired surrogates become U+FFFD
 		 * 
 		 * @param wstr UTF-16 string
 		 * @return std::string UTF-8 string
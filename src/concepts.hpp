@@ -102,4 +102,13 @@ namespace pdfv::concepts
 
 	template<typename T>
 	concept enum_class = enum_concept<T> && !std::is_convertible_v<T, std::underlying_type_t<T>>;
+
+	/**
+	 * @brief Type has to be an integral 16-bit code unit, e.g. wchar_t on Windows,
+	 * char16_t or PDFium's FPDF_WCHAR
+	 * 
+	 * @tparam T 
+	 */
+	template<typename T>
+	concept utf16_unit = std::is_integral_v<T> && sizeof(T) == 2;
 }
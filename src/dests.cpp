@@ -0,0 +1,134 @@
+#include "dests.hpp"
+#include "lib.hpp"
+#include <fpdf_doc.h>
+
+#include <vector>
+
+pdfv::DestIndex::DestIndex(DocRef doc) noexcept
+	: m_doc(std::move(doc))
+{
+}
+
+[[nodiscard]] pdfv::DestTarget pdfv::DestIndex::s_resolve(FPDF_DOCUMENT doc, FPDF_DEST dest) noexcept
+{
+	constexpr auto nan{ std::numeric_limits<f32>::quiet_NaN() };
+	DestTarget target;
+
+	const auto idx{ FPDFDest_GetDestPageIndex(doc, dest) };
+	target.page = (idx >= 0) ? u32(idx) + 1 : 0;
+
+	FPDF_BOOL hasX, hasY, hasZoom;
+	FS_FLOAT x, y, zoom;
+	if (FPDFDest_GetLocationInPage(dest, &hasX, &hasY, &hasZoom, &x, &y, &zoom))
+	{
+		target.x    = hasX    ? x    : nan;
+		target.y    = hasY    ? y    : nan;
+		target.zoom = hasZoom ? zoom : nan;
+	}
+	return target;
+}
+
+void pdfv::DestIndex::build(const std::atomic<bool> & cancel) noexcept
+{
+	DEBUGPRINT("pdfv::DestIndex::build(%p)\n", static_cast<const void *>(&cancel));
+
+	try
+	{
+		std::unordered_map<std::wstring, DestTarget> map;
+		// Most names fit, longer ones are asked for their length
+		std::vector<unsigned short> buf(256);
+		std::size_t count{ 0 };
+		{
+			auto lock{ Pdfium::lock() };
+			if (this->m_doc->get() == nullptr)
+			{
+				return;
+			}
+			count = FPDF_CountNamedDests(this->m_doc->get());
+		}
+		map.reserve(count);
+
+		for (std::size_t first = 0; first < count; first += s_cChunk)
+		{
+			if (cancel)
+			{
+				return;
+			}
+			auto lock{ Pdfium::lock() };
+			const auto doc{ this->m_doc->get() };
+			if (doc == nullptr)
+			{
+				return;
+			}
+			for (auto i{ first }; i < std::min(first + s_cChunk, count); ++i)
+			{
+				auto len{ long(buf.size() * sizeof(unsigned short)) };
+				auto dest{ FPDF_GetNamedDest(doc, int(i), buf.data(), &len) };
+				if (dest != nullptr && len < 0)
+				{
+					len = 0;
+					FPDF_GetNamedDest(doc, int(i), nullptr, &len);
+					buf.resize(std::size_t(std::max(len, 0L)) / sizeof(unsigned short) + 1);
+					len  = long(buf.size() * sizeof(unsigned short));
+					dest = FPDF_GetNamedDest(doc, int(i), buf.data(), &len);
+				}
+				if (dest == nullptr || len <= 0) [[unlikely]]
+				{
+					continue;
+				}
+				// Length is in bytes and includes the terminating null character
+				const auto units{ std::size_t(len) / sizeof(unsigned short) };
+				std::wstring name(buf.begin(), buf.begin() + ssize_t(units > 0 ? units - 1 : 0));
+				// First definition wins, like in the name tree lookup
+				map.try_emplace(std::move(name), s_resolve(doc, dest));
+			}
+		}
+
+		std::lock_guard lock{ this->m_mutex };
+		this->m_map = std::move(map);
+		this->m_ready.store(true, std::memory_order_release);
+		DEBUGPRINT("Indexed %zu named destination(s)\n", this->m_map.size());
+	}
+	catch (const std::bad_alloc &)
+	{
+	}
+}
+[[nodiscard]] bool pdfv::DestIndex::find(std::wstring_view name, DestTarget & target) const noexcept
+{
+	try
+	{
+		if (this->ready())
+		{
+			std::lock_guard lock{ this->m_mutex };
+			if (auto it{ this->m_map.find(std::wstring(name)) }; it != this->m_map.end())
+			{
+				target = it->second;
+				return true;
+			}
+			return false;
+		}
+
+		// Not built yet, search the name tree directly
+		const auto utf8{ utf::conv(name) };
+		auto lock{ Pdfium::lock() };
+		const auto doc{ this->m_doc->get() };
+		if (doc == nullptr)
+		{
+			return false;
+		}
+		if (auto dest{ FPDF_GetNamedDestByName(doc, utf8.c_str()) }; dest != nullptr)
+		{
+			target = s_resolve(doc, dest);
+			return true;
+		}
+	}
+	catch (const std::bad_alloc &)
+	{
+	}
+	return false;
+}
+[[nodiscard]] std::size_t pdfv::DestIndex::size() const noexcept
+{
+	std::lock_guard lock{ this->m_mutex };
+	return this->m_map.size();
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "common.hpp"
+#include "borrowed.hpp"
+
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace pdfv
+{
+	/**
+	 * @brief Location a named destination points to
+	 * 
+	 */
+	struct DestTarget
+	{
+		/**
+		 * @brief Page number, starting from 1, 0 if the destination doesn't resolve to a page
+		 * 
+		 */
+		u32 page{ 0 };
+		/**
+		 * @brief Location on the page and zoom factor, NaN if unspecified
+		 * 
+		 */
+		f32 x{ std::numeric_limits<f32>::quiet_NaN() };
+		f32 y{ std::numeric_limits<f32>::quiet_NaN() };
+		f32 zoom{ std::numeric_limits<f32>::quiet_NaN() };
+	};
+
+	/**
+	 * @brief Hash map of a document's named destinations, built once in the background.
+	 * Until it's ready, lookups fall back to the library's own name tree search.
+	 * 
+	 */
+	class DestIndex
+	{
+	public:
+		/**
+		 * @brief Number of destinations read per library lock, keeps rendering responsive
+		 * 
+		 */
+		static constexpr std::size_t s_cChunk{ 512 };
+
+	private:
+		mutable std::mutex m_mutex;
+		DocRef m_doc;
+		std::unordered_map<std::wstring, DestTarget> m_map;
+		std::atomic<bool> m_ready{ false };
+
+		/**
+		 * @brief Resolves a destination handle, caller has to hold the library lock
+		 * 
+		 */
+		[[nodiscard]] static DestTarget s_resolve(FPDF_DOCUMENT doc, FPDF_DEST dest) noexcept;
+
+	public:
+		/**
+		 * @param doc Document of the owner
+		 */
+		explicit DestIndex(DocRef doc) noexcept;
+		DestIndex(const DestIndex & other) = delete;
+		DestIndex(DestIndex && other) noexcept = delete;
+		DestIndex & operator=(const DestIndex & other) = delete;
+		DestIndex & operator=(DestIndex && other) noexcept = delete;
+		~DestIndex() noexcept = default;
+
+		/**
+		 * @brief Reads all named destinations into the hash map, takes the library lock
+		 * for every chunk of destinations
+		 * 
+		 * @param cancel Reference to cancellation flag
+		 */
+		void build(const std::atomic<bool> & cancel) noexcept;
+		/**
+		 * @return true Hash map is built
+		 */
+		[[nodiscard]] bool ready() const noexcept
+		{
+			return this->m_ready.load(std::memory_order_acquire);
+		}
+		/**
+		 * @brief Looks up a named destination, in constant time once the index is ready
+		 * 
+		 * @param name Destination name
+		 * @param target Reference to target, receives the location
+		 * @return true Destination exists
+		 */
+		[[nodiscard]] bool find(std::wstring_view name, DestTarget & target) const noexcept;
+		/**
+		 * @return std::size_t Number of indexed destinations
+		 */
+		[[nodiscard]] std::size_t size() const noexcept;
+	};
+}
@@ -0,0 +1,135 @@
+#include "governor.hpp"
+
+#include <algorithm>
+
+[[nodiscard]] pdfv::MemoryGovernor & pdfv::MemoryGovernor::instance() noexcept
+{
+	// Constructed on first use, so static caches can register during their own construction
+	static MemoryGovernor s_governor;
+	return s_governor;
+}
+[[nodiscard]] const wchar_t * pdfv::MemoryGovernor::s_name(Category category) noexcept
+{
+	switch (category)
+	{
+	case Category::render:
+		return L"Rendered pages";
+	case Category::objects:
+		return L"Object boxes";
+	case Category::textLayers:
+		return L"Text layers";
+	case Category::thumbnails:
+		return L"Thumbnails";
+	case Category::tagTrees:
+		return L"Tagged structure";
+	default:
+		return L"Other";
+	}
+}
+
+pdfv::u64 pdfv::MemoryGovernor::add(Client client) noexcept
+{
+	std::lock_guard lock{ this->m_mutex };
+	try
+	{
+		const auto id{ this->m_nextId++ };
+		this->m_clients.emplace_back(id, std::move(client));
+		return id;
+	}
+	catch (const std::bad_alloc &)
+	{
+		return 0;
+	}
+}
+void pdfv::MemoryGovernor::remove(u64 id) noexcept
+{
+	if (id == 0)
+	{
+		return;
+	}
+	std::lock_guard lock{ this->m_mutex };
+	auto it{ std::find_if(this->m_clients.begin(), this->m_clients.end(), [id](const auto & client) noexcept { return client.first == id; }) };
+	if (it != this->m_clients.end())
+	{
+		this->m_clients.erase(it);
+	}
+}
+void pdfv::MemoryGovernor::setBudget(std::size_t bytes) noexcept
+{
+	std::lock_guard lock{ this->m_mutex };
+	this->m_budget = bytes;
+}
+
+std::size_t pdfv::MemoryGovernor::enforce() noexcept
+{
+	std::lock_guard lock{ this->m_mutex };
+	try
+	{
+		std::size_t total{ 0 };
+		for (const auto & [id, client] : this->m_clients)
+		{
+			total += client.used();
+		}
+		if (total <= this->m_budget)
+		{
+			return 0;
+		}
+		DEBUGPRINT("pdfv::MemoryGovernor::enforce(), %zu of %zu bytes used\n", total, this->m_budget);
+
+		const auto now{ s_now() };
+		std::size_t released{ 0 };
+		while (total > this->m_budget)
+		{
+			// Old, big and cheap entries go first
+			Client * victim{ nullptr };
+			double bestScore{ 0.0 };
+			for (auto & [id, client] : this->m_clients)
+			{
+				Candidate cand;
+				if (!client.candidate(cand) || cand.bytes == 0 || now - std::min(cand.lastUse, now) < s_cMinAge)
+				{
+					continue;
+				}
+				const auto score{ double(now - cand.lastUse) * double(cand.bytes) / double(std::max<u64>(cand.cost, 1)) };
+				if (score > bestScore)
+				{
+					bestScore = score;
+					victim    = &client;
+				}
+			}
+			if (victim == nullptr)
+			{
+				break;
+			}
+
+			const auto bytes{ victim->evict() };
+			const auto cat{ std::size_t(victim->category) };
+			++this->m_evictions[cat];
+			this->m_evictedBytes[cat] += bytes;
+			released += bytes;
+			total    -= std::min(bytes, total);
+		}
+		DEBUGPRINT("Memory governor released %zu bytes\n", released);
+		return released;
+	}
+	catch (...)
+	{
+		return 0;
+	}
+}
+[[nodiscard]] pdfv::MemoryGovernor::Usage pdfv::MemoryGovernor::usage() const noexcept
+{
+	std::lock_guard lock{ this->m_mutex };
+	Usage usage{ .budget = this->m_budget, .evictions = this->m_evictions, .evictedBytes = this->m_evictedBytes };
+	for (const auto & [id, client] : this->m_clients)
+	{
+		try
+		{
+			usage.used[std::size_t(client.category)] += client.used();
+		}
+		catch (...)
+		{
+		}
+	}
+	return usage;
+}
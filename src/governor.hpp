@@ -0,0 +1,154 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <array>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace pdfv
+{
+	/**
+	 * @brief Single memory budget shared by every cache of the process. Caches register
+	 * their usage and their least recently used entry; while the total is above the budget,
+	 * the entry scoring highest across all caches is dropped. The score grows with the time
+	 * since the entry was used and with its size, and shrinks with what it costs to rebuild
+	 * 
+	 */
+	class MemoryGovernor
+	{
+	public:
+		enum class Category : u8
+		{
+			render,
+			objects,
+			textLayers,
+			thumbnails,
+			tagTrees,
+
+			count
+		};
+
+		static constexpr std::size_t s_cDefaultBudget{ 384 * 1024 * 1024 };
+		/**
+		 * @brief Entries used more recently than this in milliseconds are never dropped,
+		 * so whatever is on screen stays
+		 * 
+		 */
+		static constexpr u64 s_cMinAge{ 2000 };
+
+		/**
+		 * @brief Least recently used entry of a cache
+		 * 
+		 */
+		struct Candidate
+		{
+			/**
+			 * @brief Tick count of the last use, see s_now
+			 * 
+			 */
+			u64 lastUse{ 0 };
+			std::size_t bytes{ 0 };
+			/**
+			 * @brief Time it took to make the entry in microseconds
+			 * 
+			 */
+			u64 cost{ 1 };
+		};
+		struct Client
+		{
+			Category category{ Category::render };
+			/**
+			 * @brief Returns the memory used by the cache in bytes
+			 * 
+			 */
+			std::function<std::size_t ()> used;
+			/**
+			 * @brief Fills in the least recently used entry that can be dropped, returns false
+			 * if there is none
+			 * 
+			 */
+			std::function<bool (Candidate &)> candidate;
+			/**
+			 * @brief Drops the entry last returned by candidate, returns the bytes released
+			 * 
+			 */
+			std::function<std::size_t ()> evict;
+		};
+		struct Usage
+		{
+			std::size_t budget{ 0 };
+			std::array<std::size_t, std::size_t(Category::count)> used{};
+			/**
+			 * @brief Entries and bytes dropped by the governor since the start
+			 * 
+			 */
+			std::array<std::size_t, std::size_t(Category::count)> evictions{}, evictedBytes{};
+		};
+
+	private:
+		mutable std::mutex m_mutex;
+		std::vector<std::pair<u64, Client>> m_clients;
+		u64 m_nextId{ 1 };
+		std::size_t m_budget{ s_cDefaultBudget };
+		std::array<std::size_t, std::size_t(Category::count)> m_evictions{}, m_evictedBytes{};
+
+		MemoryGovernor() noexcept = default;
+
+	public:
+		MemoryGovernor(const MemoryGovernor & other) = delete;
+		MemoryGovernor(MemoryGovernor && other) noexcept = delete;
+		MemoryGovernor & operator=(const MemoryGovernor & other) = delete;
+		MemoryGovernor & operator=(MemoryGovernor && other) noexcept = delete;
+		~MemoryGovernor() noexcept = default;
+
+		/**
+		 * @return MemoryGovernor& The governor of the process
+		 */
+		[[nodiscard]] static MemoryGovernor & instance() noexcept;
+		/**
+		 * @return u64 Current time in milliseconds, used for the last use of entries
+		 */
+		[[nodiscard]] static u64 s_now() noexcept
+		{
+			return ::GetTickCount64();
+		}
+		/**
+		 * @return const wchar_t* Human-readable name of a category
+		 */
+		[[nodiscard]] static const wchar_t * s_name(Category category) noexcept;
+
+		/**
+		 * @brief Registers a cache. Its callbacks may be called from enforce until it's
+		 * removed, so a cache must never call into the governor while holding its own lock
+		 * 
+		 * @param client Cache callbacks
+		 * @return u64 Registration identifier, 0 on failure
+		 */
+		u64 add(Client client) noexcept;
+		/**
+		 * @brief Unregisters a cache, waits until enforce isn't using it
+		 * 
+		 * @param id Registration identifier
+		 */
+		void remove(u64 id) noexcept;
+		/**
+		 * @brief Sets a new budget, takes effect on the next enforce
+		 * 
+		 * @param bytes Budget in bytes
+		 */
+		void setBudget(std::size_t bytes) noexcept;
+		/**
+		 * @brief Drops entries until the total usage fits the budget or nothing old enough is
+		 * left, called on the GUI thread, which owns the render buffers
+		 * 
+		 * @return std::size_t Bytes released
+		 */
+		std::size_t enforce() noexcept;
+		/**
+		 * @return Usage Current usage and evictions by category
+		 */
+		[[nodiscard]] Usage usage() const noexcept;
+	};
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+namespace pdfv::hash
+{
+	/**
+	 * @brief Incremental 64-bit FNV-1a hasher, used for content fingerprints
+	 *
+	 */
+	struct Fnv1a
+	{
+		static constexpr u64 s_cOffset{ 0xCBF29CE484222325ULL };
+		static constexpr u64 s_cPrime { 0x00000100000001B3ULL };
+
+		u64 value{ s_cOffset };
+
+		/**
+		 * @brief Feeds raw bytes to the hasher
+		 *
+		 * @param data Pointer to data
+		 * @param length Length of data in bytes
+		 */
+		constexpr void bytes(const void * data, std::size_t length) noexcept
+		{
+			auto p{ static_cast<const u8 *>(data) };
+			for (std::size_t i = 0; i < length; ++i)
+			{
+				this->value ^= p[i];
+				this->value *= s_cPrime;
+			}
+		}
+		/**
+		 * @brief Feeds the object representation of a trivially copyable value to the hasher
+		 *
+		 * @tparam T Value type
+		 * @param val Value
+		 */
+		template<typename T>
+		void add(const T & val) noexcept requires std::is_trivially_copyable_v<T>
+		{
+			u8 raw[sizeof(T)];
+			std::memcpy(raw, &val, sizeof(T));
+			this->bytes(raw, sizeof(T));
+		}
+
+		/**
+		 * @return u64 Current hash value
+		 */
+		[[nodiscard]] constexpr u64 get() const noexcept
+		{
+			return this->value;
+		}
+	};
+
+	/**
+	 * @brief Calculates a fingerprint of the whole file contents. Four independent lanes take
+	 * 8 bytes each per step, so that large files are fingerprinted at memory speed, the tail
+	 * and the lanes are combined with FNV-1a
+	 *
+	 * @param data Pointer to file contents
+	 * @param length Length of the contents
+	 * @return u64 Fingerprint
+	 */
+	[[nodiscard]] inline u64 fingerprint(const void * data, std::size_t length) noexcept
+	{
+		constexpr u64 prime1{ 0x9E3779B185EBCA87ULL }, prime2{ 0xC2B2AE3D27D4EB4FULL };
+
+		auto p{ static_cast<const u8 *>(data) };
+		u64 lanes[4]{ prime1, prime2, ~prime1, ~prime2 };
+		std::size_t i{ 0 };
+		for (; length - i >= sizeof lanes; i += sizeof lanes)
+		{
+			for (std::size_t k = 0; k < 4; ++k)
+			{
+				u64 word;
+				std::memcpy(&word, p + i + k * sizeof(u64), sizeof(u64));
+				lanes[k] = std::rotl(lanes[k] + word * prime2, 31) * prime1;
+			}
+		}
+
+		Fnv1a h;
+		h.add(u64(length));
+		h.add(lanes);
+		h.bytes(p + i, length - i);
+		return h.get();
+	}
+}
@@ -1,5 +1,63 @@
 #include "hdcbuffer.hpp"
 
+#include <chrono>
+#include <limits>
+
+pdfv::hdc::Renderer::Renderer() noexcept
+{
+	this->registerBuffer();
+}
+pdfv::hdc::Renderer::Renderer(Renderer && other) noexcept
+	: bmBuffer(std::move(other.bmBuffer))
+{
+	this->registerBuffer();
+}
+pdfv::hdc::Renderer & pdfv::hdc::Renderer::operator=(Renderer && other) noexcept
+{
+	this->bmBuffer = std::move(other.bmBuffer);
+	return *this;
+}
+pdfv::hdc::Renderer::~Renderer() noexcept
+{
+	MemoryGovernor::instance().remove(this->m_governorId);
+}
+void pdfv::hdc::Renderer::registerBuffer() noexcept
+{
+	try
+	{
+		this->m_governorId = MemoryGovernor::instance().add({
+			.category  = MemoryGovernor::Category::render,
+			.used      = [this]() noexcept { return this->bytes(); },
+			.candidate = [this](MemoryGovernor::Candidate & cand) noexcept
+			{
+				const auto page{ this->oldestPage() };
+				if (page == 0)
+				{
+					return false;
+				}
+				const auto & stats{ this->bmBuffer.at(page) };
+				cand = { .lastUse = stats.lastUse, .bytes = std::size_t(stats.size.x) * std::size_t(stats.size.y) * 4, .cost = stats.cost };
+				return true;
+			},
+			.evict     = [this]() noexcept -> std::size_t
+			{
+				const auto page{ this->oldestPage() };
+				auto it{ this->bmBuffer.find(page) };
+				if (it == this->bmBuffer.end())
+				{
+					return 0;
+				}
+				const auto bytes{ std::size_t(it->second.size.x) * std::size_t(it->second.size.y) * 4 };
+				this->bmBuffer.erase(it);
+				return bytes;
+			}
+		});
+	}
+	catch (...)
+	{
+	}
+}
+
 void pdfv::hdc::Renderer::clear() noexcept
 {
 	this->bmBuffer.clear();
@@ -9,6 +67,11 @@ void pdfv::hdc::Renderer::clear() noexcept
 {
 	return this->bmBuffer.find(pageIdx) != this->bmBuffer.end();
 }
+[[nodiscard]] bool pdfv::hdc::Renderer::hasPage(std::size_t pageIdx, xy<int> size) const noexcept
+{
+	auto it{ this->bmBuffer.find(pageIdx) };
+	return it != this->bmBuffer.end() && it->second.size == size;
+}
 void pdfv::hdc::Renderer::putPage(std::size_t pageIdx, xy<int> size, std::function<Renderer::RenderT (void *)> render, void * renderArg)
 {
 	bool reRender{ true };
@@ -22,16 +85,71 @@ void pdfv::hdc::Renderer::putPage(std::size_t pageIdx, xy<int> size, std::functi
 
 	if (reRender)
 	{
-		this->bmBuffer[pageIdx] = RenderStats(render(renderArg), size);
+		const auto before{ std::chrono::steady_clock::now() };
+		auto hrender{ render(renderArg) };
+		const auto cost{ u64(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - before).count()) };
+		this->bmBuffer[pageIdx] = RenderStats{ std::move(hrender), size, MemoryGovernor::s_now(), cost };
 	}
 }
 
 pdfv::hdc::Renderer::RenderT & pdfv::hdc::Renderer::getPage(std::size_t pageIdx)
 {
-	return this->bmBuffer.at(pageIdx).hrender;
+	auto & stats{ this->bmBuffer.at(pageIdx) };
+	stats.lastUse = MemoryGovernor::s_now();
+	return stats.hrender;
+}
+[[nodiscard]] std::size_t pdfv::hdc::Renderer::oldestPage() const noexcept
+{
+	std::size_t page{ 0 };
+	auto oldest{ std::numeric_limits<u64>::max() };
+	for (const auto & [pageIdx, stats] : this->bmBuffer)
+	{
+		if (stats.lastUse < oldest)
+		{
+			oldest = stats.lastUse;
+			page   = pageIdx;
+		}
+	}
+	return page;
 }
 void pdfv::hdc::Renderer::removePage(std::size_t pageIdx) noexcept
 {
 	this->bmBuffer.erase(pageIdx);
 }
-
+std::size_t pdfv::hdc::Renderer::removeIf(const std::function<bool (std::size_t)> & pred)
+{
+	std::size_t removed{ 0 };
+	for (auto it{ this->bmBuffer.begin() }; it != this->bmBuffer.end();)
+	{
+		if (pred(it->first))
+		{
+			it = this->bmBuffer.erase(it);
+			++removed;
+		}
+		else
+		{
+			++it;
+		}
+	}
+	return removed;
+}
+[[nodiscard]] std::vector<std::size_t> pdfv::hdc::Renderer::pages() const
+{
+	std::vector<std::size_t> pages;
+	pages.reserve(this->bmBuffer.size());
+	for (const auto & [pageIdx, stats] : this->bmBuffer)
+	{
+		pages.emplace_back(pageIdx);
+	}
+	return pages;
+}
+[[nodiscard]] std::size_t pdfv::hdc::Renderer::bytes() const noexcept
+{
+	std::size_t total{ 0 };
+	for (const auto & [pageIdx, stats] : this->bmBuffer)
+	{
+		// Compatible bitmaps of display DCs are 32 bits per pixel
+		total += std::size_t(stats.size.x) * std::size_t(stats.size.y) * 4;
+	}
+	return total;
+}
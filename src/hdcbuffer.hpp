@@ -1,9 +1,11 @@
 #pragma once
 
 #include "common.hpp"
+#include "governor.hpp"
 
 #include <functional>
 #include <unordered_map>
+#include <vector>
 
 namespace pdfv::hdc
 {
@@ -16,12 +18,40 @@ namespace pdfv::hdc
 		{
 			RenderT hrender;
 			xy<int> size;
+			/**
+			 * @brief Tick count of the last use, see MemoryGovernor::s_now
+			 * 
+			 */
+			u64 lastUse{ 0 };
+			/**
+			 * @brief Rendering time in microseconds
+			 * 
+			 */
+			u64 cost{ 0 };
 		};
 
 	private:
 		std::unordered_map<std::size_t, RenderStats> bmBuffer;
+		/**
+		 * @brief Registration with the memory governor, every object has its own, a moved-from
+		 * buffer stays registered empty
+		 * 
+		 */
+		u64 m_governorId{ 0 };
+
+		/**
+		 * @brief Registers the buffer with the memory governor
+		 * 
+		 */
+		void registerBuffer() noexcept;
 
 	public:
+		Renderer() noexcept;
+		Renderer(const Renderer & other) = delete;
+		Renderer(Renderer && other) noexcept;
+		Renderer & operator=(const Renderer & other) = delete;
+		Renderer & operator=(Renderer && other) noexcept;
+		~Renderer() noexcept;
 
 		/**
 		 * @brief Clears the render buffer
@@ -36,6 +66,14 @@ namespace pdfv::hdc
 		 * @return true Page has been rendered before and is available
 		 */
 		[[nodiscard]] bool hasPage(std::size_t pageIdx) const noexcept;
+		/**
+		 * @brief Determines whether page asked for has been already rendered with the given size
+		 * 
+		 * @param pageIdx Page index to search
+		 * @param size Render size
+		 * @return true Page is available and putPage wouldn't re-render it
+		 */
+		[[nodiscard]] bool hasPage(std::size_t pageIdx, xy<int> size) const noexcept;
 		/**
 		 * @brief Put new page to render buffer, only re-renders if position and/or size is different
 		 * 
@@ -52,6 +90,10 @@ namespace pdfv::hdc
 		 * @return RenderT& Reference to requested page's render object
 		 */
 		RenderT & getPage(std::size_t pageIdx);
+		/**
+		 * @return std::size_t Least recently used page, 0 if the buffer is empty
+		 */
+		[[nodiscard]] std::size_t oldestPage() const noexcept;
 
 		/**
 		 * @brief Removes pre-rendered page from buffer
@@ -59,5 +101,20 @@ namespace pdfv::hdc
 		 * @param pageIdx Page index
 		 */
 		void removePage(std::size_t pageIdx) noexcept;
+		/**
+		 * @brief Removes all pre-rendered pages that satisfy the predicate
+		 * 
+		 * @param pred Predicate, gets page index as an argument, returns true if page should be removed
+		 * @return std::size_t Number of pages removed
+		 */
+		std::size_t removeIf(const std::function<bool (std::size_t)> & pred);
+		/**
+		 * @return std::vector<std::size_t> Indices of all pre-rendered pages
+		 */
+		[[nodiscard]] std::vector<std::size_t> pages() const;
+		/**
+		 * @return std::size_t Approximate memory usage of the pre-rendered pages in bytes
+		 */
+		[[nodiscard]] std::size_t bytes() const noexcept;
 	};
 }
@@ -0,0 +1,534 @@
+#include "layout.hpp"
+#include "textlayer.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace pdfv
+{
+	struct LayoutBox
+	{
+		f32 left{ std::numeric_limits<f32>::max() }, bottom{ std::numeric_limits<f32>::max() };
+		f32 right{ std::numeric_limits<f32>::lowest() }, top{ std::numeric_limits<f32>::lowest() };
+
+		void add(f32 l, f32 b, f32 r, f32 t) noexcept
+		{
+			this->left   = std::min(this->left,   l);
+			this->bottom = std::min(this->bottom, b);
+			this->right  = std::max(this->right,  r);
+			this->top    = std::max(this->top,    t);
+		}
+		[[nodiscard]] f32 height() const noexcept
+		{
+			return this->top - this->bottom;
+		}
+	};
+	/**
+	 * @brief Characters of a line in reading order, as a range of the candidate array
+	 * 
+	 */
+	struct LayoutLine
+	{
+		u32 first{ 0 }, last{ 0 };
+		LayoutBox box;
+	};
+	struct LayoutBlock
+	{
+		std::vector<u32> lines;
+		LayoutBox box;
+		LayoutBox lastLine;
+	};
+
+	[[nodiscard]] static constexpr bool isSpace(u32 cp) noexcept
+	{
+		return cp <= 0x20 || cp == 0x85 || cp == 0xA0 || cp == 0x1680 || (cp >= 0x2000 && cp <= 0x200B) ||
+			cp == 0x2028 || cp == 0x2029 || cp == 0x202F || cp == 0x205F || cp == 0x3000 || cp == 0xFEFF;
+	}
+	/**
+	 * @brief Hebrew, Arabic, Syriac, Thaana, N'Ko and their presentation forms, plus the
+	 * right-to-left blocks of the supplementary planes
+	 * 
+	 */
+	[[nodiscard]] static constexpr bool isRtl(u32 cp) noexcept
+	{
+		return (cp >= 0x0590 && cp <= 0x08FF) || (cp >= 0xFB1D && cp <= 0xFDFF) || (cp >= 0xFE70 && cp <= 0xFEFF) ||
+			(cp >= 0x10800 && cp <= 0x10FFF) || (cp >= 0x1E800 && cp <= 0x1EFFF);
+	}
+	/**
+	 * @brief Checks whether the content stream has whitespace between two nearby characters
+	 * 
+	 */
+	[[nodiscard]] static bool spaced(const TextLayer & layer, u32 prev, u32 c) noexcept
+	{
+		if (c > prev && c - prev <= 3)
+		{
+			for (auto k{ prev + 1 }; k < c; ++k)
+			{
+				if (isSpace(layer.codepoints[k]))
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+	static void appendCodepoint(std::wstring & out, u32 cp)
+	{
+		if (cp >= 0x10000 && cp <= 0x10FFFF)
+		{
+			cp -= 0x10000;
+			out.push_back(wchar_t(0xD800 + (cp >> 10)));
+			out.push_back(wchar_t(0xDC00 + (cp & 0x3FF)));
+		}
+		else if (cp != 0)
+		{
+			out.push_back(wchar_t(cp));
+		}
+	}
+
+	/**
+	 * @brief Orders blocks by recursive XY-cut: blocks are split into columns at vertical
+	 * gaps running through the whole set, otherwise into stripes at horizontal gaps, sets
+	 * that can't be split are read top to bottom
+	 * 
+	 * @param blocks All blocks
+	 * @param ids Indices of the blocks to order, reordered in place
+	 * @param out Receives the ordered block indices
+	 */
+	static void xyCut(const std::vector<LayoutBlock> & blocks, std::vector<u32> ids, std::vector<u32> & out)
+	{
+		if (ids.size() <= 1)
+		{
+			out.insert(out.end(), ids.begin(), ids.end());
+			return;
+		}
+
+		auto split = [&ids](auto && before, auto && startsNew) -> std::vector<std::vector<u32>>
+		{
+			std::sort(ids.begin(), ids.end(), before);
+			std::vector<std::vector<u32>> groups(1);
+			for (std::size_t i = 0; i < ids.size(); ++i)
+			{
+				// Called for every block, the predicates track the extent of the current group
+				if (startsNew(ids[i]) && i > 0)
+				{
+					groups.emplace_back();
+				}
+				groups.back().emplace_back(ids[i]);
+			}
+			return groups;
+		};
+
+		// Columns, left to right
+		f32 maxRight{ std::numeric_limits<f32>::lowest() };
+		auto groups{ split(
+			[&blocks](u32 a, u32 b) noexcept { return blocks[a].box.left < blocks[b].box.left; },
+			[&blocks, &maxRight](u32 id) noexcept
+			{
+				const bool gap{ blocks[id].box.left > maxRight };
+				maxRight = gap ? blocks[id].box.right : std::max(maxRight, blocks[id].box.right);
+				return gap;
+			}
+		) };
+		if (groups.size() == 1)
+		{
+			// Stripes, top to bottom
+			f32 minBottom{ std::numeric_limits<f32>::max() };
+			groups = split(
+				[&blocks](u32 a, u32 b) noexcept { return blocks[a].box.top > blocks[b].box.top; },
+				[&blocks, &minBottom](u32 id) noexcept
+				{
+					const bool gap{ blocks[id].box.top < minBottom };
+					minBottom = gap ? blocks[id].box.bottom : std::min(minBottom, blocks[id].box.bottom);
+					return gap;
+				}
+			);
+		}
+		if (groups.size() == 1)
+		{
+			// Overlapping blocks, already sorted from top to bottom
+			out.insert(out.end(), ids.begin(), ids.end());
+			return;
+		}
+		for (auto & group : groups)
+		{
+			xyCut(blocks, std::move(group), out);
+		}
+	}
+}
+
+void pdfv::TextLayout::build(const TextLayer & layer)
+{
+	DEBUGPRINT("pdfv::TextLayout::build(%p)\n", static_cast<const void *>(&layer));
+
+	this->m_order.clear();
+	this->m_wordStart.clear();
+	this->m_lineStart.clear();
+	this->m_blockStart.clear();
+
+	const auto & L{ layer.left };
+	const auto & B{ layer.bottom };
+	const auto & R{ layer.right };
+	const auto & T{ layer.top };
+	auto height = [&B, &T](u32 i) noexcept { return T[i] - B[i]; };
+	auto center = [&B, &T](u32 i) noexcept { return (B[i] + T[i]) * 0.5f; };
+
+	std::vector<u32> chars;
+	chars.reserve(layer.size());
+	for (std::size_t i = 0; i < layer.size(); ++i)
+	{
+		if (R[i] > L[i] && T[i] > B[i] && !isSpace(layer.codepoints[i]))
+		{
+			chars.emplace_back(u32(i));
+		}
+	}
+	if (chars.empty())
+	{
+		return;
+	}
+
+	// Vertical text would make a row of every character, such pages are read in stream order
+	std::size_t stacked{ 0 }, beside{ 0 };
+	for (std::size_t i = 1; i < chars.size(); ++i)
+	{
+		const auto a{ chars[i - 1] }, b{ chars[i] };
+		const auto overlapX{ std::min(R[a], R[b]) - std::max(L[a], L[b]) };
+		const auto overlapY{ std::min(T[a], T[b]) - std::max(B[a], B[b]) };
+		if (overlapX > 0.5f * std::min(R[a] - L[a], R[b] - L[b]) && T[b] <= center(a))
+		{
+			++stacked;
+		}
+		else if (overlapY > 0.5f * std::min(height(a), height(b)))
+		{
+			++beside;
+		}
+	}
+	if (stacked > beside)
+	{
+		this->buildStreamOrder(layer, chars);
+		return;
+	}
+
+	// Rows: sweep from top to bottom, a row takes every character centered within
+	// the vertical extent of its topmost character
+	std::sort(chars.begin(), chars.end(), [&center, &L](u32 a, u32 b) noexcept
+	{
+		const auto ca{ center(a) }, cb{ center(b) };
+		return (ca != cb) ? ca > cb : L[a] < L[b];
+	});
+
+	struct Run
+	{
+		f32 left;
+		u32 first, last;
+	};
+	std::vector<Run> runs;
+	std::vector<u32> scratch;
+	// A run continues while the stream moves on to the right, skipping whitespace only
+	auto continues = [&layer, &L, &R](u32 prev, u32 c) noexcept
+	{
+		if (c <= prev || c - prev > 3 || L[c] < L[prev] - 0.5f * (R[prev] - L[prev]))
+		{
+			return false;
+		}
+		for (auto k{ prev + 1 }; k < c; ++k)
+		{
+			if (!isSpace(layer.codepoints[k]))
+			{
+				return false;
+			}
+		}
+		return true;
+	};
+
+	std::vector<LayoutLine> lines;
+	for (std::size_t row = 0; row < chars.size();)
+	{
+		const auto rowBottom{ B[chars[row]] };
+		auto end{ row + 1 };
+		for (; end < chars.size() && center(chars[end]) >= rowBottom; ++end);
+
+		// Runs of consecutive characters keep their stream order and only runs are placed
+		// from left to right, rows with right-to-left script aren't reordered at all
+		std::sort(chars.begin() + ssize_t(row), chars.begin() + ssize_t(end));
+		const bool rtl{ std::any_of(chars.begin() + ssize_t(row), chars.begin() + ssize_t(end), [&layer](u32 c) noexcept
+		{
+			return isRtl(layer.codepoints[c]);
+		}) };
+		if (!rtl)
+		{
+			runs.clear();
+			for (auto i{ row }; i < end; ++i)
+			{
+				const auto c{ chars[i] };
+				if (i == row || !continues(chars[i - 1], c))
+				{
+					runs.push_back({ L[c], u32(i), u32(i) });
+				}
+				runs.back().left = std::min(runs.back().left, L[c]);
+				runs.back().last = u32(i + 1);
+			}
+			if (runs.size() > 1)
+			{
+				std::stable_sort(runs.begin(), runs.end(), [](const Run & a, const Run & b) noexcept
+				{
+					return a.left < b.left;
+				});
+				scratch.clear();
+				for (const auto & run : runs)
+				{
+					scratch.insert(scratch.end(), chars.begin() + ssize_t(run.first), chars.begin() + ssize_t(run.last));
+				}
+				std::copy(scratch.begin(), scratch.end(), chars.begin() + ssize_t(row));
+			}
+		}
+
+		// Lines: a row splits at gaps wide enough to be column gutters
+		LayoutLine line{ u32(row), u32(row), {} };
+		for (auto i{ row }; i < end; ++i)
+		{
+			const auto c{ chars[i] };
+			if (i > row && L[c] - line.box.right > s_cColumnGap * std::max(line.box.height(), height(c)))
+			{
+				line.last = u32(i);
+				lines.emplace_back(line);
+				line = { u32(i), u32(i), {} };
+			}
+			line.box.add(L[c], B[c], R[c], T[c]);
+		}
+		line.last = u32(end);
+		lines.emplace_back(line);
+
+		row = end;
+	}
+
+	// Blocks: sweep lines from top to bottom, a line continues the nearest block above it
+	// that overlaps it horizontally and has a similar line height
+	std::vector<u32> byTop(lines.size());
+	for (std::size_t i = 0; i < byTop.size(); ++i)
+	{
+		byTop[i] = u32(i);
+	}
+	std::stable_sort(byTop.begin(), byTop.end(), [&lines](u32 a, u32 b) noexcept
+	{
+		return lines[a].box.top > lines[b].box.top;
+	});
+
+	std::vector<LayoutBlock> blocks;
+	std::vector<u32> active;
+	for (auto id : byTop)
+	{
+		const auto & box{ lines[id].box };
+		const auto h{ box.height() };
+
+		ssize_t best{ -1 };
+		f32 bestGap{ std::numeric_limits<f32>::max() };
+		for (std::size_t a = 0; a < active.size();)
+		{
+			const auto & last{ blocks[active[a]].lastLine };
+			const auto lastH{ last.height() };
+			const auto gap{ last.bottom - box.top };
+			// Lines are visited by descending top edge, the block can't be reached anymore
+			if (gap > s_cLineGap * s_cHeightRatio * lastH)
+			{
+				active[a] = active.back();
+				active.pop_back();
+				continue;
+			}
+			++a;
+
+			const auto overlap{ std::min(box.right, last.right) - std::max(box.left, last.left) };
+			const auto minWidth{ std::min(box.right - box.left, last.right - last.left) };
+			if (std::max(h, lastH) > s_cHeightRatio * std::min(h, lastH) ||
+				gap > s_cLineGap * std::max(h, lastH) || gap < -0.5f * std::min(h, lastH) ||
+				overlap < 0.5f * minWidth)
+			{
+				continue;
+			}
+			if (gap < bestGap)
+			{
+				best    = ssize_t(active[a - 1]);
+				bestGap = gap;
+			}
+		}
+
+		if (best == -1)
+		{
+			active.emplace_back(u32(blocks.size()));
+			blocks.emplace_back();
+			best = ssize_t(blocks.size() - 1);
+		}
+		auto & block{ blocks[std::size_t(best)] };
+		block.lines.emplace_back(id);
+		block.box.add(box.left, box.bottom, box.right, box.top);
+		block.lastLine = box;
+	}
+
+	std::vector<u32> blockOrder;
+	blockOrder.reserve(blocks.size());
+	{
+		std::vector<u32> ids(blocks.size());
+		for (std::size_t i = 0; i < ids.size(); ++i)
+		{
+			ids[i] = u32(i);
+		}
+		xyCut(blocks, std::move(ids), blockOrder);
+	}
+
+	// Words: a line splits at wide gaps and where the content stream has whitespace
+	this->m_order.reserve(chars.size());
+	this->m_wordStart.reserve(chars.size() / 4 + 1);
+	this->m_lineStart.reserve(lines.size() + 1);
+	this->m_blockStart.reserve(blocks.size() + 1);
+	for (auto b : blockOrder)
+	{
+		this->m_blockStart.emplace_back(u32(this->m_lineStart.size()));
+		for (auto id : blocks[b].lines)
+		{
+			const auto & line{ lines[id] };
+			const auto wordGap{ s_cWordGap * line.box.height() };
+			this->m_lineStart.emplace_back(u32(this->m_wordStart.size()));
+
+			f32 right{ std::numeric_limits<f32>::lowest() };
+			for (auto i{ line.first }; i < line.last; ++i)
+			{
+				const auto c{ chars[i] };
+				const bool newWord{ i == line.first || L[c] - right > wordGap || spaced(layer, chars[i - 1], c) };
+				if (newWord)
+				{
+					this->m_wordStart.emplace_back(u32(this->m_order.size()));
+					right = std::numeric_limits<f32>::lowest();
+				}
+				this->m_order.emplace_back(c);
+				right = std::max(right, R[c]);
+			}
+		}
+	}
+	this->m_wordStart.emplace_back(u32(this->m_order.size()));
+	this->m_lineStart.emplace_back(u32(this->m_wordStart.size() - 1));
+	this->m_blockStart.emplace_back(u32(this->m_lineStart.size() - 1));
+
+	DEBUGPRINT("Layout: %zu chars, %zu words, %zu lines, %zu blocks\n", this->m_order.size(), this->words(), this->lines(), this->blocks());
+}
+
+void pdfv::TextLayout::buildStreamOrder(const TextLayer & layer, const std::vector<u32> & chars)
+{
+	DEBUGPRINT("pdfv::TextLayout::buildStreamOrder(%p, %zu)\n", static_cast<const void *>(&layer), chars.size());
+
+	const auto & L{ layer.left };
+	const auto & R{ layer.right };
+	const auto & T{ layer.top };
+	const auto & B{ layer.bottom };
+
+	// A single block, a line ends where the next character isn't below the previous one
+	this->m_order.assign(chars.begin(), chars.end());
+	this->m_blockStart.emplace_back(0);
+	for (std::size_t i = 0; i < chars.size(); ++i)
+	{
+		const auto c{ chars[i] };
+		if (i == 0)
+		{
+			this->m_lineStart.emplace_back(0);
+			this->m_wordStart.emplace_back(0);
+			continue;
+		}
+		const auto prev{ chars[i - 1] };
+		const auto overlapX{ std::min(R[prev], R[c]) - std::max(L[prev], L[c]) };
+		if (overlapX <= 0.5f * std::min(R[prev] - L[prev], R[c] - L[c]) || T[c] > (T[prev] + B[prev]) * 0.5f)
+		{
+			this->m_lineStart.emplace_back(u32(this->m_wordStart.size()));
+			this->m_wordStart.emplace_back(u32(i));
+		}
+		else if (spaced(layer, prev, c))
+		{
+			this->m_wordStart.emplace_back(u32(i));
+		}
+	}
+	this->m_wordStart.emplace_back(u32(this->m_order.size()));
+	this->m_lineStart.emplace_back(u32(this->m_wordStart.size() - 1));
+	this->m_blockStart.emplace_back(u32(this->m_lineStart.size() - 1));
+
+	DEBUGPRINT("Layout: %zu chars in stream order, %zu words, %zu lines\n", this->m_order.size(), this->words(), this->lines());
+}
+
+[[nodiscard]] std::size_t pdfv::TextLayout::bytes() const noexcept
+{
+	return (this->m_order.capacity() + this->m_wordStart.capacity() +
+		this->m_lineStart.capacity() + this->m_blockStart.capacity()) * sizeof(u32);
+}
+
+[[nodiscard]] std::wstring pdfv::TextLayout::text(const TextLayer & layer) const
+{
+	return this->text(layer, nullptr, this->m_order.size());
+}
+[[nodiscard]] std::wstring pdfv::TextLayout::text(const TextLayer & layer, const std::vector<u32> & chars) const
+{
+	if (chars.empty())
+	{
+		return {};
+	}
+	std::vector<u8> selected(layer.size());
+	for (auto c : chars)
+	{
+		if (c < selected.size()) [[likely]]
+		{
+			selected[c] = 1;
+		}
+	}
+	return this->text(layer, selected.data(), chars.size());
+}
+[[nodiscard]] std::wstring pdfv::TextLayout::text(const TextLayer & layer, const u8 * selected, std::size_t count) const
+{
+	enum Separator : u8
+	{
+		none,
+		word,
+		line,
+		block
+	};
+
+	std::wstring out;
+	out.reserve(count + count / 5);
+
+	Separator sep{ none };
+	for (std::size_t b = 0; b < this->blocks(); ++b)
+	{
+		for (auto l{ this->m_blockStart[b] }; l < this->m_blockStart[b + 1]; ++l)
+		{
+			for (auto w{ this->m_lineStart[l] }; w < this->m_lineStart[l + 1]; ++w)
+			{
+				for (auto k{ this->m_wordStart[w] }; k < this->m_wordStart[w + 1]; ++k)
+				{
+					const auto c{ this->m_order[k] };
+					if (selected != nullptr && !selected[c])
+					{
+						continue;
+					}
+					if (!out.empty())
+					{
+						switch (sep)
+						{
+						case word:
+							out.push_back(L' ');
+							break;
+						case line:
+							out += L"\r\n";
+							break;
+						case block:
+							out += L"\r\n\r\n";
+							break;
+						default:
+							break;
+						}
+					}
+					sep = none;
+					appendCodepoint(out, layer.codepoints[c]);
+				}
+				sep = std::max(sep, word);
+			}
+			sep = std::max(sep, line);
+		}
+		sep = std::max(sep, block);
+	}
+	return out;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <string>
+#include <vector>
+
+namespace pdfv
+{
+	struct TextLayer;
+
+	/**
+	 * @brief Reading-order layout of a page: characters grouped into words, words into lines,
+	 * lines into blocks, blocks ordered column by column. Built once from the character
+	 * boxes of a text layer. Runs of consecutive characters keep the order the content
+	 * stream draws them in, so do whole rows of right-to-left script and pages of vertical
+	 * text
+	 * 
+	 */
+	class TextLayout
+	{
+	public:
+		/**
+		 * @brief Horizontal gap, relative to line height, that separates two words
+		 * 
+		 */
+		static constexpr f32 s_cWordGap{ 0.2f };
+		/**
+		 * @brief Horizontal gap, relative to line height, that separates two lines on the
+		 * same row, e.g. neighbouring columns
+		 * 
+		 */
+		static constexpr f32 s_cColumnGap{ 1.5f };
+		/**
+		 * @brief Maximum vertical gap, relative to line height, between two lines of the
+		 * same block
+		 * 
+		 */
+		static constexpr f32 s_cLineGap{ 1.0f };
+		/**
+		 * @brief Maximum height ratio of two lines of the same block
+		 * 
+		 */
+		static constexpr f32 s_cHeightRatio{ 1.4f };
+
+	private:
+		/**
+		 * @brief Character indices in reading order, whitespace and characters without
+		 * a box are left out
+		 * 
+		 */
+		std::vector<u32> m_order;
+		/**
+		 * @brief Offset of each word in m_order, followed by the total character count
+		 * 
+		 */
+		std::vector<u32> m_wordStart;
+		/**
+		 * @brief Index of the first word of each line, followed by the total word count
+		 * 
+		 */
+		std::vector<u32> m_lineStart;
+		/**
+		 * @brief Index of the first line of each block, followed by the total line count
+		 * 
+		 */
+		std::vector<u32> m_blockStart;
+
+	public:
+		/**
+		 * @brief Analyses the character boxes of a text layer, O(n log n) in the number
+		 * of characters
+		 * 
+		 * @param layer Text layer
+		 */
+		void build(const TextLayer & layer);
+
+		/**
+		 * @return true Layout contains no characters
+		 */
+		[[nodiscard]] bool empty() const noexcept
+		{
+			return this->m_order.empty();
+		}
+		[[nodiscard]] std::size_t words() const noexcept
+		{
+			return this->m_wordStart.empty() ? 0 : this->m_wordStart.size() - 1;
+		}
+		[[nodiscard]] std::size_t lines() const noexcept
+		{
+			return this->m_lineStart.empty() ? 0 : this->m_lineStart.size() - 1;
+		}
+		[[nodiscard]] std::size_t blocks() const noexcept
+		{
+			return this->m_blockStart.empty() ? 0 : this->m_blockStart.size() - 1;
+		}
+		/**
+		 * @return const std::vector<u32>& Character indices in reading order
+		 */
+		[[nodiscard]] const std::vector<u32> & order() const noexcept
+		{
+			return this->m_order;
+		}
+		/**
+		 * @return std::size_t Approximate memory usage in bytes, excluding the object itself
+		 */
+		[[nodiscard]] std::size_t bytes() const noexcept;
+
+		/**
+		 * @brief Converts the whole page to text in reading order. Words are separated by
+		 * spaces, lines by line breaks and blocks by empty lines
+		 * 
+		 * @param layer Text layer the layout was built from
+		 * @return std::wstring Text
+		 */
+		[[nodiscard]] std::wstring text(const TextLayer & layer) const;
+		/**
+		 * @brief Converts a set of characters to text in reading order, separators are
+		 * only emitted between characters of the set
+		 * 
+		 * @param layer Text layer the layout was built from
+		 * @param chars Character indices in any order
+		 * @return std::wstring Text
+		 */
+		[[nodiscard]] std::wstring text(const TextLayer & layer, const std::vector<u32> & chars) const;
+
+	private:
+		/**
+		 * @brief Lays out vertical text: characters in stream order, a line per column and
+		 * a single block
+		 * 
+		 * @param layer Text layer
+		 * @param chars Indices of the characters with a box, in stream order
+		 */
+		void buildStreamOrder(const TextLayer & layer, const std::vector<u32> & chars);
+		/**
+		 * @param layer Text layer the layout was built from
+		 * @param selected Per-character flags, nullptr selects every character
+		 * @param count Expected number of characters, used to reserve the output
+		 * @return std::wstring Text
+		 */
+		[[nodiscard]] std::wstring text(const TextLayer & layer, const u8 * selected, std::size_t count) const;
+	};
+}
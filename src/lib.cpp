@@ -1,6 +1,13 @@
 #include "lib.hpp"
 #include "mainwindow.hpp"
+#include "hash.hpp"
+#include "trailer.hpp"
+#include <fpdf_edit.h>
+#include <fpdf_text.h>
+#include <fpdf_annot.h>
 #include <iostream>
+#include <vector>
+#include <algorithm>
 
 static struct PdfiumFree
 {
@@ -22,9 +29,17 @@ pdfv::Pdfium::Pdfium() noexcept
 	}
 }
 pdfv::Pdfium::Pdfium(Pdfium && other) noexcept
-	: m_fdoc(other.m_fdoc), m_fpage(other.m_fpage),
+	: m_fdoc(other.m_fdoc), m_borrowed(std::move(other.m_borrowed)), m_fpage(other.m_fpage),
 	m_fpagenum(other.m_fpagenum), m_numPages(other.m_numPages),
-	m_buf(std::move(other.m_buf)), m_optRenderer(std::move(other.m_optRenderer))
+	m_renderPos(other.m_renderPos), m_renderSize(other.m_renderSize),
+	m_buf(std::move(other.m_buf)), m_bufSize(other.m_bufSize), m_docId(other.m_docId),
+	m_fingerprint(other.m_fingerprint),
+	m_path(std::move(other.m_path)), m_stamp(other.m_stamp),
+	m_optRenderer(std::move(other.m_optRenderer)), m_links(std::move(other.m_links)),
+	m_outline(std::move(other.m_outline)), m_dests(std::move(other.m_dests)), m_labels(std::move(other.m_labels)),
+	m_thumbs(std::move(other.m_thumbs)), m_tags(std::move(other.m_tags)),
+	m_attachments(std::move(other.m_attachments)), m_objects(std::move(other.m_objects)),
+	m_profile(std::move(other.m_profile)), m_reload(std::move(other.m_reload))
 {
 	DEBUGPRINT("pdfv::Pdfium::Pdfium(%p)\n", static_cast<void *>(&other));
 	other.m_fdoc  = nullptr;
@@ -35,11 +50,29 @@ pdfv::Pdfium & pdfv::Pdfium::operator=(Pdfium && other) noexcept
 	DEBUGPRINT("pdfv::Pdfium::operator=(%p)\n", static_cast<void *>(&other));
 
 	this->m_fdoc        = other.m_fdoc;
+	this->m_borrowed    = std::move(other.m_borrowed);
 	this->m_fpage       = other.m_fpage;
 	this->m_fpagenum    = other.m_fpagenum;
 	this->m_numPages    = other.m_numPages;
+	this->m_renderPos   = other.m_renderPos;
+	this->m_renderSize  = other.m_renderSize;
 	this->m_buf         = std::move(other.m_buf);
+	this->m_bufSize     = other.m_bufSize;
+	this->m_docId       = other.m_docId;
+	this->m_fingerprint = other.m_fingerprint;
+	this->m_path        = std::move(other.m_path);
+	this->m_stamp       = other.m_stamp;
 	this->m_optRenderer = std::move(other.m_optRenderer);
+	this->m_links       = std::move(other.m_links);
+	this->m_outline     = std::move(other.m_outline);
+	this->m_dests       = std::move(other.m_dests);
+	this->m_labels      = std::move(other.m_labels);
+	this->m_thumbs      = std::move(other.m_thumbs);
+	this->m_tags        = std::move(other.m_tags);
+	this->m_attachments = std::move(other.m_attachments);
+	this->m_objects     = std::move(other.m_objects);
+	this->m_profile     = std::move(other.m_profile);
+	this->m_reload      = std::move(other.m_reload);
 
 	other.m_fdoc  = nullptr;
 	other.m_fpage = nullptr;
@@ -58,6 +91,7 @@ void pdfv::Pdfium::init() noexcept
 	DEBUGPRINT("pdfv::Pdfium::init()\n");
 
 	assert(s_libInit == false);
+	std::lock_guard lock{ s_mutex };
 	
 	FPDF_LIBRARY_CONFIG config{};
 	config.version = 2;
@@ -74,6 +108,7 @@ void pdfv::Pdfium::free() noexcept
 	}
 
 	// Free library as usual
+	std::lock_guard lock{ s_mutex };
 	FPDF_DestroyLibrary();
 	s_libInit = false;
 }
@@ -87,6 +122,313 @@ void pdfv::Pdfium::free() noexcept
 	s_errorHappened = false;
 	return error::Errorcode(FPDF_GetLastError() + error::pdf_success);
 }
+[[nodiscard]] std::string pdfv::Pdfium::s_credentialKey(
+	const u8 * data, std::size_t length, std::wstring_view path, bool * encrypted
+) noexcept
+{
+	DEBUGPRINT("pdfv::Pdfium::s_credentialKey(%p, %zu)\n", static_cast<const void *>(data), length);
+
+	const auto info{ trailer::scan(data, length) };
+	if (encrypted != nullptr)
+	{
+		*encrypted = info.encrypted;
+	}
+	try
+	{
+		if (!info.id.empty())
+		{
+			return "id:" + info.id;
+		}
+		else if (!path.empty())
+		{
+			return "path:" + utf::conv(path);
+		}
+	}
+	catch (...)
+	{
+	}
+	return {};
+}
+[[nodiscard]] std::string pdfv::Pdfium::getCredential(
+	const u8 * data, std::size_t length, std::wstring_view path
+)
+{
+	DEBUGPRINT("pdfv::Pdfium::getCredential(%p, %zu)\n", static_cast<const void *>(data), length);
+
+	auto key{ s_credentialKey(data, length, path) };
+	std::lock_guard lock{ s_mutex };
+	if (auto it{ s_credentials.find(key) }; !key.empty() && it != s_credentials.end())
+	{
+		return it->second;
+	}
+	return {};
+}
+pdfv::error::Errorcode pdfv::Pdfium::s_openDoc(
+	const MainWindow & window, std::wstring_view path,
+	const u8 * data, std::size_t length, FPDF_DOCUMENT & doc
+) noexcept
+{
+	DEBUGPRINT("pdfv::Pdfium::s_openDoc(%p, %zu)\n", static_cast<const void *>(data), length);
+
+	bool encrypted{ false };
+	auto key{ s_credentialKey(data, length, path, &encrypted) };
+
+	// Known encrypted document with a remembered password is opened with a single parse
+	bool needsPassword{ false };
+	if (encrypted && !key.empty())
+	{
+		std::lock_guard lock{ s_mutex };
+		if (auto it{ s_credentials.find(key) }; it != s_credentials.end())
+		{
+			doc = FPDF_LoadMemDocument(data, int(length), it->second.c_str());
+			if (doc != nullptr) [[likely]]
+			{
+				return error::pdf_success;
+			}
+			// Password has been changed in the meantime, the document still has one
+			s_credentials.erase(it);
+			needsPassword = true;
+		}
+		else
+		{
+			needsPassword = s_needsPassword.contains(key);
+		}
+	}
+
+	/*
+	 * Documents with only an owner password open without any password, so they are never
+	 * prompted for; user-password documents fail at the security handler, right after
+	 * the cross-reference parse, before any page tree is loaded. Only the first open of
+	 * an encrypted document can't tell the two apart from the trailer
+	 */
+	error::Errorcode err{ error::pdf_password };
+	if (!needsPassword)
+	{
+		std::lock_guard lock{ s_mutex };
+		doc = FPDF_LoadMemDocument(data, int(length), nullptr);
+		if (doc != nullptr) [[likely]]
+		{
+			return error::pdf_success;
+		}
+
+		s_errorHappened = true;
+		err = getLastError();
+		if (err == error::pdf_password && encrypted && !key.empty())
+		{
+			try
+			{
+				s_needsPassword.emplace(key);
+			}
+			catch (...)
+			{
+			}
+		}
+	}
+	for (std::size_t attempt = 0; err == error::pdf_password && attempt < s_cPasswordAttempts; ++attempt)
+	{
+		auto ans{ askInfo(window, (attempt == 0) ? L"Enter password:" : L"Wrong password, try again:", window.getTitle()) };
+		if (ans.empty())
+		{
+			break;
+		}
+		std::string password;
+		try
+		{
+			password = utf::conv(ans);
+		}
+		catch (...)
+		{
+			return error::pdf_password;
+		}
+
+		std::lock_guard lock{ s_mutex };
+		doc = FPDF_LoadMemDocument(data, int(length), password.c_str());
+		if (doc != nullptr) [[likely]]
+		{
+			if (!key.empty())
+			{
+				try
+				{
+					s_credentials.insert_or_assign(std::move(key), std::move(password));
+				}
+				catch (...)
+				{
+				}
+			}
+			return error::pdf_success;
+		}
+
+		s_errorHappened = true;
+		err = getLastError();
+	}
+
+	return err;
+}
+[[nodiscard]] bool pdfv::Pdfium::getFileStamp(const std::wstring & path, FileStamp & stamp) noexcept
+{
+	WIN32_FILE_ATTRIBUTE_DATA data{};
+	if (!::GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data)) [[unlikely]]
+	{
+		return false;
+	}
+
+	stamp.size      = (u64(data.nFileSizeHigh) << 32) | u64(data.nFileSizeLow);
+	stamp.writeTime = (u64(data.ftLastWriteTime.dwHighDateTime) << 32) | u64(data.ftLastWriteTime.dwLowDateTime);
+	return true;
+}
+pdfv::error::Errorcode pdfv::Pdfium::readFile(
+	const std::wstring & path,
+	std::unique_ptr<u8[]> & data, std::size_t & length, FileStamp & stamp
+) noexcept
+{
+	DEBUGPRINT("pdfv::Pdfium::readFile(%p)\n", static_cast<const void *>(path.c_str()));
+
+	auto file{ ::CreateFileW(
+		path.c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		nullptr
+	) };
+	if (file == INVALID_HANDLE_VALUE) [[unlikely]]
+	{
+		return error::pdf_file;
+	}
+
+	// Stamp is taken before reading, so that any later write is detected as a change
+	if (!getFileStamp(path, stamp)) [[unlikely]]
+	{
+		::CloseHandle(file);
+		return error::pdf_file;
+	}
+
+	auto size{ ::GetFileSize(file, nullptr) };
+	if (size == INVALID_FILE_SIZE) [[unlikely]]
+	{
+		::CloseHandle(file);
+		return error::pdf_file;
+	}
+
+	data.reset(new (std::nothrow) u8[size]);
+	if (data == nullptr) [[unlikely]]
+	{
+		::CloseHandle(file);
+		return error::pdf_file;
+	}
+
+	DWORD read{ 0 };
+	auto success{ ::ReadFile(file, data.get(), size, &read, nullptr) };
+	::CloseHandle(file);
+	if (!success) [[unlikely]]
+	{
+		data.reset();
+		return error::pdf_file;
+	}
+
+	length = std::size_t(read);
+	return error::noerror;
+}
+pdfv::error::Errorcode pdfv::Pdfium::readFile(
+	const std::wstring & path,
+	std::unique_ptr<u8[]> & data, std::size_t & length, FileStamp & stamp, u64 & fingerprint
+) noexcept
+{
+	const auto err{ readFile(path, data, length, stamp) };
+	if (err == error::noerror) [[likely]]
+	{
+		fingerprint = hash::fingerprint(data.get(), length);
+	}
+	return err;
+}
+[[nodiscard]] pdfv::u64 pdfv::Pdfium::pageHash(FPDF_DOCUMENT doc, std::size_t page) noexcept
+{
+	DEBUGPRINT("pdfv::Pdfium::pageHash(%p, %zu)\n", static_cast<void *>(doc), page);
+	assert(page >= 1);
+	std::lock_guard lock{ s_mutex };
+
+	auto fpage{ FPDF_LoadPage(doc, int(page - 1)) };
+	if (fpage == nullptr) [[unlikely]]
+	{
+		return 0;
+	}
+	auto textpage{ FPDFText_LoadPage(fpage) };
+
+	hash::Fnv1a h;
+	h.add(FPDF_GetPageWidthF(fpage));
+	h.add(FPDF_GetPageHeightF(fpage));
+	h.add(FPDFPage_GetRotation(fpage));
+	h.add(FPDFPage_GetAnnotCount(fpage));
+
+	std::vector<u8> temp;
+	std::function<void (FPDF_PAGEOBJECT)> hashObj = [&](FPDF_PAGEOBJECT obj)
+	{
+		const auto type{ FPDFPageObj_GetType(obj) };
+		h.add(type);
+
+		FS_MATRIX matrix{};
+		FPDFPageObj_GetMatrix(obj, &matrix);
+		h.add(matrix);
+
+		float bounds[4]{};
+		FPDFPageObj_GetBounds(obj, &bounds[0], &bounds[1], &bounds[2], &bounds[3]);
+		h.add(bounds);
+
+		unsigned int color[4]{};
+		FPDFPageObj_GetFillColor(obj, &color[0], &color[1], &color[2], &color[3]);
+		h.add(color);
+		FPDFPageObj_GetStrokeColor(obj, &color[0], &color[1], &color[2], &color[3]);
+		h.add(color);
+
+		switch (type)
+		{
+		case FPDF_PAGEOBJ_TEXT:
+			if (textpage != nullptr) [[likely]]
+			{
+				temp.resize(FPDFTextObj_GetText(obj, textpage, nullptr, 0));
+				FPDFTextObj_GetText(obj, textpage, reinterpret_cast<FPDF_WCHAR *>(temp.data()), temp.size());
+				h.bytes(temp.data(), temp.size());
+			}
+			break;
+		case FPDF_PAGEOBJ_PATH:
+			for (int i = 0, n = FPDFPath_CountSegments(obj); i < n; ++i)
+			{
+				auto seg{ FPDFPath_GetPathSegment(obj, i) };
+				float pt[2]{};
+				FPDFPathSegment_GetPoint(seg, &pt[0], &pt[1]);
+				h.add(pt);
+				h.add(FPDFPathSegment_GetType(seg));
+			}
+			break;
+		case FPDF_PAGEOBJ_IMAGE:
+			temp.resize(FPDFImageObj_GetImageDataRaw(obj, nullptr, 0));
+			FPDFImageObj_GetImageDataRaw(obj, temp.data(), temp.size());
+			h.bytes(temp.data(), temp.size());
+			break;
+		case FPDF_PAGEOBJ_FORM:
+			for (int i = 0, n = FPDFFormObj_CountObjects(obj); i < n; ++i)
+			{
+				hashObj(FPDFFormObj_GetObject(obj, static_cast<unsigned long>(i)));
+			}
+			break;
+		}
+	};
+
+	for (int i = 0, n = FPDFPage_CountObjects(fpage); i < n; ++i)
+	{
+		hashObj(FPDFPage_GetObject(fpage, i));
+	}
+
+	if (textpage != nullptr) [[likely]]
+	{
+		FPDFText_ClosePage(textpage);
+	}
+	FPDF_ClosePage(fpage);
+
+	// 0 is reserved for failure
+	return (h.get() != 0) ? h.get() : 1;
+}
 pdfv::error::Errorcode pdfv::Pdfium::pdfLoad(
 	const MainWindow & window,
 	std::string_view path, std::size_t page
@@ -107,33 +449,61 @@ pdfv::error::Errorcode pdfv::Pdfium::pdfLoad(
 	assert(s_libInit == true);
 	this->pdfUnload();
 
-	auto file{ ::CreateFileW(
-		path.c_str(),
-		GENERIC_READ,
-		FILE_SHARE_READ,
-		nullptr,
-		OPEN_EXISTING,
-		FILE_ATTRIBUTE_NORMAL,
-		nullptr
-	) };
-	if (file == INVALID_HANDLE_VALUE) [[unlikely]]
+	std::unique_ptr<u8[]> buf;
+	std::size_t length{ 0 };
+	FileStamp stamp;
+	u64 fingerprint{ 0 };
+	if (auto err{ this->readFile(path, buf, length, stamp, fingerprint) }; err != error::noerror) [[unlikely]]
 	{
-		return error::pdf_file;
+		return err;
 	}
 
-	auto size{ ::GetFileSize(file, nullptr) };
-	auto buf{ new std::uint8_t[size] };
-	DWORD read{ 0 };
+	return this->pdfLoad(window, path, std::move(buf), length, stamp, fingerprint, page);
+}
+pdfv::error::Errorcode pdfv::Pdfium::pdfLoad(
+	const MainWindow & window,
+	const std::wstring & path, std::unique_ptr<u8[]> && data, std::size_t length,
+	const FileStamp & stamp, u64 fingerprint, std::size_t page
+)
+{
+	DEBUGPRINT("pdfv::Pdfium::pdfLoad(%p, && %p, %zu, %zu)\n", static_cast<const void *>(path.c_str()), static_cast<void *>(data.get()), length, page);
+	assert(s_libInit == true);
+	this->pdfUnload();
 
-	if (::ReadFile(file, buf, size, &read, nullptr))
+	this->m_buf     = std::move(data);
+	this->m_bufSize = length;
+	this->m_path    = path;
+	this->m_stamp   = stamp;
+
+	if (auto err{ this->s_openDoc(window, this->m_path, this->m_buf.get(), length, this->m_fdoc) }; err != error::pdf_success) [[unlikely]]
 	{
-		::CloseHandle(file);
-		return this->pdfLoad(window, std::move(buf), std::size_t(read), page);
+		return err;
 	}
 
-	::CloseHandle(file);
-
-	return error::pdf_file;
+	std::lock_guard lock{ s_mutex };
+	// Nothing to show in a document without pages, page numbers start from 1
+	const auto count{ FPDF_GetPageCount(this->m_fdoc) };
+	if (count <= 0) [[unlikely]]
+	{
+		FPDF_CloseDocument(this->m_fdoc);
+		this->m_fdoc = nullptr;
+		return error::pdf_format;
+	}
+	this->m_numPages    = std::size_t(count);
+	this->m_docId       = ++s_docCounter;
+	this->m_fingerprint = fingerprint;
+	this->m_borrowed    = std::make_shared<BorrowedDoc>(this->m_fdoc);
+	this->m_links       = std::make_shared<LinkIndex>(this->m_borrowed, this->m_numPages);
+	this->m_outline     = std::make_unique<Outline>(this->m_fdoc);
+	this->m_dests       = std::make_shared<DestIndex>(this->m_borrowed);
+	this->m_labels      = std::make_shared<PageLabels>(this->m_borrowed, this->m_numPages);
+	this->m_thumbs      = std::make_shared<Thumbnails>(this->m_borrowed, this->m_numPages);
+	this->m_tags        = std::make_shared<TagTree>(this->m_borrowed, this->m_numPages);
+	this->m_attachments = std::make_shared<Attachments>(this->m_borrowed);
+	this->m_objects     = std::make_unique<ObjectIndex>(this->m_numPages);
+	this->m_profile     = std::make_shared<DocProfile>(this->m_fdoc, this->m_numPages);
+	// Remembered page might not exist anymore, if the file has changed since
+	return this->pageLoad(std::clamp(page, std::size_t(1), this->m_numPages));
 }
 pdfv::error::Errorcode pdfv::Pdfium::pdfLoad(
 	const MainWindow & window,
@@ -155,33 +525,191 @@ pdfv::error::Errorcode pdfv::Pdfium::pdfLoad(
 ) noexcept
 {
 	DEBUGPRINT("pdfv::Pdfium::pdfLoad(&& %p, %zu, %zu)\n", static_cast<void *>(data), length, page);
+
+	const auto fingerprint{ hash::fingerprint(data, length) };
+	return this->pdfLoad(window, std::wstring(), std::unique_ptr<u8[]>(data), length, FileStamp{}, fingerprint, page);
+}
+pdfv::error::Errorcode pdfv::Pdfium::pdfReload(const MainWindow & window, ReloadRead & read)
+{
+	DEBUGPRINT("pdfv::Pdfium::pdfReload(%p, %p)\n", static_cast<const void *>(&window), static_cast<void *>(&read));
 	assert(s_libInit == true);
-	this->pdfUnload();
 
-	this->m_buf.reset(data);
-	
-	this->m_fdoc = FPDF_LoadMemDocument(this->m_buf.get(), length, nullptr);
-	if (this->m_fdoc == nullptr) [[unlikely]]
+	if (this->m_fdoc == nullptr || this->m_path.empty() || this->m_reload != nullptr) [[unlikely]]
 	{
-		s_errorHappened = true;
-		if (auto err{ this->getLastError() }; err == error::pdf_password)
+		return error::pdf_file;
+	}
+	if (read.err != error::noerror) [[unlikely]]
+	{
+		return read.err;
+	}
+
+	auto buf{ std::move(read.data) };
+	const auto length{ read.length };
+
+	FPDF_DOCUMENT newdoc{ nullptr };
+	if (auto err{ this->s_openDoc(window, this->m_path, buf.get(), length, newdoc) }; err != error::pdf_success) [[unlikely]]
+	{
+		// File might still be in the middle of being written, keep the old document
+		return err;
+	}
+	{
+		std::lock_guard lock{ s_mutex };
+		if (FPDF_GetPageCount(newdoc) <= 0) [[unlikely]]
 		{
-			auto ans{ utf::conv(askInfo(window, L"Enter password:", window.getTitle())) };
-			this->m_fdoc = FPDF_LoadMemDocument(this->m_buf.get(), length, ans.c_str());
-			if (this->m_fdoc == nullptr) [[unlikely]]
-			{
-				s_errorHappened = true;
-				return this->getLastError();
-			}
+			FPDF_CloseDocument(newdoc);
+			return error::pdf_format;
 		}
-		else
+	}
+
+	// Once the job holds the new version, its destructor closes it
+	bool owned{ false };
+	try
+	{
+		auto job{ std::make_shared<PendingReload>() };
+		job->pages = this->m_optRenderer.pages();
+
+		std::lock_guard lock{ s_mutex };
+		job->oldDoc      = this->m_borrowed;
+		job->newDoc      = std::make_shared<BorrowedDoc>(newdoc);
+		owned            = true;
+		job->buf         = std::move(buf);
+		job->length      = length;
+		job->stamp       = read.stamp;
+		job->numPages    = std::size_t(FPDF_GetPageCount(newdoc));
+		job->fingerprint = read.fingerprint;
+		job->oldProfile  = this->m_profile;
+		job->newProfile  = std::make_shared<DocProfile>(newdoc, job->numPages);
+		this->m_reload   = std::move(job);
+	}
+	catch (const std::bad_alloc &)
+	{
+		std::lock_guard lock{ s_mutex };
+		if (!owned)
 		{
-			return err;
+			FPDF_CloseDocument(newdoc);
 		}
+		return error::pdf_file;
 	}
-	
-	this->m_numPages = FPDF_GetPageCount(this->m_fdoc);
-	return this->pageLoad(page);
+	return error::pdf_success;
+}
+pdfv::error::Errorcode pdfv::Pdfium::pdfFinishReload() noexcept
+{
+	DEBUGPRINT("pdfv::Pdfium::pdfFinishReload()\n");
+	assert(s_libInit == true);
+
+	if (this->m_reload == nullptr || !this->m_reload->done.load(std::memory_order_acquire)) [[unlikely]]
+	{
+		return error::pdf_file;
+	}
+	auto job{ std::move(this->m_reload) };
+
+	std::lock_guard lock{ s_mutex };
+	const auto oldPage{ this->m_fpagenum };
+	this->pageUnload();
+
+	// Pages rendered while the comparison was running haven't been compared
+	auto evicted{ this->m_optRenderer.removeIf(
+		[&unchanged = job->unchanged](std::size_t pageIdx) noexcept -> bool
+		{
+			return std::find(unchanged.begin(), unchanged.end(), pageIdx) == unchanged.end();
+		}
+	) };
+	DEBUGPRINT("Reload evicted %zu pre-rendered page(s)\n", evicted);
+	static_cast<void>(evicted);
+
+	this->m_borrowed->detach();
+	this->m_outline = nullptr;
+	FPDF_CloseDocument(this->m_fdoc);
+	s_textLayers.evict(this->m_fingerprint);
+	this->m_borrowed    = std::move(job->newDoc);
+	this->m_fdoc        = this->m_borrowed->get();
+	this->m_buf         = std::move(job->buf);
+	this->m_bufSize     = job->length;
+	this->m_stamp       = job->stamp;
+	this->m_numPages    = job->numPages;
+	this->m_docId       = ++s_docCounter;
+	this->m_fingerprint = job->fingerprint;
+	try
+	{
+		this->m_links       = std::make_shared<LinkIndex>(this->m_borrowed, this->m_numPages);
+		this->m_outline     = std::make_unique<Outline>(this->m_fdoc);
+		this->m_dests       = std::make_shared<DestIndex>(this->m_borrowed);
+		this->m_labels      = std::make_shared<PageLabels>(this->m_borrowed, this->m_numPages);
+		this->m_thumbs      = std::make_shared<Thumbnails>(this->m_borrowed, this->m_numPages);
+		this->m_tags        = std::make_shared<TagTree>(this->m_borrowed, this->m_numPages);
+		this->m_attachments = std::make_shared<Attachments>(this->m_borrowed);
+		this->m_objects     = std::make_unique<ObjectIndex>(this->m_numPages);
+	}
+	catch (const std::bad_alloc &)
+	{
+		this->pdfUnload();
+		return error::pdf_file;
+	}
+	this->m_profile = std::move(job->newProfile);
+
+	// Versions without pages are never swapped in, see pdfReload
+	return this->pageLoad(std::clamp(oldPage, std::size_t(1), this->m_numPages));
+}
+
+pdfv::Pdfium::PendingReload::~PendingReload() noexcept
+{
+	if (this->newDoc != nullptr)
+	{
+		std::lock_guard lock{ s_mutex };
+		FPDF_CloseDocument(this->newDoc->get());
+		this->newDoc->detach();
+	}
+}
+void pdfv::Pdfium::PendingReload::compare() noexcept
+{
+	DEBUGPRINT("pdfv::Pdfium::PendingReload::compare(), %zu page(s)\n", this->pages.size());
+
+	try
+	{
+		this->unchanged.reserve(this->pages.size());
+		for (auto pageIdx : this->pages)
+		{
+			// Tab might have been closed or hibernated in the meantime
+			std::lock_guard lock{ s_mutex };
+			if (this->oldDoc->get() == nullptr)
+			{
+				return;
+			}
+			if (pageIdx > this->numPages)
+			{
+				continue;
+			}
+			// Resized pages differ without hashing their content
+			const auto oldSize{ this->oldProfile->pageSize(pageIdx) }, newSize{ this->newProfile->pageSize(pageIdx) };
+			if (oldSize.x != newSize.x || oldSize.y != newSize.y)
+			{
+				continue;
+			}
+			const auto oldHash{ Pdfium::pageHash(this->oldDoc->get(), pageIdx) };
+			if (oldHash != 0 && oldHash == Pdfium::pageHash(this->newDoc->get(), pageIdx))
+			{
+				this->unchanged.emplace_back(pageIdx);
+			}
+		}
+	}
+	catch (const std::bad_alloc &)
+	{
+		// Nothing counts as unchanged that hasn't been compared
+	}
+	this->done.store(true, std::memory_order_release);
+}
+[[nodiscard]] bool pdfv::Pdfium::fileChanged(FileStamp & stamp) const noexcept
+{
+	if (this->m_fdoc == nullptr || this->m_path.empty())
+	{
+		return false;
+	}
+	if (!this->getFileStamp(this->m_path, stamp)) [[unlikely]]
+	{
+		// File is being replaced or has been removed
+		return false;
+	}
+	return stamp != this->m_stamp;
 }
 
 void pdfv::Pdfium::pdfUnload() noexcept
@@ -189,12 +717,34 @@ void pdfv::Pdfium::pdfUnload() noexcept
 	DEBUGPRINT("pdfv::Pdfium::pdfUnload()\n");
 	assert(s_libInit == true);
 
+	std::lock_guard lock{ s_mutex };
 	this->pageUnload();
+	// A pending reload stops comparing at its next page once the document is detached,
+	// the new version is closed by whoever holds the job last
+	this->m_reload = nullptr;
 	if (this->m_fdoc != nullptr)
 	{
+		// Background jobs still holding a helper see the document gone from here on
+		if (this->m_borrowed != nullptr)
+		{
+			this->m_borrowed->detach();
+			this->m_borrowed = nullptr;
+		}
+		this->m_links       = nullptr;
+		this->m_dests       = nullptr;
+		this->m_labels      = nullptr;
+		this->m_thumbs      = nullptr;
+		this->m_tags        = nullptr;
+		this->m_attachments = nullptr;
+		this->m_profile     = nullptr;
+		this->m_outline = nullptr;
+		this->m_objects = nullptr;
 		FPDF_CloseDocument(this->m_fdoc);
-		this->m_fdoc     = nullptr;
-		this->m_numPages = 0;
+		s_textLayers.evict(this->m_fingerprint);
+		this->m_fdoc        = nullptr;
+		this->m_numPages    = 0;
+		this->m_docId       = 0;
+		this->m_fingerprint = 0;
 	}
 }
 
@@ -208,6 +758,7 @@ pdfv::error::Errorcode pdfv::Pdfium::pageLoad(std::size_t page) noexcept
 	
 	if (page != this->m_fpagenum)
 	{
+		std::lock_guard lock{ s_mutex };
 		this->pageUnload();
 		this->m_fpage = FPDF_LoadPage(this->m_fdoc, page - 1);
 		if (this->m_fpage == nullptr)
@@ -227,59 +778,84 @@ void pdfv::Pdfium::pageUnload() noexcept
 
 	if (this->m_fpage != nullptr)
 	{
+		std::lock_guard lock{ s_mutex };
 		FPDF_ClosePage(this->m_fpage);
 		this->m_fpage    = nullptr;
 		this->m_fpagenum = 0;
 	}
 }
 
-pdfv::error::Errorcode pdfv::Pdfium::pageRender(HDC dc, pdfv::xy<int> pos, pdfv::xy<int> size)
+void pdfv::Pdfium::s_fitPage(xy<f32> pageSize, xy<int> pos, xy<int> size, xy<int> & outPos, xy<int> & outSize) noexcept
 {
-	DEBUGPRINT("pdfv::Pdfium::pageRender(%p, %p, %p)\n", static_cast<void *>(dc), static_cast<void *>(&pos), static_cast<void *>(&size));
-	assert(s_libInit == true);
+	auto heightfactor{ double(pageSize.y) / double(pageSize.x) };
 
-	if (this->m_fpage != nullptr)
-	{
-		auto heightfactor{ FPDF_GetPageHeight(this->m_fpage) / FPDF_GetPageWidth(this->m_fpage) };
-		
-		pdfv::xy<int> newsize;
-		auto temp1{ size.y - 2 * pos.y };
-		auto temp2{ int(heightfactor * double(size.x - 2 * pos.x)) };
-		newsize.y = std::min(temp1, temp2);
-		newsize.x = int(double(newsize.y) / heightfactor);
-
-		pos = (size - newsize) / 2;
-
-		void * args[]{ this, dc, &newsize };
-		this->m_optRenderer.putPage(
-			this->m_fpagenum,
-			newsize,
-			[](void * args) -> hdc::Renderer::RenderT
-			{
-				DEBUGPRINT("render!\n");
-				auto argv{ reinterpret_cast<void **>(args) };
+	auto temp1{ size.y - 2 * pos.y };
+	auto temp2{ int(heightfactor * double(size.x - 2 * pos.x)) };
+	outSize.y = std::min(temp1, temp2);
+	outSize.x = int(double(outSize.y) / heightfactor);
 
-				auto self{ static_cast<Pdfium * >(argv[0]) };
-				auto dc  { static_cast<HDC      >(argv[1]) };
-				auto size{ static_cast<xy<int> *>(argv[2]) };
+	outPos = (size - outSize) / 2;
+}
+[[nodiscard]] pdfv::hdc::Renderer::RenderT pdfv::Pdfium::s_renderBitmap(
+	HDC dc, FPDF_PAGE page, xy<int> size, const ObjectLayer * objects
+) noexcept
+{
+	DEBUGPRINT("render!\n");
 
-				auto memdc { ::CreateCompatibleDC(dc) };
-				auto render{ ::CreateCompatibleBitmap(dc, size->x, size->y) };
+	auto memdc { ::CreateCompatibleDC(dc) };
+	auto render{ ::CreateCompatibleBitmap(dc, size.x, size.y) };
 
-				auto hbmold{ ::SelectObject(memdc, render) };
+	auto hbmold{ ::SelectObject(memdc, render) };
 
-				RECT r{ .left = 0, .top = 0, .right = size->x, .bottom = size->y };
-				::FillRect(memdc, &r, static_cast<HBRUSH>(::GetStockObject(WHITE_BRUSH)));
+	RECT r{ .left = 0, .top = 0, .right = size.x, .bottom = size.y };
+	::FillRect(memdc, &r, static_cast<HBRUSH>(::GetStockObject(WHITE_BRUSH)));
 
-				FPDF_RenderPage(memdc, self->m_fpage, 0, 0, size->x, size->y, 0, 0);
+	// Blank pages, e.g. separator pages of scanned documents, don't need the library at all
+	FS_RECTF box;
+	if (objects != nullptr && FPDF_GetPageBoundingBox(page, &box) &&
+		!objects->intersects(box.left, std::min(box.bottom, box.top), box.right, std::max(box.bottom, box.top)))
+	{
+		DEBUGPRINT("Blank page, rendering skipped\n");
+	}
+	else
+	{
+		FPDF_RenderPage(memdc, page, 0, 0, size.x, size.y, 0, 0);
+	}
 
-				::SelectObject(memdc, hbmold);
-				::DeleteDC(memdc);
+	::SelectObject(memdc, hbmold);
+	::DeleteDC(memdc);
 
-				return render;
-			},
-			args
-		);
+	return render;
+}
+[[nodiscard]] pdfv::hdc::Renderer::RenderT pdfv::Pdfium::s_renderCallback(void * args) noexcept
+{
+	auto argv{ static_cast<void **>(args) };
+	return s_renderBitmap(
+		static_cast<HDC>(argv[1]), static_cast<FPDF_PAGE>(argv[0]), *static_cast<xy<int> *>(argv[2]),
+		static_cast<const ObjectLayer *>(argv[3])
+	);
+}
+pdfv::error::Errorcode pdfv::Pdfium::pageRender(HDC dc, pdfv::xy<int> pos, pdfv::xy<int> size)
+{
+	DEBUGPRINT("pdfv::Pdfium::pageRender(%p, %p, %p)\n", static_cast<void *>(dc), static_cast<void *>(&pos), static_cast<void *>(&size));
+	assert(s_libInit == true);
+
+	if (this->m_fpage != nullptr)
+	{
+		std::lock_guard lock{ s_mutex };
+		auto pageSize{ this->m_profile->pageSize(this->m_fpagenum) };
+		if (pageSize.x <= 0.0f || pageSize.y <= 0.0f) [[unlikely]]
+		{
+			pageSize = { FPDF_GetPageWidthF(this->m_fpage), FPDF_GetPageHeightF(this->m_fpage) };
+		}
+		pdfv::xy<int> newsize;
+		s_fitPage(pageSize, pos, size, pos, newsize);
+		this->m_renderPos  = pos;
+		this->m_renderSize = newsize;
+
+		auto objects{ (this->m_objects != nullptr) ? this->m_objects->build(this->m_fpage, this->m_fpagenum) : nullptr };
+		void * args[]{ this->m_fpage, dc, &newsize, const_cast<ObjectLayer *>(objects) };
+		this->m_optRenderer.putPage(this->m_fpagenum, newsize, s_renderCallback, args);
 		
 		const auto & render{ this->m_optRenderer.getPage(this->m_fpagenum) };
 
@@ -299,6 +875,127 @@ pdfv::error::Errorcode pdfv::Pdfium::pageRender(HDC dc, pdfv::xy<int> pos, pdfv:
 		return error::pdf_page;
 	}
 }
+bool pdfv::Pdfium::pagePrefetch(HDC dc, std::size_t page, pdfv::xy<int> pos, pdfv::xy<int> size)
+{
+	DEBUGPRINT("pdfv::Pdfium::pagePrefetch(%p, %zu)\n", static_cast<void *>(dc), page);
+	assert(s_libInit == true);
+
+	if (this->m_fdoc == nullptr || page < 1 || page > this->m_numPages) [[unlikely]]
+	{
+		return false;
+	}
+
+	auto pageSize{ this->m_profile->pageSize(page) };
+	if (pageSize.x <= 0.0f || pageSize.y <= 0.0f) [[unlikely]]
+	{
+		return false;
+	}
+	pdfv::xy<int> newsize;
+	s_fitPage(pageSize, pos, size, pos, newsize);
+	// Size is known from the profile, so an already rendered page doesn't have to be loaded
+	if (this->m_optRenderer.hasPage(page, newsize))
+	{
+		return true;
+	}
+
+	std::lock_guard lock{ s_mutex };
+	auto fpage{ FPDF_LoadPage(this->m_fdoc, int(page - 1)) };
+	if (fpage == nullptr) [[unlikely]]
+	{
+		return false;
+	}
+
+	auto objects{ (this->m_objects != nullptr) ? this->m_objects->build(fpage, page) : nullptr };
+	void * args[]{ fpage, dc, &newsize, const_cast<ObjectLayer *>(objects) };
+	this->m_optRenderer.putPage(page, newsize, s_renderCallback, args);
+	FPDF_ClosePage(fpage);
+	return true;
+}
+
+[[nodiscard]] std::shared_ptr<const pdfv::LinkLayer> pdfv::Pdfium::pageGetLinks(std::size_t page) const noexcept
+{
+	return (this->m_links != nullptr) ? this->m_links->get(page) : nullptr;
+}
+[[nodiscard]] std::shared_ptr<const pdfv::ObjectLayer> pdfv::Pdfium::pageGetObjects(std::size_t page) const noexcept
+{
+	return (this->m_objects != nullptr) ? this->m_objects->get(page) : nullptr;
+}
+[[nodiscard]] std::shared_ptr<const pdfv::TextLayer> pdfv::Pdfium::pageGetText(std::size_t page) const
+{
+	DEBUGPRINT("pdfv::Pdfium::pageGetText(%zu)\n", page);
+
+	if (this->m_fdoc == nullptr || page < 1 || page > this->m_numPages) [[unlikely]]
+	{
+		return nullptr;
+	}
+	// Current page is already loaded
+	if (page == this->m_fpagenum && this->m_fpage != nullptr)
+	{
+		return s_textLayers.get(this->m_fpage, this->m_fingerprint, page);
+	}
+	return s_textLayers.get(this->m_fdoc, this->m_fingerprint, page);
+}
+bool pdfv::Pdfium::pageFromDevice(xy<int> point, f32 & x, f32 & y) const noexcept
+{
+	if (this->m_fpage == nullptr || this->m_renderSize.x <= 0 || this->m_renderSize.y <= 0)
+	{
+		return false;
+	}
+
+	std::lock_guard lock{ s_mutex };
+	double px, py;
+	if (!FPDF_DeviceToPage(
+		this->m_fpage,
+		this->m_renderPos.x, this->m_renderPos.y, this->m_renderSize.x, this->m_renderSize.y, 0,
+		point.x, point.y, &px, &py
+	)) [[unlikely]]
+	{
+		return false;
+	}
+	x = f32(px);
+	y = f32(py);
+	return true;
+}
+[[nodiscard]] RECT pdfv::Pdfium::pageToDevice(f32 left, f32 bottom, f32 right, f32 top) const noexcept
+{
+	RECT r{};
+	if (this->m_fpage == nullptr || this->m_renderSize.x <= 0 || this->m_renderSize.y <= 0)
+	{
+		return r;
+	}
+
+	std::lock_guard lock{ s_mutex };
+	int x0, y0, x1, y1;
+	FPDF_PageToDevice(
+		this->m_fpage,
+		this->m_renderPos.x, this->m_renderPos.y, this->m_renderSize.x, this->m_renderSize.y, 0,
+		left, top, &x0, &y0
+	);
+	FPDF_PageToDevice(
+		this->m_fpage,
+		this->m_renderPos.x, this->m_renderPos.y, this->m_renderSize.x, this->m_renderSize.y, 0,
+		right, bottom, &x1, &y1
+	);
+	r.left   = std::min(x0, x1);
+	r.top    = std::min(y0, y1);
+	r.right  = std::max(x0, x1);
+	r.bottom = std::max(y0, y1);
+	return r;
+}
+
+[[nodiscard]] std::size_t pdfv::Pdfium::pdfGetBytes() const noexcept
+{
+	if (this->m_fdoc == nullptr)
+	{
+		return 0;
+	}
+	auto total{ this->m_bufSize + this->m_optRenderer.bytes() };
+	total += (this->m_objects != nullptr) ? this->m_objects->bytes() : 0;
+	total += (this->m_thumbs  != nullptr) ? this->m_thumbs->bytes()  : 0;
+	// Tag tree is still growing on a background thread until it's ready
+	total += (this->m_tags != nullptr && this->m_tags->ready()) ? this->m_tags->bytes() : 0;
+	return total;
+}
 
 void pdfv::Pdfium::flush() noexcept
 {
@@ -1,28 +1,263 @@
 #pragma once
 
 #include "common.hpp"
+#include "borrowed.hpp"
 #include "hdcbuffer.hpp"
+#include "textlayer.hpp"
+#include "links.hpp"
+#include "outline.hpp"
+#include "dests.hpp"
+#include "pagelabels.hpp"
+#include "thumbs.hpp"
+#include "tagtree.hpp"
+#include "attachments.hpp"
+#include "objects.hpp"
+#include "profile.hpp"
 
+#include <atomic>
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <memory>
 
 namespace pdfv
 {
 	class MainWindow;
 
+	/**
+	 * @brief Identifies a particular version of a file on disk
+	 * 
+	 */
+	struct FileStamp
+	{
+		u64 size{ 0 };
+		u64 writeTime{ 0 };
+
+		[[nodiscard]] constexpr bool operator==(const FileStamp & rhs) const noexcept = default;
+	};
+
 	class Pdfium
 	{
+	public:
+		/**
+		 * @brief New version of a reloaded document, opened on the GUI thread. Its pre-rendered
+		 * pages are compared with the loaded version on a worker, the loaded version is shown
+		 * until the comparison is done
+		 * 
+		 */
+		struct PendingReload
+		{
+			/**
+			 * @brief Versions being compared. The old one is detached when the tab closes its
+			 * document, which abandons the reload. The new one is owned until it's taken over
+			 * 
+			 */
+			DocRef oldDoc;
+			std::shared_ptr<BorrowedDoc> newDoc;
+			std::unique_ptr<u8[]> buf;
+			std::size_t length{ 0 };
+			FileStamp stamp;
+			std::size_t numPages{ 0 };
+			u64 fingerprint{ 0 };
+			std::shared_ptr<DocProfile> oldProfile, newProfile;
+			/**
+			 * @brief Pre-rendered pages when the reload started, pages that are the same in both
+			 * versions once done
+			 * 
+			 */
+			std::vector<std::size_t> pages, unchanged;
+			std::atomic<bool> done{ false };
+
+			PendingReload() noexcept = default;
+			PendingReload(const PendingReload & other) = delete;
+			PendingReload(PendingReload && other) noexcept = delete;
+			PendingReload & operator=(const PendingReload & other) = delete;
+			PendingReload & operator=(PendingReload && other) noexcept = delete;
+			~PendingReload() noexcept;
+
+			/**
+			 * @brief Hashes the pages in both versions, takes the library lock for every page
+			 * 
+			 */
+			void compare() noexcept;
+		};
+		/**
+		 * @brief New version of a changed file, read and fingerprinted on the I/O worker
+		 * before pdfReload opens it on the GUI thread
+		 * 
+		 */
+		struct ReloadRead
+		{
+			std::unique_ptr<u8[]> data;
+			std::size_t length{ 0 };
+			FileStamp stamp;
+			u64 fingerprint{ 0 };
+			error::Errorcode err{ error::noerror };
+			std::atomic<bool> ready{ false };
+		};
+
 	private:
 		static inline bool s_errorHappened{ false };
 		static inline bool s_libInit{ false };
+		static constexpr std::size_t s_cPasswordAttempts{ 3 };
+		/**
+		 * @brief Passwords of successfully opened encrypted documents for the lifetime
+		 * of the process, keyed by file identifier or by path if the file has no identifier
+		 * 
+		 */
+		static inline std::unordered_map<std::string, std::string> s_credentials;
+		/**
+		 * @brief Encrypted documents that failed to open without a password, keyed like
+		 * s_credentials. They are prompted for right away, without another password-less parse
+		 * 
+		 */
+		static inline std::unordered_set<std::string> s_needsPassword;
+		/**
+		 * @brief Serialises all calls to the library, Pdfium is not thread-safe
+		 * 
+		 */
+		static inline std::recursive_mutex s_mutex;
+		static inline u64 s_docCounter{ 0 };
+		/**
+		 * @brief Text layers shared by every text consumer
+		 * 
+		 */
+		static inline TextLayerCache s_textLayers;
 
 		FPDF_DOCUMENT m_fdoc{ nullptr };
+		/**
+		 * @brief Handle of m_fdoc lent to the helpers, detached before the document is closed
+		 * 
+		 */
+		std::shared_ptr<BorrowedDoc> m_borrowed;
 		FPDF_PAGE m_fpage{ nullptr };
 		std::size_t m_fpagenum{ 0 };
 		std::size_t m_numPages{ 0 };
+		/**
+		 * @brief Device rectangle, where the current page was last rendered
+		 * 
+		 */
+		xy<int> m_renderPos, m_renderSize;
 		
-		std::unique_ptr<u8> m_buf{ nullptr };
+		std::shared_ptr<u8[]> m_buf{ nullptr };
+		std::size_t m_bufSize{ 0 };
+		u64 m_docId{ 0 };
+		u64 m_fingerprint{ 0 };
+
+		std::wstring m_path;
+		FileStamp m_stamp;
 
 		hdc::Renderer m_optRenderer;
+		/**
+		 * @brief Link layers of the loaded document version, built in the background
+		 * 
+		 */
+		std::shared_ptr<LinkIndex> m_links;
+		/**
+		 * @brief Outline of the loaded document version, read lazily by the outline panel
+		 * 
+		 */
+		std::unique_ptr<Outline> m_outline;
+		/**
+		 * @brief Named destinations of the loaded document version, built in the background
+		 * 
+		 */
+		std::shared_ptr<DestIndex> m_dests;
+		/**
+		 * @brief Page labels of the loaded document version, extracted in the background
+		 * 
+		 */
+		std::shared_ptr<PageLabels> m_labels;
+		/**
+		 * @brief Page thumbnails of the loaded document version, made in the background
+		 * 
+		 */
+		std::shared_ptr<Thumbnails> m_thumbs;
+		/**
+		 * @brief Logical structure of the loaded document version, read in the background
+		 * 
+		 */
+		std::shared_ptr<TagTree> m_tags;
+		/**
+		 * @brief Embedded files of the loaded document version, listed by the attachment panel
+		 * 
+		 */
+		std::shared_ptr<Attachments> m_attachments;
+		/**
+		 * @brief Object boxes of the rendered pages of the loaded document version
+		 * 
+		 */
+		std::unique_ptr<ObjectIndex> m_objects;
+		/**
+		 * @brief Page sizes and document facts of the loaded document version, read when
+		 * it's opened
+		 * 
+		 */
+		std::shared_ptr<DocProfile> m_profile;
+		/**
+		 * @brief Reload waiting for its page comparison, nullptr if there is none
+		 * 
+		 */
+		std::shared_ptr<PendingReload> m_reload;
+
+		/**
+		 * @brief Fits a page into an area, preserving its aspect ratio
+		 * 
+		 * @param pageSize Page size in points
+		 * @param pos Margins of the area
+		 * @param size Size of the area
+		 * @param outPos Reference to position, receives the centered position of the page
+		 * @param outSize Reference to size, receives the fitted size of the page
+		 */
+		static void s_fitPage(xy<f32> pageSize, xy<int> pos, xy<int> size, xy<int> & outPos, xy<int> & outSize) noexcept;
+		/**
+		 * @brief Renders a page to a new bitmap compatible with the device context. Pages
+		 * without any object inside their bounding box are only filled white
+		 * 
+		 * @param dc Device context
+		 * @param page Page handle
+		 * @param size Bitmap size
+		 * @param objects Object layer of the page, nullptr if unknown
+		 * @return hdc::Renderer::RenderT Bitmap
+		 */
+		[[nodiscard]] static hdc::Renderer::RenderT s_renderBitmap(
+			HDC dc, FPDF_PAGE page, xy<int> size, const ObjectLayer * objects
+		) noexcept;
+		/**
+		 * @brief Render callback of the render buffer, arguments are the page handle, device
+		 * context, bitmap size and object layer
+		 * 
+		 */
+		[[nodiscard]] static hdc::Renderer::RenderT s_renderCallback(void * args) noexcept;
+
+		/**
+		 * @brief Derives the key of document's remembered password
+		 * 
+		 * @param data Pointer to PDF file contents
+		 * @param length Length of the contents
+		 * @param path Path of the document, used if the document has no identifier
+		 * @param encrypted Optional pointer to flag, receives whether the document is encrypted
+		 * @return std::string Key, empty if the document can't be identified
+		 */
+		[[nodiscard]] static std::string s_credentialKey(
+			const u8 * data, std::size_t length, std::wstring_view path, bool * encrypted = nullptr
+		) noexcept;
+		/**
+		 * @brief Opens PDF document from memory, asks for password if document is encrypted.
+		 * Encryption is detected from the trailer, remembered passwords are tried first
+		 * 
+		 * @param window Const-reference to window object
+		 * @param path Path of the document, used as credential key if the document has no identifier
+		 * @param data Pointer to an array of bytes containing the PDF, has to outlive the document
+		 * @param length Length of binary data
+		 * @param doc Reference to document handle, receives the opened document
+		 * @return error::Errorcode 
+		 */
+		static error::Errorcode s_openDoc(
+			const MainWindow & window, std::wstring_view path,
+			const u8 * data, std::size_t length, FPDF_DOCUMENT & doc
+		) noexcept;
 
 	public:
 		Pdfium() noexcept;
@@ -47,6 +282,34 @@ namespace pdfv
 		 * @return error::Errorcode The last error of the Pdfium library
 		 */
 		[[nodiscard]] static error::Errorcode getLastError() noexcept;
+		/**
+		 * @brief Locks the library for the calling thread, all library calls made
+		 * outside of this class have to hold the lock
+		 * 
+		 * @return std::unique_lock<std::recursive_mutex> Lock object
+		 */
+		[[nodiscard]] static std::unique_lock<std::recursive_mutex> lock()
+		{
+			return std::unique_lock{ s_mutex };
+		}
+		/**
+		 * @return TextLayerCache& Text layer cache shared by all documents
+		 */
+		[[nodiscard]] static TextLayerCache & textLayers() noexcept
+		{
+			return s_textLayers;
+		}
+		/**
+		 * @brief Retrieves the remembered password of a document
+		 * 
+		 * @param data Pointer to PDF file contents
+		 * @param length Length of the contents
+		 * @param path Path of the document, may be empty
+		 * @return std::string Password, empty if none is remembered
+		 */
+		[[nodiscard]] static std::string getCredential(
+			const u8 * data, std::size_t length, std::wstring_view path
+		);
 		/**
 		 * @brief Loads PDF file from path given as UTF-8 string, loads given page, first page by default
 		 * 
@@ -71,6 +334,71 @@ namespace pdfv
 			const MainWindow & window,
 			const std::wstring & path, std::size_t page = 1
 		);
+		/**
+		 * @brief Retrieves size and last write time of a file
+		 * 
+		 * @param path UTF-16 string path
+		 * @param stamp Reference to file stamp, receives the stamp
+		 * @return true Success
+		 * @return false Failure
+		 */
+		[[nodiscard]] static bool getFileStamp(const std::wstring & path, FileStamp & stamp) noexcept;
+		/**
+		 * @brief Reads the whole file to memory
+		 * 
+		 * @param path UTF-16 string path
+		 * @param data Reference to byte array, receives the contents
+		 * @param length Reference to length, receives the length of data
+		 * @param stamp Reference to file stamp, receives the stamp of the read file
+		 * @return error::Errorcode 
+		 */
+		static error::Errorcode readFile(
+			const std::wstring & path,
+			std::unique_ptr<u8[]> & data, std::size_t & length, FileStamp & stamp
+		) noexcept;
+		/**
+		 * @brief Reads the whole file to memory and fingerprints the contents, meant for
+		 * workers, so that hashing never holds up the GUI thread
+		 * 
+		 * @param path UTF-16 string path
+		 * @param data Reference to byte array, receives the contents
+		 * @param length Reference to length, receives the length of data
+		 * @param stamp Reference to file stamp, receives the stamp of the read file
+		 * @param fingerprint Reference to fingerprint, receives the fingerprint of the contents
+		 * @return error::Errorcode 
+		 */
+		static error::Errorcode readFile(
+			const std::wstring & path,
+			std::unique_ptr<u8[]> & data, std::size_t & length, FileStamp & stamp, u64 & fingerprint
+		) noexcept;
+		/**
+		 * @brief Calculates a hash of page's content, pages with identical
+		 * content produce identical hashes
+		 * 
+		 * @param doc Document handle
+		 * @param page Page to hash, starting from 1
+		 * @return u64 Hash value, 0 if page could not be loaded
+		 */
+		[[nodiscard]] static u64 pageHash(FPDF_DOCUMENT doc, std::size_t page) noexcept;
+
+		/**
+		 * @brief Loads a PDF file from binary data that has already been read from the given path,
+		 * consumes the array, loads given page, first page by default
+		 * 
+		 * @param window Const-reference to window object
+		 * @param path UTF-16 string path, where the data was read from
+		 * @param data Array of bytes containing the PDF
+		 * @param length Length of binary data
+		 * @param stamp Stamp of the file at the time of reading
+		 * @param fingerprint Fingerprint of the data, taken where the data was read
+		 * @param page Page to load
+		 * @return error::Errorcode 
+		 */
+		error::Errorcode pdfLoad(
+			const MainWindow & window,
+			const std::wstring & path, std::unique_ptr<u8[]> && data, std::size_t length,
+			const FileStamp & stamp, u64 fingerprint, std::size_t page = 1
+		);
 		/**
 		 * @brief Loads a PDF file from binary data, given as byte array, preserves the array,
 		 * loads given page, first page by default
@@ -99,6 +427,40 @@ namespace pdfv
 			const MainWindow & window,
 			u8 * && data, std::size_t length, std::size_t page = 1
 		) noexcept;
+		/**
+		 * @brief Opens the new version of the currently loaded PDF, as read from disk. The
+		 * current version stays loaded until pdfFinishReload, the pre-rendered pages are
+		 * compared in the meantime by PendingReload::compare
+		 * 
+		 * @param window Const-reference to window object
+		 * @param read Contents of the new version, consumed
+		 * @return error::Errorcode 
+		 */
+		error::Errorcode pdfReload(const MainWindow & window, ReloadRead & read);
+		/**
+		 * @brief Switches to the new version once its pages have been compared, retains
+		 * current page if possible. Only the pre-rendered pages, whose content has changed,
+		 * are removed from render buffer
+		 * 
+		 * @return error::Errorcode 
+		 */
+		error::Errorcode pdfFinishReload() noexcept;
+		/**
+		 * @return std::shared_ptr<PendingReload> Reload waiting for its page comparison,
+		 * nullptr if there is none
+		 */
+		[[nodiscard]] std::shared_ptr<PendingReload> pdfGetReload() const noexcept
+		{
+			return this->m_reload;
+		}
+		/**
+		 * @brief Checks whether the currently loaded PDF file has changed on disk
+		 * 
+		 * @param stamp Reference to file stamp, receives the new stamp of the file
+		 * @return true File has changed
+		 * @return false File hasn't changed or no file is loaded
+		 */
+		[[nodiscard]] bool fileChanged(FileStamp & stamp) const noexcept;
 		/**
 		 * @brief Unloads (closes) currently loaded PDF if any is open,
 		 * also any pages that might be open
@@ -128,6 +490,62 @@ namespace pdfv
 		 * @return error::Errorcode 
 		 */
 		error::Errorcode pageRender(HDC dc, pdfv::xy<int> pos, pdfv::xy<int> size);
+		/**
+		 * @brief Renders a page to the render buffer ahead of time, with the size it would
+		 * be rendered by pageRender, e.g. the target page of a hovered link
+		 * 
+		 * @param dc Device context, compatible with the one used by pageRender
+		 * @param page Page number, starting from 1
+		 * @param pos Position of the page
+		 * @param size Size of the page
+		 * @return true Page is in the render buffer
+		 */
+		bool pagePrefetch(HDC dc, std::size_t page, pdfv::xy<int> pos, pdfv::xy<int> size);
+
+		/**
+		 * @brief Returns the cached text layer of a page of the currently loaded PDF
+		 * 
+		 * @param page Page number, starting from 1
+		 * @return std::shared_ptr<const TextLayer> Text layer, nullptr if not available
+		 */
+		[[nodiscard]] std::shared_ptr<const TextLayer> pageGetText(std::size_t page) const;
+		/**
+		 * @brief Returns the link layer of a page of the currently loaded PDF
+		 * 
+		 * @param page Page number, starting from 1
+		 * @return std::shared_ptr<const LinkLayer> Link layer, nullptr if it hasn't been built yet
+		 */
+		[[nodiscard]] std::shared_ptr<const LinkLayer> pageGetLinks(std::size_t page) const noexcept;
+		/**
+		 * @brief Returns the object boxes of a page of the currently loaded PDF
+		 * 
+		 * @param page Page number, starting from 1
+		 * @return std::shared_ptr<const ObjectLayer> Object layer, nullptr if the page
+		 * hasn't been rendered yet
+		 */
+		[[nodiscard]] std::shared_ptr<const ObjectLayer> pageGetObjects(std::size_t page) const noexcept;
+		/**
+		 * @brief Converts a device point to page coordinates of the current page, relative
+		 * to where the page was last rendered
+		 * 
+		 * @param point Device point
+		 * @param x Reference to horizontal page coordinate, receives the result
+		 * @param y Reference to vertical page coordinate, receives the result
+		 * @return true Success
+		 * @return false Current page hasn't been rendered yet
+		 */
+		bool pageFromDevice(xy<int> point, f32 & x, f32 & y) const noexcept;
+		/**
+		 * @brief Converts a rectangle in page coordinates of the current page to device
+		 * coordinates, relative to where the page was last rendered
+		 * 
+		 * @param left Left edge
+		 * @param bottom Bottom edge
+		 * @param right Right edge
+		 * @param top Top edge
+		 * @return RECT Device rectangle, empty if the current page hasn't been rendered yet
+		 */
+		[[nodiscard]] RECT pageToDevice(f32 left, f32 bottom, f32 right, f32 top) const noexcept;
 
 		/**
 		 * @return std::size_t Page count of the currently open PDF, 0 if none is open
@@ -143,6 +561,116 @@ namespace pdfv
 		{
 			return this->m_fpagenum;
 		}
+		/**
+		 * @param page Page number, starting from 1
+		 * @return std::wstring_view Label of the page, empty if it has none or labels
+		 * aren't extracted yet
+		 */
+		[[nodiscard]] std::wstring_view pageGetLabel(std::size_t page) const noexcept
+		{
+			return (this->m_labels != nullptr) ? this->m_labels->label(page) : std::wstring_view();
+		}
+		/**
+		 * @return const std::wstring& Path of the currently loaded PDF, empty if the PDF
+		 * was not loaded from a file
+		 */
+		[[nodiscard]] constexpr const std::wstring & pdfGetPath() const noexcept
+		{
+			return this->m_path;
+		}
+		/**
+		 * @return std::shared_ptr<const u8[]> Contents of the currently loaded PDF, shared
+		 * so that background jobs can open their own document handles
+		 */
+		[[nodiscard]] std::shared_ptr<const u8[]> pdfGetData() const noexcept
+		{
+			return this->m_buf;
+		}
+		/**
+		 * @return std::size_t Length of the currently loaded PDF contents
+		 */
+		[[nodiscard]] constexpr std::size_t pdfGetSize() const noexcept
+		{
+			return this->m_bufSize;
+		}
+		/**
+		 * @return std::shared_ptr<LinkIndex> Link index of the currently loaded PDF, shared
+		 * with the background jobs building it, nullptr if no PDF is loaded
+		 */
+		[[nodiscard]] std::shared_ptr<LinkIndex> pdfGetLinks() const noexcept
+		{
+			return this->m_links;
+		}
+		/**
+		 * @return Outline* Outline of the currently loaded PDF, nullptr if no PDF is loaded
+		 */
+		[[nodiscard]] Outline * pdfGetOutline() const noexcept
+		{
+			return this->m_outline.get();
+		}
+		/**
+		 * @return std::shared_ptr<DestIndex> Named destinations of the currently loaded PDF,
+		 * shared with the background job building them, nullptr if no PDF is loaded
+		 */
+		[[nodiscard]] std::shared_ptr<DestIndex> pdfGetDests() const noexcept
+		{
+			return this->m_dests;
+		}
+		/**
+		 * @return std::shared_ptr<PageLabels> Page labels of the currently loaded PDF, shared
+		 * with the background job extracting them, nullptr if no PDF is loaded
+		 */
+		[[nodiscard]] std::shared_ptr<PageLabels> pdfGetLabels() const noexcept
+		{
+			return this->m_labels;
+		}
+		/**
+		 * @return std::shared_ptr<Thumbnails> Page thumbnails of the currently loaded PDF, shared
+		 * with the background job making them, nullptr if no PDF is loaded
+		 */
+		[[nodiscard]] std::shared_ptr<Thumbnails> pdfGetThumbs() const noexcept
+		{
+			return this->m_thumbs;
+		}
+		/**
+		 * @return std::shared_ptr<TagTree> Logical structure of the currently loaded PDF, shared
+		 * with the background job reading it, nullptr if no PDF is loaded
+		 */
+		[[nodiscard]] std::shared_ptr<TagTree> pdfGetTags() const noexcept
+		{
+			return this->m_tags;
+		}
+		/**
+		 * @return std::shared_ptr<Attachments> Embedded files of the currently loaded PDF, shared
+		 * with background extraction jobs, nullptr if no PDF is loaded
+		 */
+		[[nodiscard]] std::shared_ptr<Attachments> pdfGetAttachments() const noexcept
+		{
+			return this->m_attachments;
+		}
+		/**
+		 * @return std::shared_ptr<DocProfile> Profile of the currently loaded PDF, shared
+		 * with a pending reload comparing page sizes, nullptr if no PDF is loaded
+		 */
+		[[nodiscard]] std::shared_ptr<DocProfile> pdfGetProfile() const noexcept
+		{
+			return this->m_profile;
+		}
+		/**
+		 * @return u64 Identifier of the currently loaded document version, changes with
+		 * every load or reload, 0 if no PDF is loaded
+		 */
+		[[nodiscard]] constexpr u64 pdfGetId() const noexcept
+		{
+			return this->m_docId;
+		}
+		/**
+		 * @return u64 Fingerprint of the currently loaded PDF contents
+		 */
+		[[nodiscard]] constexpr u64 pdfGetFingerprint() const noexcept
+		{
+			return this->m_fingerprint;
+		}
 		/**
 		 * @return true PDF is loaded
 		 * @return false PDF is not loaded
@@ -151,6 +679,11 @@ namespace pdfv
 		{
 			return this->m_fdoc != nullptr;
 		}
+		/**
+		 * @return std::size_t Approximate memory held by the currently loaded PDF in bytes,
+		 * file contents stand in for the objects parsed by the library
+		 */
+		[[nodiscard]] std::size_t pdfGetBytes() const noexcept;
 
 		void flush() noexcept;
 	};
@@ -0,0 +1,313 @@
+#include "links.hpp"
+#include "lib.hpp"
+#include <fpdf_doc.h>
+#include <fpdf_text.h>
+
+#include <algorithm>
+#include <limits>
+
+[[nodiscard]] std::size_t pdfv::LinkLayer::bytes() const noexcept
+{
+	return sizeof(LinkLayer) +
+		(this->left.capacity() + this->bottom.capacity() + this->right.capacity() + this->top.capacity()) * sizeof(f32) +
+		(this->action.capacity() + this->source.capacity()) * sizeof(u8) +
+		this->targetPage.capacity() * sizeof(u32) +
+		(this->targetX.capacity() + this->targetY.capacity()) * sizeof(f32) +
+		this->stringStart.capacity() * sizeof(u32) + this->strings.capacity() * sizeof(wchar_t) +
+		this->slabY.capacity() * sizeof(f32) +
+		(this->slabStart.capacity() + this->slabItems.capacity()) * sizeof(u32);
+}
+[[nodiscard]] std::wstring_view pdfv::LinkLayer::target(std::size_t idx) const noexcept
+{
+	if (idx >= this->size()) [[unlikely]]
+	{
+		return {};
+	}
+	return std::wstring_view(this->strings).substr(
+		this->stringStart[idx], this->stringStart[idx + 1] - this->stringStart[idx]
+	);
+}
+
+[[nodiscard]] pdfv::ssize_t pdfv::LinkLayer::hitTest(f32 x, f32 y) const noexcept
+{
+	if (this->slabY.size() < 2 || y < this->slabY.front() || y > this->slabY.back())
+	{
+		return s_cNoHit;
+	}
+	// Top edge of the topmost slab belongs to it
+	auto slab{ std::size_t(std::upper_bound(this->slabY.begin(), this->slabY.end(), y) - this->slabY.begin()) };
+	slab = std::min(slab, this->slabY.size() - 1) - 1;
+
+	ssize_t best{ s_cNoHit };
+	f32 bestArea{ std::numeric_limits<f32>::max() };
+	for (auto i{ this->slabStart[slab] }; i < this->slabStart[slab + 1]; ++i)
+	{
+		const auto idx{ this->slabItems[i] };
+		if (x < this->left[idx] || x > this->right[idx] || y < this->bottom[idx] || y > this->top[idx])
+		{
+			continue;
+		}
+		const auto area{ (this->right[idx] - this->left[idx]) * (this->top[idx] - this->bottom[idx]) };
+		if (area < bestArea)
+		{
+			best     = ssize_t(idx);
+			bestArea = area;
+		}
+	}
+	return best;
+}
+
+void pdfv::LinkLayer::add(f32 l, f32 b, f32 r, f32 t, Action act, Source src, std::wstring_view str)
+{
+	if (this->stringStart.empty())
+	{
+		this->stringStart.emplace_back(0);
+	}
+	this->left.emplace_back(std::min(l, r));
+	this->bottom.emplace_back(std::min(b, t));
+	this->right.emplace_back(std::max(l, r));
+	this->top.emplace_back(std::max(b, t));
+	this->action.emplace_back(act);
+	this->source.emplace_back(src);
+	this->targetPage.emplace_back(0);
+	this->targetX.emplace_back(std::numeric_limits<f32>::quiet_NaN());
+	this->targetY.emplace_back(std::numeric_limits<f32>::quiet_NaN());
+	this->strings.append(str);
+	this->stringStart.emplace_back(u32(this->strings.size()));
+}
+void pdfv::LinkLayer::buildIndex()
+{
+	const auto count{ this->size() };
+	this->slabY.clear();
+	this->slabStart.clear();
+	this->slabItems.clear();
+	if (count == 0)
+	{
+		return;
+	}
+
+	this->slabY.reserve(count * 2);
+	this->slabY.insert(this->slabY.end(), this->bottom.begin(), this->bottom.end());
+	this->slabY.insert(this->slabY.end(), this->top.begin(), this->top.end());
+	std::sort(this->slabY.begin(), this->slabY.end());
+	this->slabY.erase(std::unique(this->slabY.begin(), this->slabY.end()), this->slabY.end());
+	if (this->slabY.size() < 2) [[unlikely]]
+	{
+		// Only degenerate rectangles, keep a single empty-height slab
+		this->slabY.emplace_back(this->slabY.front());
+	}
+
+	const auto numSlabs{ this->slabY.size() - 1 };
+	auto slabRange = [this, numSlabs](std::size_t idx) noexcept
+	{
+		const auto first{ std::size_t(std::lower_bound(this->slabY.begin(), this->slabY.end(), this->bottom[idx]) - this->slabY.begin()) };
+		const auto last { std::size_t(std::lower_bound(this->slabY.begin(), this->slabY.end(), this->top[idx])    - this->slabY.begin()) };
+		// Slab starting at the top edge is included too, queries on an edge land in the slab above it
+		return std::pair{ std::min(first, numSlabs - 1), std::clamp(last + 1, first + 1, numSlabs) };
+	};
+
+	// Counting pass, then filling pass
+	this->slabStart.assign(numSlabs + 1, 0);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const auto [first, last]{ slabRange(i) };
+		for (auto s{ first }; s < last; ++s)
+		{
+			++this->slabStart[s + 1];
+		}
+	}
+	for (std::size_t s = 0; s < numSlabs; ++s)
+	{
+		this->slabStart[s + 1] += this->slabStart[s];
+	}
+	this->slabItems.resize(this->slabStart.back());
+	std::vector<u32> fill(this->slabStart.begin(), this->slabStart.end() - 1);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const auto [first, last]{ slabRange(i) };
+		for (auto s{ first }; s < last; ++s)
+		{
+			this->slabItems[fill[s]++] = u32(i);
+		}
+	}
+}
+
+[[nodiscard]] std::shared_ptr<pdfv::LinkLayer> pdfv::LinkLayer::s_extract(FPDF_DOCUMENT doc, FPDF_PAGE page)
+{
+	DEBUGPRINT("pdfv::LinkLayer::s_extract(%p, %p)\n", static_cast<void *>(doc), static_cast<void *>(page));
+
+	auto layer{ std::make_shared<LinkLayer>() };
+	std::string buf;
+
+	// Link annotations
+	int pos{ 0 };
+	FPDF_LINK link{ nullptr };
+	while (FPDFLink_Enumerate(page, &pos, &link))
+	{
+		FS_RECTF r{};
+		if (!FPDFLink_GetAnnotRect(link, &r)) [[unlikely]]
+		{
+			continue;
+		}
+
+		auto act{ Action::unsupported };
+		auto dest{ FPDFLink_GetDest(doc, link) };
+		std::wstring str;
+		if (dest != nullptr)
+		{
+			act = Action::goTo;
+		}
+		else if (auto action{ FPDFLink_GetAction(link) }; action != nullptr)
+		{
+			switch (FPDFAction_GetType(action))
+			{
+			case PDFACTION_GOTO:
+				act  = Action::goTo;
+				dest = FPDFAction_GetDest(doc, action);
+				break;
+			case PDFACTION_URI:
+				act = Action::uri;
+				buf.resize(FPDFAction_GetURIPath(doc, action, nullptr, 0));
+				FPDFAction_GetURIPath(doc, action, buf.data(), ul(buf.size()));
+				break;
+			case PDFACTION_REMOTEGOTO:
+			case PDFACTION_LAUNCH:
+				act = (FPDFAction_GetType(action) == PDFACTION_LAUNCH) ? Action::launch : Action::remoteGoTo;
+				buf.resize(FPDFAction_GetFilePath(action, nullptr, 0));
+				FPDFAction_GetFilePath(action, buf.data(), ul(buf.size()));
+				break;
+			case PDFACTION_EMBEDDEDGOTO:
+				act = Action::embeddedGoTo;
+				break;
+			}
+			if (act == Action::uri || act == Action::remoteGoTo || act == Action::launch)
+			{
+				// Both lengths include the terminating null character
+				str = utf::conv(std::string_view(buf.data(), buf.empty() ? 0 : buf.size() - 1));
+			}
+		}
+
+		layer->add(r.left, r.bottom, r.right, r.top, act, Source::annotation, str);
+		if (dest != nullptr)
+		{
+			const auto idx{ FPDFDest_GetDestPageIndex(doc, dest) };
+			layer->targetPage.back() = (idx >= 0) ? u32(idx) + 1 : 0;
+
+			FPDF_BOOL hasX, hasY, hasZoom;
+			FS_FLOAT x, y, zoom;
+			if (FPDFDest_GetLocationInPage(dest, &hasX, &hasY, &hasZoom, &x, &y, &zoom))
+			{
+				if (hasX)
+				{
+					layer->targetX.back() = x;
+				}
+				if (hasY)
+				{
+					layer->targetY.back() = y;
+				}
+			}
+		}
+	}
+	const auto numAnnots{ layer->size() };
+
+	// URLs written out in the text, unless an annotation covers them already
+	if (auto tpage{ FPDFText_LoadPage(page) }; tpage != nullptr)
+	{
+		if (auto web{ FPDFLink_LoadWebLinks(tpage) }; web != nullptr)
+		{
+			std::vector<unsigned short> url;
+			const auto numWeb{ FPDFLink_CountWebLinks(web) };
+			for (int i = 0; i < numWeb; ++i)
+			{
+				url.resize(std::size_t(std::max(FPDFLink_GetURL(web, i, nullptr, 0), 1)));
+				const auto len{ std::max(FPDFLink_GetURL(web, i, url.data(), int(url.size())) - 1, 0) };
+				const std::wstring str(url.begin(), url.begin() + len);
+
+				const auto numRects{ FPDFLink_CountRects(web, i) };
+				for (int j = 0; j < numRects; ++j)
+				{
+					double l, t, r, b;
+					if (!FPDFLink_GetRect(web, i, j, &l, &t, &r, &b)) [[unlikely]]
+					{
+						continue;
+					}
+					const auto cx{ f32((l + r) * 0.5) }, cy{ f32((t + b) * 0.5) };
+					bool covered{ false };
+					for (std::size_t k = 0; k < numAnnots && !covered; ++k)
+					{
+						covered = cx >= layer->left[k] && cx <= layer->right[k] &&
+							cy >= layer->bottom[k] && cy <= layer->top[k];
+					}
+					if (!covered)
+					{
+						layer->add(f32(l), f32(b), f32(r), f32(t), Action::uri, Source::web, str);
+					}
+				}
+			}
+			FPDFLink_CloseWebLinks(web);
+		}
+		FPDFText_ClosePage(tpage);
+	}
+
+	layer->buildIndex();
+	return layer;
+}
+
+pdfv::LinkIndex::LinkIndex(DocRef doc, std::size_t numPages)
+	: m_doc(std::move(doc)), m_state(numPages, State::none), m_pages(numPages)
+{
+}
+
+[[nodiscard]] bool pdfv::LinkIndex::request(std::size_t page) noexcept
+{
+	std::lock_guard lock{ this->m_mutex };
+	if (page < 1 || page > this->m_state.size() || this->m_state[page - 1] != State::none)
+	{
+		return false;
+	}
+	this->m_state[page - 1] = State::queued;
+	return true;
+}
+void pdfv::LinkIndex::build(std::size_t page) noexcept
+{
+	DEBUGPRINT("pdfv::LinkIndex::build(%zu)\n", page);
+
+	std::shared_ptr<const LinkLayer> layer;
+	try
+	{
+		auto lock{ Pdfium::lock() };
+		if (this->m_doc->get() == nullptr || page < 1 || page > this->m_pages.size())
+		{
+			return;
+		}
+		auto fpage{ FPDF_LoadPage(this->m_doc->get(), int(page - 1)) };
+		if (fpage != nullptr) [[likely]]
+		{
+			layer = LinkLayer::s_extract(this->m_doc->get(), fpage);
+			FPDF_ClosePage(fpage);
+		}
+	}
+	catch (const std::bad_alloc &)
+	{
+	}
+
+	std::lock_guard lock{ this->m_mutex };
+	if (layer == nullptr) [[unlikely]]
+	{
+		// Allow another attempt the next time the page is shown
+		this->m_state[page - 1] = State::none;
+		return;
+	}
+	DEBUGPRINT("Page %zu: %zu link(s), %zu bytes\n", page, layer->size(), layer->bytes());
+	this->m_pages[page - 1] = std::move(layer);
+	this->m_state[page - 1] = State::ready;
+}
+[[nodiscard]] std::shared_ptr<const pdfv::LinkLayer> pdfv::LinkIndex::get(std::size_t page) const noexcept
+{
+	std::lock_guard lock{ this->m_mutex };
+	if (page < 1 || page > this->m_pages.size())
+	{
+		return nullptr;
+	}
+	return this->m_pages[page - 1];
+}
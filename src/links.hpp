@@ -0,0 +1,175 @@
+#pragma once
+
+#include "common.hpp"
+#include "borrowed.hpp"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pdfv
+{
+	/**
+	 * @brief Links of a single page in structure-of-arrays layout: link annotations and
+	 * URLs detected in the page text. Rectangles are in page coordinates, origin at the
+	 * bottom-left corner. Links spanning several lines have one entry per rectangle
+	 * 
+	 */
+	struct LinkLayer
+	{
+		enum class Action : u8
+		{
+			unsupported,
+			/**
+			 * @brief Destination inside the same document
+			 * 
+			 */
+			goTo,
+			remoteGoTo,
+			uri,
+			launch,
+			embeddedGoTo
+		};
+		enum class Source : u8
+		{
+			annotation,
+			/**
+			 * @brief URL recognised in the page text
+			 * 
+			 */
+			web
+		};
+
+		static constexpr ssize_t s_cNoHit{ -1 };
+
+		std::vector<f32> left, bottom, right, top;
+		std::vector<Action> action;
+		std::vector<Source> source;
+		/**
+		 * @brief Target page number of internal links, starting from 1, 0 if there is none
+		 * 
+		 */
+		std::vector<u32> targetPage;
+		/**
+		 * @brief Target location on the target page, NaN if unspecified
+		 * 
+		 */
+		std::vector<f32> targetX, targetY;
+		/**
+		 * @brief Offset of each link's URI or file path in strings, followed by the total length
+		 * 
+		 */
+		std::vector<u32> stringStart;
+		std::wstring strings;
+
+		/**
+		 * @brief Horizontal slabs between consecutive distinct rectangle edges, each slab
+		 * lists the links crossing it, stored as one flat index array with per-slab offsets
+		 * 
+		 */
+		std::vector<f32> slabY;
+		std::vector<u32> slabStart;
+		std::vector<u32> slabItems;
+
+		/**
+		 * @return std::size_t Number of link rectangles on the page
+		 */
+		[[nodiscard]] std::size_t size() const noexcept
+		{
+			return this->action.size();
+		}
+		/**
+		 * @return std::size_t Approximate memory usage in bytes
+		 */
+		[[nodiscard]] std::size_t bytes() const noexcept;
+		/**
+		 * @param idx Link index
+		 * @return std::wstring_view URI or file path of the link, empty for internal links
+		 */
+		[[nodiscard]] std::wstring_view target(std::size_t idx) const noexcept;
+
+		/**
+		 * @brief Finds the link at a point in O(log n) plus the number of links crossing
+		 * the same slab. Among overlapping rectangles the smallest one wins
+		 * 
+		 * @param x Horizontal page coordinate
+		 * @param y Vertical page coordinate
+		 * @return ssize_t Link index, s_cNoHit if there is none
+		 */
+		[[nodiscard]] ssize_t hitTest(f32 x, f32 y) const noexcept;
+
+		/**
+		 * @brief Extracts links of a page, caller has to hold the library lock
+		 * 
+		 * @param doc Document handle
+		 * @param page Page handle
+		 * @return std::shared_ptr<LinkLayer> Link layer, nullptr on failure
+		 */
+		[[nodiscard]] static std::shared_ptr<LinkLayer> s_extract(FPDF_DOCUMENT doc, FPDF_PAGE page);
+
+	private:
+		/**
+		 * @brief Appends a link rectangle, target page and location are left unset
+		 * 
+		 */
+		void add(f32 l, f32 b, f32 r, f32 t, Action act, Source src, std::wstring_view str);
+		/**
+		 * @brief Builds the slab index from link rectangles
+		 * 
+		 */
+		void buildIndex();
+	};
+
+	/**
+	 * @brief Link layers of a single document version, built page by page in the background
+	 * 
+	 */
+	class LinkIndex
+	{
+	private:
+		enum class State : u8
+		{
+			none,
+			queued,
+			ready
+		};
+
+		mutable std::mutex m_mutex;
+		DocRef m_doc;
+		std::vector<State> m_state;
+		std::vector<std::shared_ptr<const LinkLayer>> m_pages;
+
+	public:
+		/**
+		 * @param doc Document of the owner
+		 * @param numPages Page count of the document
+		 */
+		LinkIndex(DocRef doc, std::size_t numPages);
+		LinkIndex(const LinkIndex & other) = delete;
+		LinkIndex(LinkIndex && other) noexcept = delete;
+		LinkIndex & operator=(const LinkIndex & other) = delete;
+		LinkIndex & operator=(LinkIndex && other) noexcept = delete;
+		~LinkIndex() noexcept = default;
+
+		/**
+		 * @brief Marks a page as queued for building
+		 * 
+		 * @param page Page number, starting from 1
+		 * @return true Page has to be built, false if it's already built or queued
+		 */
+		[[nodiscard]] bool request(std::size_t page) noexcept;
+		/**
+		 * @brief Extracts links of a queued page, takes the library lock
+		 * 
+		 * @param page Page number, starting from 1
+		 */
+		void build(std::size_t page) noexcept;
+		/**
+		 * @param page Page number, starting from 1
+		 * @return std::shared_ptr<const LinkLayer> Link layer, nullptr if it's not built yet
+		 */
+		[[nodiscard]] std::shared_ptr<const LinkLayer> get(std::size_t page) const noexcept;
+	};
+}
@@ -14,13 +14,26 @@ int WINAPI wWinMain(HINSTANCE hInst, HINSTANCE, LPWSTR, int nCmdShow)
 
 	DEBUGPRINT("argc: %d, argv: %p", argc, static_cast<void *>(argv.get()));
 
-	wchar_t fname[MAX_PATH]{};
-	if (argv != nullptr && argc > 1)
+	// Headless search worker, started by a running instance
+	if (argv != nullptr && argc == 2 && pdfv::Search::s_cWorkerArg == argv.get()[1])
 	{
-		::GetFullPathNameW(argv.get()[1], MAX_PATH, fname, nullptr);
+		return pdfv::Search::s_workerMain();
 	}
 
-	pdfv::OtherWindow otherWnd{ fname };
+	std::vector<std::wstring> files;
+	if (argv != nullptr)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			wchar_t fname[MAX_PATH]{};
+			if (::GetFullPathNameW(argv.get()[i], MAX_PATH, fname, nullptr) > 0) [[likely]]
+			{
+				files.emplace_back(fname);
+			}
+		}
+	}
+
+	pdfv::OtherWindow otherWnd{ files };
 	if (otherWnd.exists())
 	{
 		return pdfv::error::success;
@@ -32,7 +45,7 @@ int WINAPI wWinMain(HINSTANCE hInst, HINSTANCE, LPWSTR, int nCmdShow)
 		return pdfv::error::error;
 	}
 
-	if (!mwnd.run(fname, nCmdShow)) [[unlikely]]
+	if (!mwnd.run(files, nCmdShow)) [[unlikely]]
 	{
 		pdfv::error::report(mwnd);
 		return pdfv::error::error;
@@ -1,11 +1,20 @@
 #include "mainwindow.hpp"
+#include "governor.hpp"
 
+#include <commdlg.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cwchar>
+#include <limits>
+#include <unordered_set>
 #include <vector>
 
 
 [[nodiscard]] bool pdfv::MainWindow::intersectsTabClose() noexcept
 {
-	auto p{ w::getCur(this->getHandle()) };
+	auto p{ w::getCur(this->m_tabs->getTabsHandle()) };
 
 	for (std::size_t i = 0; i < this->m_tabs->size(); ++i)
 	{
@@ -25,6 +34,49 @@
 	return false;
 }
 
+void pdfv::MainWindow::showMemoryUsage() noexcept
+{
+	DEBUGPRINT("pdfv::MainWindow::showMemoryUsage()\n");
+
+	try
+	{
+		constexpr double mib{ 1024.0 * 1024.0 };
+		const auto usage{ MemoryGovernor::instance().usage() };
+
+		std::wstring text;
+		wchar_t line[128]{};
+		std::size_t total{ 0 };
+		for (std::size_t i = 0; i < std::size_t(MemoryGovernor::Category::count); ++i)
+		{
+			std::swprintf(
+				line, std::size(line), L"%ls: %.1f MiB, %zu dropped (%.1f MiB)\n",
+				MemoryGovernor::s_name(MemoryGovernor::Category(i)),
+				double(usage.used[i]) / mib, usage.evictions[i], double(usage.evictedBytes[i]) / mib
+			);
+			text += line;
+			total += usage.used[i];
+		}
+		std::swprintf(line, std::size(line), L"\nCaches: %.1f of %.1f MiB\n", double(total) / mib, double(usage.budget) / mib);
+		text += line;
+
+		std::size_t docBytes{ 0 }, hibernated{ 0 };
+		for (const auto & tab : this->m_tabs->m_tabs)
+		{
+			docBytes   += tab.second.pdfGetSize();
+			hibernated += tab.hibernated() ? 1 : 0;
+		}
+		std::swprintf(
+			line, std::size(line), L"Documents: %.1f MiB, %zu of %zu tab(s) hibernated",
+			double(docBytes) / mib, hibernated, this->m_tabs->size()
+		);
+		text += line;
+
+		this->message(text.c_str(), L"Memory usage", MB_ICONINFORMATION | MB_OK);
+	}
+	catch (const std::bad_alloc &)
+	{
+	}
+}
 void pdfv::MainWindow::showAboutBox() noexcept
 {
 	DEBUGPRINT("pdfv::MainWindow::aboutBox()\n");
@@ -40,7 +92,7 @@ void pdfv::MainWindow::showAboutBox() noexcept
 void pdfv::MainWindow::setStatusParts() const noexcept
 {
 	auto w{ this->m_usableArea.x };
-	w::status::setParts(this->m_statushwnd, { w - dip(210, dpi.x), w - dip(120, dpi.x), w - dip(17, dpi.x) });
+	w::status::setParts(this->m_statushwnd, { w - dip(260, dpi.x), w - dip(170, dpi.x), w - dip(17, dpi.x) });
 }
 
 pdfv::MainWindow::MainWindow() noexcept
@@ -95,6 +147,13 @@ pdfv::MainWindow::~MainWindow() noexcept
 {
 	DEBUGPRINT("pdfv::MainWindow::~MainWindow()\n");
 
+	// Abandon background jobs as soon as possible
+	this->m_bgCancel = true;
+	this->m_bgWorker.stop();
+	this->m_pageWorker.stop();
+	this->m_attachWorker.stop();
+	this->m_ioWorker.stop();
+
 	// Kill moving thread
 	if (this->m_moveThread != nullptr) [[likely]]
 	{
@@ -154,10 +213,10 @@ pdfv::MainWindow::~MainWindow() noexcept
 	return true;
 }
 
-[[nodiscard]] bool pdfv::MainWindow::run(const wchar_t * fname, int nCmdShow) noexcept
+[[nodiscard]] bool pdfv::MainWindow::run(const std::vector<std::wstring> & files, int nCmdShow) noexcept
 {
-	DEBUGPRINT("pdfv::MainWindow::run(%p, %s, %d)\n", static_cast<const void *>(fname), fname, nCmdShow);
-	std::pair<MainWindow *, const wchar_t *> initPair{ this, fname };
+	DEBUGPRINT("pdfv::MainWindow::run(%p, %d)\n", static_cast<const void *>(&files), nCmdShow);
+	std::pair<MainWindow *, const std::vector<std::wstring> *> initPair{ this, &files };
 	this->m_hwnd = ::CreateWindowExW(
 		0,
 		APP_CLASSNAME,
@@ -195,6 +254,9 @@ pdfv::MainWindow::~MainWindow() noexcept
 	// Good practise
 	::UpdateWindow(this->getHandle());
 
+	// Only the current tab of the last session is opened now, files given on the command line replace it
+	this->m_tabs->restoreSession(files.empty());
+
 	return true;
 }
 
@@ -291,10 +353,10 @@ LRESULT CALLBACK pdfv::MainWindow::windowProc(HWND hwnd, UINT uMsg, WPARAM wp, L
 	if (uMsg == WM_CREATE) [[unlikely]]
 	{
 		auto cs{ reinterpret_cast<CREATESTRUCTW *>(lp) };
-		auto vals = static_cast<std::pair<MainWindow *, const wchar_t *> *>(cs->lpCreateParams);
+		auto vals = static_cast<std::pair<MainWindow *, const std::vector<std::wstring> *> *>(cs->lpCreateParams);
 		self = vals->first;
 		w::setPtr(hwnd, self);
-		cs->lpCreateParams = const_cast<wchar_t *>(vals->second);
+		cs->lpCreateParams = const_cast<std::vector<std::wstring> *>(vals->second);
 	}
 	else [[likely]]
 	{
@@ -352,12 +414,20 @@ LRESULT pdfv::MainWindow::intWindowProc(HWND hwnd, UINT uMsg, WPARAM wp, LPARAM
 		this->wOnSize();
 		break;
 	case WM_CLOSE:
+		this->m_tabs->saveSession();
 		::DestroyWindow(hwnd);
 		this->m_hwnd = nullptr;
 		break;
 	case WM_DESTROY:
 		::PostQuitMessage(pdfv::error::success);
 		break;
+	case WM_ENDSESSION:
+		// Windows is shutting down, WM_CLOSE isn't sent
+		if (wp)
+		{
+			this->m_tabs->saveSession();
+		}
+		break;
 	case WM_CREATE:
 		this->wOnCreate(hwnd, lp);
 		break;
@@ -371,6 +441,58 @@ LRESULT pdfv::MainWindow::intWindowProc(HWND hwnd, UINT uMsg, WPARAM wp, LPARAM
 	case pdfv::MainWindow::WM_BRINGTOFRONT:
 		this->wOnBringToFront();
 		break;
+	case WM_TIMER:
+		this->wOnTimer(wp);
+		break;
+	case pdfv::MainWindow::WM_FILEREADY:
+		this->wOnFileReady();
+		break;
+	case pdfv::MainWindow::WM_SEARCHRESULT:
+		this->wOnSearchResult();
+		break;
+	case pdfv::MainWindow::WM_RELOADREADY:
+		this->m_tabs->finishReloads();
+		break;
+	case pdfv::MainWindow::WM_RELOADREAD:
+		this->m_tabs->checkReload();
+		// Files that were read while a reload prompted for a password
+		this->wOnFileReady();
+		break;
+	case pdfv::MainWindow::WM_TAGSREADY:
+		// Only if the same document is still current, the pointer is just compared
+		if (auto tab{ this->m_tabs->curTab() }; tab != nullptr)
+		{
+			if (auto tags{ tab->second.pdfGetTags() }; tags != nullptr && tags->ready() &&
+				reinterpret_cast<LPARAM>(tags.get()) == lp)
+			{
+				this->copyTags();
+			}
+		}
+		break;
+	case pdfv::MainWindow::WM_LABELSREADY:
+		this->m_tabs->updatePageCounter();
+		break;
+	case pdfv::MainWindow::WM_ATTACHDONE:
+		// Lengths of the extracted files are known now
+		if (this->m_attachShown)
+		{
+			::InvalidateRect(this->m_attachhwnd, nullptr, FALSE);
+		}
+		try
+		{
+			const auto text{ L"Extracted " + std::to_wstring(wp) + L" of " + std::to_wstring(lp) + L" attachment(s)" };
+			w::status::setText(this->m_statushwnd, StatusGeneral, w::status::DrawOp::def, text.c_str());
+		}
+		catch (const std::bad_alloc &)
+		{
+		}
+		break;
+	case pdfv::MainWindow::WM_THUMBREADY:
+		if (this->m_thumbsShown && wp >= 1)
+		{
+			ListView_RedrawItems(this->m_thumbshwnd, int(wp - 1), int(wp - 1));
+		}
+		break;
 	default:
 		return ::DefWindowProcW(hwnd, uMsg, wp, lp);
 	}
@@ -470,6 +592,48 @@ void pdfv::MainWindow::wOnCommand(WPARAM wp) noexcept
 	case IDM_FILE_EXIT:
 		this->close();
 		break;
+	case IDM_EDIT_COPY:
+		this->m_tabs->copySelection();
+		break;
+	case IDM_EDIT_SELECTALL:
+		this->m_tabs->selectAll();
+		break;
+	case IDM_EDIT_FIND:
+		this->find();
+		break;
+	case IDM_EDIT_FINDNEXT:
+		this->findNext(true);
+		break;
+	case IDM_EDIT_FINDPREV:
+		this->findNext(false);
+		break;
+	case IDM_EDIT_MATCHCASE:
+		this->toggleSearchOption(this->m_searchOptions.matchCase, IDM_EDIT_MATCHCASE);
+		break;
+	case IDM_EDIT_MATCHDIACRITICS:
+		this->toggleSearchOption(this->m_searchOptions.matchDiacritics, IDM_EDIT_MATCHDIACRITICS);
+		break;
+	case IDM_EDIT_REGEX:
+		this->toggleSearchOption(this->m_searchOptions.regex, IDM_EDIT_REGEX);
+		break;
+	case IDM_EDIT_COPYTAGS:
+		this->copyTags();
+		break;
+	case IDM_EDIT_GOTOPAGE:
+		this->goToLabel();
+		break;
+	case IDM_VIEW_ATTACHMENTS:
+		this->toggleAttachments();
+		break;
+	case IDM_VIEW_THUMBS:
+		this->toggleThumbs();
+		break;
+	case IDM_VIEW_OUTLINE:
+		this->toggleOutline();
+		break;
+	case IDM_VIEW_MEMORY:
+		this->showMemoryUsage();
+		break;
 	case IDM_HELP_ABOUT:
 		if (this->m_helpAvailable)
 		{
@@ -635,6 +799,18 @@ void pdfv::MainWindow::wOnTabMouseMove([[maybe_unused]] WPARAM wp, [[maybe_unuse
 LRESULT pdfv::MainWindow::wOnNotify(LPARAM lp) noexcept
 {
 	DEBUGPRINT("pdfv::MainWIndow::wOnNotify(%lu)\n", lp);
+	if (auto hdr{ reinterpret_cast<NMHDR *>(lp) }; hdr->hwndFrom == this->m_outlinehwnd && hdr->hwndFrom != nullptr)
+	{
+		return this->wOnOutlineNotify(hdr);
+	}
+	else if (hdr->hwndFrom == this->m_thumbshwnd && hdr->hwndFrom != nullptr)
+	{
+		return this->wOnThumbsNotify(hdr);
+	}
+	else if (hdr->hwndFrom == this->m_attachhwnd && hdr->hwndFrom != nullptr)
+	{
+		return this->wOnAttachNotify(hdr);
+	}
 	switch (reinterpret_cast<NMHDR *>(lp)->code)
 	{
 	case TCN_KEYDOWN:
@@ -705,7 +881,34 @@ void pdfv::MainWindow::wOnSize() noexcept
 	this->m_border.y -= this->m_menuSize;
 
 	auto statusr{ w::getCliR(this->m_statushwnd) };
-	this->m_tabs->resize(this->m_usableArea - xy<int>{ 0, statusr.bottom - statusr.top });
+	const auto area{ this->m_usableArea - xy<int>{ 0, statusr.bottom - statusr.top } };
+	const auto outlineWidth{ this->m_outlineShown ? std::min(dip(MainWindow::s_cOutlineWidth, dpi.x), area.x / 2) : 0 };
+	if (this->m_outlineShown)
+	{
+		w::moveWin(this->m_outlinehwnd, RECT{ 0, 0, outlineWidth, area.y }, true);
+		ListView_SetColumnWidth(this->m_outlinehwnd, 0, LVSCW_AUTOSIZE_USEHEADER);
+	}
+	const auto thumbsWidth{ this->m_thumbsShown ? std::min(
+		dip(Thumbnails::s_cWidth + 2 * MainWindow::s_cThumbsMargin, dpi.x) + ::GetSystemMetrics(SM_CXVSCROLL),
+		(area.x - outlineWidth) / 2
+	) : 0 };
+	if (this->m_thumbsShown)
+	{
+		w::moveWin(this->m_thumbshwnd, RECT{ area.x - thumbsWidth, 0, area.x, area.y }, true);
+		ListView_SetColumnWidth(this->m_thumbshwnd, 0, LVSCW_AUTOSIZE_USEHEADER);
+	}
+	const auto attachHeight{ this->m_attachShown ? std::min(dip(MainWindow::s_cAttachHeight, dpi.y), area.y / 2) : 0 };
+	if (this->m_attachShown)
+	{
+		w::moveWin(this->m_attachhwnd, RECT{ outlineWidth, area.y - attachHeight, area.x - thumbsWidth, area.y }, true);
+		const auto sizeWidth{ dip(MainWindow::s_cAttachSizeWidth, dpi.x) };
+		ListView_SetColumnWidth(this->m_attachhwnd, 1, sizeWidth);
+		ListView_SetColumnWidth(this->m_attachhwnd, 0, std::max(
+			area.x - thumbsWidth - outlineWidth - sizeWidth - ::GetSystemMetrics(SM_CXVSCROLL) - 4, sizeWidth
+		));
+	}
+	this->m_tabs->move({ outlineWidth, 0 });
+	this->m_tabs->resize(area - xy<int>{ outlineWidth + thumbsWidth, attachHeight });
 	w::resize(this->m_statushwnd, 0, 0);
 	
 	// Set status bar parts
@@ -751,18 +954,108 @@ void pdfv::MainWindow::wOnCreate(HWND hwnd, LPARAM lp) noexcept
 	this->m_tabs = std::make_unique<Tabs>(*this, hwnd, this->getHinst(), clir);
 	w::setFont(this->m_tabs->getTabsHandle(), this->getDefFont());
 
+	// Outline panel, hidden until toggled
+	this->m_outlinehwnd = ::CreateWindowExW(
+		0,
+		WC_LISTVIEW,
+		nullptr,
+		WS_CHILD | WS_CLIPSIBLINGS | WS_TABSTOP | LVS_REPORT | LVS_NOCOLUMNHEADER |
+			LVS_OWNERDATA | LVS_SINGLESEL | LVS_SHOWSELALWAYS,
+		0, 0, 0, 0,
+		hwnd,
+		reinterpret_cast<HMENU>(IDC_OUTLINE),
+		this->m_hInst,
+		nullptr
+	);
+	if (this->m_outlinehwnd != nullptr) [[likely]]
+	{
+		ListView_SetExtendedListViewStyle(this->m_outlinehwnd, LVS_EX_FULLROWSELECT | LVS_EX_DOUBLEBUFFER);
+		// Rows are indented by multiples of the small image width, the list view destroys the image list
+		ListView_SetImageList(
+			this->m_outlinehwnd,
+			ImageList_Create(dip(MainWindow::s_cOutlineIndent, dpi.x), 1, ILC_COLOR32, 0, 1),
+			LVSIL_SMALL
+		);
+		LVCOLUMNW col{};
+		col.mask = LVCF_WIDTH;
+		col.cx   = dip(MainWindow::s_cOutlineWidth, dpi.x);
+		ListView_InsertColumn(this->m_outlinehwnd, 0, &col);
+		w::setFont(this->m_outlinehwnd, this->getDefFont());
+	}
+
+	// Thumbnail strip, hidden until toggled
+	this->m_thumbshwnd = ::CreateWindowExW(
+		0,
+		WC_LISTVIEW,
+		nullptr,
+		WS_CHILD | WS_CLIPSIBLINGS | WS_TABSTOP | LVS_REPORT | LVS_NOCOLUMNHEADER |
+			LVS_OWNERDATA | LVS_SINGLESEL,
+		0, 0, 0, 0,
+		hwnd,
+		reinterpret_cast<HMENU>(IDC_THUMBS),
+		this->m_hInst,
+		nullptr
+	);
+	if (this->m_thumbshwnd != nullptr) [[likely]]
+	{
+		ListView_SetExtendedListViewStyle(this->m_thumbshwnd, LVS_EX_FULLROWSELECT | LVS_EX_DOUBLEBUFFER);
+		// Row height follows the small image height, rows are custom drawn
+		ListView_SetImageList(
+			this->m_thumbshwnd,
+			ImageList_Create(
+				1, dip(Thumbnails::s_cHeight + 2 * MainWindow::s_cThumbsMargin + MainWindow::s_cThumbsCaption, dpi.y),
+				ILC_COLOR32, 0, 1
+			),
+			LVSIL_SMALL
+		);
+		LVCOLUMNW col{};
+		col.mask = LVCF_WIDTH;
+		col.cx   = dip(Thumbnails::s_cWidth + 2 * MainWindow::s_cThumbsMargin, dpi.x);
+		ListView_InsertColumn(this->m_thumbshwnd, 0, &col);
+		w::setFont(this->m_thumbshwnd, this->getDefFont());
+	}
+
+	// Attachment panel, hidden until toggled
+	this->m_attachhwnd = ::CreateWindowExW(
+		0,
+		WC_LISTVIEW,
+		nullptr,
+		WS_CHILD | WS_CLIPSIBLINGS | WS_TABSTOP | LVS_REPORT | LVS_OWNERDATA | LVS_SHOWSELALWAYS,
+		0, 0, 0, 0,
+		hwnd,
+		reinterpret_cast<HMENU>(IDC_ATTACHMENTS),
+		this->m_hInst,
+		nullptr
+	);
+	if (this->m_attachhwnd != nullptr) [[likely]]
+	{
+		ListView_SetExtendedListViewStyle(this->m_attachhwnd, LVS_EX_FULLROWSELECT | LVS_EX_DOUBLEBUFFER);
+		LVCOLUMNW col{};
+		col.mask    = LVCF_WIDTH | LVCF_TEXT;
+		col.cx      = dip(MainWindow::s_cOutlineWidth, dpi.x);
+		col.pszText = const_cast<wchar_t *>(L"Attachment");
+		ListView_InsertColumn(this->m_attachhwnd, 0, &col);
+		col.mask   |= LVCF_FMT;
+		col.fmt     = LVCFMT_RIGHT;
+		col.cx      = dip(MainWindow::s_cAttachSizeWidth, dpi.x);
+		col.pszText = const_cast<wchar_t *>(L"Size");
+		ListView_InsertColumn(this->m_attachhwnd, 1, &col);
+		w::setFont(this->m_attachhwnd, this->getDefFont());
+	}
+
 	this->m_tabs->insert(Tabs::defaulttitle);
 
-	// Open PDF if any
-	const wchar_t * fname{ static_cast<wchar_t *>(reinterpret_cast<CREATESTRUCTW *>(lp)->lpCreateParams) };
-	if ((fname != nullptr) && (fname[0] != '\0'))
+	// Open PDFs if any
+	auto files{ static_cast<const std::vector<std::wstring> *>(reinterpret_cast<CREATESTRUCTW *>(lp)->lpCreateParams) };
+	if ((files != nullptr) && !files->empty())
 	{
-		// Open pdf
-		std::wstring_view fnv(fname);
-		this->openPdfFile(fnv);
-		this->m_openDialog.updateName(fnv);
+		this->openPdfFiles(*files);
+		this->m_openDialog.updateName(files->back());
 	}
 
+	// Watch open files for changes
+	::SetTimer(hwnd, IDT_FILEWATCH, MainWindow::s_cFileWatchInterval, nullptr);
+
 	// Create thread to check for highlighting
 	this->m_moveThread = ::CreateThread(
 		nullptr,
@@ -801,16 +1094,54 @@ void pdfv::MainWindow::wOnCreate(HWND hwnd, LPARAM lp) noexcept
 void pdfv::MainWindow::wOnCopydata(LPARAM lp) noexcept
 {
 	DEBUGPRINT("pdfv::MainWindow::wOnCopyData(%lu)\n", lp);
-	if (auto receive{ reinterpret_cast<const COPYDATASTRUCT *>(lp) }; receive != nullptr && receive->dwData > 0) [[likely]]
+	auto receive{ reinterpret_cast<const COPYDATASTRUCT *>(lp) };
+	if (receive == nullptr || receive->lpData == nullptr) [[unlikely]]
+	{
+		return;
+	}
+
+	// Never trust the sender with the terminators
+	std::wstring_view data(static_cast<const wchar_t *>(receive->lpData), receive->cbData / sizeof(wchar_t));
+	std::vector<std::wstring> files;
+
+	switch (receive->dwData)
 	{
-		// Open pdf
-		std::wstring_view fnv(static_cast<wchar_t *>(receive->lpData));
-		if (fnv.length() == 0) [[unlikely]]
+	case MainWindow::s_cCopyDataFile:
+		if (auto end{ data.find(L'\0') }; end != std::wstring_view::npos)
 		{
-			return;
+			data = data.substr(0, end);
+		}
+		if (!data.empty()) [[likely]]
+		{
+			files.emplace_back(data);
+		}
+		break;
+	case MainWindow::s_cCopyDataBatch:
+		while (!data.empty())
+		{
+			auto end{ data.find(L'\0') };
+			auto file{ data.substr(0, end) };
+			if (file.empty())
+			{
+				break;
+			}
+			files.emplace_back(file);
+			if (end == std::wstring_view::npos)
+			{
+				break;
+			}
+			data.remove_prefix(end + 1);
 		}
-		this->openPdfFile(fnv);
-		this->m_openDialog.updateName(fnv);
+		break;
+	default:
+		return;
+	}
+
+	if (!files.empty()) [[likely]]
+	{
+		// Only queue the files here, the sender is blocked until this message returns
+		this->openPdfFiles(files);
+		this->m_openDialog.updateName(files.back());
 	}
 }
 void pdfv::MainWindow::wOnBringToFront() noexcept
@@ -829,6 +1160,24 @@ void pdfv::MainWindow::wOnBringToFront() noexcept
 	::SetActiveWindow(this->getHandle());
 	::AttachThreadInput(dwCurID, dwMyID, FALSE);
 }
+void pdfv::MainWindow::wOnTimer(WPARAM wp) noexcept
+{
+	switch (wp)
+	{
+	case IDT_FILEWATCH:
+		// Nothing is released under a reload that prompts for a password
+		if (this->m_tabs->reloading())
+		{
+			break;
+		}
+		this->m_tabs->checkReload();
+		this->wOnFileReady();
+		this->m_tabs->checkHibernate();
+		MemoryGovernor::instance().enforce();
+		this->m_tabs->warmUp();
+		break;
+	}
+}
 
 
 INT_PTR CALLBACK pdfv::MainWindow::aboutProc(HWND hwnd, UINT uMsg, WPARAM wp, LPARAM lp) noexcept
@@ -875,26 +1224,1074 @@ INT_PTR CALLBACK pdfv::MainWindow::aboutProc(HWND hwnd, UINT uMsg, WPARAM wp, LP
 void pdfv::MainWindow::openPdfFile(std::wstring_view file) noexcept
 {
 	DEBUGPRINT("pdfv::MainWindow::openPdfFile(%p)\n", static_cast<const void *>(file.data()));
-	std::wstring_view fshort;
-	for (std::size_t i = file.length() - 1; i > 0; --i)
+	this->openPdfFiles({ std::wstring(file) });
+}
+void pdfv::MainWindow::openPdfFiles(const std::vector<std::wstring> & files) noexcept
+{
+	DEBUGPRINT("pdfv::MainWindow::openPdfFiles(%zu)\n", files.size());
+
+	for (const auto & file : files)
 	{
-		if (file[i] == L'\\') [[unlikely]]
+		if (file.empty()) [[unlikely]]
 		{
-			fshort = file.substr(i + 1);
-			break;
+			continue;
+		}
+
+		// Destinations in documents that are already open resolve without reopening them
+		bool jumped{ false };
+		for (std::size_t i = 0; i < this->m_tabs->size() && !jumped; ++i)
+		{
+			const auto & path{ this->m_tabs->m_tabs[i].path() };
+			if (!path.empty() && file.size() > path.size() + 1 && file[path.size()] == L'#' && file.starts_with(path))
+			{
+				this->m_tabs->select(ssize_t(i));
+				this->goToDest(std::wstring_view(file).substr(path.size() + 1));
+				jumped = true;
+			}
+		}
+		if (jumped)
+		{
+			continue;
+		}
+
+		try
+		{
+			auto pending{ std::make_shared<PendingOpen>() };
+			pending->path = file;
+
+			// Files are read in order on the I/O worker, while the GUI thread parses the ones that are already read
+			this->m_ioWorker.post([pending, hwnd = this->getHandle()]()
+			{
+				// "#" is valid in file names, it only starts a destination name if the whole path doesn't exist
+				if (auto hash{ pending->path.rfind(L'#') };
+					hash != std::wstring::npos && ::GetFileAttributesW(pending->path.c_str()) == INVALID_FILE_ATTRIBUTES)
+				{
+					pending->dest = pending->path.substr(hash + 1);
+					pending->path.resize(hash);
+				}
+				pending->err = Pdfium::readFile(pending->path, pending->data, pending->length, pending->stamp, pending->fingerprint);
+				pending->ready.store(true, std::memory_order_release);
+				::PostMessageW(hwnd, MainWindow::WM_FILEREADY, 0, 0);
+			});
+			// Queued only once posted, a file that is never read would hold up the ones after it
+			this->m_openQueue.emplace_back(std::move(pending));
+		}
+		catch (...)
+		{
+			w::status::setText(this->m_statushwnd, StatusGeneral, w::status::DrawOp::def, L"Not enough memory");
+		}
+	}
+}
+void pdfv::MainWindow::wOnFileReady() noexcept
+{
+	DEBUGPRINT("pdfv::MainWindow::wOnFileReady()\n");
+
+	if (this->m_opening || this->m_tabs->reloading())
+	{
+		return;
+	}
+	this->m_opening = true;
+
+	// Open files strictly in the order they were queued
+	while (!this->m_openQueue.empty() && this->m_openQueue.front()->ready.load(std::memory_order_acquire))
+	{
+		auto pending{ this->m_openQueue.front() };
+
+		std::wstring_view file{ pending->path }, fshort{ file };
+		if (auto pos{ file.find_last_of(L"\\/") }; pos != std::wstring_view::npos) [[likely]]
+		{
+			fshort = file.substr(pos + 1);
+		}
+
+		// Loaded outside of the tab list, a password prompt lets the user open and close tabs
+		pdfv::Pdfium doc;
+		bool loaded{ false };
+		if (pending->err == error::noerror) [[likely]]
+		{
+			loaded = doc.pdfLoad(
+				*this, pending->path, std::move(pending->data), pending->length, pending->stamp, pending->fingerprint
+			) == error::pdf_success;
+		}
+
+		pdfv::Tabs::ListType::iterator it;
+		if (this->m_tabs->size() == 1 && this->m_tabs->getName() == Tabs::defaulttitlepadded)
+		{
+			it = this->m_tabs->rename(fshort);
+		}
+		else
+		{
+			it = this->m_tabs->insert(fshort);
+		}
+		(it)->second = std::move(doc);
+		if (loaded)
+		{
+			this->indexDocument((it)->second);
+		}
+
+		this->m_tabs->select();
+		if (!pending->dest.empty() && (it)->second.pdfExists())
+		{
+			this->goToDest(pending->dest);
 		}
+		this->m_openQueue.pop_front();
+	}
+
+	this->m_opening = false;
+}
+void pdfv::MainWindow::copyTags() noexcept
+{
+	DEBUGPRINT("pdfv::MainWindow::copyTags()\n");
+
+	auto tab{ this->m_tabs->curTab() };
+	auto tags{ (tab != nullptr) ? tab->second.pdfGetTags() : nullptr };
+	if (tags == nullptr)
+	{
+		return;
 	}
-	pdfv::Tabs::ListType::iterator it;
-	if (this->m_tabs->size() == 1 && this->m_tabs->getName() == Tabs::defaulttitlepadded)
+
+	const wchar_t * status{ L"Reading tagged structure..." };
+	if (!tags->ready())
 	{
-		it = this->m_tabs->rename(fshort);
+		if (tags->request())
+		{
+			try
+			{
+				this->m_pageWorker.post(
+					[tags, &cancel = this->m_bgCancel, hwnd = this->getHandle()]
+					{
+						tags->build(cancel);
+						::PostMessageW(hwnd, MainWindow::WM_TAGSREADY, 0, reinterpret_cast<LPARAM>(tags.get()));
+					}
+				);
+			}
+			catch (...)
+			{
+				tags->withdraw();
+				status = L"Not enough memory";
+			}
+		}
 	}
 	else
 	{
-		it = this->m_tabs->insert(fshort);
+		status = L"Document isn't tagged";
+		try
+		{
+			if (tags->any())
+			{
+				status = w::setClipboardText(this->getHandle(), tags->exportText()) ?
+					L"Tagged structure copied" : L"Couldn't open the clipboard";
+			}
+		}
+		catch (const std::bad_alloc &)
+		{
+			status = L"Not enough memory";
+		}
+	}
+	w::status::setText(this->m_statushwnd, StatusGeneral, w::status::DrawOp::def, status);
+}
+void pdfv::MainWindow::goToLabel() noexcept
+{
+	DEBUGPRINT("pdfv::MainWindow::goToLabel()\n");
+
+	if (auto tab{ this->m_tabs->curTab() }; tab == nullptr || !tab->second.pdfExists())
+	{
+		return;
+	}
+	auto input{ askInfo(*this, L"Page label or number:", L"Go to page") };
+	std::wstring_view label{ input };
+	while (!label.empty() && label.front() == L' ')
+	{
+		label.remove_prefix(1);
+	}
+	while (!label.empty() && label.back() == L' ')
+	{
+		label.remove_suffix(1);
+	}
+	if (label.empty())
+	{
+		return;
+	}
+
+	// Tab might have been closed while the dialog was open
+	auto tab{ this->m_tabs->curTab() };
+	if (tab == nullptr || !tab->second.pdfExists())
+	{
+		return;
+	}
+	std::size_t page{ 0 };
+	if (auto labels{ tab->second.pdfGetLabels() }; labels != nullptr)
+	{
+		page = labels->find(label);
+	}
+	if (page == 0 && std::all_of(label.begin(), label.end(), [](wchar_t ch) { return ch >= L'0' && ch <= L'9'; }))
+	{
+		// Physical page number
+		for (auto ch : label)
+		{
+			page = std::min(page * 10 + std::size_t(ch - L'0'), tab->second.pageGetCount() + 1);
+		}
+	}
+
+	if (page >= 1 && page <= tab->second.pageGetCount())
+	{
+		this->m_tabs->goToPage(page);
+		return;
+	}
+	try
+	{
+		std::wstring text{ L"Page not found: " };
+		text += label;
+		w::status::setText(this->m_statushwnd, StatusGeneral, w::status::DrawOp::def, text.c_str());
+	}
+	catch (const std::bad_alloc &)
+	{
+	}
+}
+bool pdfv::MainWindow::goToDest(std::wstring_view name) noexcept
+{
+	DEBUGPRINT("pdfv::MainWindow::goToDest(%p)\n", static_cast<const void *>(name.data()));
+
+	auto tab{ this->m_tabs->curTab() };
+	auto dests{ (tab != nullptr) ? tab->second.pdfGetDests() : nullptr };
+	DestTarget target;
+	if (dests != nullptr && dests->find(name, target) && target.page != 0)
+	{
+		this->m_tabs->goToPage(target.page);
+		return true;
+	}
+
+	try
+	{
+		std::wstring text{ L"Destination not found: " };
+		text += name;
+		w::status::setText(this->m_statushwnd, StatusGeneral, w::status::DrawOp::def, text.c_str());
+	}
+	catch (const std::bad_alloc &)
+	{
+	}
+	return false;
+}
+void pdfv::MainWindow::wOnSearchResult() noexcept
+{
+	DEBUGPRINT("pdfv::MainWindow::wOnSearchResult()\n");
+
+	const auto hadHits{ !this->m_search.hitPages().empty() };
+	std::size_t newHits{ 0 };
+	try
+	{
+		newHits = this->m_search.update();
+	}
+	catch (...)
+	{
+		this->m_search.cancel();
+	}
+
+	auto tab{ this->m_tabs->curTab() };
+	if (newHits > 0 && tab != nullptr && tab->second.pdfGetId() == this->m_search.docId())
+	{
+		// Jump to the first match as soon as it's found, results closer to the current page arrive first
+		if (auto page{ this->m_search.nearestPage(tab->second.pageGetNum()) }; !hadHits && page != 0)
+		{
+			this->m_curHit = this->m_search.pageHits(page).front();
+			this->m_tabs->goToPage(page);
+		}
+		// Highlights are drawn over the cached page, no re-rendering takes place
+		this->m_tabs->redrawCanvas();
+	}
+
+	this->updateSearchStatus();
+}
+
+void pdfv::MainWindow::find() noexcept
+{
+	DEBUGPRINT("pdfv::MainWindow::find()\n");
+
+	auto tab{ this->m_tabs->curTab() };
+	if (tab == nullptr || !tab->second.pdfExists())
+	{
+		return;
+	}
+
+	auto query{ askInfo(*this, L"Find text:", L"Find") };
+	if (query.empty())
+	{
+		return;
+	}
+
+	// Tab might have been closed while the dialog was open
+	tab = this->m_tabs->curTab();
+	if (tab == nullptr || !tab->second.pdfExists())
+	{
+		return;
+	}
+
+	this->m_curHit = {};
+	bool started{ false };
+	try
+	{
+		started = this->m_search.start(
+			this->m_hwnd, WM_SEARCHRESULT, tab->second, query, this->m_searchOptions, tab->second.pageGetNum(),
+			TextIndex::open(tab->second.pdfGetFingerprint())
+		);
+	}
+	catch (...)
+	{
+		this->m_search.cancel();
+	}
+	if (!started && this->m_searchOptions.regex)
+	{
+		this->message(L"Invalid regular expression!", MB_ICONERROR | MB_OK);
+	}
+	this->updateSearchStatus();
+}
+void pdfv::MainWindow::findNext(bool forward) noexcept
+{
+	DEBUGPRINT("pdfv::MainWindow::findNext(%d)\n", forward);
+
+	auto tab{ this->m_tabs->curTab() };
+	if (tab == nullptr || !tab->second.pdfExists())
+	{
+		return;
+	}
+	if (tab->second.pdfGetId() != this->m_search.docId() || this->m_search.query().empty())
+	{
+		this->find();
+		return;
+	}
+
+	auto from{ this->m_curHit };
+	if (from.page != tab->second.pageGetNum())
+	{
+		// Page was changed since, continue from the edge of the current page
+		from = { .page = tab->second.pageGetNum(), .index = forward ? -1 : std::numeric_limits<int>::max() };
+	}
+	auto hit{ this->m_search.nextHit(from, forward) };
+	if (hit.page == 0)
+	{
+		return;
+	}
+
+	this->m_curHit = hit;
+	if (hit.page != tab->second.pageGetNum())
+	{
+		this->m_tabs->goToPage(hit.page);
+	}
+	else
+	{
+		this->m_tabs->redrawCanvas();
+	}
+}
+void pdfv::MainWindow::updateSearchStatus() const noexcept
+{
+	try
+	{
+		std::wstring text;
+		if (!this->m_search.query().empty())
+		{
+			text = L"\"" + this->m_search.query() + L"\": " +
+				std::to_wstring(this->m_search.hits().size()) + L" match(es) on " +
+				std::to_wstring(this->m_search.hitPages().size()) + L" page(s)";
+			if (this->m_search.running())
+			{
+				text += L", searched " + std::to_wstring(this->m_search.pagesDone()) + L'/' +
+					std::to_wstring(this->m_search.numPages());
+			}
+		}
+		w::status::setText(this->m_statushwnd, StatusGeneral, w::status::DrawOp::def, text.c_str());
+	}
+	catch (...)
+	{
+	}
+}
+void pdfv::MainWindow::toggleSearchOption(bool & option, UINT id) noexcept
+{
+	DEBUGPRINT("pdfv::MainWindow::toggleSearchOption(%p, %u)\n", static_cast<void *>(&option), id);
+
+	option = !option;
+	::CheckMenuItem(::GetMenu(this->getHandle()), id, MF_BYCOMMAND | (option ? MF_CHECKED : MF_UNCHECKED));
+}
+void pdfv::MainWindow::indexDocument(const Pdfium & doc) const noexcept
+{
+	DEBUGPRINT("pdfv::MainWindow::indexDocument(%p)\n", static_cast<const void *>(&doc));
+
+	if (!doc.pdfExists())
+	{
+		return;
+	}
+
+	try
+	{
+		if (auto labels{ doc.pdfGetLabels() }; labels != nullptr && !labels->ready())
+		{
+			this->m_bgWorker.post(
+				[labels = std::move(labels), &cancel = this->m_bgCancel, hwnd = this->getHandle()]
+				{
+					labels->build(cancel);
+					if (labels->any())
+					{
+						// Show the label of the current page right away
+						::PostMessageW(hwnd, MainWindow::WM_LABELSREADY, 0, 0);
+					}
+				}
+			);
+		}
+		if (auto dests{ doc.pdfGetDests() }; dests != nullptr && !dests->ready())
+		{
+			this->m_bgWorker.post(
+				[dests = std::move(dests), &cancel = this->m_bgCancel]
+				{
+					dests->build(cancel);
+				}
+			);
+		}
+		if (TextIndex::exists(doc.pdfGetFingerprint()))
+		{
+			return;
+		}
+
+		// Index is stored unencrypted, so documents that needed a password are only ever searched page by page
+		auto data{ doc.pdfGetData() };
+		if (!Pdfium::getCredential(data.get(), doc.pdfGetSize(), doc.pdfGetPath()).empty())
+		{
+			return;
+		}
+		this->m_bgWorker.post(
+			[fingerprint = doc.pdfGetFingerprint(), data = std::move(data), length = doc.pdfGetSize(),
+			 &cancel = this->m_bgCancel]
+			{
+				// Same document might have been queued more than once
+				if (!TextIndex::exists(fingerprint))
+				{
+					TextIndex::build(fingerprint, data.get(), length, cancel);
+				}
+			}
+		);
+	}
+	catch (...)
+	{
+	}
+}
+void pdfv::MainWindow::compareReload(const Pdfium & doc) const noexcept
+{
+	DEBUGPRINT("pdfv::MainWindow::compareReload(%p)\n", static_cast<const void *>(&doc));
+
+	auto reload{ doc.pdfGetReload() };
+	if (reload == nullptr)
+	{
+		return;
+	}
+
+	try
+	{
+		this->m_pageWorker.post(
+			[reload, hwnd = this->getHandle()]
+			{
+				reload->compare();
+				::PostMessageW(hwnd, MainWindow::WM_RELOADREADY, 0, 0);
+			}
+		);
+	}
+	catch (...)
+	{
+		// Without a worker the pages are compared right away
+		reload->compare();
+		::PostMessageW(this->getHandle(), MainWindow::WM_RELOADREADY, 0, 0);
+	}
+}
+void pdfv::MainWindow::readReload(std::shared_ptr<Pdfium::ReloadRead> read, const std::wstring & path) const noexcept
+{
+	DEBUGPRINT("pdfv::MainWindow::readReload(%p)\n", static_cast<void *>(read.get()));
+
+	try
+	{
+		this->m_ioWorker.post(
+			[read, path, hwnd = this->getHandle()]
+			{
+				read->err = Pdfium::readFile(path, read->data, read->length, read->stamp, read->fingerprint);
+				read->ready.store(true, std::memory_order_release);
+				::PostMessageW(hwnd, MainWindow::WM_RELOADREAD, 0, 0);
+			}
+		);
+	}
+	catch (...)
+	{
+		read->err = error::pdf_file;
+		read->ready.store(true, std::memory_order_release);
+	}
+}
+void pdfv::MainWindow::indexLinks(const Pdfium & doc, std::size_t page) const noexcept
+{
+	DEBUGPRINT("pdfv::MainWindow::indexLinks(%p, %zu)\n", static_cast<const void *>(&doc), page);
+
+	auto links{ doc.pdfGetLinks() };
+	if (links == nullptr || !links->request(page))
+	{
+		return;
+	}
+
+	try
+	{
+		this->m_pageWorker.post(
+			[links = std::move(links), page]
+			{
+				links->build(page);
+			}
+		);
+	}
+	catch (...)
+	{
+	}
+}
+void pdfv::MainWindow::updateOutline() const noexcept
+{
+	if (!this->m_outlineShown)
+	{
+		return;
+	}
+	auto tab{ this->m_tabs->curTab() };
+	const auto id{ (tab != nullptr) ? tab->second.pdfGetId() : 0 };
+	if (id == this->m_outlineDocId)
+	{
+		return;
+	}
+	DEBUGPRINT("pdfv::MainWindow::updateOutline()\n");
+
+	this->m_outlineDocId = id;
+	auto outline{ (tab != nullptr) ? tab->second.pdfGetOutline() : nullptr };
+	if (outline != nullptr)
+	{
+		outline->loadRoot();
+	}
+	ListView_SetItemCountEx(this->m_outlinehwnd, (outline != nullptr) ? int(outline->rows()) : 0, 0);
+	if (outline != nullptr && outline->rows() > 0)
+	{
+		ListView_EnsureVisible(this->m_outlinehwnd, 0, FALSE);
+	}
+}
+void pdfv::MainWindow::toggleOutline() noexcept
+{
+	DEBUGPRINT("pdfv::MainWindow::toggleOutline()\n");
+
+	if (this->m_outlinehwnd == nullptr) [[unlikely]]
+	{
+		return;
+	}
+	this->m_outlineShown = !this->m_outlineShown;
+	this->m_outlineDocId = MainWindow::s_cNoOutline;
+	::CheckMenuItem(
+		::GetMenu(this->getHandle()), IDM_VIEW_OUTLINE,
+		MF_BYCOMMAND | (this->m_outlineShown ? MF_CHECKED : MF_UNCHECKED)
+	);
+	::ShowWindow(this->m_outlinehwnd, this->m_outlineShown ? SW_SHOW : SW_HIDE);
+	this->wOnSize();
+	this->updateOutline();
+	::SetFocus(this->m_outlineShown ? this->m_outlinehwnd : this->m_tabs->getCanvasHandle());
+}
+LRESULT pdfv::MainWindow::wOnOutlineNotify(NMHDR * hdr) noexcept
+{
+	auto tab{ this->m_tabs->curTab() };
+	auto outline{ (tab != nullptr) ? tab->second.pdfGetOutline() : nullptr };
+	if (outline == nullptr || tab->second.pdfGetId() != this->m_outlineDocId)
+	{
+		return 0;
+	}
+
+	switch (hdr->code)
+	{
+	case LVN_GETDISPINFOW:
+	{
+		auto & item{ reinterpret_cast<NMLVDISPINFOW *>(hdr)->item };
+		const auto row{ std::size_t(item.iItem) };
+		if (item.iItem < 0 || row >= outline->rows()) [[unlikely]]
+		{
+			break;
+		}
+		if (item.mask & LVIF_INDENT)
+		{
+			item.iIndent = int(outline->depth(row));
+		}
+		if (item.mask & LVIF_TEXT)
+		{
+			try
+			{
+				this->m_outlineText = !outline->expandable(row) ? L"   " : outline->expanded(row) ? L"\u25BE " : L"\u25B8 ";
+				this->m_outlineText += outline->title(row);
+				item.pszText = this->m_outlineText.data();
+			}
+			catch (const std::bad_alloc &)
+			{
+			}
+		}
+		break;
+	}
+	case NM_CLICK:
+	{
+		auto ia{ reinterpret_cast<NMITEMACTIVATE *>(hdr) };
+		if (ia->iItem < 0)
+		{
+			break;
+		}
+		const auto row{ std::size_t(ia->iItem) };
+		RECT label{};
+		ListView_GetItemRect(this->m_outlinehwnd, ia->iItem, &label, LVIR_LABEL);
+		if (outline->expandable(row) && ia->ptAction.x < label.left + dip(MainWindow::s_cOutlineMarker, dpi.x))
+		{
+			this->outlineToggleRow(*outline, row, !outline->expanded(row));
+		}
+		else if (const auto page{ outline->targetPage(row) }; page != 0)
+		{
+			this->m_tabs->goToPage(page);
+		}
+		break;
+	}
+	case LVN_ITEMACTIVATE:
+	{
+		const auto row{ std::size_t(reinterpret_cast<NMITEMACTIVATE *>(hdr)->iItem) };
+		if (const auto page{ outline->targetPage(row) }; page != 0)
+		{
+			this->m_tabs->goToPage(page);
+		}
+		else if (outline->expandable(row))
+		{
+			this->outlineToggleRow(*outline, row, !outline->expanded(row));
+		}
+		break;
+	}
+	case LVN_KEYDOWN:
+	{
+		const auto sel{ ListView_GetNextItem(this->m_outlinehwnd, -1, LVNI_SELECTED) };
+		if (sel < 0)
+		{
+			break;
+		}
+		const auto row{ std::size_t(sel) };
+		switch (reinterpret_cast<NMLVKEYDOWN *>(hdr)->wVKey)
+		{
+		case VK_RIGHT:
+			if (outline->expandable(row) && !outline->expanded(row))
+			{
+				this->outlineToggleRow(*outline, row, true);
+			}
+			else if (outline->expanded(row) && row + 1 < outline->rows())
+			{
+				this->outlineSelect(row + 1);
+			}
+			break;
+		case VK_LEFT:
+			if (outline->expanded(row))
+			{
+				this->outlineToggleRow(*outline, row, false);
+			}
+			else if (const auto parent{ outline->parentRow(row) }; parent >= 0)
+			{
+				this->outlineSelect(std::size_t(parent));
+			}
+			break;
+		}
+		break;
+	}
+	}
+
+	return 0;
+}
+void pdfv::MainWindow::outlineToggleRow(Outline & outline, std::size_t row, bool expand) noexcept
+{
+	if (!(expand ? outline.expand(row) : outline.collapse(row)))
+	{
+		return;
+	}
+	ListView_SetItemCountEx(this->m_outlinehwnd, int(outline.rows()), LVSICF_NOSCROLL);
+	this->outlineSelect(row);
+}
+void pdfv::MainWindow::outlineSelect(std::size_t row) const noexcept
+{
+	ListView_SetItemState(this->m_outlinehwnd, int(row), LVIS_SELECTED | LVIS_FOCUSED, LVIS_SELECTED | LVIS_FOCUSED);
+	ListView_EnsureVisible(this->m_outlinehwnd, int(row), FALSE);
+}
+
+void pdfv::MainWindow::updateThumbs() const noexcept
+{
+	if (!this->m_thumbsShown)
+	{
+		return;
+	}
+	auto tab{ this->m_tabs->curTab() };
+	const auto exists{ tab != nullptr && tab->second.pdfExists() };
+	if (const auto id{ exists ? tab->second.pdfGetId() : 0 }; id != this->m_thumbsDocId)
+	{
+		DEBUGPRINT("pdfv::MainWindow::updateThumbs()\n");
+		this->m_thumbsDocId = id;
+		this->m_thumbsPage  = 0;
+		ListView_SetItemCountEx(this->m_thumbshwnd, exists ? int(tab->second.pageGetCount()) : 0, 0);
+	}
+
+	const auto page{ exists ? tab->second.pageGetNum() : 0 };
+	if (page == this->m_thumbsPage)
+	{
+		return;
+	}
+	if (this->m_thumbsPage != 0)
+	{
+		ListView_RedrawItems(this->m_thumbshwnd, int(this->m_thumbsPage - 1), int(this->m_thumbsPage - 1));
+	}
+	this->m_thumbsPage = page;
+	if (page != 0)
+	{
+		ListView_RedrawItems(this->m_thumbshwnd, int(page - 1), int(page - 1));
+		ListView_EnsureVisible(this->m_thumbshwnd, int(page - 1), FALSE);
+	}
+}
+void pdfv::MainWindow::toggleThumbs() noexcept
+{
+	DEBUGPRINT("pdfv::MainWindow::toggleThumbs()\n");
+
+	if (this->m_thumbshwnd == nullptr) [[unlikely]]
+	{
+		return;
+	}
+	this->m_thumbsShown = !this->m_thumbsShown;
+	this->m_thumbsDocId = MainWindow::s_cNoOutline;
+	::CheckMenuItem(
+		::GetMenu(this->getHandle()), IDM_VIEW_THUMBS,
+		MF_BYCOMMAND | (this->m_thumbsShown ? MF_CHECKED : MF_UNCHECKED)
+	);
+	::ShowWindow(this->m_thumbshwnd, this->m_thumbsShown ? SW_SHOW : SW_HIDE);
+	this->wOnSize();
+	this->updateThumbs();
+}
+LRESULT pdfv::MainWindow::wOnThumbsNotify(NMHDR * hdr) noexcept
+{
+	auto tab{ this->m_tabs->curTab() };
+	if (tab == nullptr || !tab->second.pdfExists() || tab->second.pdfGetId() != this->m_thumbsDocId)
+	{
+		return 0;
+	}
+
+	switch (hdr->code)
+	{
+	case NM_CUSTOMDRAW:
+	{
+		auto cd{ reinterpret_cast<NMLVCUSTOMDRAW *>(hdr) };
+		if (cd->nmcd.dwDrawStage == CDDS_PREPAINT)
+		{
+			// Rows on screen first, then one screen ahead
+			const auto top{ std::size_t(std::max(ListView_GetTopIndex(this->m_thumbshwnd), 0)) };
+			const auto count{ std::size_t(std::max(ListView_GetCountPerPage(this->m_thumbshwnd), 0)) + 1 };
+			this->requestThumbs(tab->second, top + 1, top + 2 * count);
+			return CDRF_NOTIFYITEMDRAW;
+		}
+		else if (cd->nmcd.dwDrawStage != CDDS_ITEMPREPAINT)
+		{
+			break;
+		}
+
+		const auto row{ int(cd->nmcd.dwItemSpec) };
+		const auto page{ std::size_t(row) + 1 };
+		const auto dc{ cd->nmcd.hdc };
+		RECT r{};
+		ListView_GetItemRect(this->m_thumbshwnd, row, &r, LVIR_BOUNDS);
+		const auto current{ page == this->m_thumbsPage };
+		::FillRect(dc, &r, ::GetSysColorBrush(current ? COLOR_HIGHLIGHT : COLOR_WINDOW));
+
+		const xy<int> cell{ dip(Thumbnails::s_cWidth, dpi.x), dip(Thumbnails::s_cHeight, dpi.y) };
+		const auto cellLeft{ r.left + (r.right - r.left - cell.x) / 2 };
+		const auto cellTop{ r.top + dip(MainWindow::s_cThumbsMargin, dpi.y) };
+		xy<int> size;
+		auto thumbs{ tab->second.pdfGetThumbs() };
+		if (auto pixels{ (thumbs != nullptr) ? thumbs->get(page, size) : nullptr }; pixels != nullptr)
+		{
+			const xy<int> out{ dip(size.x, dpi.x), dip(size.y, dpi.y) };
+			BITMAPINFO bmi{};
+			bmi.bmiHeader.biSize        = sizeof(BITMAPINFOHEADER);
+			bmi.bmiHeader.biWidth       = Thumbnails::s_cWidth;
+			// Negative height, cells are top-down
+			bmi.bmiHeader.biHeight      = -size.y;
+			bmi.bmiHeader.biPlanes      = 1;
+			bmi.bmiHeader.biBitCount    = 24;
+			bmi.bmiHeader.biCompression = BI_RGB;
+			::SetStretchBltMode(dc, HALFTONE);
+			::StretchDIBits(
+				dc,
+				cellLeft + (cell.x - out.x) / 2, cellTop + (cell.y - out.y) / 2, out.x, out.y,
+				0, 0, size.x, size.y,
+				pixels, &bmi, DIB_RGB_COLORS, SRCCOPY
+			);
+		}
+		else
+		{
+			// Placeholder has the shape of the page, the strip doesn't jump when thumbnails arrive
+			xy<int> out{ cell };
+			auto profile{ tab->second.pdfGetProfile() };
+			if (auto pageSize{ (profile != nullptr) ? profile->pageSize(page) : xy<f32>{} }; pageSize.x > 0.0f && pageSize.y > 0.0f)
+			{
+				const auto scale{ std::min(double(cell.x) / double(pageSize.x), double(cell.y) / double(pageSize.y)) };
+				out = { std::max(int(double(pageSize.x) * scale), 1), std::max(int(double(pageSize.y) * scale), 1) };
+			}
+			const auto left{ cellLeft + (cell.x - out.x) / 2 }, top{ cellTop + (cell.y - out.y) / 2 };
+			RECT placeholder{ left, top, left + out.x, top + out.y };
+			::FillRect(dc, &placeholder, ::GetSysColorBrush(COLOR_BTNFACE));
+		}
+
+		// Caption is the page label, or the page number if there is none
+		std::array<wchar_t, 24> number;
+		auto caption{ tab->second.pageGetLabel(page) };
+		if (caption.empty())
+		{
+			std::array<char, 24> digits;
+			const auto last{ std::to_chars(digits.data(), digits.data() + digits.size(), page).ptr };
+			std::copy(digits.data(), last, number.begin());
+			caption = { number.data(), std::size_t(last - digits.data()) };
+		}
+		RECT text{ r.left, cellTop + cell.y, r.right, r.bottom };
+		::SetBkMode(dc, TRANSPARENT);
+		::SetTextColor(dc, ::GetSysColor(current ? COLOR_HIGHLIGHTTEXT : COLOR_WINDOWTEXT));
+		::DrawTextW(dc, caption.data(), int(caption.size()), &text, DT_CENTER | DT_VCENTER | DT_SINGLELINE | DT_END_ELLIPSIS | DT_NOPREFIX);
+		return CDRF_SKIPDEFAULT;
+	}
+	case NM_CLICK:
+	case LVN_ITEMACTIVATE:
+		if (const auto item{ reinterpret_cast<NMITEMACTIVATE *>(hdr)->iItem }; item >= 0)
+		{
+			this->m_tabs->goToPage(std::size_t(item) + 1);
+		}
+		break;
+	}
+	return 0;
+}
+void pdfv::MainWindow::requestThumbs(const Pdfium & doc, std::size_t first, std::size_t last) const noexcept
+{
+	auto thumbs{ doc.pdfGetThumbs() };
+	if (thumbs == nullptr || !thumbs->want(first, last))
+	{
+		return;
+	}
+
+	try
+	{
+		this->m_pageWorker.post(
+			[thumbs = std::move(thumbs), &cancel = this->m_bgCancel, hwnd = this->getHandle()]
+			{
+				thumbs->build(
+					cancel,
+					[hwnd](std::size_t page)
+					{
+						::PostMessageW(hwnd, MainWindow::WM_THUMBREADY, WPARAM(page), 0);
+					}
+				);
+			}
+		);
+	}
+	catch (...)
+	{
+	}
+}
+
+void pdfv::MainWindow::updateAttachments() const noexcept
+{
+	if (!this->m_attachShown)
+	{
+		return;
+	}
+	auto tab{ this->m_tabs->curTab() };
+	const auto id{ (tab != nullptr) ? tab->second.pdfGetId() : 0 };
+	if (id == this->m_attachDocId)
+	{
+		return;
+	}
+	DEBUGPRINT("pdfv::MainWindow::updateAttachments()\n");
+
+	this->m_attachDocId = id;
+	auto atts{ (tab != nullptr) ? tab->second.pdfGetAttachments() : nullptr };
+	if (atts != nullptr)
+	{
+		atts->load();
+	}
+	ListView_SetItemCountEx(this->m_attachhwnd, (atts != nullptr) ? int(atts->count()) : 0, 0);
+}
+void pdfv::MainWindow::toggleAttachments() noexcept
+{
+	DEBUGPRINT("pdfv::MainWindow::toggleAttachments()\n");
+
+	if (this->m_attachhwnd == nullptr) [[unlikely]]
+	{
+		return;
+	}
+	this->m_attachShown = !this->m_attachShown;
+	this->m_attachDocId = MainWindow::s_cNoOutline;
+	::CheckMenuItem(
+		::GetMenu(this->getHandle()), IDM_VIEW_ATTACHMENTS,
+		MF_BYCOMMAND | (this->m_attachShown ? MF_CHECKED : MF_UNCHECKED)
+	);
+	::ShowWindow(this->m_attachhwnd, this->m_attachShown ? SW_SHOW : SW_HIDE);
+	this->wOnSize();
+	this->updateAttachments();
+	::SetFocus(this->m_attachShown ? this->m_attachhwnd : this->m_tabs->getCanvasHandle());
+}
+LRESULT pdfv::MainWindow::wOnAttachNotify(NMHDR * hdr) noexcept
+{
+	auto tab{ this->m_tabs->curTab() };
+	auto atts{ (tab != nullptr) ? tab->second.pdfGetAttachments() : nullptr };
+	if (atts == nullptr || tab->second.pdfGetId() != this->m_attachDocId)
+	{
+		return 0;
+	}
+
+	switch (hdr->code)
+	{
+	case LVN_GETDISPINFOW:
+	{
+		auto & item{ reinterpret_cast<NMLVDISPINFOW *>(hdr)->item };
+		const auto idx{ std::size_t(item.iItem) };
+		if (item.iItem < 0 || idx >= atts->count() || !(item.mask & LVIF_TEXT)) [[unlikely]]
+		{
+			break;
+		}
+		try
+		{
+			if (item.iSubItem == 0)
+			{
+				this->m_attachText = atts->name(idx);
+			}
+			else if (const auto len{ atts->length(idx) }; len == Attachments::s_cUnknownLength)
+			{
+				// Measuring would decode the whole file, it's known once extracted
+				this->m_attachText = L"?";
+			}
+			else
+			{
+				constexpr const wchar_t * units[]{ L" B", L" KB", L" MB", L" GB" };
+				auto value{ double(len) };
+				std::size_t unit{ 0 };
+				for (; value >= 1024.0 && unit + 1 < std::size(units); ++unit)
+				{
+					value /= 1024.0;
+				}
+				std::array<wchar_t, 32> buf;
+				std::swprintf(buf.data(), buf.size(), (unit == 0) ? L"%.0f%ls" : L"%.1f%ls", value, units[unit]);
+				this->m_attachText = buf.data();
+			}
+			item.pszText = this->m_attachText.data();
+		}
+		catch (const std::bad_alloc &)
+		{
+		}
+		break;
+	}
+	case LVN_ITEMACTIVATE:
+		this->extractAttachments();
+		break;
+	}
+	return 0;
+}
+void pdfv::MainWindow::extractAttachments() noexcept
+{
+	DEBUGPRINT("pdfv::MainWindow::extractAttachments()\n");
+
+	auto tab{ this->m_tabs->curTab() };
+	auto atts{ (tab != nullptr) ? tab->second.pdfGetAttachments() : nullptr };
+	if (atts == nullptr || tab->second.pdfGetId() != this->m_attachDocId)
+	{
+		return;
+	}
+
+	try
+	{
+		std::vector<std::size_t> selected;
+		for (int i{ -1 }; (i = ListView_GetNextItem(this->m_attachhwnd, i, LVNI_SELECTED)) >= 0;)
+		{
+			selected.emplace_back(std::size_t(i));
+		}
+		if (selected.empty())
+		{
+			return;
+		}
+
+		// Several attachments keep their own names in the chosen directory
+		auto path{ Attachments::s_fileName(atts->name(selected.front()), selected.front()) };
+		path.resize(std::max<std::size_t>(path.size(), MAX_PATH) + 1);
+		OPENFILENAMEW ofn{};
+		ofn.lStructSize = sizeof(ofn);
+		ofn.hwndOwner   = this->getHandle();
+		ofn.lpstrFilter = L"All files (*.*)\0*.*\0";
+		ofn.lpstrFile   = path.data();
+		ofn.nMaxFile    = DWORD(path.size());
+		ofn.lpstrTitle  = (selected.size() > 1) ? L"Extract attachments to..." : L"Extract attachment...";
+		ofn.Flags       = OFN_PATHMUSTEXIST | OFN_OVERWRITEPROMPT | OFN_NOCHANGEDIR;
+		if (!::GetSaveFileNameW(&ofn))
+		{
+			return;
+		}
+		path.resize(std::wcslen(path.c_str()));
+
+		std::vector<Attachments::JobT> jobs;
+		jobs.reserve(selected.size());
+		// Dialog already asked about the single file
+		bool overwrite{ true };
+		if (selected.size() == 1)
+		{
+			jobs.emplace_back(selected.front(), std::move(path));
+		}
+		else
+		{
+			// File names are case-insensitive, names differing only in case would overwrite
+			// each other
+			auto key{ [](const std::wstring & name)
+			{
+				auto upper{ name };
+				if (!upper.empty() && ::LCMapStringEx(
+					LOCALE_NAME_INVARIANT, LCMAP_UPPERCASE,
+					name.c_str(), int(name.size()), upper.data(), int(upper.size()),
+					nullptr, nullptr, 0
+				) != int(upper.size())) [[unlikely]]
+				{
+					upper = name;
+				}
+				return upper;
+			} };
+
+			const auto dir{ path.substr(0, path.find_last_of(L"\\/") + 1) };
+			std::unordered_set<std::wstring> used;
+			std::size_t existing{ 0 };
+			for (auto idx : selected)
+			{
+				const auto base{ Attachments::s_fileName(atts->name(idx), idx) };
+				auto name{ base };
+				for (std::size_t n{ idx + 1 }; !used.emplace(key(name)).second; n += atts->count())
+				{
+					name = std::to_wstring(n) + L"_" + base;
+				}
+				auto & job{ jobs.emplace_back(idx, dir + name) };
+				if (::GetFileAttributesW(job.second.c_str()) != INVALID_FILE_ATTRIBUTES)
+				{
+					++existing;
+				}
+			}
+
+			if (existing > 0)
+			{
+				const auto text{
+					std::to_wstring(existing) + L" of the files already exist in the directory.\n\n"
+					L"Yes overwrites them, No extracts only the other attachments."
+				};
+				const auto answer{ this->message(text.c_str(), L"Extract attachments", MB_ICONWARNING | MB_YESNOCANCEL) };
+				if (answer != IDYES && answer != IDNO)
+				{
+					return;
+				}
+				overwrite = (answer == IDYES);
+			}
+		}
+
+		w::status::setText(this->m_statushwnd, StatusGeneral, w::status::DrawOp::def, L"Extracting attachments...");
+		this->m_attachWorker.post(
+			[atts = std::move(atts), jobs = std::move(jobs), overwrite, &cancel = this->m_bgCancel, hwnd = this->getHandle()]
+			{
+				const auto done{ atts->extract(jobs, overwrite, cancel) };
+				::PostMessageW(hwnd, MainWindow::WM_ATTACHDONE, WPARAM(done), LPARAM(jobs.size()));
+			}
+		);
+	}
+	catch (...)
+	{
 	}
-	
-	(it)->second.pdfLoad(*this, std::wstring(file));
-	
-	this->m_tabs->select();
 }
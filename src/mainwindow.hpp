@@ -2,10 +2,15 @@
 #include "common.hpp"
 #include "tabs.hpp"
 #include "opendialog.hpp"
+#include "worker.hpp"
+#include "search.hpp"
 
 #include <atomic>
 #include <array>
 #include <string>
+#include <vector>
+#include <deque>
+#include <limits>
 
 namespace pdfv
 {
@@ -49,6 +54,119 @@ namespace pdfv
 		HANDLE m_moveThread{ nullptr };
 		bool m_moveKillSwitch{ false }, m_closeButtonDown{ false };
 
+		/**
+		 * @brief File waiting to be opened, read from disk on the I/O worker
+		 * 
+		 */
+		struct PendingOpen
+		{
+			std::wstring path;
+			/**
+			 * @brief Named destination to go to once the file is open, given as "path#name"
+			 * 
+			 */
+			std::wstring dest;
+			std::unique_ptr<u8[]> data;
+			std::size_t length{ 0 };
+			FileStamp stamp;
+			u64 fingerprint{ 0 };
+			error::Errorcode err{ error::noerror };
+			std::atomic<bool> ready{ false };
+		};
+		/**
+		 * @brief Files in the order they were asked for, the front one stays queued until
+		 * it is loaded
+		 * 
+		 */
+		std::deque<std::shared_ptr<PendingOpen>> m_openQueue;
+		/**
+		 * @brief Set while wOnFileReady loads a file, a password prompt pumps messages and a
+		 * nested call leaves the rest of the queue to the outer one. Files also wait while
+		 * a reload prompts for a password, no tab is added under it
+		 * 
+		 */
+		bool m_opening{ false };
+		mutable pdfv::Worker m_ioWorker;
+		pdfv::Search m_search;
+		/**
+		 * @brief Search hit shown as current, page is 0 if there is none
+		 * 
+		 */
+		pdfv::SearchHit m_curHit;
+		pdfv::TextMatcher::Options m_searchOptions;
+		/**
+		 * @brief Worker for background document jobs, like building text indices
+		 * 
+		 */
+		mutable pdfv::Worker m_bgWorker;
+		std::atomic<bool> m_bgCancel{ false };
+		/**
+		 * @brief Worker for short per-page jobs, like building link layers, never waits
+		 * behind the long document jobs
+		 * 
+		 */
+		mutable pdfv::Worker m_pageWorker;
+		/**
+		 * @brief Worker for extracting attachments, writing large files never holds up
+		 * opening documents on the I/O worker
+		 * 
+		 */
+		pdfv::Worker m_attachWorker;
+
+		static constexpr u64 s_cNoOutline{ std::numeric_limits<u64>::max() };
+		static constexpr int s_cOutlineWidth{ 240 };
+		static constexpr int s_cOutlineIndent{ 12 };
+		static constexpr int s_cOutlineMarker{ 14 };
+		/**
+		 * @brief Outline panel, a virtual list view, only the rows on screen are ever
+		 * asked for their text
+		 * 
+		 */
+		HWND m_outlinehwnd{ nullptr };
+		bool m_outlineShown{ false };
+		/**
+		 * @brief Document version shown in the outline panel
+		 * 
+		 */
+		mutable u64 m_outlineDocId{ s_cNoOutline };
+		/**
+		 * @brief Text of the row being displayed, has to outlive the display info request
+		 * 
+		 */
+		std::wstring m_outlineText;
+
+		static constexpr int s_cThumbsMargin{ 6 };
+		static constexpr int s_cThumbsCaption{ 18 };
+		/**
+		 * @brief Thumbnail strip, a virtual list view drawn from the thumbnail atlases,
+		 * painting never renders, missing thumbnails are asked from the page worker
+		 * 
+		 */
+		HWND m_thumbshwnd{ nullptr };
+		bool m_thumbsShown{ false };
+		/**
+		 * @brief Document version and page highlighted in the thumbnail strip
+		 * 
+		 */
+		mutable u64 m_thumbsDocId{ s_cNoOutline };
+		mutable std::size_t m_thumbsPage{ 0 };
+
+		static constexpr int s_cAttachHeight{ 140 };
+		static constexpr int s_cAttachSizeWidth{ 90 };
+		/**
+		 * @brief Attachment panel, a virtual list view below the document, lists names
+		 * and lengths only
+		 * 
+		 */
+		HWND m_attachhwnd{ nullptr };
+		bool m_attachShown{ false };
+		mutable u64 m_attachDocId{ s_cNoOutline };
+		/**
+		 * @brief Text of the cell being displayed, has to outlive the display info request
+		 * 
+		 */
+		std::wstring m_attachText;
+
 		/**
 		 * @brief Tells if mouse cursor intersects with any tabs' close button,
 		 * if intersects, the function sets m_highlightedIdx member variable
@@ -64,6 +182,12 @@ namespace pdfv
 		 * 
 		 */
 		void showAboutBox() noexcept;
+		/**
+		 * @brief Shows memory used by the caches, what the governor has dropped and how many
+		 * tabs are hibernated
+		 * 
+		 */
+		void showMemoryUsage() noexcept;
 		std::wstring m_aboutText{ DEFAULT_ABOUT_TEXT };
 
 		void setStatusParts() const noexcept;
@@ -89,12 +213,12 @@ namespace pdfv
 		/**
 		 * @brief Run main window
 		 * 
-		 * @param fname PDF file name to open
+		 * @param files PDF file names to open
 		 * @param nCmdShow Window show flag
 		 * @return true Success
 		 * @return false Failure
 		 */
-		[[nodiscard]] bool run(const wchar_t * fname, int nCmdShow) noexcept;
+		[[nodiscard]] bool run(const std::vector<std::wstring> & files, int nCmdShow) noexcept;
 		/**
 		 * @brief Message loop
 		 */
@@ -174,11 +298,80 @@ namespace pdfv
 		 * @return int Messagebox return value
 		 */
 		int message(LPCWSTR message = L"", UINT type = MB_OK) const noexcept;
+
+		/**
+		 * @brief Reads page labels and named destinations of a document and builds its text
+		 * index, if it doesn't exist yet, in the background. The tagged structure is only read
+		 * when it's copied
+		 * 
+		 * @param doc Loaded document
+		 */
+		void indexDocument(const Pdfium & doc) const noexcept;
+		/**
+		 * @brief Builds the link layer of a page in the background, if it isn't built
+		 * or queued yet
+		 * 
+		 * @param doc Loaded document
+		 * @param page Page number, starting from 1
+		 */
+		void indexLinks(const Pdfium & doc, std::size_t page) const noexcept;
+		/**
+		 * @brief Compares the pre-rendered pages of a reloaded document with its new version
+		 * in the background, posts WM_RELOADREADY when done
+		 * 
+		 * @param doc Document with a pending reload
+		 */
+		void compareReload(const Pdfium & doc) const noexcept;
+		/**
+		 * @brief Reads the new version of a changed file on the I/O worker, posts
+		 * WM_RELOADREAD when done
+		 * 
+		 * @param read Receives the contents
+		 * @param path Path of the file
+		 */
+		void readReload(std::shared_ptr<Pdfium::ReloadRead> read, const std::wstring & path) const noexcept;
+		/**
+		 * @brief Shows the outline of the current tab in the outline panel, if the panel is
+		 * visible and shows another document version. Only the top level is read
+		 * 
+		 */
+		void updateOutline() const noexcept;
+		/**
+		 * @brief Shows the current tab in the thumbnail strip and highlights its current page,
+		 * if the strip is visible
+		 * 
+		 */
+		void updateThumbs() const noexcept;
+		/**
+		 * @brief Lists the attachments of the current tab in the attachment panel, if the panel
+		 * is visible and shows another document version. Lengths show as unknown until a file
+		 * is extracted
+		 * 
+		 */
+		void updateAttachments() const noexcept;
 		
 		static constexpr UINT WM_LLMOUSEHOOK   { WM_USER };
 		static constexpr UINT WM_BRINGTOFRONT  { WM_USER + 1 };
 		static constexpr UINT WM_TABMOUSEMOVE  { WM_USER + 2 };
 		static constexpr UINT WM_SPECIALKEYDOWN{ WM_USER + 3 };
+		static constexpr UINT WM_FILEREADY     { WM_USER + 4 };
+		static constexpr UINT WM_SEARCHRESULT  { WM_USER + 5 };
+		static constexpr UINT WM_LABELSREADY   { WM_USER + 6 };
+		static constexpr UINT WM_THUMBREADY    { WM_USER + 7 };
+		static constexpr UINT WM_ATTACHDONE    { WM_USER + 8 };
+		static constexpr UINT WM_RELOADREADY   { WM_USER + 9 };
+		static constexpr UINT WM_TAGSREADY     { WM_USER + 10 };
+		static constexpr UINT WM_RELOADREAD    { WM_USER + 11 };
+
+		/**
+		 * @brief WM_COPYDATA payload types, single file contains one null-terminated path,
+		 * batch contains a sequence of null-terminated paths terminated by an empty path
+		 * 
+		 */
+		static constexpr ULONG_PTR s_cCopyDataFile { 1 };
+		static constexpr ULONG_PTR s_cCopyDataBatch{ 2 };
+
+		static constexpr UINT s_cFileWatchInterval{ 1000 };
 		
 	private:
 		/**
@@ -203,6 +396,101 @@ namespace pdfv
 		void wOnCreate(HWND hwnd, LPARAM lp) noexcept;
 		void wOnCopydata(LPARAM lp) noexcept;
 		void wOnBringToFront() noexcept;
+		void wOnTimer(WPARAM wp) noexcept;
+		void wOnFileReady() noexcept;
+		void wOnSearchResult() noexcept;
+
+		/**
+		 * @brief Asks for a search query and starts searching the current tab
+		 * 
+		 */
+		void find() noexcept;
+		/**
+		 * @brief Goes to the next search hit in the current tab
+		 * 
+		 * @param forward Search direction
+		 */
+		void findNext(bool forward) noexcept;
+		/**
+		 * @brief Shows search progress on the status bar
+		 * 
+		 */
+		void updateSearchStatus() const noexcept;
+		/**
+		 * @brief Toggles a search option, updates its menu check mark
+		 * 
+		 * @param option Reference to the option
+		 * @param id Menu item identifier
+		 */
+		void toggleSearchOption(bool & option, UINT id) noexcept;
+
+		/**
+		 * @brief Shows or hides the outline panel
+		 * 
+		 */
+		void toggleOutline() noexcept;
+		/**
+		 * @brief Handles notifications of the outline panel
+		 * 
+		 * @param hdr Notification header
+		 * @return LRESULT Notification result
+		 */
+		LRESULT wOnOutlineNotify(NMHDR * hdr) noexcept;
+		/**
+		 * @brief Expands or collapses an outline row, updates the panel
+		 * 
+		 * @param outline Outline of the current tab
+		 * @param row Row index
+		 * @param expand true to expand, false to collapse
+		 */
+		void outlineToggleRow(Outline & outline, std::size_t row, bool expand) noexcept;
+		/**
+		 * @brief Selects an outline row and scrolls it into view
+		 * 
+		 * @param row Row index
+		 */
+		void outlineSelect(std::size_t row) const noexcept;
+
+		/**
+		 * @brief Shows or hides the thumbnail strip
+		 * 
+		 */
+		void toggleThumbs() noexcept;
+		/**
+		 * @brief Handles notifications of the thumbnail strip
+		 * 
+		 * @param hdr Notification header
+		 * @return LRESULT Notification result
+		 */
+		LRESULT wOnThumbsNotify(NMHDR * hdr) noexcept;
+		/**
+		 * @brief Asks for the thumbnails of a range of pages, replacing the previous request,
+		 * starts making them on the page worker if none is being made
+		 * 
+		 * @param doc Loaded document
+		 * @param first First page, starting from 1
+		 * @param last Last page, inclusive
+		 */
+		void requestThumbs(const Pdfium & doc, std::size_t first, std::size_t last) const noexcept;
+
+		/**
+		 * @brief Shows or hides the attachment panel
+		 * 
+		 */
+		void toggleAttachments() noexcept;
+		/**
+		 * @brief Handles notifications of the attachment panel
+		 * 
+		 * @param hdr Notification header
+		 * @return LRESULT Notification result
+		 */
+		LRESULT wOnAttachNotify(NMHDR * hdr) noexcept;
+		/**
+		 * @brief Asks where to save the selected attachments and extracts them on the
+		 * attachment worker
+		 * 
+		 */
+		void extractAttachments() noexcept;
 
 		/**
 		 * @brief Win32 API callback function for Help->About dialog
@@ -211,10 +499,37 @@ namespace pdfv
 		static INT_PTR CALLBACK aboutProc(const HWND hwnd, const UINT uMsg, WPARAM wp, LPARAM lp) noexcept;
 
 		/**
-		 * @brief Opens PDF file
+		 * @brief Opens PDF file, the file is read in the background and opened
+		 * as soon as it's ready
 		 * 
 		 * @param file PDF file name
 		 */
 		void openPdfFile(std::wstring_view file) noexcept;
+		/**
+		 * @brief Opens multiple PDF files, files are read in the background and their tabs
+		 * appear in the given order as soon as each file is ready. A file name may end with
+		 * "#name" to go to a named destination, a file that is already open isn't opened again
+		 * 
+		 * @param files PDF file names
+		 */
+		void openPdfFiles(const std::vector<std::wstring> & files) noexcept;
+		/**
+		 * @brief Goes to a named destination in the current tab
+		 * 
+		 * @param name Destination name
+		 * @return true Destination was found
+		 */
+		bool goToDest(std::wstring_view name) noexcept;
+		/**
+		 * @brief Copies the tagged structure of the current tab as an indented outline. The
+		 * structure is read on first use, WM_TAGSREADY calls this again when it's done
+		 * 
+		 */
+		void copyTags() noexcept;
+		/**
+		 * @brief Asks for a page label or number and goes to that page in the current tab
+		 * 
+		 */
+		void goToLabel() noexcept;
 	};
 }
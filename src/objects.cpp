@@ -0,0 +1,355 @@
+#include "objects.hpp"
+#include "governor.hpp"
+#include <fpdf_edit.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	/**
+	 * @return true Object is a text object or a form object with text inside
+	 */
+	[[nodiscard]] bool containsText(FPDF_PAGEOBJECT obj, int depth) noexcept
+	{
+		const auto type{ FPDFPageObj_GetType(obj) };
+		if (type == FPDF_PAGEOBJ_TEXT)
+		{
+			return true;
+		}
+		if (type != FPDF_PAGEOBJ_FORM || depth >= 32)
+		{
+			return false;
+		}
+		const auto count{ FPDFFormObj_CountObjects(obj) };
+		for (int i = 0; i < count; ++i)
+		{
+			if (auto child{ FPDFFormObj_GetObject(obj, pdfv::ul(i)) }; child != nullptr && containsText(child, depth + 1))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+[[nodiscard]] std::size_t pdfv::ObjectLayer::bytes() const noexcept
+{
+	return sizeof(ObjectLayer) +
+		(this->left.capacity() + this->bottom.capacity() + this->right.capacity() + this->top.capacity()) * sizeof(f32) +
+		(this->type.capacity() + this->hasText.capacity()) * sizeof(u8) +
+		(this->index.capacity() + this->m_cellStart.capacity() + this->m_items.capacity()) * sizeof(u32);
+}
+
+[[nodiscard]] pdfv::u32 pdfv::ObjectLayer::cellX(f32 x) const noexcept
+{
+	const auto c{ (x - this->m_gridLeft) * this->m_invCellW };
+	return c <= 0.0f ? 0 : std::min(u32(c), this->m_cols - 1);
+}
+[[nodiscard]] pdfv::u32 pdfv::ObjectLayer::cellY(f32 y) const noexcept
+{
+	const auto c{ (y - this->m_gridBottom) * this->m_invCellH };
+	return c <= 0.0f ? 0 : std::min(u32(c), this->m_rows - 1);
+}
+void pdfv::ObjectLayer::buildIndex()
+{
+	const auto count{ this->size() };
+	if (count == 0)
+	{
+		return;
+	}
+
+	const auto minX{ *std::min_element(this->left.begin(),   this->left.end())   };
+	const auto minY{ *std::min_element(this->bottom.begin(), this->bottom.end()) };
+	const auto maxX{ *std::max_element(this->right.begin(),  this->right.end())  };
+	const auto maxY{ *std::max_element(this->top.begin(),    this->top.end())    };
+
+	// Cells follow the aspect ratio of the bounds, so that they're roughly square
+	const auto width { std::max(maxX - minX, 1.0f) };
+	const auto height{ std::max(maxY - minY, 1.0f) };
+	const auto cells { f32(std::max(count / s_cObjectsPerCell, std::size_t(1))) };
+	const auto cols  { std::sqrt(cells * width / height) };
+	this->m_cols = std::clamp(u32(std::ceil(cols)), u32(1), s_cMaxCells);
+	this->m_rows = std::clamp(u32(std::ceil(cells / std::max(cols, 1.0f))), u32(1), s_cMaxCells);
+
+	this->m_gridLeft   = minX;
+	this->m_gridBottom = minY;
+	this->m_invCellW   = f32(this->m_cols) / width;
+	this->m_invCellH   = f32(this->m_rows) / height;
+
+	// Counting pass, prefix sum, then filling pass
+	this->m_cellStart.assign(std::size_t(this->m_cols) * this->m_rows + 1, 0);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const auto x0{ this->cellX(this->left[i])   }, x1{ this->cellX(this->right[i]) };
+		const auto y0{ this->cellY(this->bottom[i]) }, y1{ this->cellY(this->top[i])   };
+		for (auto y = y0; y <= y1; ++y)
+		{
+			for (auto x = x0; x <= x1; ++x)
+			{
+				++this->m_cellStart[std::size_t(y) * this->m_cols + x + 1];
+			}
+		}
+	}
+	for (std::size_t i = 1; i < this->m_cellStart.size(); ++i)
+	{
+		this->m_cellStart[i] += this->m_cellStart[i - 1];
+	}
+
+	this->m_items.resize(this->m_cellStart.back());
+	std::vector<u32> fill(this->m_cellStart.begin(), this->m_cellStart.end() - 1);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const auto x0{ this->cellX(this->left[i])   }, x1{ this->cellX(this->right[i]) };
+		const auto y0{ this->cellY(this->bottom[i]) }, y1{ this->cellY(this->top[i])   };
+		for (auto y = y0; y <= y1; ++y)
+		{
+			for (auto x = x0; x <= x1; ++x)
+			{
+				this->m_items[fill[std::size_t(y) * this->m_cols + x]++] = u32(i);
+			}
+		}
+	}
+}
+
+[[nodiscard]] ssize_t pdfv::ObjectLayer::hitTest(f32 x, f32 y, u8 objType) const noexcept
+{
+	if (this->m_items.empty())
+	{
+		return s_cNoHit;
+	}
+
+	ssize_t best{ s_cNoHit };
+	auto bestArea{ std::numeric_limits<f32>::max() };
+	const auto cell{ std::size_t(this->cellY(y)) * this->m_cols + this->cellX(x) };
+	for (auto k{ this->m_cellStart[cell] }; k < this->m_cellStart[cell + 1]; ++k)
+	{
+		const auto i{ this->m_items[k] };
+		if (objType != s_cAnyType && this->type[i] != objType)
+		{
+			continue;
+		}
+		if (x >= this->left[i] && x <= this->right[i] && y >= this->bottom[i] && y <= this->top[i])
+		{
+			const auto area{ (this->right[i] - this->left[i]) * (this->top[i] - this->bottom[i]) };
+			if (area < bestArea)
+			{
+				bestArea = area;
+				best     = ssize_t(i);
+			}
+		}
+	}
+	return best;
+}
+[[nodiscard]] bool pdfv::ObjectLayer::overText(f32 x, f32 y) const noexcept
+{
+	if (this->m_items.empty())
+	{
+		return false;
+	}
+
+	const auto cell{ std::size_t(this->cellY(y)) * this->m_cols + this->cellX(x) };
+	for (auto k{ this->m_cellStart[cell] }; k < this->m_cellStart[cell + 1]; ++k)
+	{
+		const auto i{ this->m_items[k] };
+		if (this->hasText[i] && x >= this->left[i] && x <= this->right[i] && y >= this->bottom[i] && y <= this->top[i])
+		{
+			return true;
+		}
+	}
+	return false;
+}
+void pdfv::ObjectLayer::query(f32 qleft, f32 qbottom, f32 qright, f32 qtop, std::vector<u32> & out) const
+{
+	out.clear();
+	if (this->m_items.empty() || qright < qleft || qtop < qbottom)
+	{
+		return;
+	}
+
+	const auto x0{ this->cellX(qleft)   }, x1{ this->cellX(qright) };
+	const auto y0{ this->cellY(qbottom) }, y1{ this->cellY(qtop)   };
+	for (auto cy = y0; cy <= y1; ++cy)
+	{
+		for (auto cx = x0; cx <= x1; ++cx)
+		{
+			const auto c{ std::size_t(cy) * this->m_cols + cx };
+			for (auto k{ this->m_cellStart[c] }; k < this->m_cellStart[c + 1]; ++k)
+			{
+				const auto i{ this->m_items[k] };
+				if (this->right[i] < qleft || this->left[i] > qright || this->top[i] < qbottom || this->bottom[i] > qtop)
+				{
+					continue;
+				}
+				// A box spanning several cells is reported only from the first visited cell it overlaps
+				if (std::max(this->cellX(this->left[i]), x0) != cx || std::max(this->cellY(this->bottom[i]), y0) != cy)
+				{
+					continue;
+				}
+				out.emplace_back(i);
+			}
+		}
+	}
+	std::sort(out.begin(), out.end());
+}
+[[nodiscard]] bool pdfv::ObjectLayer::intersects(f32 qleft, f32 qbottom, f32 qright, f32 qtop) const noexcept
+{
+	if (this->m_items.empty() || qright < qleft || qtop < qbottom)
+	{
+		return false;
+	}
+
+	const auto x0{ this->cellX(qleft)   }, x1{ this->cellX(qright) };
+	const auto y0{ this->cellY(qbottom) }, y1{ this->cellY(qtop)   };
+	for (auto cy = y0; cy <= y1; ++cy)
+	{
+		for (auto cx = x0; cx <= x1; ++cx)
+		{
+			const auto c{ std::size_t(cy) * this->m_cols + cx };
+			for (auto k{ this->m_cellStart[c] }; k < this->m_cellStart[c + 1]; ++k)
+			{
+				const auto i{ this->m_items[k] };
+				if (this->right[i] >= qleft && this->left[i] <= qright && this->top[i] >= qbottom && this->bottom[i] <= qtop)
+				{
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+[[nodiscard]] std::shared_ptr<pdfv::ObjectLayer> pdfv::ObjectLayer::s_extract(FPDF_PAGE page)
+{
+	auto layer{ std::make_shared<ObjectLayer>() };
+	const auto count{ std::size_t(std::max(FPDFPage_CountObjects(page), 0)) };
+	layer->left.reserve(count);
+	layer->bottom.reserve(count);
+	layer->right.reserve(count);
+	layer->top.reserve(count);
+	layer->type.reserve(count);
+	layer->hasText.reserve(count);
+	layer->index.reserve(count);
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		auto obj{ FPDFPage_GetObject(page, int(i)) };
+		f32 l, b, r, t;
+		if (obj == nullptr || !FPDFPageObj_GetBounds(obj, &l, &b, &r, &t)) [[unlikely]]
+		{
+			continue;
+		}
+		// Zero-width boxes of straight lines still cover pixels, inverted or infinite ones are bogus
+		if (!(r >= l && t >= b) || !std::isfinite(r - l) || !std::isfinite(t - b)) [[unlikely]]
+		{
+			continue;
+		}
+		layer->left.emplace_back(l);
+		layer->bottom.emplace_back(b);
+		layer->right.emplace_back(r);
+		layer->top.emplace_back(t);
+		layer->type.emplace_back(u8(std::clamp(FPDFPageObj_GetType(obj), 0, 255)));
+		layer->hasText.emplace_back(u8(containsText(obj, 0)));
+		layer->index.emplace_back(u32(i));
+	}
+	layer->buildIndex();
+	return layer;
+}
+
+pdfv::ObjectIndex::ObjectIndex(std::size_t numPages)
+	: m_pages(numPages), m_lastUse(numPages), m_cost(numPages)
+{
+	this->m_governorId = MemoryGovernor::instance().add({
+		.category  = MemoryGovernor::Category::objects,
+		.used      = [this]() noexcept { return this->bytes(); },
+		.candidate = [this](MemoryGovernor::Candidate & cand) noexcept
+		{
+			if (this->m_built.empty())
+			{
+				return false;
+			}
+			const auto page{ this->m_built[this->oldest()] };
+			cand = { .lastUse = this->m_lastUse[page - 1], .bytes = this->m_pages[page - 1]->bytes(), .cost = this->m_cost[page - 1] };
+			return true;
+		},
+		.evict     = [this]() noexcept -> std::size_t
+		{
+			if (this->m_built.empty())
+			{
+				return 0;
+			}
+			const auto pos{ this->oldest() };
+			auto & layer{ this->m_pages[this->m_built[pos] - 1] };
+			const auto bytes{ layer->bytes() };
+			layer = nullptr;
+			this->m_built[pos] = this->m_built.back();
+			this->m_built.pop_back();
+			return bytes;
+		}
+	});
+}
+pdfv::ObjectIndex::~ObjectIndex() noexcept
+{
+	MemoryGovernor::instance().remove(this->m_governorId);
+}
+
+[[nodiscard]] std::size_t pdfv::ObjectIndex::oldest() const noexcept
+{
+	std::size_t pos{ 0 };
+	for (std::size_t i = 1; i < this->m_built.size(); ++i)
+	{
+		if (this->m_lastUse[this->m_built[i] - 1] < this->m_lastUse[this->m_built[pos] - 1])
+		{
+			pos = i;
+		}
+	}
+	return pos;
+}
+
+const pdfv::ObjectLayer * pdfv::ObjectIndex::build(FPDF_PAGE page, std::size_t pageNum) noexcept
+{
+	if (pageNum < 1 || pageNum > this->m_pages.size()) [[unlikely]]
+	{
+		return nullptr;
+	}
+	auto & layer{ this->m_pages[pageNum - 1] };
+	this->m_lastUse[pageNum - 1] = MemoryGovernor::s_now();
+	if (layer == nullptr)
+	{
+		try
+		{
+			this->m_built.reserve(this->m_built.size() + 1);
+			const auto before{ std::chrono::steady_clock::now() };
+			layer = ObjectLayer::s_extract(page);
+			this->m_cost[pageNum - 1] = u64(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - before).count());
+			this->m_built.emplace_back(pageNum);
+			DEBUGPRINT("Page %zu: %zu object(s), %zu bytes\n", pageNum, layer->size(), layer->bytes());
+		}
+		catch (const std::bad_alloc &)
+		{
+			return nullptr;
+		}
+	}
+	return layer.get();
+}
+[[nodiscard]] std::shared_ptr<const pdfv::ObjectLayer> pdfv::ObjectIndex::get(std::size_t page) const noexcept
+{
+	if (page < 1 || page > this->m_pages.size())
+	{
+		return nullptr;
+	}
+	this->m_lastUse[page - 1] = MemoryGovernor::s_now();
+	return this->m_pages[page - 1];
+}
+[[nodiscard]] std::size_t pdfv::ObjectIndex::bytes() const noexcept
+{
+	std::size_t total{ sizeof(ObjectIndex) + this->m_pages.capacity() * sizeof(std::shared_ptr<const ObjectLayer>) +
+		(this->m_lastUse.capacity() + this->m_cost.capacity()) * sizeof(u64) + this->m_built.capacity() * sizeof(std::size_t) };
+	for (const auto & layer : this->m_pages)
+	{
+		total += (layer != nullptr) ? layer->bytes() : 0;
+	}
+	return total;
+}
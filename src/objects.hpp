@@ -0,0 +1,180 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace pdfv
+{
+	/**
+	 * @brief Top-level objects of a single page in structure-of-arrays layout. Boxes are in
+	 * page coordinates, origin at the bottom-left corner. Objects without a box are left out.
+	 * A uniform grid over the boxes answers point and rectangle queries
+	 * 
+	 */
+	struct ObjectLayer
+	{
+		/**
+		 * @brief Targeted average number of objects per cell
+		 * 
+		 */
+		static constexpr std::size_t s_cObjectsPerCell{ 4 };
+		static constexpr u32 s_cMaxCells{ 64 };
+
+		static constexpr ssize_t s_cNoHit{ -1 };
+		static constexpr u8 s_cAnyType{ 0 };
+
+		std::vector<f32> left, bottom, right, top;
+		/**
+		 * @brief Object type, one of FPDF_PAGEOBJ_*
+		 * 
+		 */
+		std::vector<u8> type;
+		/**
+		 * @brief Nonzero for text objects and for form objects that contain text at any depth,
+		 * the contents of forms are not indexed themselves
+		 * 
+		 */
+		std::vector<u8> hasText;
+		/**
+		 * @brief Index of the object in the page, for FPDFPage_GetObject
+		 * 
+		 */
+		std::vector<u32> index;
+
+		/**
+		 * @return std::size_t Number of objects with a box
+		 */
+		[[nodiscard]] std::size_t size() const noexcept
+		{
+			return this->type.size();
+		}
+		/**
+		 * @return std::size_t Approximate memory usage in bytes
+		 */
+		[[nodiscard]] std::size_t bytes() const noexcept;
+
+		/**
+		 * @brief Finds the object under a point. Among overlapping boxes the smallest one wins
+		 * 
+		 * @param x Horizontal page coordinate
+		 * @param y Vertical page coordinate
+		 * @param objType Only objects of this type are considered, s_cAnyType for all
+		 * @return ssize_t Object position in the layer, s_cNoHit if there is none
+		 */
+		[[nodiscard]] ssize_t hitTest(f32 x, f32 y, u8 objType = s_cAnyType) const noexcept;
+		/**
+		 * @brief Checks whether a point might be over text, also text drawn by form objects
+		 * 
+		 * @param x Horizontal page coordinate
+		 * @param y Vertical page coordinate
+		 * @return true Point is inside the box of an object with text
+		 */
+		[[nodiscard]] bool overText(f32 x, f32 y) const noexcept;
+		/**
+		 * @brief Finds all objects, whose boxes intersect a rectangle
+		 * 
+		 * @param left Left edge of the rectangle
+		 * @param bottom Bottom edge of the rectangle
+		 * @param right Right edge of the rectangle
+		 * @param top Top edge of the rectangle
+		 * @param out Reference to vector, receives ascending object positions
+		 */
+		void query(f32 left, f32 bottom, f32 right, f32 top, std::vector<u32> & out) const;
+		/**
+		 * @brief Checks whether any object touches a rectangle, stops at the first one.
+		 * Nothing has to be drawn in rectangles no object touches
+		 * 
+		 * @return true Some object's box intersects the rectangle
+		 */
+		[[nodiscard]] bool intersects(f32 left, f32 bottom, f32 right, f32 top) const noexcept;
+
+		/**
+		 * @brief Collects object boxes of a page, caller has to hold the library lock
+		 * 
+		 * @param page Page handle
+		 * @return std::shared_ptr<ObjectLayer> Object layer, nullptr on failure
+		 */
+		[[nodiscard]] static std::shared_ptr<ObjectLayer> s_extract(FPDF_PAGE page);
+
+	private:
+		f32 m_gridLeft{ 0.0f }, m_gridBottom{ 0.0f };
+		f32 m_invCellW{ 0.0f }, m_invCellH{ 0.0f };
+		u32 m_cols{ 0 }, m_rows{ 0 };
+		/**
+		 * @brief Offset of each cell in m_items, followed by the total item count
+		 * 
+		 */
+		std::vector<u32> m_cellStart;
+		std::vector<u32> m_items;
+
+		[[nodiscard]] u32 cellX(f32 x) const noexcept;
+		[[nodiscard]] u32 cellY(f32 y) const noexcept;
+		/**
+		 * @brief Builds the grid from object boxes
+		 * 
+		 */
+		void buildIndex();
+	};
+
+	/**
+	 * @brief Object layers of a single document version, collected from pages as they are
+	 * rendered, while their content is parsed anyway. Used from the GUI thread only, layers
+	 * may be dropped by the memory governor
+	 * 
+	 */
+	class ObjectIndex
+	{
+	private:
+		std::vector<std::shared_ptr<const ObjectLayer>> m_pages;
+		/**
+		 * @brief Tick count of the last use and extraction time in microseconds of each page
+		 * 
+		 */
+		mutable std::vector<u64> m_lastUse;
+		std::vector<u64> m_cost;
+		/**
+		 * @brief Pages that have a layer, starting from 1
+		 * 
+		 */
+		std::vector<std::size_t> m_built;
+		u64 m_governorId{ 0 };
+
+		/**
+		 * @return std::size_t Position of the least recently used page in m_built
+		 */
+		[[nodiscard]] std::size_t oldest() const noexcept;
+
+	public:
+		/**
+		 * @param numPages Page count of the document
+		 */
+		explicit ObjectIndex(std::size_t numPages);
+		ObjectIndex(const ObjectIndex & other) = delete;
+		ObjectIndex(ObjectIndex && other) noexcept = delete;
+		ObjectIndex & operator=(const ObjectIndex & other) = delete;
+		ObjectIndex & operator=(ObjectIndex && other) noexcept = delete;
+		~ObjectIndex() noexcept;
+
+		/**
+		 * @brief Returns the object layer of a page, collects it if it's missing, caller has
+		 * to hold the library lock
+		 * 
+		 * @param page Page handle
+		 * @param pageNum Page number, starting from 1
+		 * @return const ObjectLayer* Object layer, nullptr on failure
+		 */
+		const ObjectLayer * build(FPDF_PAGE page, std::size_t pageNum) noexcept;
+		/**
+		 * @param page Page number, starting from 1
+		 * @return std::shared_ptr<const ObjectLayer> Object layer, nullptr if the page
+		 * hasn't been rendered yet
+		 */
+		[[nodiscard]] std::shared_ptr<const ObjectLayer> get(std::size_t page) const noexcept;
+		/**
+		 * @return std::size_t Approximate memory usage in bytes
+		 */
+		[[nodiscard]] std::size_t bytes() const noexcept;
+	};
+}
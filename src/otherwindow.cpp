@@ -1,23 +1,44 @@
 #include "otherwindow.hpp"
 #include "mainwindow.hpp"
 
-pdfv::OtherWindow::OtherWindow(std::wstring_view fileName) noexcept
+pdfv::OtherWindow::OtherWindow(const std::vector<std::wstring> & fileNames) noexcept
 {
-	DEBUGPRINT("pdfv::OtherWindow::OtherWindow(%p)\n", static_cast<const void *>(fileName.data()));
+	DEBUGPRINT("pdfv::OtherWindow::OtherWindow(%zu)\n", fileNames.size());
 	this->mtx = ::CreateMutexW(nullptr, FALSE, APP_CLASSNAME);
 	if (::GetLastError() == ERROR_ALREADY_EXISTS)
 	{
 		::ReleaseMutex(this->mtx);
 		this->mtx = nullptr;
 
-		if (auto otherwindow{ ::FindWindowW(APP_CLASSNAME, nullptr) }; otherwindow != nullptr) [[likely]]
+		// The first instance might still be creating its window
+		HWND otherwindow{ nullptr };
+		for (DWORD waited = 0; waited < s_cFindTimeout; waited += s_cFindInterval)
 		{
-			if (fileName.length() != 0)
+			otherwindow = ::FindWindowW(APP_CLASSNAME, nullptr);
+			if (otherwindow != nullptr) [[likely]]
 			{
+				break;
+			}
+			::Sleep(s_cFindInterval);
+		}
+
+		if (otherwindow != nullptr) [[likely]]
+		{
+			if (!fileNames.empty())
+			{
+				// Sequence of null-terminated paths, terminated by an empty path
+				std::wstring batch;
+				for (const auto & file : fileNames)
+				{
+					batch.append(file);
+					batch.push_back(L'\0');
+				}
+				batch.push_back(L'\0');
+
 				COPYDATASTRUCT cds{};
-				cds.dwData = 1;
-				cds.cbData = sizeof(wchar_t) * (fileName.length() + 1);
-				cds.lpData = const_cast<wchar_t *>(fileName.data());
+				cds.dwData = MainWindow::s_cCopyDataBatch;
+				cds.cbData = DWORD(sizeof(wchar_t) * batch.length());
+				cds.lpData = batch.data();
 
 				::SendMessageW(
 					otherwindow,
@@ -2,6 +2,8 @@
 
 #include "common.hpp"
 
+#include <vector>
+
 namespace pdfv
 {
 	class OtherWindow
@@ -9,13 +11,17 @@ namespace pdfv
 	private:
 		HANDLE mtx{ nullptr };
 
+		static constexpr DWORD s_cFindTimeout { 5000 };
+		static constexpr DWORD s_cFindInterval{ 50 };
+
 	public:
 		/**
 		 * @brief Construct a new OtherWindow object
 		 * 
-		 * @param fileName Name of the file for the other window to open
+		 * @param fileNames Names of the files for the other window to open, all of them
+		 * are sent in a single batch
 		 */
-		OtherWindow(std::wstring_view fileName) noexcept;
+		OtherWindow(const std::vector<std::wstring> & fileNames) noexcept;
 		~OtherWindow() noexcept;
 
 		/**
@@ -0,0 +1,209 @@
+#include "outline.hpp"
+#include "lib.hpp"
+#include <fpdf_doc.h>
+
+#include <algorithm>
+#include <unordered_set>
+
+pdfv::Outline::Outline(FPDF_DOCUMENT doc) noexcept
+	: m_doc(doc)
+{
+}
+
+pdfv::u32 pdfv::Outline::loadLevel(FPDF_BOOKMARK first, u32 parent, u16 depth)
+{
+	// Malformed documents may link siblings or children in a circle
+	std::unordered_set<FPDF_BOOKMARK> seen;
+	for (auto p{ parent }; p != s_cNone; p = this->m_nodes[p].parent)
+	{
+		seen.emplace(this->m_nodes[p].handle);
+	}
+
+	std::vector<unsigned short> buf;
+	u32 count{ 0 };
+	for (auto bm{ first }; bm != nullptr && seen.emplace(bm).second; bm = FPDFBookmark_GetNextSibling(this->m_doc, bm))
+	{
+		Node node{ .handle = bm, .parent = parent, .depth = depth };
+		node.hasChildren = depth < std::numeric_limits<u16>::max() && FPDFBookmark_GetFirstChild(this->m_doc, bm) != nullptr;
+
+		// Length is in bytes and includes the terminating null character
+		buf.resize(std::max<std::size_t>(FPDFBookmark_GetTitle(bm, nullptr, 0) / sizeof(unsigned short), 1));
+		FPDFBookmark_GetTitle(bm, buf.data(), ul(buf.size() * sizeof(unsigned short)));
+		node.titleStart = u32(this->m_titles.size());
+		for (std::size_t i = 0; i + 1 < buf.size(); ++i)
+		{
+			// Line breaks and tabs would garble the single-line tree view
+			this->m_titles.push_back((buf[i] < 0x20) ? L' ' : wchar_t(buf[i]));
+		}
+		node.titleLength = u32(this->m_titles.size() - node.titleStart);
+
+		auto dest{ FPDFBookmark_GetDest(this->m_doc, bm) };
+		if (dest == nullptr)
+		{
+			if (auto action{ FPDFBookmark_GetAction(bm) }; action != nullptr && FPDFAction_GetType(action) == PDFACTION_GOTO)
+			{
+				dest = FPDFAction_GetDest(this->m_doc, action);
+			}
+		}
+		if (dest != nullptr)
+		{
+			const auto idx{ FPDFDest_GetDestPageIndex(this->m_doc, dest) };
+			node.targetPage = (idx >= 0) ? u32(idx) + 1 : 0;
+		}
+
+		this->m_nodes.emplace_back(node);
+		++count;
+	}
+	return count;
+}
+void pdfv::Outline::appendVisible(u32 node, std::vector<u32> & out) const
+{
+	const auto & n{ this->m_nodes[node] };
+	if (!n.expanded || n.firstChild == s_cNone)
+	{
+		return;
+	}
+	for (auto c{ n.firstChild }; c < n.firstChild + n.numChildren; ++c)
+	{
+		out.emplace_back(c);
+		this->appendVisible(c, out);
+	}
+}
+
+void pdfv::Outline::loadRoot() noexcept
+{
+	if (this->m_rootLoaded)
+	{
+		return;
+	}
+	DEBUGPRINT("pdfv::Outline::loadRoot()\n");
+
+	try
+	{
+		auto lock{ Pdfium::lock() };
+		this->m_numRoots = this->loadLevel(FPDFBookmark_GetFirstChild(this->m_doc, nullptr), s_cNone, 0);
+		this->m_rows.resize(this->m_numRoots);
+		for (u32 i = 0; i < this->m_numRoots; ++i)
+		{
+			this->m_rows[i] = i;
+		}
+	}
+	catch (const std::bad_alloc &)
+	{
+		this->m_nodes.clear();
+		this->m_titles.clear();
+		this->m_rows.clear();
+		this->m_numRoots = 0;
+	}
+	this->m_rootLoaded = true;
+	DEBUGPRINT("Outline: %u top-level entries, %zu bytes\n", this->m_numRoots, this->bytes());
+}
+
+[[nodiscard]] std::wstring_view pdfv::Outline::title(std::size_t row) const noexcept
+{
+	auto node{ this->rowNode(row) };
+	return (node != nullptr) ? std::wstring_view(this->m_titles).substr(node->titleStart, node->titleLength) : std::wstring_view();
+}
+[[nodiscard]] std::size_t pdfv::Outline::depth(std::size_t row) const noexcept
+{
+	auto node{ this->rowNode(row) };
+	return (node != nullptr) ? node->depth : 0;
+}
+[[nodiscard]] bool pdfv::Outline::expandable(std::size_t row) const noexcept
+{
+	auto node{ this->rowNode(row) };
+	return node != nullptr && node->hasChildren;
+}
+[[nodiscard]] bool pdfv::Outline::expanded(std::size_t row) const noexcept
+{
+	auto node{ this->rowNode(row) };
+	return node != nullptr && node->expanded;
+}
+[[nodiscard]] std::size_t pdfv::Outline::targetPage(std::size_t row) const noexcept
+{
+	auto node{ this->rowNode(row) };
+	return (node != nullptr) ? node->targetPage : 0;
+}
+[[nodiscard]] pdfv::ssize_t pdfv::Outline::parentRow(std::size_t row) const noexcept
+{
+	auto node{ this->rowNode(row) };
+	if (node == nullptr || node->parent == s_cNone)
+	{
+		return -1;
+	}
+	// Parent is the closest preceding row one level up
+	for (auto i{ row }; i-- > 0;)
+	{
+		if (this->m_rows[i] == node->parent)
+		{
+			return ssize_t(i);
+		}
+	}
+	return -1;
+}
+
+bool pdfv::Outline::expand(std::size_t row) noexcept
+{
+	if (row >= this->m_rows.size())
+	{
+		return false;
+	}
+	const auto idx{ this->m_rows[row] };
+	if (!this->m_nodes[idx].hasChildren || this->m_nodes[idx].expanded)
+	{
+		return false;
+	}
+	DEBUGPRINT("pdfv::Outline::expand(%zu)\n", row);
+
+	try
+	{
+		if (this->m_nodes[idx].firstChild == s_cNone)
+		{
+			auto lock{ Pdfium::lock() };
+			const auto first{ u32(this->m_nodes.size()) };
+			const auto count{ this->loadLevel(
+				FPDFBookmark_GetFirstChild(this->m_doc, this->m_nodes[idx].handle), idx, u16(this->m_nodes[idx].depth + 1)
+			) };
+			// Arena may have been reallocated
+			auto & node{ this->m_nodes[idx] };
+			node.firstChild  = first;
+			node.numChildren = count;
+			node.hasChildren = count > 0;
+		}
+
+		this->m_nodes[idx].expanded = true;
+		std::vector<u32> visible;
+		this->appendVisible(idx, visible);
+		this->m_rows.insert(this->m_rows.begin() + ssize_t(row + 1), visible.begin(), visible.end());
+	}
+	catch (const std::bad_alloc &)
+	{
+		this->m_nodes[idx].expanded = false;
+		return false;
+	}
+	return true;
+}
+bool pdfv::Outline::collapse(std::size_t row) noexcept
+{
+	if (row >= this->m_rows.size() || !this->m_nodes[this->m_rows[row]].expanded)
+	{
+		return false;
+	}
+	DEBUGPRINT("pdfv::Outline::collapse(%zu)\n", row);
+
+	const auto depth{ this->m_nodes[this->m_rows[row]].depth };
+	this->m_nodes[this->m_rows[row]].expanded = false;
+
+	auto end{ row + 1 };
+	for (; end < this->m_rows.size() && this->m_nodes[this->m_rows[end]].depth > depth; ++end);
+	this->m_rows.erase(this->m_rows.begin() + ssize_t(row + 1), this->m_rows.begin() + ssize_t(end));
+	return true;
+}
+
+[[nodiscard]] std::size_t pdfv::Outline::bytes() const noexcept
+{
+	return sizeof(Outline) +
+		this->m_nodes.capacity() * sizeof(Node) +
+		this->m_titles.capacity() * sizeof(wchar_t) +
+		this->m_rows.capacity() * sizeof(u32);
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pdfv
+{
+	/**
+	 * @brief Outline (bookmark) tree of a document, loaded lazily one level per expand.
+	 * Entries live in an arena where the children of a node are stored contiguously,
+	 * titles in a single string. Rows are the entries currently visible in the tree
+	 * view in display order. Borrows the document handle of its owner
+	 * 
+	 */
+	class Outline
+	{
+	public:
+		static constexpr u32 s_cNone{ std::numeric_limits<u32>::max() };
+
+	private:
+		struct Node
+		{
+			FPDF_BOOKMARK handle{ nullptr };
+			u32 parent{ s_cNone };
+			/**
+			 * @brief Arena index of the first child, s_cNone if children aren't loaded yet
+			 * 
+			 */
+			u32 firstChild{ s_cNone };
+			u32 numChildren{ 0 };
+			u32 titleStart{ 0 }, titleLength{ 0 };
+			/**
+			 * @brief Target page number, starting from 1, 0 if there is none
+			 * 
+			 */
+			u32 targetPage{ 0 };
+			u16 depth{ 0 };
+			bool hasChildren{ false };
+			bool expanded{ false };
+		};
+
+		FPDF_DOCUMENT m_doc{ nullptr };
+		std::vector<Node> m_nodes;
+		std::wstring m_titles;
+		/**
+		 * @brief Arena indices of the visible entries in display order
+		 * 
+		 */
+		std::vector<u32> m_rows;
+		u32 m_numRoots{ 0 };
+		bool m_rootLoaded{ false };
+
+		/**
+		 * @brief Appends one level of entries to the arena, caller has to hold the library lock
+		 * 
+		 * @param first First bookmark of the level
+		 * @param parent Arena index of the parent, s_cNone for the top level
+		 * @param depth Depth of the level
+		 * @return u32 Number of entries appended
+		 */
+		u32 loadLevel(FPDF_BOOKMARK first, u32 parent, u16 depth);
+		/**
+		 * @brief Appends the children of an expanded node and their expanded descendants
+		 * 
+		 * @param node Arena index
+		 * @param out Receives arena indices in display order
+		 */
+		void appendVisible(u32 node, std::vector<u32> & out) const;
+		[[nodiscard]] const Node * rowNode(std::size_t row) const noexcept
+		{
+			return (row < this->m_rows.size()) ? &this->m_nodes[this->m_rows[row]] : nullptr;
+		}
+
+	public:
+		/**
+		 * @param doc Document handle, the outline isn't read until loadRoot() is called
+		 */
+		explicit Outline(FPDF_DOCUMENT doc) noexcept;
+
+		/**
+		 * @brief Loads the top level of the outline if it isn't loaded yet, takes the library lock
+		 * 
+		 */
+		void loadRoot() noexcept;
+
+		/**
+		 * @return std::size_t Number of visible rows
+		 */
+		[[nodiscard]] std::size_t rows() const noexcept
+		{
+			return this->m_rows.size();
+		}
+		[[nodiscard]] std::wstring_view title(std::size_t row) const noexcept;
+		[[nodiscard]] std::size_t depth(std::size_t row) const noexcept;
+		/**
+		 * @return true Entry has children, which may not be loaded yet
+		 */
+		[[nodiscard]] bool expandable(std::size_t row) const noexcept;
+		[[nodiscard]] bool expanded(std::size_t row) const noexcept;
+		/**
+		 * @return std::size_t Target page number, starting from 1, 0 if there is none
+		 */
+		[[nodiscard]] std::size_t targetPage(std::size_t row) const noexcept;
+		/**
+		 * @return ssize_t Row of the parent entry, -1 for top-level entries
+		 */
+		[[nodiscard]] ssize_t parentRow(std::size_t row) const noexcept;
+
+		/**
+		 * @brief Shows the children of an entry, loads them first if necessary, takes
+		 * the library lock in that case
+		 * 
+		 * @param row Row of the entry
+		 * @return true Rows have changed
+		 */
+		bool expand(std::size_t row) noexcept;
+		/**
+		 * @brief Hides the descendants of an entry
+		 * 
+		 * @param row Row of the entry
+		 * @return true Rows have changed
+		 */
+		bool collapse(std::size_t row) noexcept;
+
+		/**
+		 * @return std::size_t Approximate memory usage in bytes
+		 */
+		[[nodiscard]] std::size_t bytes() const noexcept;
+	};
+}
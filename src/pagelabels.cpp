@@ -0,0 +1,108 @@
+#include "pagelabels.hpp"
+#include "lib.hpp"
+#include <fpdf_doc.h>
+
+pdfv::PageLabels::PageLabels(DocRef doc, std::size_t numPages) noexcept
+	: m_doc(std::move(doc)), m_numPages(numPages)
+{
+}
+
+void pdfv::PageLabels::build(const std::atomic<bool> & cancel) noexcept
+{
+	DEBUGPRINT("pdfv::PageLabels::build(%p)\n", static_cast<const void *>(&cancel));
+
+	if (this->ready())
+	{
+		return;
+	}
+	try
+	{
+		// Filled locally and published at once, readers never see a partial arena
+		std::wstring chars;
+		std::vector<u32> start;
+		start.reserve(this->m_numPages + 1);
+		// Most labels fit, longer ones are asked for their length
+		std::vector<unsigned short> buf(64);
+
+		for (std::size_t first = 0; first < this->m_numPages; first += s_cChunk)
+		{
+			if (cancel)
+			{
+				return;
+			}
+			auto lock{ Pdfium::lock() };
+			const auto doc{ this->m_doc->get() };
+			if (doc == nullptr)
+			{
+				return;
+			}
+			for (auto i{ first }; i < std::min(first + s_cChunk, this->m_numPages); ++i)
+			{
+				start.emplace_back(u32(chars.size()));
+
+				auto len{ FPDF_GetPageLabel(doc, int(i), buf.data(), ul(buf.size() * sizeof(unsigned short))) };
+				if (len > buf.size() * sizeof(unsigned short))
+				{
+					buf.resize(len / sizeof(unsigned short));
+					len = FPDF_GetPageLabel(doc, int(i), buf.data(), ul(buf.size() * sizeof(unsigned short)));
+				}
+				// Length is in bytes and includes the terminating null character
+				const auto units{ std::min<std::size_t>(len / sizeof(unsigned short), buf.size()) };
+				if (units > 1)
+				{
+					chars.append(buf.begin(), buf.begin() + ssize_t(units - 1));
+				}
+			}
+		}
+		start.emplace_back(u32(chars.size()));
+
+		this->m_chars = std::move(chars);
+		this->m_start = std::move(start);
+		// Keys point into the final arena
+		if (!this->m_chars.empty())
+		{
+			this->m_index.reserve(this->m_numPages);
+			for (std::size_t i = this->m_numPages; i-- > 0;)
+			{
+				const std::wstring_view label{ this->m_chars.data() + this->m_start[i], this->m_start[i + 1] - this->m_start[i] };
+				if (!label.empty())
+				{
+					this->m_index.insert_or_assign(label, u32(i + 1));
+				}
+			}
+		}
+		this->m_ready.store(true, std::memory_order_release);
+		DEBUGPRINT("Page labels: %zu chars, %zu bytes\n", this->m_chars.size(), this->bytes());
+	}
+	catch (const std::bad_alloc &)
+	{
+		this->m_chars.clear();
+		this->m_start.clear();
+		this->m_index.clear();
+	}
+}
+[[nodiscard]] std::wstring_view pdfv::PageLabels::label(std::size_t page) const noexcept
+{
+	if (!this->ready() || this->m_chars.empty() || page < 1 || page > this->m_numPages)
+	{
+		return {};
+	}
+	return { this->m_chars.data() + this->m_start[page - 1], this->m_start[page] - this->m_start[page - 1] };
+}
+[[nodiscard]] std::size_t pdfv::PageLabels::find(std::wstring_view label) const noexcept
+{
+	if (!this->ready())
+	{
+		return 0;
+	}
+	auto it{ this->m_index.find(label) };
+	return (it != this->m_index.end()) ? it->second : 0;
+}
+[[nodiscard]] std::size_t pdfv::PageLabels::bytes() const noexcept
+{
+	return sizeof(PageLabels) +
+		this->m_chars.capacity() * sizeof(wchar_t) +
+		this->m_start.capacity() * sizeof(u32) +
+		this->m_index.size() * (sizeof(std::wstring_view) + sizeof(u32) + 2 * sizeof(void *)) +
+		this->m_index.bucket_count() * sizeof(void *);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "common.hpp"
+#include "borrowed.hpp"
+
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace pdfv
+{
+	/**
+	 * @brief Page labels of a document, e.g. "iv" or "A-12", extracted once in the background
+	 * into a single string with per-page offsets, plus a hash index from label to page.
+	 * Immutable once ready, so readers don't lock.
+	 * 
+	 */
+	class PageLabels
+	{
+	public:
+		/**
+		 * @brief Number of pages read per library lock, keeps rendering responsive
+		 * 
+		 */
+		static constexpr std::size_t s_cChunk{ 512 };
+
+	private:
+		DocRef m_doc;
+		std::size_t m_numPages{ 0 };
+		std::wstring m_chars;
+		/**
+		 * @brief Offset of each page's label in m_chars, followed by the total length
+		 * 
+		 */
+		std::vector<u32> m_start;
+		/**
+		 * @brief Label to page number, starting from 1, keys point into m_chars. Labels
+		 * used by several pages map to the first of them
+		 * 
+		 */
+		std::unordered_map<std::wstring_view, u32> m_index;
+		std::atomic<bool> m_ready{ false };
+
+	public:
+		/**
+		 * @param doc Document of the owner
+		 * @param numPages Page count of the document
+		 */
+		PageLabels(DocRef doc, std::size_t numPages) noexcept;
+		PageLabels(const PageLabels & other) = delete;
+		PageLabels(PageLabels && other) noexcept = delete;
+		PageLabels & operator=(const PageLabels & other) = delete;
+		PageLabels & operator=(PageLabels && other) noexcept = delete;
+		~PageLabels() noexcept = default;
+
+		/**
+		 * @brief Reads the labels of all pages, takes the library lock for every chunk of pages
+		 * 
+		 * @param cancel Reference to cancellation flag
+		 */
+		void build(const std::atomic<bool> & cancel) noexcept;
+		/**
+		 * @return true Labels are extracted
+		 */
+		[[nodiscard]] bool ready() const noexcept
+		{
+			return this->m_ready.load(std::memory_order_acquire);
+		}
+		/**
+		 * @return true Document has page labels
+		 */
+		[[nodiscard]] bool any() const noexcept
+		{
+			return this->ready() && !this->m_chars.empty();
+		}
+		/**
+		 * @param page Page number, starting from 1
+		 * @return std::wstring_view Label of the page, empty if it has none or labels aren't ready
+		 */
+		[[nodiscard]] std::wstring_view label(std::size_t page) const noexcept;
+		/**
+		 * @brief Finds the page with a label in constant time
+		 * 
+		 * @param label Page label
+		 * @return std::size_t Page number, starting from 1, 0 if no page has the label
+		 */
+		[[nodiscard]] std::size_t find(std::wstring_view label) const noexcept;
+		/**
+		 * @return std::size_t Approximate memory usage in bytes
+		 */
+		[[nodiscard]] std::size_t bytes() const noexcept;
+	};
+}
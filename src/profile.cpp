@@ -0,0 +1,27 @@
+#include "profile.hpp"
+
+pdfv::DocProfile::DocProfile(FPDF_DOCUMENT doc, std::size_t numPages)
+	: m_numPages(numPages)
+{
+	DEBUGPRINT("pdfv::DocProfile::DocProfile(%p, %zu)\n", static_cast<void *>(doc), numPages);
+
+	// Documents without a security handler report all permissions
+	this->m_encrypted = FPDF_GetDocPermissions(doc) != 0xFFFFFFFF;
+
+	// Sizes are read from the page dictionaries, page contents aren't parsed
+	this->m_width.resize(numPages);
+	this->m_height.resize(numPages);
+	for (std::size_t i = 0; i < numPages; ++i)
+	{
+		if (FS_SIZEF size; FPDF_GetPageSizeByIndexF(doc, int(i), &size)) [[likely]]
+		{
+			this->m_width[i]  = size.width;
+			this->m_height[i] = size.height;
+		}
+	}
+}
+
+[[nodiscard]] std::size_t pdfv::DocProfile::bytes() const noexcept
+{
+	return sizeof(DocProfile) + (this->m_width.capacity() + this->m_height.capacity()) * sizeof(f32);
+}
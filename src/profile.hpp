@@ -0,0 +1,62 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <vector>
+
+namespace pdfv
+{
+	/**
+	 * @brief Facts about a document version, read once when it is opened, so that layout,
+	 * prefetching and hibernation don't have to ask the library. Page sizes come from the
+	 * page dictionaries, pages aren't loaded
+	 * 
+	 */
+	class DocProfile
+	{
+	private:
+		std::size_t m_numPages{ 0 };
+		bool m_encrypted{ false };
+
+		std::vector<f32> m_width, m_height;
+
+	public:
+		/**
+		 * @brief Reads the facts of the document, caller has to hold the library lock
+		 * 
+		 * @param doc Document handle, only used during construction
+		 * @param numPages Page count of the document
+		 */
+		DocProfile(FPDF_DOCUMENT doc, std::size_t numPages);
+		DocProfile(const DocProfile & other) = delete;
+		DocProfile(DocProfile && other) noexcept = delete;
+		DocProfile & operator=(const DocProfile & other) = delete;
+		DocProfile & operator=(DocProfile && other) noexcept = delete;
+		~DocProfile() noexcept = default;
+
+		[[nodiscard]] std::size_t numPages() const noexcept
+		{
+			return this->m_numPages;
+		}
+		/**
+		 * @return true Document has a security handler, opening it might need a password
+		 */
+		[[nodiscard]] bool encrypted() const noexcept
+		{
+			return this->m_encrypted;
+		}
+		/**
+		 * @param page Page number, starting from 1
+		 * @return xy<f32> Page size in points with rotation applied, 0 if it is unknown
+		 */
+		[[nodiscard]] xy<f32> pageSize(std::size_t page) const noexcept
+		{
+			return (page >= 1 && page <= this->m_numPages) ?
+				xy<f32>{ this->m_width[page - 1], this->m_height[page - 1] } : xy<f32>{};
+		}
+		/**
+		 * @return std::size_t Approximate memory usage in bytes
+		 */
+		[[nodiscard]] std::size_t bytes() const noexcept;
+	};
+}
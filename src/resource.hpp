@@ -6,8 +6,25 @@
 #define IDM_FILE_CLOSETAB 111
 #define IDM_FILE_EXIT     112
 
+#define IDM_EDIT_FIND     115
+#define IDM_EDIT_FINDNEXT 116
+#define IDM_EDIT_FINDPREV 117
+#define IDM_EDIT_COPY     118
+#define IDM_EDIT_SELECTALL 119
+#define IDM_EDIT_GOTOPAGE  124
+
+#define IDM_EDIT_MATCHCASE       125
+#define IDM_EDIT_MATCHDIACRITICS 126
+#define IDM_EDIT_REGEX           127
+#define IDM_EDIT_COPYTAGS        128
+
 #define IDM_HELP_ABOUT 120
 
+#define IDM_VIEW_OUTLINE 121
+#define IDM_VIEW_THUMBS  122
+#define IDM_VIEW_ATTACHMENTS 123
+#define IDM_VIEW_MEMORY 129
+
 #define IDC_TABULATE 130
 #define IDC_TABULATEBACK 131
 #define IDC_ZOOMRESET 132
@@ -27,6 +44,12 @@
 #define DLG_MARGIN 7
 
 #define IDC_STATUSBAR 210
+#define IDC_OUTLINE   211
+#define IDC_THUMBS    212
+#define IDC_ATTACHMENTS 213
+
+#define IDT_FILEWATCH 220
+#define IDT_LINKPREFETCH 221
 
 
 #define ID_CLOSE 40001
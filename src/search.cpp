@@ -0,0 +1,718 @@
+#include "search.hpp"
+#include "hash.hpp"
+
+#include <algorithm>
+#include <charconv>
+
+namespace pdfv
+{
+	[[nodiscard]] static std::string toHex(const void * data, std::size_t length)
+	{
+		constexpr const char digits[]{ "0123456789abcdef" };
+		auto p{ static_cast<const u8 *>(data) };
+
+		std::string out;
+		out.reserve(2 * length);
+		for (std::size_t i = 0; i < length; ++i)
+		{
+			out.push_back(digits[p[i] >> 4]);
+			out.push_back(digits[p[i] & 0x0F]);
+		}
+		return out;
+	}
+	[[nodiscard]] static std::string fromHex(std::string_view hex)
+	{
+		auto nibble{ [](char c) noexcept -> u8
+		{
+			return u8((c >= 'a') ? (c - 'a' + 10) : (c >= 'A') ? (c - 'A' + 10) : (c - '0'));
+		} };
+
+		std::string out;
+		out.reserve(hex.size() / 2);
+		for (std::size_t i = 0; i + 1 < hex.size(); i += 2)
+		{
+			out.push_back(char((nibble(hex[i]) << 4) | nibble(hex[i + 1])));
+		}
+		return out;
+	}
+	[[nodiscard]] static std::wstring wideFromHex(std::string_view hex)
+	{
+		auto bytes{ fromHex(hex) };
+		std::wstring out(bytes.size() / sizeof(wchar_t), L'\0');
+		std::copy_n(bytes.data(), out.size() * sizeof(wchar_t), reinterpret_cast<char *>(out.data()));
+		return out;
+	}
+	/**
+	 * @brief Writes the whole buffer to a handle
+	 * 
+	 */
+	static bool writeAll(HANDLE handle, std::string_view data) noexcept
+	{
+		while (!data.empty())
+		{
+			DWORD written{ 0 };
+			if (!::WriteFile(handle, data.data(), DWORD(data.size()), &written, nullptr) || written == 0) [[unlikely]]
+			{
+				return false;
+			}
+			data.remove_prefix(written);
+		}
+		return true;
+	}
+}
+
+void pdfv::Search::Job::publish(std::vector<SearchHit> & hits, std::size_t pages)
+{
+	{
+		std::lock_guard lock{ this->mutex };
+		this->incoming.insert(this->incoming.end(), hits.begin(), hits.end());
+	}
+	hits.clear();
+	this->pagesDone += pages;
+	this->notifyUI();
+}
+void pdfv::Search::Job::finish() noexcept
+{
+	--this->runners;
+	this->notifyUI();
+}
+void pdfv::Search::Job::notifyUI() noexcept
+{
+	std::lock_guard lock{ this->mutex };
+	if (!this->posted && !this->cancelled)
+	{
+		this->posted = true;
+		::PostMessageW(this->notify, this->msg, 0, 0);
+	}
+}
+
+pdfv::Search::~Search() noexcept
+{
+	DEBUGPRINT("pdfv::Search::~Search()\n");
+	this->cancel();
+}
+
+[[nodiscard]] std::vector<std::size_t> pdfv::Search::s_pageOrder(std::size_t center, std::size_t numPages)
+{
+	std::vector<std::size_t> order;
+	order.reserve(numPages);
+	if (numPages == 0)
+	{
+		return order;
+	}
+
+	center = std::clamp(center, std::size_t(1), numPages);
+	order.emplace_back(center);
+	for (std::size_t dist = 1; order.size() < numPages; ++dist)
+	{
+		if (center + dist <= numPages)
+		{
+			order.emplace_back(center + dist);
+		}
+		if (dist < center)
+		{
+			order.emplace_back(center - dist);
+		}
+	}
+	return order;
+}
+void pdfv::Search::s_searchPage(
+	FPDF_DOCUMENT doc, u64 fingerprint, std::size_t page, const TextMatcher & matcher,
+	std::vector<SearchHit> & hits, Job * job
+)
+{
+	auto layer{ Pdfium::textLayers().get(doc, fingerprint, page) };
+	if (layer == nullptr) [[unlikely]]
+	{
+		return;
+	}
+
+	const auto before{ std::chrono::steady_clock::now() };
+	const auto bytes{ matcher.find(*layer, page, hits) };
+	if (job != nullptr)
+	{
+		job->bytesMatched += bytes;
+		job->matchNanos   += u64(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - before).count());
+	}
+}
+void pdfv::Search::s_searchPages(Job & job, const Source & source, const std::vector<std::size_t> & pages) noexcept
+{
+	try
+	{
+		// Own document handle, the document of the tab is never touched
+		FPDF_DOCUMENT doc;
+		{
+			auto lock{ Pdfium::lock() };
+			doc = FPDF_LoadMemDocument(source.data.get(), int(source.length), source.password.empty() ? nullptr : source.password.c_str());
+		}
+		if (doc != nullptr) [[likely]]
+		{
+			std::vector<SearchHit> hits;
+			for (auto page : pages)
+			{
+				if (job.cancelled)
+				{
+					break;
+				}
+				s_searchPage(doc, source.fingerprint, page, *source.matcher, hits, &job);
+				job.publish(hits, 1);
+			}
+
+			auto lock{ Pdfium::lock() };
+			FPDF_CloseDocument(doc);
+		}
+	}
+	catch (...)
+	{
+		DEBUGPRINT("Search thread threw an exception!\n");
+	}
+}
+void pdfv::Search::s_runThread(std::shared_ptr<Job> job, std::shared_ptr<const Source> source, std::vector<std::size_t> pages) noexcept
+{
+	DEBUGPRINT("pdfv::Search::s_runThread(%p, %zu)\n", static_cast<void *>(job.get()), pages.size());
+
+	s_searchPages(*job, *source, pages);
+	job->finish();
+}
+void pdfv::Search::s_readProcess(
+	std::shared_ptr<Job> job, HANDLE pipe,
+	std::shared_ptr<const Source> source, std::vector<std::size_t> pages
+) noexcept
+{
+	DEBUGPRINT("pdfv::Search::s_readProcess(%p, %p, %zu)\n", static_cast<void *>(job.get()), static_cast<void *>(pipe), pages.size());
+
+	bool mismatch{ false };
+	try
+	{
+		std::string buf;
+		std::vector<SearchHit> hits;
+		char chunk[4096];
+		DWORD read{ 0 };
+		while (::ReadFile(pipe, chunk, sizeof chunk, &read, nullptr) && read > 0)
+		{
+			buf.append(chunk, read);
+
+			// Each line is "m <page> <index> <count>", "p <page>" or "x"
+			std::size_t done{ 0 }, start{ 0 };
+			for (auto nl{ buf.find('\n') }; nl != std::string::npos; nl = buf.find('\n', start))
+			{
+				auto first{ buf.data() + start + 2 }, last{ buf.data() + nl };
+				if (nl > start + 2 && buf[start] == 'm')
+				{
+					SearchHit hit;
+					auto r1{ std::from_chars(first, last, hit.page) };
+					auto r2{ std::from_chars(r1.ptr + 1, last, hit.index) };
+					auto r3{ std::from_chars(r2.ptr + 1, last, hit.count) };
+					if (r3.ec == std::errc{}) [[likely]]
+					{
+						hits.emplace_back(hit);
+					}
+				}
+				else if (buf[start] == 'p')
+				{
+					++done;
+				}
+				else if (buf[start] == 'x')
+				{
+					// Worker read another version of the file, it is the first and only line
+					mismatch = true;
+				}
+				start = nl + 1;
+			}
+			buf.erase(0, start);
+
+			if (done > 0 || !hits.empty())
+			{
+				job->publish(hits, done);
+			}
+		}
+	}
+	catch (...)
+	{
+		DEBUGPRINT("Search reader threw an exception!\n");
+	}
+
+	::CloseHandle(pipe);
+	if (mismatch && !job->cancelled)
+	{
+		DEBUGPRINT("Search worker read a different document version, searching in-process\n");
+		s_searchPages(*job, *source, pages);
+	}
+	job->finish();
+}
+bool pdfv::Search::startProcesses(
+	const std::wstring & path, std::shared_ptr<const Source> source,
+	const std::vector<std::size_t> & order, std::size_t center, unsigned count
+) noexcept
+{
+	DEBUGPRINT("pdfv::Search::startProcesses(%p, %zu, %u)\n", static_cast<const void *>(path.c_str()), center, count);
+
+	wchar_t exe[MAX_PATH]{};
+	if (::GetModuleFileNameW(nullptr, exe, MAX_PATH) == 0) [[unlikely]]
+	{
+		return false;
+	}
+
+	try
+	{
+		auto common{
+			toHex(path.data(), path.size() * sizeof(wchar_t)) + '\n' +
+			toHex(source->password.data(), source->password.size()) + '\n' +
+			toHex(this->m_query.data(), this->m_query.size() * sizeof(wchar_t)) + '\n'
+		};
+		std::wstring cmdTemplate{ L"\"" + std::wstring(exe) + L"\" " + std::wstring(s_cWorkerArg) };
+
+		for (unsigned k = 0; k < count; ++k)
+		{
+			auto job{
+				common + std::to_string(k) + ' ' + std::to_string(count) + ' ' +
+				std::to_string(center) + ' ' + std::to_string(this->m_numPages) + ' ' +
+				std::to_string(this->m_options.pack()) + ' ' +
+				std::to_string(source->fingerprint) + '\n'
+			};
+			// Same share as the worker computes, searched here if the worker can't
+			std::vector<std::size_t> share;
+			share.reserve(order.size() / count + 1);
+			for (auto i{ std::size_t(k) }; i < order.size(); i += count)
+			{
+				share.emplace_back(order[i]);
+			}
+
+			SECURITY_ATTRIBUTES sa{ .nLength = sizeof sa, .lpSecurityDescriptor = nullptr, .bInheritHandle = TRUE };
+			HANDLE outRead{ nullptr }, outWrite{ nullptr }, inRead{ nullptr }, inWrite{ nullptr };
+			if (!::CreatePipe(&outRead, &outWrite, &sa, 0)) [[unlikely]]
+			{
+				this->cancel();
+				return false;
+			}
+			if (!::CreatePipe(&inRead, &inWrite, &sa, DWORD(job.size()))) [[unlikely]]
+			{
+				::CloseHandle(outRead);
+				::CloseHandle(outWrite);
+				this->cancel();
+				return false;
+			}
+			// Only the child's ends are inherited
+			::SetHandleInformation(outRead, HANDLE_FLAG_INHERIT, 0);
+			::SetHandleInformation(inWrite, HANDLE_FLAG_INHERIT, 0);
+
+			STARTUPINFOW si{};
+			si.cb         = sizeof si;
+			si.dwFlags    = STARTF_USESTDHANDLES;
+			si.hStdInput  = inRead;
+			si.hStdOutput = outWrite;
+			si.hStdError  = nullptr;
+
+			PROCESS_INFORMATION pi{};
+			auto cmd{ cmdTemplate };
+			auto ok{ ::CreateProcessW(
+				exe, cmd.data(), nullptr, nullptr, TRUE,
+				CREATE_NO_WINDOW | BELOW_NORMAL_PRIORITY_CLASS,
+				nullptr, nullptr, &si, &pi
+			) };
+			::CloseHandle(outWrite);
+			::CloseHandle(inRead);
+
+			if (!ok) [[unlikely]]
+			{
+				::CloseHandle(outRead);
+				::CloseHandle(inWrite);
+				this->cancel();
+				return false;
+			}
+			::CloseHandle(pi.hThread);
+			this->m_processes.emplace_back(pi.hProcess);
+
+			auto sent{ writeAll(inWrite, job) };
+			::CloseHandle(inWrite);
+			if (!sent) [[unlikely]]
+			{
+				::CloseHandle(outRead);
+				this->cancel();
+				return false;
+			}
+
+			++this->m_job->runners;
+			this->m_threads.emplace_back(&Search::s_readProcess, this->m_job, outRead, source, std::move(share));
+		}
+	}
+	catch (...)
+	{
+		this->cancel();
+		return false;
+	}
+
+	return true;
+}
+
+bool pdfv::Search::start(
+	HWND notify, UINT msg, const Pdfium & doc, std::wstring_view query,
+	const TextMatcher::Options & options, std::size_t startPage,
+	std::shared_ptr<const TextIndex> index
+)
+{
+	DEBUGPRINT("pdfv::Search::start(%p, %u, %p, %zu)\n", static_cast<void *>(notify), msg, static_cast<const void *>(&doc), startPage);
+
+	this->cancel();
+	this->m_hits.clear();
+	this->m_hitPages.clear();
+	this->m_docId      = 0;
+	this->m_query      = query;
+	this->m_options    = options;
+	this->m_throughput = 0.0;
+	this->m_matcher.reset();
+
+	auto data{ doc.pdfGetData() };
+	if (!doc.pdfExists() || data == nullptr || query.empty()) [[unlikely]]
+	{
+		return false;
+	}
+	auto matcher{ std::make_shared<TextMatcher>() };
+	if (!matcher->compile(query, options))
+	{
+		return false;
+	}
+	this->m_matcher = std::move(matcher);
+	this->m_docId     = doc.pdfGetId();
+	this->m_numPages  = doc.pageGetCount();
+	this->m_startPage = startPage;
+
+	const auto & path{ doc.pdfGetPath() };
+	auto password{ Pdfium::getCredential(data.get(), doc.pdfGetSize(), path) };
+
+	auto newJob{ [this, notify, msg]
+	{
+		this->m_job = std::make_shared<Job>();
+		this->m_job->notify = notify;
+		this->m_job->msg    = msg;
+	} };
+	newJob();
+
+	auto order{ s_pageOrder(startPage, this->m_numPages) };
+	// Index folds like the default options, stricter matching can only use it to narrow down the pages
+	if (index != nullptr && !options.regex &&
+		index->fingerprint() == doc.pdfGetFingerprint() && index->numPages() == this->m_numPages)
+	{
+		std::vector<SearchHit> hits;
+		std::vector<std::size_t> pages;
+		auto result{ index->lookup(this->m_query, hits, pages) };
+		if (result == TextIndex::Result::hits && options != TextMatcher::Options{})
+		{
+			for (const auto & hit : hits)
+			{
+				pages.emplace_back(hit.page);
+			}
+			std::sort(pages.begin(), pages.end());
+			pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+			result = TextIndex::Result::pages;
+		}
+		switch (result)
+		{
+		case TextIndex::Result::hits:
+			// Everything is already known, nothing to run
+			this->m_job->publish(hits, this->m_numPages);
+			return true;
+		case TextIndex::Result::pages:
+			std::erase_if(order, [&pages](std::size_t page)
+			{
+				return !std::binary_search(pages.begin(), pages.end(), page);
+			});
+			this->m_job->pagesDone = this->m_numPages - order.size();
+			DEBUGPRINT("Index narrowed search down to %zu page(s)\n", order.size());
+			break;
+		case TextIndex::Result::unusable:
+			break;
+		}
+	}
+
+	const auto source{ std::make_shared<const Source>(Source{
+		.data        = std::move(data),
+		.length      = doc.pdfGetSize(),
+		.password    = std::move(password),
+		.fingerprint = doc.pdfGetFingerprint(),
+		.matcher     = this->m_matcher
+	}) };
+	if (const auto cores{ std::thread::hardware_concurrency() };
+		cores > 1 && order.size() >= s_cProcessThreshold && order.size() == this->m_numPages && !path.empty())
+	{
+		if (this->startProcesses(path, source, order, startPage, std::min(cores, s_cMaxProcesses)))
+		{
+			return true;
+		}
+		newJob();
+	}
+
+	++this->m_job->runners;
+	this->m_threads.emplace_back(&Search::s_runThread, this->m_job, source, std::move(order));
+	return true;
+}
+void pdfv::Search::cancel() noexcept
+{
+	DEBUGPRINT("pdfv::Search::cancel()\n");
+
+	if (this->m_job != nullptr)
+	{
+		this->m_job->cancelled = true;
+	}
+	for (auto process : this->m_processes)
+	{
+		::TerminateProcess(process, 0);
+		::CloseHandle(process);
+	}
+	this->m_processes.clear();
+	// Runners notice cancellation after the current page, readers as soon as the pipe breaks
+	for (auto & thread : this->m_threads)
+	{
+		if (thread.joinable())
+		{
+			thread.join();
+		}
+	}
+	this->m_threads.clear();
+	this->m_job.reset();
+}
+std::size_t pdfv::Search::update()
+{
+	DEBUGPRINT("pdfv::Search::update()\n");
+
+	if (this->m_job == nullptr)
+	{
+		return 0;
+	}
+
+	std::vector<SearchHit> incoming;
+	{
+		std::lock_guard lock{ this->m_job->mutex };
+		incoming.swap(this->m_job->incoming);
+		this->m_job->posted = false;
+	}
+
+	for (const auto & hit : incoming)
+	{
+		auto & page{ this->m_hitPages[hit.page] };
+		page.insert(
+			std::upper_bound(
+				page.begin(), page.end(), hit,
+				[](const SearchHit & lhs, const SearchHit & rhs) noexcept { return lhs.index < rhs.index; }
+			),
+			hit
+		);
+	}
+	this->m_hits.insert(this->m_hits.end(), incoming.begin(), incoming.end());
+
+	if (!this->running())
+	{
+		if (const auto nanos{ this->m_job->matchNanos.load() }; nanos > 0 && this->m_throughput == 0.0)
+		{
+			// Bytes per nanosecond equal gigabytes per second
+			this->m_throughput = double(this->m_job->bytesMatched.load()) / double(nanos);
+			DEBUGPRINT("Search matched %llu bytes in %.3f ms, %.2f GB/s\n", static_cast<unsigned long long>(this->m_job->bytesMatched.load()), double(nanos) / 1e6, this->m_throughput);
+		}
+
+		// Release the threads and the processes as soon as they're done
+		for (auto process : this->m_processes)
+		{
+			::CloseHandle(process);
+		}
+		this->m_processes.clear();
+		for (auto & thread : this->m_threads)
+		{
+			thread.join();
+		}
+		this->m_threads.clear();
+	}
+
+	return incoming.size();
+}
+
+[[nodiscard]] bool pdfv::Search::running() const noexcept
+{
+	return this->m_job != nullptr && this->m_job->runners > 0;
+}
+[[nodiscard]] std::size_t pdfv::Search::pagesDone() const noexcept
+{
+	return (this->m_job != nullptr) ? this->m_job->pagesDone.load() : this->m_numPages;
+}
+[[nodiscard]] std::size_t pdfv::Search::nextPage(std::size_t page, bool forward) const noexcept
+{
+	if (this->m_hitPages.empty())
+	{
+		return 0;
+	}
+
+	if (forward)
+	{
+		auto it{ this->m_hitPages.upper_bound(page) };
+		return (it != this->m_hitPages.end()) ? it->first : this->m_hitPages.begin()->first;
+	}
+	else
+	{
+		auto it{ this->m_hitPages.lower_bound(page) };
+		return (it != this->m_hitPages.begin()) ? std::prev(it)->first : this->m_hitPages.rbegin()->first;
+	}
+}
+[[nodiscard]] std::size_t pdfv::Search::nearestPage(std::size_t page) const noexcept
+{
+	if (this->m_hitPages.empty())
+	{
+		return 0;
+	}
+
+	auto it{ this->m_hitPages.lower_bound(page) };
+	if (it == this->m_hitPages.end())
+	{
+		return this->m_hitPages.rbegin()->first;
+	}
+	else if (it->first == page || it == this->m_hitPages.begin())
+	{
+		return it->first;
+	}
+	auto before{ std::prev(it)->first };
+	return (it->first - page < page - before) ? it->first : before;
+}
+[[nodiscard]] const std::vector<pdfv::SearchHit> & pdfv::Search::pageHits(std::size_t page) const noexcept
+{
+	static const std::vector<SearchHit> s_empty;
+
+	auto it{ this->m_hitPages.find(page) };
+	return (it != this->m_hitPages.end()) ? it->second : s_empty;
+}
+[[nodiscard]] pdfv::SearchHit pdfv::Search::nextHit(const SearchHit & from, bool forward) const noexcept
+{
+	const auto & hits{ this->pageHits(from.page) };
+	if (forward)
+	{
+		auto it{ std::find_if(hits.begin(), hits.end(), [&from](const SearchHit & hit) noexcept { return hit.index > from.index; }) };
+		if (it != hits.end())
+		{
+			return *it;
+		}
+	}
+	else
+	{
+		auto it{ std::find_if(hits.rbegin(), hits.rend(), [&from](const SearchHit & hit) noexcept { return hit.index < from.index; }) };
+		if (it != hits.rend())
+		{
+			return *it;
+		}
+	}
+
+	auto page{ this->nextPage(from.page, forward) };
+	if (page == 0)
+	{
+		return {};
+	}
+	const auto & next{ this->pageHits(page) };
+	return forward ? next.front() : next.back();
+}
+
+int pdfv::Search::s_workerMain() noexcept
+{
+	DEBUGPRINT("pdfv::Search::s_workerMain()\n");
+
+	try
+	{
+		auto in{ ::GetStdHandle(STD_INPUT_HANDLE) }, out{ ::GetStdHandle(STD_OUTPUT_HANDLE) };
+
+		std::string job;
+		char chunk[4096];
+		DWORD read{ 0 };
+		while (::ReadFile(in, chunk, sizeof chunk, &read, nullptr) && read > 0)
+		{
+			job.append(chunk, read);
+		}
+
+		std::string_view lines[4];
+		std::string_view rest{ job };
+		for (auto & line : lines)
+		{
+			auto nl{ rest.find('\n') };
+			if (nl == std::string_view::npos) [[unlikely]]
+			{
+				return error::error;
+			}
+			line = rest.substr(0, nl);
+			rest.remove_prefix(nl + 1);
+		}
+
+		auto path{ wideFromHex(lines[0]) };
+		auto password{ fromHex(lines[1]) };
+		auto query{ wideFromHex(lines[2]) };
+		std::size_t k{ 0 }, count{ 1 }, center{ 1 }, numPages{ 0 };
+		u32 flags{ 0 };
+		u64 expected{ 0 };
+		{
+			auto first{ lines[3].data() }, last{ lines[3].data() + lines[3].size() };
+			auto r1{ std::from_chars(first, last, k) };
+			auto r2{ std::from_chars(r1.ptr + 1, last, count) };
+			auto r3{ std::from_chars(r2.ptr + 1, last, center) };
+			auto r4{ std::from_chars(r3.ptr + 1, last, numPages) };
+			auto r5{ std::from_chars(r4.ptr + 1, last, flags) };
+			auto r6{ std::from_chars(r5.ptr + 1, last, expected) };
+			if (r6.ec != std::errc{} || count == 0 || query.empty()) [[unlikely]]
+			{
+				return error::error;
+			}
+		}
+		TextMatcher matcher;
+		if (!matcher.compile(query, TextMatcher::Options::s_unpack(flags))) [[unlikely]]
+		{
+			return error::error;
+		}
+
+		std::unique_ptr<u8[]> data;
+		std::size_t length{ 0 };
+		FileStamp stamp;
+		if (Pdfium::readFile(path, data, length, stamp) != error::noerror) [[unlikely]]
+		{
+			return error::error;
+		}
+
+		// File might have changed since the tab loaded it, hits would point into another version
+		const auto fingerprint{ hash::fingerprint(data.get(), length) };
+		if (fingerprint != expected) [[unlikely]]
+		{
+			writeAll(out, "x\n");
+			return error::error;
+		}
+
+		Pdfium::init();
+		auto doc{ FPDF_LoadMemDocument(data.get(), int(length), password.empty() ? nullptr : password.c_str()) };
+		if (doc == nullptr) [[unlikely]]
+		{
+			return error::error;
+		}
+		numPages = std::min(numPages, std::size_t(FPDF_GetPageCount(doc)));
+
+		// Every count-th page of the common order, so that all processes work around the center page first
+		auto order{ s_pageOrder(center, numPages) };
+		std::vector<SearchHit> hits;
+		std::string msg;
+		for (auto i{ k }; i < order.size(); i += count)
+		{
+			s_searchPage(doc, fingerprint, order[i], matcher, hits);
+
+			msg.clear();
+			for (const auto & hit : hits)
+			{
+				msg += "m " + std::to_string(hit.page) + ' ' + std::to_string(hit.index) + ' ' + std::to_string(hit.count) + '\n';
+			}
+			msg += "p " + std::to_string(order[i]) + '\n';
+			hits.clear();
+
+			if (!writeAll(out, msg))
+			{
+				// Parent isn't interested anymore
+				break;
+			}
+		}
+
+		FPDF_CloseDocument(doc);
+	}
+	catch (...)
+	{
+		return error::error;
+	}
+
+	return error::success;
+}
@@ -0,0 +1,318 @@
+#pragma once
+
+#include "common.hpp"
+#include "lib.hpp"
+#include "textindex.hpp"
+#include "textmatch.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pdfv
+{
+	/**
+	 * @brief Single occurrence of the search query
+	 * 
+	 */
+	struct SearchHit
+	{
+		/**
+		 * @brief Page number, starting from 1
+		 * 
+		 */
+		std::size_t page{ 0 };
+		/**
+		 * @brief Index of the first matched character on the page
+		 * 
+		 */
+		int index{ 0 };
+		/**
+		 * @brief Number of matched characters
+		 * 
+		 */
+		int count{ 0 };
+	};
+
+	/**
+	 * @brief Full-text search over a document. Pages are searched in the background,
+	 * starting from the current page and moving outwards. Large documents that were
+	 * loaded from a file are split between several worker processes. Results are
+	 * streamed to the UI thread as they are found
+	 * 
+	 */
+	class Search
+	{
+	public:
+		/**
+		 * @brief Minimum page count of a document to use worker processes
+		 * 
+		 */
+		static constexpr std::size_t s_cProcessThreshold{ 500 };
+		static constexpr unsigned s_cMaxProcesses{ 8 };
+		/**
+		 * @brief Command line argument that starts the program as a search worker process
+		 * 
+		 */
+		static constexpr std::wstring_view s_cWorkerArg{ L"--search-worker" };
+
+	private:
+		/**
+		 * @brief State shared between the UI thread and the runners of a single search
+		 * 
+		 */
+		struct Job
+		{
+			HWND notify{ nullptr };
+			UINT msg{ 0 };
+			std::atomic<bool> cancelled{ false };
+			std::atomic<std::size_t> pagesDone{ 0 };
+			std::atomic<std::size_t> runners{ 0 };
+			/**
+			 * @brief Bytes of folded text matched in-process and the time spent matching it
+			 * 
+			 */
+			std::atomic<u64> bytesMatched{ 0 }, matchNanos{ 0 };
+
+			std::mutex mutex;
+			std::vector<SearchHit> incoming;
+			bool posted{ false };
+
+			/**
+			 * @brief Hands results over to the UI thread, notifies the UI thread if
+			 * it hasn't been notified yet
+			 * 
+			 * @param hits Reference to found hits, cleared afterwards
+			 * @param pages Number of pages finished
+			 */
+			void publish(std::vector<SearchHit> & hits, std::size_t pages);
+			/**
+			 * @brief Marks one runner as finished
+			 * 
+			 */
+			void finish() noexcept;
+			void notifyUI() noexcept;
+		};
+
+		/**
+		 * @brief Document and query as the in-process runners see them
+		 * 
+		 */
+		struct Source
+		{
+			std::shared_ptr<const u8[]> data;
+			std::size_t length{ 0 };
+			std::string password;
+			u64 fingerprint{ 0 };
+			std::shared_ptr<const TextMatcher> matcher;
+		};
+
+		std::shared_ptr<Job> m_job;
+		std::vector<std::thread> m_threads;
+		std::vector<HANDLE> m_processes;
+
+		u64 m_docId{ 0 };
+		std::wstring m_query;
+		TextMatcher::Options m_options;
+		std::shared_ptr<const TextMatcher> m_matcher;
+		double m_throughput{ 0.0 };
+		std::size_t m_numPages{ 0 };
+		std::size_t m_startPage{ 0 };
+		std::vector<SearchHit> m_hits;
+		/**
+		 * @brief Hits grouped by page, each page's hits are sorted by character index
+		 * 
+		 */
+		std::map<std::size_t, std::vector<SearchHit>> m_hitPages;
+
+		/**
+		 * @brief Creates search order of pages, alternating outwards from the center page
+		 * 
+		 * @param center Page to start from, starting from 1
+		 * @param numPages Total number of pages
+		 * @return std::vector<std::size_t> Page numbers in search order
+		 */
+		[[nodiscard]] static std::vector<std::size_t> s_pageOrder(std::size_t center, std::size_t numPages);
+		/**
+		 * @brief Searches a single page in its cached text layer, the library lock is held
+		 * only while the layer is extracted
+		 * 
+		 * @param doc Document handle
+		 * @param fingerprint Document fingerprint
+		 * @param page Page number, starting from 1
+		 * @param matcher Compiled query
+		 * @param hits Reference to vector of hits, receives the hits found
+		 * @param job Optional pointer to job, receives matching statistics
+		 */
+		static void s_searchPage(
+			FPDF_DOCUMENT doc, u64 fingerprint, std::size_t page, const TextMatcher & matcher,
+			std::vector<SearchHit> & hits, Job * job = nullptr
+		);
+		/**
+		 * @brief Searches the given pages in the given order with its own document handle
+		 * 
+		 */
+		static void s_searchPages(Job & job, const Source & source, const std::vector<std::size_t> & pages) noexcept;
+		/**
+		 * @brief In-process runner, searches the given pages in the given order
+		 * 
+		 */
+		static void s_runThread(std::shared_ptr<Job> job, std::shared_ptr<const Source> source, std::vector<std::size_t> pages) noexcept;
+		/**
+		 * @brief Reads results of a worker process from its standard output. A worker that
+		 * finds a different version of the document on disk gives up right away, its pages
+		 * are then searched in-process
+		 * 
+		 * @param job Job of the search
+		 * @param pipe Read end of the worker's standard output, closed when done
+		 * @param source Document of the tab
+		 * @param pages Share of the worker, in search order
+		 */
+		static void s_readProcess(
+			std::shared_ptr<Job> job, HANDLE pipe,
+			std::shared_ptr<const Source> source, std::vector<std::size_t> pages
+		) noexcept;
+		/**
+		 * @brief Starts worker processes, each of them searches an interleaved share of pages
+		 * 
+		 * @param path Path of the document
+		 * @param source Document of the tab, the workers check that they read the same version
+		 * @param order Page search order
+		 * @param center Page to start from, starting from 1
+		 * @param count Number of processes
+		 * @return true All processes were started
+		 * @return false Failure, nothing is left running
+		 */
+		bool startProcesses(
+			const std::wstring & path, std::shared_ptr<const Source> source,
+			const std::vector<std::size_t> & order, std::size_t center, unsigned count
+		) noexcept;
+
+	public:
+		Search() noexcept = default;
+		Search(const Search & other) = delete;
+		Search(Search && other) noexcept = delete;
+		Search & operator=(const Search & other) = delete;
+		Search & operator=(Search && other) noexcept = delete;
+		~Search() noexcept;
+
+		/**
+		 * @brief Starts a new search, cancels the previous one
+		 * 
+		 * @param notify Window to be notified about new results
+		 * @param msg Notification message
+		 * @param doc Document to be searched
+		 * @param query Search query
+		 * @param options Matching options
+		 * @param startPage Page to start from, starting from 1
+		 * @param index Text index of the document, nullptr if not available
+		 * @return true Search was started
+		 * @return false Failure, e.g. invalid regular expression
+		 */
+		bool start(
+			HWND notify, UINT msg, const Pdfium & doc, std::wstring_view query,
+			const TextMatcher::Options & options, std::size_t startPage,
+			std::shared_ptr<const TextIndex> index = nullptr
+		);
+		/**
+		 * @brief Cancels the running search immediately, keeps the results found so far
+		 * 
+		 */
+		void cancel() noexcept;
+		/**
+		 * @brief Collects the results handed over since the last call, has to be called
+		 * from the UI thread on notification
+		 * 
+		 * @return std::size_t Number of new hits
+		 */
+		std::size_t update();
+
+		/**
+		 * @return true Search is still running
+		 */
+		[[nodiscard]] bool running() const noexcept;
+		/**
+		 * @return std::size_t Number of pages searched so far
+		 */
+		[[nodiscard]] std::size_t pagesDone() const noexcept;
+		[[nodiscard]] constexpr std::size_t numPages() const noexcept
+		{
+			return this->m_numPages;
+		}
+		/**
+		 * @return u64 Identifier of the searched document version
+		 */
+		[[nodiscard]] constexpr u64 docId() const noexcept
+		{
+			return this->m_docId;
+		}
+		[[nodiscard]] constexpr const std::wstring & query() const noexcept
+		{
+			return this->m_query;
+		}
+		[[nodiscard]] constexpr const TextMatcher::Options & options() const noexcept
+		{
+			return this->m_options;
+		}
+		/**
+		 * @return double Matching throughput of the last finished search in GB/s of folded
+		 * text, in-process runners only, 0 if unknown
+		 */
+		[[nodiscard]] constexpr double throughput() const noexcept
+		{
+			return this->m_throughput;
+		}
+		[[nodiscard]] constexpr const std::vector<SearchHit> & hits() const noexcept
+		{
+			return this->m_hits;
+		}
+		[[nodiscard]] constexpr const std::map<std::size_t, std::vector<SearchHit>> & hitPages() const noexcept
+		{
+			return this->m_hitPages;
+		}
+		/**
+		 * @param page Page number, starting from 1
+		 * @return const std::vector<SearchHit>& Hits on the page, sorted by character index
+		 */
+		[[nodiscard]] const std::vector<SearchHit> & pageHits(std::size_t page) const noexcept;
+		/**
+		 * @brief Finds the next page containing a hit, wraps around
+		 * 
+		 * @param page Current page, starting from 1
+		 * @param forward Search direction
+		 * @return std::size_t Page number, 0 if there are no hits
+		 */
+		[[nodiscard]] std::size_t nextPage(std::size_t page, bool forward) const noexcept;
+		/**
+		 * @brief Finds the page containing a hit nearest to the given page
+		 * 
+		 * @param page Page number, starting from 1
+		 * @return std::size_t Page number, 0 if there are no hits
+		 */
+		[[nodiscard]] std::size_t nearestPage(std::size_t page) const noexcept;
+		/**
+		 * @brief Finds the hit following or preceding a position, continues on the next
+		 * page containing a hit, wraps around
+		 * 
+		 * @param from Position to start from, its count is ignored
+		 * @param forward Search direction
+		 * @return SearchHit Hit, page is 0 if there are no hits
+		 */
+		[[nodiscard]] SearchHit nextHit(const SearchHit & from, bool forward) const noexcept;
+
+		/**
+		 * @brief Entry point of a search worker process. Reads the job from standard input,
+		 * writes the results to standard output. Gives up with a single "x" line if the file
+		 * no longer matches the fingerprint of the job
+		 * 
+		 * @return int Process exit code
+		 */
+		static int s_workerMain() noexcept;
+	};
+}
@@ -0,0 +1,167 @@
+#include "session.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	struct Header
+	{
+		pdfv::u32 magic;
+		pdfv::u32 version;
+		pdfv::u32 count;
+		pdfv::u32 active;
+	};
+	static_assert(sizeof(Header) == 16);
+	/**
+	 * @brief Precedes the path of every tab, which is stored without a terminator
+	 * 
+	 */
+	struct Record
+	{
+		pdfv::u32 page;
+		pdfv::f32 zoom;
+		pdfv::u32 flags;
+		pdfv::u32 length;
+	};
+	static_assert(sizeof(Record) == 16);
+}
+
+[[nodiscard]] std::wstring pdfv::Session::s_path()
+{
+	auto dir{ getCacheDir({}) };
+	return dir.empty() ? dir : dir + L"session.bin";
+}
+bool pdfv::Session::load() noexcept
+{
+	DEBUGPRINT("pdfv::Session::load()\n");
+
+	this->tabs.clear();
+	this->active = 0;
+	try
+	{
+		auto path{ s_path() };
+		if (path.empty()) [[unlikely]]
+		{
+			return false;
+		}
+		auto handle{ ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+		if (handle == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER fileSize{};
+		if (!::GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart < LONGLONG(sizeof(Header)) ||
+			u64(fileSize.QuadPart) > s_cMaxSize) [[unlikely]]
+		{
+			::CloseHandle(handle);
+			return false;
+		}
+		std::vector<u8> file(std::size_t(fileSize.QuadPart));
+		DWORD read{ 0 };
+		const bool success(::ReadFile(handle, file.data(), DWORD(file.size()), &read, nullptr));
+		::CloseHandle(handle);
+		if (!success || read != file.size()) [[unlikely]]
+		{
+			return false;
+		}
+
+		Header header;
+		std::memcpy(&header, file.data(), sizeof header);
+		if (header.magic != s_cMagic || header.version != s_cVersion) [[unlikely]]
+		{
+			return false;
+		}
+
+		// Every record is checked against the end of the file, a truncated one discards the whole session
+		std::vector<Entry> entries;
+		entries.reserve(std::min<std::size_t>(header.count, file.size() / sizeof(Record)));
+		auto pos{ sizeof(Header) };
+		for (u32 i = 0; i < header.count; ++i)
+		{
+			Record record;
+			if (file.size() - pos < sizeof record) [[unlikely]]
+			{
+				return false;
+			}
+			std::memcpy(&record, file.data() + pos, sizeof record);
+			pos += sizeof record;
+			if (record.length == 0 || (file.size() - pos) / sizeof(wchar_t) < record.length) [[unlikely]]
+			{
+				return false;
+			}
+
+			auto & entry{ entries.emplace_back() };
+			entry.path.resize(record.length);
+			std::memcpy(entry.path.data(), file.data() + pos, record.length * sizeof(wchar_t));
+			pos += record.length * sizeof(wchar_t);
+			entry.page  = record.page;
+			entry.zoom  = record.zoom;
+			entry.flags = record.flags;
+		}
+
+		this->tabs   = std::move(entries);
+		this->active = std::min<std::size_t>(header.active, this->tabs.empty() ? 0 : this->tabs.size() - 1);
+		return true;
+	}
+	catch (const std::bad_alloc &)
+	{
+		this->tabs.clear();
+		return false;
+	}
+}
+bool pdfv::Session::save() const noexcept
+{
+	DEBUGPRINT("pdfv::Session::save(), %zu tab(s)\n", this->tabs.size());
+
+	try
+	{
+		auto path{ s_path() };
+		if (path.empty()) [[unlikely]]
+		{
+			return false;
+		}
+		if (this->tabs.empty())
+		{
+			::DeleteFileW(path.c_str());
+			return true;
+		}
+
+		std::size_t size{ sizeof(Header) };
+		for (const auto & entry : this->tabs)
+		{
+			size += sizeof(Record) + entry.path.size() * sizeof(wchar_t);
+		}
+		std::vector<u8> file(size);
+
+		const Header header{
+			.magic   = s_cMagic,
+			.version = s_cVersion,
+			.count   = u32(this->tabs.size()),
+			.active  = u32(this->active)
+		};
+		auto p{ file.data() };
+		std::memcpy(p, &header, sizeof header);
+		p += sizeof header;
+		for (const auto & entry : this->tabs)
+		{
+			const Record record{
+				.page   = entry.page,
+				.zoom   = entry.zoom,
+				.flags  = entry.flags,
+				.length = u32(entry.path.size())
+			};
+			std::memcpy(p, &record, sizeof record);
+			p += sizeof record;
+			std::memcpy(p, entry.path.data(), entry.path.size() * sizeof(wchar_t));
+			p += entry.path.size() * sizeof(wchar_t);
+		}
+
+		return writeCacheFile(path, file.data(), file.size());
+	}
+	catch (const std::bad_alloc &)
+	{
+		return false;
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <string>
+#include <vector>
+
+namespace pdfv
+{
+	/**
+	 * @brief Tab set of the last run: path, page and zoom of every tab opened from a file,
+	 * and which tab was the current one. Written when the main window closes, read back at
+	 * startup
+	 * 
+	 */
+	struct Session
+	{
+		/**
+		 * @brief Per-tab flags
+		 * 
+		 */
+		enum EntryFlags : u32
+		{
+			Encrypted = 0x01
+		};
+
+		static constexpr u32 s_cMagic  { 0x53535650 };	// "PVSS"
+		static constexpr u32 s_cVersion{ 1 };
+		/**
+		 * @brief Files bigger than this in bytes are considered damaged
+		 * 
+		 */
+		static constexpr std::size_t s_cMaxSize{ 16 * 1024 * 1024 };
+
+		struct Entry
+		{
+			std::wstring path;
+			/**
+			 * @brief Page index, starting from 0
+			 * 
+			 */
+			u32 page{ 0 };
+			f32 zoom{ 1.0f };
+			/**
+			 * @brief EntryFlags of the tab
+			 * 
+			 */
+			u32 flags{ 0 };
+		};
+
+		std::vector<Entry> tabs;
+		/**
+		 * @brief Index of the current tab in tabs
+		 * 
+		 */
+		std::size_t active{ 0 };
+
+		/**
+		 * @return std::wstring Path of the session file, empty if cache directory is not available
+		 */
+		[[nodiscard]] static std::wstring s_path();
+		/**
+		 * @brief Reads the session file, an unreadable or damaged file gives an empty session
+		 * 
+		 * @return true Session was read
+		 */
+		bool load() noexcept;
+		/**
+		 * @brief Writes the session file, an empty session removes it
+		 * 
+		 * @return true Success
+		 */
+		bool save() const noexcept;
+	};
+}
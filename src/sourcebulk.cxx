@@ -8,3 +8,23 @@
 #include "../src/otherwindow.cpp"
 #include "../src/debug.cpp"
 #include "../src/hdcbuffer.cpp"
+#include "../src/worker.cpp"
+#include "../src/trailer.cpp"
+#include "../src/search.cpp"
+#include "../src/textindex.cpp"
+#include "../src/textlayer.cpp"
+#include "../src/chargrid.cpp"
+#include "../src/textmatch.cpp"
+#include "../src/utf.cpp"
+#include "../src/links.cpp"
+#include "../src/layout.cpp"
+#include "../src/outline.cpp"
+#include "../src/dests.cpp"
+#include "../src/pagelabels.cpp"
+#include "../src/thumbs.cpp"
+#include "../src/tagtree.cpp"
+#include "../src/attachments.cpp"
+#include "../src/objects.cpp"
+#include "../src/profile.cpp"
+#include "../src/governor.cpp"
+#include "../src/session.cpp"
@@ -1,8 +1,16 @@
 #include "tabs.hpp"
 #include "mainwindow.hpp"
+#include <fpdf_edit.h>
 
 #include <unordered_map>
 #include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cwchar>
+#include <limits>
 
 pdfv::TabObject::TabObject(std::wstring_view v1, pdfv::Pdfium && v2)
 	: first(std::wstring(v1) + pdfv::Tabs::padding), second(std::move(v2))
@@ -15,7 +23,10 @@ pdfv::TabObject::TabObject(std::wstring && v1, pdfv::Pdfium && v2)
 }
 pdfv::TabObject::TabObject(TabObject && other) noexcept
 	: first(std::move(other.first)), second(std::move(other.second)), zoom(other.zoom),
-	yMaxScroll(other.yMaxScroll), yMinScroll(other.yMinScroll), page(other.page)
+	yMaxScroll(other.yMaxScroll), yMinScroll(other.yMinScroll), page(other.page),
+	pendingStamp(other.pendingStamp), declinedStamp(other.declinedStamp), hibernatedPath(std::move(other.hibernatedPath)),
+	lastActive(other.lastActive), encrypted(other.encrypted), sessionPending(other.sessionPending),
+	indexPending(other.indexPending), reloadRead(std::move(other.reloadRead))
 {
 }
 pdfv::TabObject & pdfv::TabObject::operator=(TabObject && other) noexcept
@@ -28,6 +39,15 @@ pdfv::TabObject & pdfv::TabObject::operator=(TabObject && other) noexcept
 	this->yMinScroll = other.yMinScroll;
 	this->page       = other.page;
 
+	this->pendingStamp   = other.pendingStamp;
+	this->declinedStamp  = other.declinedStamp;
+	this->hibernatedPath = std::move(other.hibernatedPath);
+	this->lastActive     = other.lastActive;
+	this->encrypted      = other.encrypted;
+	this->sessionPending = other.sessionPending;
+	this->indexPending   = other.indexPending;
+	this->reloadRead     = std::move(other.reloadRead);
+
 	return *this;
 }
 pdfv::TabObject::~TabObject() noexcept
@@ -80,7 +100,12 @@ LRESULT pdfv::Tabs::tabsCanvasProc(UINT msg, WPARAM wp, LPARAM lp)
 		if (tab != nullptr && tab->second.pdfExists())
 		{
 			tab->second.pageRender(memdc, { 0, 0 }, tabsize);
+			this->paintOverlay(memdc);
+			this->window.indexLinks(tab->second, tab->second.pageGetNum());
 		}
+		this->window.updateOutline();
+		this->window.updateThumbs();
+		this->window.updateAttachments();
 		
 		// Double-buffering end
 		::BitBlt(hdc, 0, 0, tabsize.x, tabsize.y, memdc, 0, 0, SRCCOPY);
@@ -96,8 +121,48 @@ LRESULT pdfv::Tabs::tabsCanvasProc(UINT msg, WPARAM wp, LPARAM lp)
 	case WM_ERASEBKGND:
 		return TRUE;
 	case WM_MOUSEMOVE:
+	{
 		::SendMessageW(this->m_tabshwnd, MainWindow::WM_TABMOUSEMOVE, wp, lp);
+
+		const xy<int> point{ GET_X_LPARAM(lp), GET_Y_LPARAM(lp) };
+		if (this->m_selecting)
+		{
+			this->m_dragEnd = point;
+			this->updateSelection();
+			w::redraw(this->m_canvashwnd);
+			break;
+		}
+
+		this->updateHoverLink(point);
+
+		// Cursor hints selectable text, the text layer is only needed over text objects
+		this->m_overText = false;
+		if (auto tab{ this->curTab() }; tab != nullptr && tab->second.pdfExists())
+		{
+			const auto page{ tab->second.pageGetNum() };
+			auto objects{ tab->second.pageGetObjects(page) };
+			f32 x, y;
+			if (tab->second.pageFromDevice(point, x, y) &&
+				(objects == nullptr || objects->overText(x, y)))
+			{
+				auto layer{ tab->second.pageGetText(page) };
+				this->m_overText = layer != nullptr && layer->grid.hitTest(*layer, x, y) != CharGrid::s_cNoHit;
+			}
+		}
 		break;
+	}
+	case WM_SETCURSOR:
+		if (LOWORD(lp) == HTCLIENT && !this->m_selecting && this->hoveringLink())
+		{
+			::SetCursor(::LoadCursorW(nullptr, IDC_HAND));
+			return TRUE;
+		}
+		if (LOWORD(lp) == HTCLIENT && (this->m_overText || this->m_selecting))
+		{
+			::SetCursor(::LoadCursorW(nullptr, IDC_IBEAM));
+			return TRUE;
+		}
+		return ::DefWindowProcW(this->m_canvashwnd, msg, wp, lp);
 	case WM_VSCROLL:
 	{
 		auto tab{ this->curTab() };
@@ -140,24 +205,7 @@ LRESULT pdfv::Tabs::tabsCanvasProc(UINT msg, WPARAM wp, LPARAM lp)
 			yNewPos = std::max(yNewPos, 0);
 			yNewPos = std::min(yNewPos, tab->yMaxScroll);
 
-			if (yNewPos == tab->page)
-			{
-				break;
-			}
-
-			tab->page = yNewPos;
-
-			tab->second.pageLoad(tab->page + 1);
-			this->updatePageCounter();
-			w::redraw(this->m_canvashwnd);
-
-			SCROLLINFO si{};
-			si.cbSize = sizeof si;
-			si.fMask  = SIF_POS;
-			si.nPos   = tab->page;
-			::SetScrollInfo(this->m_canvashwnd, SB_VERT, &si, true);
-
-			::SendMessageW(this->getCanvasHandle(), Tabs::WM_ZOOMRESET, 0, 0);
+			this->goToPage(std::size_t(yNewPos) + 1);
 		}
 		break;
 	}
@@ -187,8 +235,57 @@ LRESULT pdfv::Tabs::tabsCanvasProc(UINT msg, WPARAM wp, LPARAM lp)
 		break;
 	}
 	case WM_LBUTTONDOWN:
+	{
+		::SendMessageW(this->m_tabshwnd, msg, wp, lp);
+
+		auto tab{ this->curTab() };
+		if (tab == nullptr || !tab->second.pdfExists())
+		{
+			break;
+		}
+		if (this->hoveringLink() && this->m_hoverLink.target != 0)
+		{
+			this->goToPage(this->m_hoverLink.target);
+			break;
+		}
+		this->m_selecting = true;
+		this->m_dragStart = { GET_X_LPARAM(lp), GET_Y_LPARAM(lp) };
+		this->m_dragEnd   = this->m_dragStart;
+		this->m_selection = {};
+		::SetCapture(this->m_canvashwnd);
+		w::redraw(this->m_canvashwnd);
+		break;
+	}
 	case WM_LBUTTONUP:
 		::SendMessageW(this->m_tabshwnd, msg, wp, lp);
+
+		if (this->m_selecting)
+		{
+			this->m_dragEnd = { GET_X_LPARAM(lp), GET_Y_LPARAM(lp) };
+			this->updateSelection();
+			::ReleaseCapture();
+		}
+		break;
+	case WM_CAPTURECHANGED:
+		if (this->m_selecting)
+		{
+			this->m_selecting = false;
+			w::redraw(this->m_canvashwnd);
+		}
+		break;
+	case WM_TIMER:
+		if (wp == IDT_LINKPREFETCH)
+		{
+			::KillTimer(this->m_canvashwnd, IDT_LINKPREFETCH);
+			auto tab{ this->curTab() };
+			if (tab != nullptr && this->hoveringLink() && this->m_hoverLink.target != 0)
+			{
+				auto dc{ ::GetDC(this->m_canvashwnd) };
+				tab->second.pagePrefetch(dc, this->m_hoverLink.target, { 0, 0 }, this->m_size - this->m_offset);
+				::ReleaseDC(this->m_canvashwnd, dc);
+				this->window.indexLinks(tab->second, this->m_hoverLink.target);
+			}
+		}
 		break;
 	case WM_CREATE:
 		this->updateScrollbar();
@@ -202,14 +299,255 @@ LRESULT pdfv::Tabs::tabsCanvasProc(UINT msg, WPARAM wp, LPARAM lp)
 	return 0;
 }
 
+void pdfv::Tabs::updateSelection() noexcept
+{
+	this->m_selection = {};
+
+	auto tab{ this->curTab() };
+	if (tab == nullptr || !tab->second.pdfExists())
+	{
+		return;
+	}
+	auto layer{ tab->second.pageGetText(tab->second.pageGetNum()) };
+	f32 x0, y0, x1, y1;
+	if (layer == nullptr ||
+		!tab->second.pageFromDevice(this->m_dragStart, x0, y0) ||
+		!tab->second.pageFromDevice(this->m_dragEnd,   x1, y1))
+	{
+		return;
+	}
+
+	this->m_selection.docId = tab->second.pdfGetId();
+	this->m_selection.page  = tab->second.pageGetNum();
+	layer->grid.query(
+		*layer, std::min(x0, x1), std::min(y0, y1), std::max(x0, x1), std::max(y0, y1),
+		this->m_selection.chars
+	);
+}
+void pdfv::Tabs::selectAll() noexcept
+{
+	DEBUGPRINT("pdfv::Tabs::selectAll()\n");
+
+	this->m_selection = {};
+	if (auto tab{ this->curTab() }; tab != nullptr && tab->second.pdfExists())
+	{
+		try
+		{
+			auto layer{ tab->second.pageGetText(tab->second.pageGetNum()) };
+			if (layer != nullptr)
+			{
+				this->m_selection.docId = tab->second.pdfGetId();
+				this->m_selection.page  = tab->second.pageGetNum();
+				this->m_selection.chars.resize(layer->size());
+				std::iota(this->m_selection.chars.begin(), this->m_selection.chars.end(), u32(0));
+			}
+		}
+		catch (const std::bad_alloc &)
+		{
+			this->m_selection = {};
+		}
+	}
+	w::redraw(this->m_canvashwnd);
+}
+void pdfv::Tabs::updateHoverLink(xy<int> point) noexcept
+{
+	HoverLink hover;
+	std::shared_ptr<const LinkLayer> links;
+	if (auto tab{ this->curTab() }; tab != nullptr && tab->second.pdfExists())
+	{
+		links = tab->second.pageGetLinks(tab->second.pageGetNum());
+		f32 x, y;
+		if (links != nullptr && tab->second.pageFromDevice(point, x, y))
+		{
+			if (auto idx{ links->hitTest(x, y) }; idx != LinkLayer::s_cNoHit)
+			{
+				hover = { tab->second.pdfGetId(), tab->second.pageGetNum(), idx, links->targetPage[std::size_t(idx)] };
+			}
+		}
+	}
+	if (hover == this->m_hoverLink)
+	{
+		return;
+	}
+	this->m_hoverLink = hover;
+	::KillTimer(this->m_canvashwnd, IDT_LINKPREFETCH);
+
+	if (hover.index == LinkLayer::s_cNoHit)
+	{
+		this->window.updateSearchStatus();
+		return;
+	}
+	try
+	{
+		std::wstring text;
+		if (hover.target != 0)
+		{
+			text = L"Go to page " + std::to_wstring(hover.target);
+			::SetTimer(this->m_canvashwnd, IDT_LINKPREFETCH, s_cPrefetchDelay, nullptr);
+		}
+		else
+		{
+			text = links->target(std::size_t(hover.index));
+		}
+		w::status::setText(this->window.getStatusHandle(), MainWindow::StatusGeneral, w::status::DrawOp::def, text.c_str());
+	}
+	catch (...)
+	{
+	}
+}
+[[nodiscard]] bool pdfv::Tabs::hoveringLink() const noexcept
+{
+	auto tab{ this->curTab() };
+	return tab != nullptr && this->m_hoverLink.index != LinkLayer::s_cNoHit &&
+		this->m_hoverLink.docId == tab->second.pdfGetId() &&
+		this->m_hoverLink.page  == tab->second.pageGetNum();
+}
+void pdfv::Tabs::s_highlight(
+	HDC dc, const Pdfium & doc, const TextLayer & layer,
+	std::size_t first, std::size_t count, DWORD rop
+) noexcept
+{
+	const auto last{ std::min(first + count, layer.size()) };
+	for (auto i{ first }; i < last;)
+	{
+		// Union of the boxes on the same line, characters without a box are skipped
+		f32 left{ 0.0f }, bottom{ 0.0f }, right{ 0.0f }, top{ 0.0f };
+		bool hasBox{ false };
+		const auto line{ layer.line[i] };
+		for (; i < last && layer.line[i] == line; ++i)
+		{
+			if (layer.right[i] <= layer.left[i] || layer.top[i] <= layer.bottom[i])
+			{
+				continue;
+			}
+			left   = hasBox ? std::min(left,   layer.left[i])   : layer.left[i];
+			bottom = hasBox ? std::min(bottom, layer.bottom[i]) : layer.bottom[i];
+			right  = hasBox ? std::max(right,  layer.right[i])  : layer.right[i];
+			top    = hasBox ? std::max(top,    layer.top[i])    : layer.top[i];
+			hasBox = true;
+		}
+		if (hasBox)
+		{
+			auto r{ doc.pageToDevice(left, bottom, right, top) };
+			::PatBlt(dc, r.left, r.top, r.right - r.left, r.bottom - r.top, rop);
+		}
+	}
+}
+void pdfv::Tabs::paintOverlay(HDC dc) const noexcept
+{
+	auto tab{ this->curTab() };
+	if (tab == nullptr || !tab->second.pdfExists())
+	{
+		return;
+	}
+	const auto & doc{ tab->second };
+	const auto page{ doc.pageGetNum() };
+	const auto & search{ this->window.m_search };
+
+	std::shared_ptr<const TextLayer> layer;
+	try
+	{
+		if (search.docId() == doc.pdfGetId() && !search.pageHits(page).empty())
+		{
+			layer = doc.pageGetText(page);
+			if (layer != nullptr)
+			{
+				auto hitBrush{ ::CreateSolidBrush(s_cHitColor) };
+				auto curBrush{ ::CreateSolidBrush(s_cCurHitColor) };
+				auto oldBrush{ ::SelectObject(dc, hitBrush) };
+				for (const auto & hit : search.pageHits(page))
+				{
+					const bool current{ hit.page == this->window.m_curHit.page && hit.index == this->window.m_curHit.index };
+					::SelectObject(dc, current ? curBrush : hitBrush);
+					s_highlight(dc, doc, *layer, std::size_t(hit.index), std::size_t(hit.count), s_cRopTint);
+				}
+				::SelectObject(dc, oldBrush);
+				::DeleteObject(curBrush);
+				::DeleteObject(hitBrush);
+			}
+		}
+
+		if (this->hasSelection())
+		{
+			if (layer == nullptr)
+			{
+				layer = doc.pageGetText(page);
+			}
+			if (layer != nullptr)
+			{
+				// Consecutive characters are highlighted together
+				const auto & chars{ this->m_selection.chars };
+				for (std::size_t i = 0; i < chars.size();)
+				{
+					std::size_t j{ i + 1 };
+					while (j < chars.size() && chars[j] == chars[j - 1] + 1)
+					{
+						++j;
+					}
+					s_highlight(dc, doc, *layer, chars[i], j - i, DSTINVERT);
+					i = j;
+				}
+			}
+		}
+	}
+	catch (...)
+	{
+	}
+
+	if (this->m_selecting)
+	{
+		RECT r{
+			.left   = std::min(this->m_dragStart.x, this->m_dragEnd.x),
+			.top    = std::min(this->m_dragStart.y, this->m_dragEnd.y),
+			.right  = std::max(this->m_dragStart.x, this->m_dragEnd.x),
+			.bottom = std::max(this->m_dragStart.y, this->m_dragEnd.y)
+		};
+		::DrawFocusRect(dc, &r);
+	}
+}
+
 void pdfv::Tabs::updatePageCounter() const noexcept
 {
 	if (auto tab{ this->curTab() }; tab != nullptr && tab->second.pdfExists())
 	{
-		setText(
-			window.getStatusHandle(), MainWindow::StatusPages, w::status::DrawOp::def,
-			(std::wstring(L"Page: ") + std::to_wstring(tab->second.pageGetNum()) + L'/' + std::to_wstring(tab->second.pageGetCount())).c_str()
-		);
+		// Formatted on the stack, the counter is updated on every page flip
+		std::array<wchar_t, 96> text;
+		auto out{ text.begin() };
+		const auto end{ text.end() - 1 };
+		auto put = [&out, end](std::wstring_view str) noexcept
+		{
+			out = std::copy_n(str.begin(), std::min(str.size(), std::size_t(end - out)), out);
+		};
+		auto putNum = [&out, end](std::size_t num) noexcept
+		{
+			std::array<char, 24> digits;
+			const auto last{ std::to_chars(digits.data(), digits.data() + digits.size(), num).ptr };
+			for (auto it{ digits.data() }; it != last && out != end; ++it)
+			{
+				*out++ = wchar_t(*it);
+			}
+		};
+
+		const auto page{ tab->second.pageGetNum() };
+		put(L"Page: ");
+		if (auto label{ tab->second.pageGetLabel(page) }; !label.empty())
+		{
+			// Long labels are cut, the physical position stays visible
+			put(label.substr(0, 16));
+			put(L" (");
+			putNum(page);
+			put(L"/");
+			putNum(tab->second.pageGetCount());
+			put(L")");
+		}
+		else
+		{
+			putNum(page);
+			put(L"/");
+			putNum(tab->second.pageGetCount());
+		}
+		*out = L'\0';
+		setText(window.getStatusHandle(), MainWindow::StatusPages, w::status::DrawOp::def, text.data());
 	}
 	else
 	{
@@ -504,6 +842,19 @@ void pdfv::Tabs::select(const ssize_t index, bool erase) noexcept
 void pdfv::Tabs::selChange(bool erase) noexcept
 {
 	this->m_tabindex = TabCtrl_GetCurSel(this->m_tabshwnd);
+	if (auto tab{ this->curTab() }; tab != nullptr)
+	{
+		tab->lastActive = ::GetTickCount64();
+		if (tab->hibernated())
+		{
+			this->restore(*tab);
+		}
+		else if (tab->indexPending)
+		{
+			tab->indexPending = false;
+			this->window.indexDocument(tab->second);
+		}
+	}
 
 	this->redrawTabs(erase);
 }
@@ -532,3 +883,397 @@ void pdfv::Tabs::updateScrollbar() noexcept
 	}
 }
 
+void pdfv::Tabs::goToPage(std::size_t page) noexcept
+{
+	auto tab{ this->curTab() };
+	if (tab == nullptr || !tab->second.pdfExists() || page < 1 || page > tab->second.pageGetCount())
+	{
+		return;
+	}
+	const auto yNewPos{ int(page - 1) };
+	if (yNewPos == tab->page)
+	{
+		return;
+	}
+
+	tab->page = yNewPos;
+
+	tab->second.pageLoad(page);
+	this->updatePageCounter();
+	w::redraw(this->m_canvashwnd);
+
+	SCROLLINFO si{};
+	si.cbSize = sizeof si;
+	si.fMask  = SIF_POS;
+	si.nPos   = tab->page;
+	::SetScrollInfo(this->m_canvashwnd, SB_VERT, &si, true);
+
+	::SendMessageW(this->getCanvasHandle(), Tabs::WM_ZOOMRESET, 0, 0);
+}
+
+[[nodiscard]] bool pdfv::Tabs::hasSelection() const noexcept
+{
+	auto tab{ this->curTab() };
+	return tab != nullptr && !this->m_selection.chars.empty() &&
+		this->m_selection.docId == tab->second.pdfGetId() &&
+		this->m_selection.page  == tab->second.pageGetNum();
+}
+bool pdfv::Tabs::copySelection() const noexcept
+{
+	DEBUGPRINT("pdfv::Tabs::copySelection()\n");
+
+	if (!this->hasSelection())
+	{
+		return false;
+	}
+	std::wstring text;
+	try
+	{
+		auto layer{ this->curTab()->second.pageGetText(this->m_selection.page) };
+		if (layer == nullptr) [[unlikely]]
+		{
+			return false;
+		}
+		text = layer->text(this->m_selection.chars);
+	}
+	catch (const std::bad_alloc &)
+	{
+		return false;
+	}
+
+	return w::setClipboardText(this->m_canvashwnd, text);
+}
+
+void pdfv::Tabs::checkReload() noexcept
+{
+	// Password prompt may pump messages, prevent re-entrance
+	if (this->m_reloading)
+	{
+		return;
+	}
+	this->m_reloading = true;
+
+	for (std::size_t i = 0; i < this->m_tabs.size(); ++i)
+	{
+		auto & tab{ this->m_tabs[i] };
+		if (tab.reloadRead != nullptr && !tab.reloadRead->ready.load(std::memory_order_acquire))
+		{
+			continue;
+		}
+		auto read{ std::move(tab.reloadRead) };
+
+		FileStamp stamp;
+		if (tab.second.pdfGetReload() != nullptr || !tab.second.fileChanged(stamp) || stamp == tab.declinedStamp)
+		{
+			tab.pendingStamp = {};
+			continue;
+		}
+		// Wait until the file stops changing before reloading it, also while it was read
+		if (stamp != tab.pendingStamp || (read != nullptr && read->stamp != stamp))
+		{
+			tab.pendingStamp = stamp;
+			continue;
+		}
+		if (read == nullptr)
+		{
+			// Contents are read and fingerprinted on the I/O worker, opened once read
+			try
+			{
+				tab.reloadRead = std::make_shared<Pdfium::ReloadRead>();
+				this->window.readReload(tab.reloadRead, tab.second.pdfGetPath());
+			}
+			catch (const std::bad_alloc &)
+			{
+			}
+			continue;
+		}
+		tab.pendingStamp = {};
+
+		DEBUGPRINT("Reloading tab %zu\n", i);
+		const auto id{ tab.second.pdfGetId() };
+		const auto err{ tab.second.pdfReload(this->window, *read) };
+		// Password prompt pumps messages, the tab might be gone or hold another document
+		if (i >= this->m_tabs.size() || this->m_tabs[i].second.pdfGetId() != id)
+		{
+			continue;
+		}
+		if (err == error::pdf_success)
+		{
+			this->window.compareReload(this->m_tabs[i].second);
+		}
+		else if (err == error::pdf_password)
+		{
+			// Prompt was cancelled, asking again every other second would be a nuisance
+			this->m_tabs[i].declinedStamp = stamp;
+		}
+	}
+
+	this->m_reloading = false;
+}
+void pdfv::Tabs::finishReloads() noexcept
+{
+	for (std::size_t i = 0; i < this->m_tabs.size(); ++i)
+	{
+		auto & tab{ this->m_tabs[i] };
+		auto reload{ tab.second.pdfGetReload() };
+		if (reload == nullptr || !reload->done.load(std::memory_order_acquire))
+		{
+			continue;
+		}
+
+		DEBUGPRINT("Finishing reload of tab %zu\n", i);
+		if (tab.second.pdfFinishReload() == error::pdf_success)
+		{
+			if (!tab.indexPending)
+			{
+				this->window.indexDocument(tab.second);
+			}
+			if (ssize_t(i) == this->m_tabindex)
+			{
+				this->updateScrollbar();
+				this->redrawCanvas();
+			}
+		}
+	}
+}
+
+bool pdfv::Tabs::hibernate(TabObject & tab) noexcept
+{
+	if (tab.hibernated() || !tab.second.pdfExists() || tab.second.pdfGetPath().empty())
+	{
+		return false;
+	}
+	DEBUGPRINT("pdfv::Tabs::hibernate(%p), %zu bytes\n", static_cast<void *>(&tab), tab.second.pdfGetBytes());
+
+	try
+	{
+		tab.hibernatedPath = tab.second.pdfGetPath();
+	}
+	catch (const std::bad_alloc &)
+	{
+		return false;
+	}
+	auto profile{ tab.second.pdfGetProfile() };
+	tab.encrypted = profile != nullptr && profile->encrypted();
+	// Unloading keeps the file contents and the pre-rendered pages, a fresh object has neither
+	tab.second.pdfUnload();
+	tab.second = Pdfium();
+	tab.pendingStamp = {};
+	return true;
+}
+void pdfv::Tabs::restore(TabObject & tab, bool warm) noexcept
+{
+	DEBUGPRINT("pdfv::Tabs::restore(%p, %d)\n", static_cast<void *>(&tab), int(warm));
+
+	tab.sessionPending = false;
+	const auto before{ std::chrono::steady_clock::now() };
+	const auto err{ tab.second.pdfLoad(this->window, tab.hibernatedPath, std::size_t(tab.page) + 1) };
+	const auto millis{ double(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - before).count()) / 1000.0 };
+	DEBUGPRINT("Tab restored in %.3f ms, error %d\n", millis, int(err));
+
+	std::array<wchar_t, 64> status;
+	if (err == error::pdf_success) [[likely]]
+	{
+		tab.hibernatedPath.clear();
+		// Queued indexing jobs of a tab that isn't shown would hold up those of the current one
+		tab.indexPending = warm;
+		if (!warm)
+		{
+			this->window.indexDocument(tab.second);
+		}
+		std::swprintf(status.data(), status.size(), L"Tab restored in %.1f ms", millis);
+	}
+	else
+	{
+		// Path is kept, selecting the tab again retries
+		tab.second.pdfUnload();
+		tab.second = Pdfium();
+		std::swprintf(status.data(), status.size(), L"Couldn't restore the tab");
+	}
+	if (!warm)
+	{
+		w::status::setText(this->window.getStatusHandle(), MainWindow::StatusGeneral, w::status::DrawOp::def, status.data());
+	}
+}
+void pdfv::Tabs::checkHibernate() noexcept
+{
+	// Password prompt of a reload pumps messages, the tab being reloaded must stay
+	if (this->m_reloading)
+	{
+		return;
+	}
+	const auto now{ ::GetTickCount64() };
+	if (auto tab{ this->curTab() }; tab != nullptr)
+	{
+		tab->lastActive = now;
+	}
+
+	try
+	{
+		std::vector<std::pair<u64, std::size_t>> candidates;
+		std::size_t total{ 0 };
+		for (std::size_t i = 0; i < this->m_tabs.size(); ++i)
+		{
+			auto & tab{ this->m_tabs[i] };
+			if (ssize_t(i) == this->m_tabindex || tab.hibernated() || !tab.second.pdfExists())
+			{
+				continue;
+			}
+			if (now - tab.lastActive >= s_cHibernateIdle)
+			{
+				DEBUGPRINT("Tab %zu idle, hibernating\n", i);
+				this->hibernate(tab);
+				continue;
+			}
+			total += tab.second.pdfGetBytes();
+			candidates.emplace_back(tab.lastActive, i);
+		}
+		if (total <= s_cHibernateBudget)
+		{
+			return;
+		}
+
+		std::sort(candidates.begin(), candidates.end());
+		for (auto [lastActive, i] : candidates)
+		{
+			if (total <= s_cHibernateBudget)
+			{
+				break;
+			}
+			const auto bytes{ this->m_tabs[i].second.pdfGetBytes() };
+			if (this->hibernate(this->m_tabs[i]))
+			{
+				DEBUGPRINT("Tab %zu hibernated over budget, %zu bytes released\n", i, bytes);
+				total -= bytes;
+			}
+		}
+	}
+	catch (const std::bad_alloc &)
+	{
+	}
+}
+void pdfv::Tabs::warmUp() noexcept
+{
+	if (this->m_reloading)
+	{
+		return;
+	}
+	LASTINPUTINFO input{};
+	input.cbSize = sizeof input;
+	if (!::GetLastInputInfo(&input) || ::GetTickCount() - input.dwTime < s_cWarmUpIdle)
+	{
+		return;
+	}
+
+	std::size_t total{ 0 };
+	TabObject * next{ nullptr };
+	for (std::size_t i = 0; i < this->m_tabs.size(); ++i)
+	{
+		auto & tab{ this->m_tabs[i] };
+		if (ssize_t(i) == this->m_tabindex)
+		{
+			continue;
+		}
+		if (!tab.hibernated())
+		{
+			total += tab.second.pdfGetBytes();
+		}
+		else if (next == nullptr && tab.sessionPending && !tab.encrypted)
+		{
+			next = &tab;
+		}
+	}
+	if (next == nullptr || total >= s_cHibernateBudget / 2)
+	{
+		return;
+	}
+
+	DEBUGPRINT("Warming up a tab of the last session, %zu bytes in background tabs\n", total);
+	// Otherwise it would count as idle since startup and be hibernated right away
+	next->lastActive = ::GetTickCount64();
+	this->restore(*next, true);
+}
+
+void pdfv::Tabs::saveSession() const noexcept
+{
+	DEBUGPRINT("pdfv::Tabs::saveSession()\n");
+
+	try
+	{
+		Session session;
+		for (std::size_t i = 0; i < this->m_tabs.size(); ++i)
+		{
+			const auto & tab{ this->m_tabs[i] };
+			// Documents not loaded from a file can't be reopened
+			if (tab.path().empty())
+			{
+				continue;
+			}
+			if (ssize_t(i) == this->m_tabindex)
+			{
+				session.active = session.tabs.size();
+			}
+
+			auto profile{ tab.second.pdfGetProfile() };
+			const bool encrypted{ tab.hibernated() ? tab.encrypted : (profile != nullptr && profile->encrypted()) };
+			const auto page{ tab.second.pdfExists() ? tab.second.pageGetNum() - 1 : std::size_t(std::max(tab.page, 0)) };
+			session.tabs.push_back({
+				.path  = tab.path(),
+				.page  = u32(page),
+				.zoom  = tab.zoom,
+				.flags = encrypted ? u32(Session::Encrypted) : u32(0)
+			});
+		}
+		session.save();
+	}
+	catch (const std::bad_alloc &)
+	{
+	}
+}
+void pdfv::Tabs::restoreSession(bool select) noexcept
+{
+	DEBUGPRINT("pdfv::Tabs::restoreSession(%d)\n", int(select));
+
+	Session session;
+	if (!session.load() || session.tabs.empty())
+	{
+		return;
+	}
+
+	// A lone unopened tab is taken over by the first restored one
+	const bool reuse{ this->m_tabs.size() == 1 && this->getName() == Tabs::defaulttitlepadded && this->m_tabs.front().path().empty() };
+	const auto base{ reuse ? std::size_t(0) : this->m_tabs.size() };
+	try
+	{
+		for (std::size_t i = 0; i < session.tabs.size(); ++i)
+		{
+			auto & entry{ session.tabs[i] };
+			std::wstring_view fshort{ entry.path };
+			if (auto pos{ fshort.find_last_of(L"\\/") }; pos != std::wstring_view::npos) [[likely]]
+			{
+				fshort = fshort.substr(pos + 1);
+			}
+
+			auto it{ (reuse && i == 0) ? this->rename(fshort, 0) : this->insert(fshort) };
+			// Page is clamped when the document is opened, zoom here to the range the canvas allows
+			it->hibernatedPath = std::move(entry.path);
+			it->page           = int(std::min<u32>(entry.page, u32(std::numeric_limits<int>::max())));
+			it->zoom           = (entry.zoom >= 1.0f && entry.zoom <= 10.0f) ? entry.zoom : 1.0f;
+			it->encrypted      = (entry.flags & Session::Encrypted) != 0;
+			it->sessionPending = true;
+		}
+	}
+	catch (const std::bad_alloc &)
+	{
+	}
+
+	DEBUGPRINT("Restored %zu tab(s) of the last session\n", this->m_tabs.size() - base);
+	if (select && this->m_tabs.size() > base + session.active)
+	{
+		this->select(ssize_t(base + session.active));
+	}
+	else
+	{
+		this->redrawTabs();
+	}
+}
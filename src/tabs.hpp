@@ -1,6 +1,7 @@
 #pragma once
 #include "common.hpp"
 #include "lib.hpp"
+#include "session.hpp"
 
 #include <list>
 #include <utility>
@@ -28,12 +29,64 @@ namespace pdfv
 		TabObject & operator=(const TabObject & other) = delete;
 		TabObject & operator=(TabObject && other) noexcept;
 		~TabObject() noexcept;
+
+		/**
+		 * @return true Document of the tab has been released, it's reopened when the tab is selected
+		 */
+		[[nodiscard]] bool hibernated() const noexcept
+		{
+			return !this->hibernatedPath.empty();
+		}
+		/**
+		 * @return const std::wstring& Path of the tab's document, also of a hibernated one
+		 */
+		[[nodiscard]] const std::wstring & path() const noexcept
+		{
+			return this->hibernated() ? this->hibernatedPath : this->second.pdfGetPath();
+		}
 		
 	private:
 
 		int yMaxScroll{};
 		int yMinScroll{};
 		int page{};
+		FileStamp pendingStamp;
+		/**
+		 * @brief Stamp of the file version, whose password wasn't given, it isn't reloaded
+		 * until the file changes again
+		 * 
+		 */
+		FileStamp declinedStamp;
+		/**
+		 * @brief Path of the released document while hibernated, empty otherwise
+		 * 
+		 */
+		std::wstring hibernatedPath;
+		/**
+		 * @brief Tick count of the last time the tab was the current one
+		 * 
+		 */
+		u64 lastActive{ ::GetTickCount64() };
+		/**
+		 * @brief Document of the hibernated tab might ask for a password when it's reopened
+		 * 
+		 */
+		bool encrypted{ false };
+		/**
+		 * @brief Tab comes from the last session and its document hasn't been opened yet
+		 * 
+		 */
+		bool sessionPending{ false };
+		/**
+		 * @brief Document was opened in the background, it is indexed once the tab is selected
+		 * 
+		 */
+		bool indexPending{ false };
+		/**
+		 * @brief New version of the file being read in the background, reloaded once read
+		 * 
+		 */
+		std::shared_ptr<Pdfium::ReloadRead> reloadRead;
 
 		friend class pdfv::Tabs;
 
@@ -63,6 +116,38 @@ namespace pdfv
 
 		ListType m_tabs;
 		ssize_t m_tabindex{ 0 };
+		bool m_reloading{ false };
+
+		/**
+		 * @brief Text selection, valid only for the document version and page it was made on
+		 * 
+		 */
+		struct Selection
+		{
+			u64 docId{ 0 };
+			std::size_t page{ 0 };
+			std::vector<u32> chars;
+		} m_selection;
+		bool m_selecting{ false }, m_overText{ false };
+		xy<int> m_dragStart, m_dragEnd;
+		/**
+		 * @brief Link under the mouse cursor, valid only for the document version and page
+		 * it was found on
+		 * 
+		 */
+		struct HoverLink
+		{
+			u64 docId{ 0 };
+			std::size_t page{ 0 };
+			ssize_t index{ LinkLayer::s_cNoHit };
+			/**
+			 * @brief Target page of an internal link, 0 otherwise
+			 * 
+			 */
+			std::size_t target{ 0 };
+
+			[[nodiscard]] constexpr bool operator==(const HoverLink & rhs) const noexcept = default;
+		} m_hoverLink;
 
 		/**
 		 * @brief Return pointer to current tab, nullptr, if none is open
@@ -81,11 +166,95 @@ namespace pdfv
 
 		static constexpr xy<int> s_cCloseButtonSz{ 20, 20 };
 
+		static constexpr COLORREF s_cHitColor   { RGB(255, 235, 59) };
+		static constexpr COLORREF s_cCurHitColor{ RGB(255, 152, 0) };
+		/**
+		 * @brief Raster operation DPa, page AND brush, tints the page but keeps the text dark
+		 * 
+		 */
+		static constexpr DWORD s_cRopTint{ 0x00A000C9 };
+		/**
+		 * @brief Time an internal link has to be hovered before its target page is prefetched
+		 * 
+		 */
+		static constexpr UINT s_cPrefetchDelay{ 200 };
+		/**
+		 * @brief Background tabs unused for this long in milliseconds are hibernated
+		 * 
+		 */
+		static constexpr u64 s_cHibernateIdle{ 15 * 60 * 1000 };
+		/**
+		 * @brief Memory background tabs may hold together, the least recently used ones
+		 * are hibernated above it
+		 * 
+		 */
+		static constexpr std::size_t s_cHibernateBudget{ 512 * 1024 * 1024 };
+		/**
+		 * @brief Time without user input in milliseconds, after which tabs of the last session
+		 * are opened in the background
+		 * 
+		 */
+		static constexpr DWORD s_cWarmUpIdle{ 5000 };
+
 		LRESULT tabsCanvasProc(UINT msg, WPARAM wp, LPARAM lp);
 
 		void updatePageCounter() const noexcept;
 		void updateZoom() const noexcept;
 
+		/**
+		 * @brief Selects the characters intersecting the rubber band rectangle
+		 * 
+		 */
+		void updateSelection() noexcept;
+		/**
+		 * @brief Finds the link under the cursor, shows its target on the status bar and
+		 * schedules prefetching of the target page of internal links
+		 * 
+		 * @param point Cursor position on the canvas
+		 */
+		void updateHoverLink(xy<int> point) noexcept;
+		/**
+		 * @return true Hovered link belongs to the current page of the current tab
+		 */
+		[[nodiscard]] bool hoveringLink() const noexcept;
+		/**
+		 * @brief Highlights a range of characters of the current page, one rectangle per line
+		 * 
+		 * @param dc Device context, where the current page has been rendered
+		 * @param doc Document
+		 * @param layer Text layer of the current page
+		 * @param first Index of the first character
+		 * @param count Number of characters
+		 * @param rop Raster operation combining the selected brush with the page
+		 */
+		static void s_highlight(
+			HDC dc, const Pdfium & doc, const TextLayer & layer,
+			std::size_t first, std::size_t count, DWORD rop
+		) noexcept;
+		/**
+		 * @brief Composites search hits, the selection and the rubber band rectangle over
+		 * the rendered page, the cached page bitmap itself is left untouched
+		 * 
+		 * @param dc Device context, where the current page has been rendered
+		 */
+		void paintOverlay(HDC dc) const noexcept;
+		/**
+		 * @brief Releases the document, pages and pre-rendered pages of a tab, keeps only
+		 * its path, page and zoom. Documents not loaded from a file stay as they are
+		 * 
+		 * @param tab Reference to tab
+		 * @return true Tab was hibernated
+		 */
+		bool hibernate(TabObject & tab) noexcept;
+		/**
+		 * @brief Reopens the document of a hibernated tab at its page
+		 * 
+		 * @param tab Reference to tab
+		 * @param warm Tab isn't selected, the document is only opened, it isn't indexed and
+		 * the time it took isn't shown on the status bar
+		 */
+		void restore(TabObject & tab, bool warm = false) noexcept;
+
 	public:
 		Tabs(const MainWindow & wnd) noexcept;
 		/**
@@ -202,6 +371,77 @@ namespace pdfv
 		void selChange(bool erase = false) noexcept;
 
 		void updateScrollbar() noexcept;
+		/**
+		 * @brief Shows given page of the current tab
+		 * 
+		 * @param page Page number, starting from 1
+		 */
+		void goToPage(std::size_t page) noexcept;
+
+		/**
+		 * @return true Current page of the current tab has selected text
+		 */
+		[[nodiscard]] bool hasSelection() const noexcept;
+		/**
+		 * @brief Copies the selected text to clipboard
+		 * 
+		 * @return true Success
+		 * @return false Nothing is selected or clipboard is unavailable
+		 */
+		bool copySelection() const noexcept;
+		/**
+		 * @brief Selects all text of the current page
+		 * 
+		 */
+		void selectAll() noexcept;
+
+		/**
+		 * @brief Checks all open tabs for changes of their files on disk, reads the new
+		 * versions of the ones whose files have changed and haven't been written to since
+		 * the last check on the I/O worker and opens them once read, their pages are compared
+		 * in the background
+		 * 
+		 */
+		void checkReload() noexcept;
+		/**
+		 * @return true A reload is opening a document, it might be prompting for a password
+		 */
+		[[nodiscard]] bool reloading() const noexcept
+		{
+			return this->m_reloading;
+		}
+		/**
+		 * @brief Switches the tabs, whose reloads have finished comparing pages, to the new
+		 * versions of their documents
+		 * 
+		 */
+		void finishReloads() noexcept;
+		/**
+		 * @brief Hibernates background tabs that have been idle for too long and the least
+		 * recently used ones while background tabs hold more memory than the budget
+		 * 
+		 */
+		void checkHibernate() noexcept;
+		/**
+		 * @brief Opens the document of one tab of the last session while the user is idle and
+		 * background tabs hold less than half of the hibernation budget. Documents that might
+		 * ask for a password wait until their tab is selected, so does indexing
+		 * 
+		 */
+		void warmUp() noexcept;
+
+		/**
+		 * @brief Writes path, page and zoom of all tabs opened from files to the session file
+		 * 
+		 */
+		void saveSession() const noexcept;
+		/**
+		 * @brief Adds the tabs of the last session as hibernated placeholders, their documents
+		 * are opened when they're selected or by warmUp
+		 * 
+		 * @param select Whether to select the tab that was current, which opens its document
+		 */
+		void restoreSession(bool select) noexcept;
 
 	};
 }
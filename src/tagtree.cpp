@@ -0,0 +1,385 @@
+#include "tagtree.hpp"
+#include "lib.hpp"
+#include "governor.hpp"
+#include <fpdf_structtree.h>
+#include <fpdf_catalog.h>
+#include <fpdf_edit.h>
+#include <fpdf_text.h>
+
+#include <chrono>
+
+namespace
+{
+	/**
+	 * @brief Appends the text of a page object's marked content to its identifier's text,
+	 * descends into form objects
+	 * 
+	 */
+	void collectText(
+		FPDF_PAGEOBJECT obj, FPDF_TEXTPAGE textPage, std::unordered_map<int, std::wstring> & texts,
+		std::vector<unsigned short> & buf, int depth
+	)
+	{
+		const auto type{ FPDFPageObj_GetType(obj) };
+		if (type == FPDF_PAGEOBJ_FORM && depth < 32)
+		{
+			const auto count{ FPDFFormObj_CountObjects(obj) };
+			for (int i = 0; i < count; ++i)
+			{
+				if (auto child{ FPDFFormObj_GetObject(obj, pdfv::ul(i)) }; child != nullptr)
+				{
+					collectText(child, textPage, texts, buf, depth + 1);
+				}
+			}
+			return;
+		}
+		if (type != FPDF_PAGEOBJ_TEXT)
+		{
+			return;
+		}
+
+		// Innermost marked content sequence with an identifier owns the object
+		int mcid{ -1 };
+		for (auto i{ FPDFPageObj_CountMarks(obj) }; i-- > 0 && mcid < 0;)
+		{
+			if (auto mark{ FPDFPageObj_GetMark(obj, pdfv::ul(i)) }; mark != nullptr)
+			{
+				int value;
+				if (FPDFPageObjMark_GetParamIntValue(mark, "MCID", &value) && value >= 0)
+				{
+					mcid = value;
+				}
+			}
+		}
+		if (mcid < 0)
+		{
+			return;
+		}
+
+		// Length is in bytes and includes the terminating null character
+		auto len{ FPDFTextObj_GetText(obj, textPage, buf.data(), pdfv::ul(buf.size() * sizeof(unsigned short))) };
+		if (len > buf.size() * sizeof(unsigned short))
+		{
+			buf.resize(len / sizeof(unsigned short));
+			len = FPDFTextObj_GetText(obj, textPage, buf.data(), pdfv::ul(buf.size() * sizeof(unsigned short)));
+		}
+		const auto units{ std::min<std::size_t>(len / sizeof(unsigned short), buf.size()) };
+		if (units > 1)
+		{
+			texts[mcid].append(buf.begin(), buf.begin() + pdfv::ssize_t(units - 1));
+		}
+	}
+}
+
+pdfv::TagTree::TagTree(DocRef doc, std::size_t numPages) noexcept
+	: m_doc(std::move(doc)), m_numPages(numPages)
+{
+	// Only a published tree counts, the builder owns the arrays until then
+	this->m_governorId = MemoryGovernor::instance().add({
+		.category  = MemoryGovernor::Category::tagTrees,
+		.used      = [this]() noexcept { return this->ready() ? this->bytes() : 0; },
+		.candidate = [this](MemoryGovernor::Candidate & cand) noexcept
+		{
+			if (!this->ready())
+			{
+				return false;
+			}
+			cand = { .lastUse = this->m_lastUse.load(std::memory_order_relaxed), .bytes = this->bytes(), .cost = this->m_cost };
+			return true;
+		},
+		.evict     = [this]() noexcept -> std::size_t
+		{
+			if (!this->ready())
+			{
+				return 0;
+			}
+			const auto bytes{ this->bytes() };
+			this->m_ready.store(false, std::memory_order_release);
+			this->clear();
+			this->m_requested.store(false, std::memory_order_release);
+			return bytes;
+		}
+	});
+}
+pdfv::TagTree::~TagTree() noexcept
+{
+	MemoryGovernor::instance().remove(this->m_governorId);
+}
+
+void pdfv::TagTree::clear() noexcept
+{
+	this->m_typeNames   = {};
+	this->m_pageStart   = {};
+	this->m_type        = {};
+	this->m_depth       = {};
+	this->m_parent      = {};
+	this->m_end         = {};
+	this->m_mcid        = {};
+	this->m_textStart   = {};
+	this->m_text        = {};
+}
+
+void pdfv::TagTree::readPage(FPDF_PAGE page, std::unordered_map<std::wstring, u16> & types)
+{
+	auto tree{ FPDF_StructTree_GetForPage(page) };
+	if (tree == nullptr)
+	{
+		return;
+	}
+	const auto numRoots{ FPDF_StructTree_CountChildren(tree) };
+	if (numRoots <= 0)
+	{
+		FPDF_StructTree_Close(tree);
+		return;
+	}
+
+	std::vector<unsigned short> buf(64);
+	std::unordered_map<int, std::wstring> texts;
+	if (auto textPage{ FPDFText_LoadPage(page) }; textPage != nullptr) [[likely]]
+	{
+		const auto count{ FPDFPage_CountObjects(page) };
+		for (int i = 0; i < count; ++i)
+		{
+			if (auto obj{ FPDFPage_GetObject(page, i) }; obj != nullptr)
+			{
+				collectText(obj, textPage, texts, buf, 0);
+			}
+		}
+		FPDFText_ClosePage(textPage);
+	}
+
+	auto appendText = [this, &texts](int mcid)
+	{
+		if (auto it{ texts.find(mcid) }; it != texts.end())
+		{
+			this->m_text += it->second;
+		}
+	};
+	auto readType = [this, &buf, &types](FPDF_STRUCTELEMENT elem) -> u16
+	{
+		auto len{ FPDF_StructElement_GetType(elem, buf.data(), ul(buf.size() * sizeof(unsigned short))) };
+		if (len > buf.size() * sizeof(unsigned short))
+		{
+			buf.resize(len / sizeof(unsigned short));
+			len = FPDF_StructElement_GetType(elem, buf.data(), ul(buf.size() * sizeof(unsigned short)));
+		}
+		const auto units{ std::min<std::size_t>(len / sizeof(unsigned short), buf.size()) };
+		std::wstring name(buf.begin(), buf.begin() + ssize_t(units > 0 ? units - 1 : 0));
+		if (auto it{ types.find(name) }; it != types.end())
+		{
+			return it->second;
+		}
+		const auto id{ u16(std::min<std::size_t>(this->m_typeNames.size(), std::numeric_limits<u16>::max())) };
+		if (id == std::numeric_limits<u16>::max()) [[unlikely]]
+		{
+			// Absurd number of distinct types, the rest share the last one
+			return u16(id - 1);
+		}
+		this->m_typeNames.emplace_back(name);
+		types.emplace(std::move(name), id);
+		return id;
+	};
+
+	// Depth-first with an explicit stack, siblings are pushed in reverse to keep pre-order
+	struct Pending
+	{
+		FPDF_STRUCTELEMENT elem;
+		u32 parent;
+		u16 depth;
+	};
+	std::vector<Pending> stack;
+	for (auto i{ numRoots }; i-- > 0;)
+	{
+		if (auto root{ FPDF_StructTree_GetChildAtIndex(tree, i) }; root != nullptr)
+		{
+			stack.push_back({ root, s_cNone, 0 });
+		}
+	}
+	const auto first{ this->m_type.size() };
+	while (!stack.empty())
+	{
+		const auto cur{ stack.back() };
+		stack.pop_back();
+
+		const auto idx{ u32(this->m_type.size()) };
+		this->m_type.emplace_back(readType(cur.elem));
+		this->m_depth.emplace_back(cur.depth);
+		this->m_parent.emplace_back(cur.parent);
+		this->m_end.emplace_back(idx + 1);
+		this->m_textStart.emplace_back(u32(this->m_text.size()));
+
+		const auto mcids{ FPDF_StructElement_GetMarkedContentIdCount(cur.elem) };
+		if (mcids > 0)
+		{
+			this->m_mcid.emplace_back(FPDF_StructElement_GetMarkedContentIdAtIndex(cur.elem, 0));
+			for (int i = 0; i < mcids; ++i)
+			{
+				appendText(FPDF_StructElement_GetMarkedContentIdAtIndex(cur.elem, i));
+			}
+		}
+		else
+		{
+			const auto mcid{ FPDF_StructElement_GetMarkedContentID(cur.elem) };
+			this->m_mcid.emplace_back(mcid);
+			appendText(mcid);
+		}
+
+		if (cur.depth + 1 < s_cMaxDepth)
+		{
+			for (auto i{ FPDF_StructElement_CountChildren(cur.elem) }; i-- > 0;)
+			{
+				if (auto child{ FPDF_StructElement_GetChildAtIndex(cur.elem, i) }; child != nullptr)
+				{
+					stack.push_back({ child, idx, u16(cur.depth + 1) });
+				}
+			}
+		}
+	}
+	FPDF_StructTree_Close(tree);
+
+	// Subtree of an element ends where the next element at the same or a lower depth starts
+	std::vector<u32> open;
+	for (auto i{ first }; i < this->m_type.size(); ++i)
+	{
+		while (!open.empty() && this->m_depth[open.back()] >= this->m_depth[i])
+		{
+			this->m_end[open.back()] = u32(i);
+			open.pop_back();
+		}
+		open.emplace_back(u32(i));
+	}
+	for (auto i : open)
+	{
+		this->m_end[i] = u32(this->m_type.size());
+	}
+}
+
+void pdfv::TagTree::build(const std::atomic<bool> & cancel) noexcept
+{
+	DEBUGPRINT("pdfv::TagTree::build(%p)\n", static_cast<const void *>(&cancel));
+
+	if (this->ready())
+	{
+		return;
+	}
+	// Not published until ready, a cancelled or failed build can be requested again
+	auto abandon = [this]() noexcept
+	{
+		this->clear();
+		this->m_requested.store(false, std::memory_order_release);
+	};
+	try
+	{
+		this->clear();
+		const auto before{ std::chrono::steady_clock::now() };
+
+		bool tagged{ false };
+		{
+			auto lock{ Pdfium::lock() };
+			if (this->m_doc->get() == nullptr)
+			{
+				abandon();
+				return;
+			}
+			tagged = FPDFCatalog_IsTagged(this->m_doc->get());
+		}
+
+		std::unordered_map<std::wstring, u16> types;
+		this->m_pageStart.reserve(this->m_numPages + 1);
+		for (std::size_t i = 0; tagged && i < this->m_numPages; ++i)
+		{
+			if (cancel)
+			{
+				abandon();
+				return;
+			}
+			this->m_pageStart.emplace_back(u32(this->m_type.size()));
+
+			auto lock{ Pdfium::lock() };
+			if (this->m_doc->get() == nullptr)
+			{
+				abandon();
+				return;
+			}
+			if (auto page{ FPDF_LoadPage(this->m_doc->get(), int(i)) }; page != nullptr) [[likely]]
+			{
+				this->readPage(page, types);
+				FPDF_ClosePage(page);
+			}
+		}
+		this->m_pageStart.resize(this->m_numPages, u32(this->m_type.size()));
+		this->m_pageStart.emplace_back(u32(this->m_type.size()));
+		this->m_textStart.emplace_back(u32(this->m_text.size()));
+
+		this->m_cost = u64(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - before).count());
+		this->m_lastUse.store(MemoryGovernor::s_now(), std::memory_order_relaxed);
+		this->m_ready.store(true, std::memory_order_release);
+		DEBUGPRINT("Tag tree: %zu elements, %zu types, %zu bytes\n", this->m_type.size(), this->m_typeNames.size(), this->bytes());
+	}
+	catch (const std::bad_alloc &)
+	{
+		abandon();
+	}
+}
+[[nodiscard]] std::pair<std::size_t, std::size_t> pdfv::TagTree::pageElements(std::size_t page) const noexcept
+{
+	if (!this->ready() || page < 1 || page > this->m_numPages)
+	{
+		return { 0, 0 };
+	}
+	return { this->m_pageStart[page - 1], this->m_pageStart[page] };
+}
+[[nodiscard]] std::wstring pdfv::TagTree::exportText() const
+{
+	std::wstring out;
+	if (!this->any())
+	{
+		return out;
+	}
+	this->m_lastUse.store(MemoryGovernor::s_now(), std::memory_order_relaxed);
+	out.reserve(this->m_text.size() + this->m_type.size() * 8);
+	for (std::size_t page = 1; page <= this->m_numPages; ++page)
+	{
+		const auto [first, last]{ this->pageElements(page) };
+		if (first == last)
+		{
+			continue;
+		}
+		out += L"Page ";
+		out += std::to_wstring(page);
+		out += L"\r\n";
+		for (auto i{ first }; i < last; ++i)
+		{
+			out.append(2 * (this->depth(i) + 1), L' ');
+			out += this->type(i);
+			if (const auto str{ this->text(i) }; !str.empty())
+			{
+				out += L": ";
+				for (auto ch : str)
+				{
+					// Keep one element per line
+					out += (ch == L'\r' || ch == L'\n') ? L' ' : ch;
+				}
+			}
+			out += L"\r\n";
+		}
+	}
+	return out;
+}
+[[nodiscard]] std::size_t pdfv::TagTree::bytes() const noexcept
+{
+	std::size_t names{ 0 };
+	for (const auto & name : this->m_typeNames)
+	{
+		names += sizeof(std::wstring) + name.capacity() * sizeof(wchar_t);
+	}
+	return sizeof(TagTree) + names +
+		this->m_pageStart.capacity() * sizeof(u32) +
+		this->m_type.capacity() * sizeof(u16) +
+		this->m_depth.capacity() * sizeof(u16) +
+		this->m_parent.capacity() * sizeof(u32) +
+		this->m_end.capacity() * sizeof(u32) +
+		this->m_mcid.capacity() * sizeof(i32) +
+		this->m_textStart.capacity() * sizeof(u32) +
+		this->m_text.capacity() * sizeof(wchar_t);
+}
@@ -0,0 +1,216 @@
+#pragma once
+
+#include "common.hpp"
+#include "borrowed.hpp"
+
+#include <atomic>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace pdfv
+{
+	/**
+	 * @brief Logical structure of a tagged document, read in the background when it's first
+	 * asked for and flattened into parallel arrays. Elements of every page are stored in
+	 * pre-order, so the subtree of an element is a contiguous range and so is its text, which
+	 * is taken from the marked content the element owns. Immutable once ready, so readers
+	 * don't lock. The memory governor may drop a ready tree on the GUI thread, it's read
+	 * again on the next request
+	 * 
+	 */
+	class TagTree
+	{
+	public:
+		static constexpr u32 s_cNone{ std::numeric_limits<u32>::max() };
+		/**
+		 * @brief Deeper elements are dropped, guards against malformed trees
+		 * 
+		 */
+		static constexpr u16 s_cMaxDepth{ 256 };
+
+	private:
+		DocRef m_doc;
+		std::size_t m_numPages{ 0 };
+
+		/**
+		 * @brief Structure types, e.g. "P" or "H1", indexed by type id
+		 * 
+		 */
+		std::vector<std::wstring> m_typeNames;
+		/**
+		 * @brief First element of each page, followed by the total element count
+		 * 
+		 */
+		std::vector<u32> m_pageStart;
+		std::vector<u16> m_type;
+		std::vector<u16> m_depth;
+		/**
+		 * @brief Parent element, s_cNone for the top elements of a page
+		 * 
+		 */
+		std::vector<u32> m_parent;
+		/**
+		 * @brief One past the last element of the subtree
+		 * 
+		 */
+		std::vector<u32> m_end;
+		/**
+		 * @brief First marked-content identifier of the element, -1 if it has none
+		 * 
+		 */
+		std::vector<i32> m_mcid;
+		/**
+		 * @brief Offset of each element's own text in m_text, followed by the total length
+		 * 
+		 */
+		std::vector<u32> m_textStart;
+		std::wstring m_text;
+		std::atomic<bool> m_ready{ false };
+		/**
+		 * @brief A build is queued or running
+		 * 
+		 */
+		std::atomic<bool> m_requested{ false };
+		/**
+		 * @brief Tick count of the last read, see MemoryGovernor::s_now
+		 * 
+		 */
+		mutable std::atomic<u64> m_lastUse{ 0 };
+		/**
+		 * @brief Time the last build took in microseconds
+		 * 
+		 */
+		u64 m_cost{ 0 };
+		u64 m_governorId{ 0 };
+
+		/**
+		 * @brief Releases all elements, the tree must not be published
+		 * 
+		 */
+		void clear() noexcept;
+
+		/**
+		 * @brief Walks a page's structure, caller has to hold the library lock
+		 * 
+		 * @param page Page handle
+		 * @param types Reference to type interning map
+		 */
+		void readPage(FPDF_PAGE page, std::unordered_map<std::wstring, u16> & types);
+
+	public:
+		/**
+		 * @param doc Document of the owner
+		 * @param numPages Page count of the document
+		 */
+		TagTree(DocRef doc, std::size_t numPages) noexcept;
+		TagTree(const TagTree & other) = delete;
+		TagTree(TagTree && other) noexcept = delete;
+		TagTree & operator=(const TagTree & other) = delete;
+		TagTree & operator=(TagTree && other) noexcept = delete;
+		~TagTree() noexcept;
+
+		/**
+		 * @brief Asks for the structure, only the first caller until it's ready or dropped
+		 * has to queue build()
+		 * 
+		 * @return true Caller should queue build()
+		 */
+		[[nodiscard]] bool request() noexcept
+		{
+			return !this->ready() && !this->m_requested.exchange(true);
+		}
+		/**
+		 * @brief Takes back a request whose build couldn't be queued
+		 * 
+		 */
+		void withdraw() noexcept
+		{
+			this->m_requested.store(false, std::memory_order_release);
+		}
+		/**
+		 * @brief Reads the structure of all pages, takes the library lock for every page
+		 * 
+		 * @param cancel Reference to cancellation flag
+		 */
+		void build(const std::atomic<bool> & cancel) noexcept;
+		/**
+		 * @return true Structure is read
+		 */
+		[[nodiscard]] bool ready() const noexcept
+		{
+			return this->m_ready.load(std::memory_order_acquire);
+		}
+		/**
+		 * @return true Document is tagged and has structure elements
+		 */
+		[[nodiscard]] bool any() const noexcept
+		{
+			return this->ready() && !this->m_type.empty();
+		}
+		/**
+		 * @return std::size_t Number of elements of all pages, 0 until the structure is read
+		 */
+		[[nodiscard]] std::size_t size() const noexcept
+		{
+			return this->ready() ? this->m_type.size() : 0;
+		}
+		/**
+		 * @param page Page number, starting from 1
+		 * @return std::pair<std::size_t, std::size_t> Range of the page's elements, empty if
+		 * the page has none or the structure isn't read yet
+		 */
+		[[nodiscard]] std::pair<std::size_t, std::size_t> pageElements(std::size_t page) const noexcept;
+
+		[[nodiscard]] std::wstring_view type(std::size_t elem) const noexcept
+		{
+			return this->m_typeNames[this->m_type[elem]];
+		}
+		[[nodiscard]] std::size_t depth(std::size_t elem) const noexcept
+		{
+			return this->m_depth[elem];
+		}
+		[[nodiscard]] u32 parent(std::size_t elem) const noexcept
+		{
+			return this->m_parent[elem];
+		}
+		[[nodiscard]] std::size_t subtreeEnd(std::size_t elem) const noexcept
+		{
+			return this->m_end[elem];
+		}
+		[[nodiscard]] i32 mcid(std::size_t elem) const noexcept
+		{
+			return this->m_mcid[elem];
+		}
+		/**
+		 * @return std::wstring_view Text of the marked content the element owns
+		 */
+		[[nodiscard]] std::wstring_view text(std::size_t elem) const noexcept
+		{
+			return std::wstring_view(this->m_text).substr(this->m_textStart[elem], this->m_textStart[elem + 1] - this->m_textStart[elem]);
+		}
+		/**
+		 * @return std::wstring_view Text of the element and its descendants in structure order
+		 */
+		[[nodiscard]] std::wstring_view subtreeText(std::size_t elem) const noexcept
+		{
+			const auto end{ this->m_textStart[this->m_end[elem]] };
+			return std::wstring_view(this->m_text).substr(this->m_textStart[elem], end - this->m_textStart[elem]);
+		}
+
+		/**
+		 * @brief Writes the structure as an indented outline, one element per line with its
+		 * type and text, pages separated by headings
+		 * 
+		 * @return std::wstring Outline, empty if there is no structure
+		 */
+		[[nodiscard]] std::wstring exportText() const;
+		/**
+		 * @return std::size_t Approximate memory usage in bytes
+		 */
+		[[nodiscard]] std::size_t bytes() const noexcept;
+	};
+}
@@ -0,0 +1,545 @@
+#include "textindex.hpp"
+#include "textmatch.hpp"
+#include "search.hpp"
+#include "lib.hpp"
+#include <fpdf_text.h>
+
+#include <algorithm>
+#include <cwctype>
+#include <cstring>
+#include <cwchar>
+#include <unordered_map>
+
+namespace pdfv
+{
+	static void putVarint(std::vector<u8> & out, u32 value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back(u8(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back(u8(value));
+	}
+	[[nodiscard]] static u32 getVarint(const u8 *& p, const u8 * end) noexcept
+	{
+		u32 value{ 0 };
+		for (u32 shift = 0; p < end && shift < 32; shift += 7)
+		{
+			const auto byte{ *p++ };
+			value |= u32(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+			{
+				break;
+			}
+		}
+		return value;
+	}
+
+	/**
+	 * @brief Splits folded text into words, units the matcher drops are already gone, so
+	 * that e.g. a decomposed "e\u0301" stays inside its word just like in a full scan
+	 * 
+	 * @tparam Fn Callable with signature void(std::wstring_view word, std::size_t offset)
+	 * @param folded Text folded by TextMatcher::s_foldText or foldQuery
+	 * @param fn Callback for each word, offset is the position in the folded text
+	 */
+	template<typename Fn>
+	static void tokenize(std::wstring_view folded, Fn && fn)
+	{
+		for (std::size_t i = 0; i < folded.size();)
+		{
+			if (!TextIndex::s_isWordChar(folded[i]))
+			{
+				++i;
+				continue;
+			}
+			auto start{ i };
+			for (; i < folded.size() && TextIndex::s_isWordChar(folded[i]); ++i);
+			fn(folded.substr(start, i - start), start);
+		}
+	}
+	/**
+	 * @brief Folds a query the way TextMatcher::compile folds it with default options
+	 * 
+	 * @param query Search query
+	 * @return std::wstring Folded query
+	 */
+	[[nodiscard]] static std::wstring foldQuery(std::wstring_view query)
+	{
+		std::wstring folded;
+		folded.reserve(query.size());
+		for (auto c : query)
+		{
+			if (auto f{ TextIndex::s_fold(c) }; f != L'\0')
+			{
+				folded.push_back(f);
+			}
+		}
+		return folded;
+	}
+
+	/**
+	 * @brief Postings of a single term being built
+	 * 
+	 */
+	struct TermBuild
+	{
+		std::vector<u8> bytes;
+		u32 lastPage{ 0 };
+		u32 lastOffset{ 0 };
+		u32 count{ 0 };
+		/**
+		 * @brief Every occurrence maps one folded unit to one character, see Term::s_cInexact
+		 * 
+		 */
+		bool exact{ true };
+
+		void add(u32 page, u32 offset)
+		{
+			const auto pageDelta{ page - this->lastPage };
+			putVarint(this->bytes, pageDelta);
+			putVarint(this->bytes, (pageDelta == 0) ? (offset - this->lastOffset) : offset);
+			this->lastPage   = page;
+			this->lastOffset = offset;
+			++this->count;
+		}
+	};
+	struct TermHash
+	{
+		using is_transparent = void;
+		[[nodiscard]] std::size_t operator()(std::wstring_view str) const noexcept
+		{
+			return std::hash<std::wstring_view>{}(str);
+		}
+	};
+}
+
+pdfv::TextIndex::~TextIndex() noexcept
+{
+	DEBUGPRINT("pdfv::TextIndex::~TextIndex()\n");
+
+	if (this->m_view != nullptr)
+	{
+		::UnmapViewOfFile(this->m_view);
+	}
+	if (this->m_mapping != nullptr)
+	{
+		::CloseHandle(this->m_mapping);
+	}
+	if (this->m_file != INVALID_HANDLE_VALUE)
+	{
+		::CloseHandle(this->m_file);
+	}
+}
+
+bool pdfv::TextIndex::map(const std::wstring & path, u64 fingerprint) noexcept
+{
+	DEBUGPRINT("pdfv::TextIndex::map(%p)\n", static_cast<const void *>(path.c_str()));
+
+	this->m_file = ::CreateFileW(
+		path.c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_DELETE,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS,
+		nullptr
+	);
+	if (this->m_file == INVALID_HANDLE_VALUE) [[unlikely]]
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size{};
+	if (!::GetFileSizeEx(this->m_file, &size) || size.QuadPart < LONGLONG(sizeof(Header))) [[unlikely]]
+	{
+		return false;
+	}
+	this->m_size = std::size_t(size.QuadPart);
+
+	this->m_mapping = ::CreateFileMappingW(this->m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (this->m_mapping == nullptr) [[unlikely]]
+	{
+		return false;
+	}
+	this->m_view = static_cast<const u8 *>(::MapViewOfFile(this->m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (this->m_view == nullptr) [[unlikely]]
+	{
+		return false;
+	}
+
+	auto h{ reinterpret_cast<const Header *>(this->m_view) };
+	if (h->magic != s_cMagic || h->version != s_cVersion || h->fingerprint != fingerprint ||
+		h->fileSize != this->m_size ||
+		h->termsOffset + u64(h->numTerms) * sizeof(Term) > h->charsOffset ||
+		h->charsOffset > h->postingsOffset || h->postingsOffset > h->fileSize ||
+		(h->termsOffset % alignof(Term)) != 0 || (h->charsOffset % alignof(wchar_t)) != 0) [[unlikely]]
+	{
+		return false;
+	}
+
+	this->m_header   = h;
+	this->m_terms    = reinterpret_cast<const Term *>(this->m_view + h->termsOffset);
+	this->m_chars    = reinterpret_cast<const wchar_t *>(this->m_view + h->charsOffset);
+	this->m_postings = this->m_view + h->postingsOffset;
+
+	// Every term has to point inside the file
+	const auto numChars{ (h->postingsOffset - h->charsOffset) / sizeof(wchar_t) };
+	const auto numBytes{ h->fileSize - h->postingsOffset };
+	for (u32 i = 0; i < h->numTerms; ++i)
+	{
+		const auto & t{ this->m_terms[i] };
+		if (u64(t.charsOffset) + (t.length & ~Term::s_cInexact) > numChars || t.postingsOffset + t.postingsLength > numBytes) [[unlikely]]
+		{
+			this->m_header = nullptr;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+[[nodiscard]] std::wstring pdfv::TextIndex::s_path(u64 fingerprint)
+{
+	auto dir{ getCacheDir(L"index") };
+	if (dir.empty()) [[unlikely]]
+	{
+		return {};
+	}
+
+	// Versioned name, so that indices of an older format get rebuilt and eventually pruned
+	wchar_t name[40]{};
+	std::swprintf(name, std::size(name), L"%016llx-v%u.idx", static_cast<unsigned long long>(fingerprint), s_cVersion);
+	return dir + name;
+}
+[[nodiscard]] std::wstring_view pdfv::TextIndex::termText(const Term & term) const noexcept
+{
+	return { this->m_chars + term.charsOffset, term.length & ~Term::s_cInexact };
+}
+template<typename Fn>
+void pdfv::TextIndex::decode(const Term & term, Fn && fn) const noexcept
+{
+	auto p{ this->m_postings + term.postingsOffset };
+	const auto end{ p + term.postingsLength };
+
+	u32 page{ 0 }, offset{ 0 };
+	for (u32 i = 0; i < term.count && p < end; ++i)
+	{
+		const auto pageDelta{ getVarint(p, end) };
+		const auto value{ getVarint(p, end) };
+		page  += pageDelta;
+		offset = (pageDelta == 0) ? (offset + value) : value;
+		fn(page, offset);
+	}
+}
+
+[[nodiscard]] wchar_t pdfv::TextIndex::s_fold(wchar_t c) noexcept
+{
+	return TextMatcher::s_fold(c, {});
+}
+[[nodiscard]] bool pdfv::TextIndex::s_isWordChar(wchar_t c) noexcept
+{
+	// Surrogates are kept together with their word
+	return std::iswalnum(std::wint_t(c)) || c == L'_' || (c >= 0xD800 && c <= 0xDFFF);
+}
+
+[[nodiscard]] std::shared_ptr<const pdfv::TextIndex> pdfv::TextIndex::open(u64 fingerprint) noexcept
+{
+	DEBUGPRINT("pdfv::TextIndex::open(%llx)\n", static_cast<unsigned long long>(fingerprint));
+
+	try
+	{
+		auto path{ s_path(fingerprint) };
+		if (path.empty())
+		{
+			return nullptr;
+		}
+		auto index{ std::make_shared<TextIndex>() };
+		if (!index->map(path, fingerprint))
+		{
+			return nullptr;
+		}
+		return index;
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+[[nodiscard]] bool pdfv::TextIndex::exists(u64 fingerprint) noexcept
+{
+	try
+	{
+		auto path{ s_path(fingerprint) };
+		return !path.empty() && ::GetFileAttributesW(path.c_str()) != INVALID_FILE_ATTRIBUTES;
+	}
+	catch (...)
+	{
+		return false;
+	}
+}
+bool pdfv::TextIndex::build(
+	u64 fingerprint, const u8 * data, std::size_t length, const std::atomic<bool> & cancel
+) noexcept
+{
+	DEBUGPRINT("pdfv::TextIndex::build(%llx, %p, %zu)\n", static_cast<unsigned long long>(fingerprint), static_cast<const void *>(data), length);
+
+	FPDF_DOCUMENT doc{ nullptr };
+	try
+	{
+		auto path{ s_path(fingerprint) };
+		if (path.empty()) [[unlikely]]
+		{
+			return false;
+		}
+
+		std::size_t numPages{ 0 };
+		{
+			auto lock{ Pdfium::lock() };
+			// Text of documents that need a password isn't written to disk in plain text
+			doc = FPDF_LoadMemDocument(data, int(length), nullptr);
+			if (doc == nullptr) [[unlikely]]
+			{
+				return false;
+			}
+			numPages = std::size_t(FPDF_GetPageCount(doc));
+		}
+
+		std::unordered_map<std::wstring, TermBuild, TermHash, std::equal_to<>> terms;
+		TextLayer layer;
+		std::wstring folded;
+		std::vector<u32> map;
+		for (std::size_t page = 1; page <= numPages; ++page)
+		{
+			if (cancel)
+			{
+				auto lock{ Pdfium::lock() };
+				FPDF_CloseDocument(doc);
+				return false;
+			}
+
+			// Only code points are needed, folding follows the matcher exactly
+			layer.codepoints.clear();
+			{
+				auto lock{ Pdfium::lock() };
+				auto fpage{ FPDF_LoadPage(doc, int(page - 1)) };
+				if (fpage == nullptr) [[unlikely]]
+				{
+					continue;
+				}
+				if (auto tpage{ FPDFText_LoadPage(fpage) }; tpage != nullptr) [[likely]]
+				{
+					const auto numChars{ std::max(FPDFText_CountChars(tpage), 0) };
+					layer.codepoints.resize(std::size_t(numChars));
+					for (int i = 0; i < numChars; ++i)
+					{
+						layer.codepoints[std::size_t(i)] = FPDFText_GetUnicode(tpage, i);
+					}
+					FPDFText_ClosePage(tpage);
+				}
+				FPDF_ClosePage(fpage);
+			}
+
+			TextMatcher::s_foldText(layer, {}, folded, map);
+			tokenize(folded, [&terms, &map, page](std::wstring_view word, std::size_t offset)
+			{
+				auto it{ terms.find(word) };
+				if (it == terms.end())
+				{
+					it = terms.emplace(std::wstring(word), TermBuild{}).first;
+				}
+				// Postings hold character indices, hits are only exact if the units are the characters
+				const auto first{ map[offset] };
+				for (std::size_t k = 1; k < word.size() && it->second.exact; ++k)
+				{
+					it->second.exact = map[offset + k] == first + k;
+				}
+				it->second.add(u32(page), first);
+			});
+		}
+
+		{
+			auto lock{ Pdfium::lock() };
+			FPDF_CloseDocument(doc);
+			doc = nullptr;
+		}
+
+		// Lay out the file
+		std::vector<const decltype(terms)::value_type *> sorted;
+		sorted.reserve(terms.size());
+		std::size_t numTermChars{ 0 }, numPostingBytes{ 0 };
+		for (const auto & entry : terms)
+		{
+			sorted.emplace_back(&entry);
+			numTermChars    += entry.first.size();
+			numPostingBytes += entry.second.bytes.size();
+		}
+		std::sort(sorted.begin(), sorted.end(), [](auto lhs, auto rhs) { return lhs->first < rhs->first; });
+
+		Header header{
+			.magic          = s_cMagic,
+			.version        = s_cVersion,
+			.fingerprint    = fingerprint,
+			.numPages       = u32(numPages),
+			.numTerms       = u32(sorted.size()),
+			.termsOffset    = sizeof(Header),
+			.charsOffset    = sizeof(Header) + sorted.size() * sizeof(Term),
+			.postingsOffset = 0,
+			.fileSize       = 0
+		};
+		header.postingsOffset = header.charsOffset + numTermChars * sizeof(wchar_t);
+		header.fileSize       = header.postingsOffset + numPostingBytes;
+
+		std::vector<u8> file(header.fileSize);
+		std::memcpy(file.data(), &header, sizeof header);
+		u32 charPos{ 0 };
+		u64 postingPos{ 0 };
+		for (std::size_t i = 0; i < sorted.size(); ++i)
+		{
+			const auto & [word, build] { *sorted[i] };
+			Term term{
+				.charsOffset    = charPos,
+				.length         = u32(word.size()) | (build.exact ? 0 : Term::s_cInexact),
+				.count          = build.count,
+				.postingsLength = u32(build.bytes.size()),
+				.postingsOffset = postingPos
+			};
+			std::memcpy(file.data() + header.termsOffset + i * sizeof(Term), &term, sizeof term);
+			std::memcpy(file.data() + header.charsOffset + charPos * sizeof(wchar_t), word.data(), word.size() * sizeof(wchar_t));
+			std::memcpy(file.data() + header.postingsOffset + postingPos, build.bytes.data(), build.bytes.size());
+			charPos    += u32(word.size());
+			postingPos += build.bytes.size();
+		}
+		terms.clear();
+
+		if (!writeCacheFile(path, file.data(), file.size())) [[unlikely]]
+		{
+			return false;
+		}
+
+		DEBUGPRINT("Indexed %zu pages, %u terms, %llu bytes\n", numPages, header.numTerms, static_cast<unsigned long long>(header.fileSize));
+		pruneCacheDir(path.substr(0, path.find_last_of(L'\\') + 1), L"*.idx", s_cMaxFiles);
+		return true;
+	}
+	catch (...)
+	{
+		if (doc != nullptr)
+		{
+			auto lock{ Pdfium::lock() };
+			FPDF_CloseDocument(doc);
+		}
+		return false;
+	}
+}
+
+[[nodiscard]] pdfv::u64 pdfv::TextIndex::fingerprint() const noexcept
+{
+	return this->m_header->fingerprint;
+}
+[[nodiscard]] std::size_t pdfv::TextIndex::numPages() const noexcept
+{
+	return this->m_header->numPages;
+}
+[[nodiscard]] std::size_t pdfv::TextIndex::numTerms() const noexcept
+{
+	return this->m_header->numTerms;
+}
+
+pdfv::TextIndex::Result pdfv::TextIndex::lookup(
+	std::wstring_view query, std::vector<SearchHit> & hits, std::vector<std::size_t> & pages
+) const
+{
+	DEBUGPRINT("pdfv::TextIndex::lookup(%p)\n", static_cast<const void *>(query.data()));
+
+	std::vector<std::wstring> words;
+	const auto folded{ foldQuery(query) };
+	tokenize(folded, [&words](std::wstring_view word, std::size_t)
+	{
+		words.emplace_back(word);
+	});
+	if (words.empty())
+	{
+		return Result::unusable;
+	}
+
+	const auto numTerms{ this->m_header->numTerms };
+
+	// Single word, every occurrence lies inside one indexed word
+	if (words.size() == 1 && words.front().size() == folded.size())
+	{
+		const auto & word{ words.front() };
+		std::vector<std::size_t> positions;
+		bool exact{ true };
+		for (u32 i = 0; i < numTerms; ++i)
+		{
+			const auto & term{ this->m_terms[i] };
+			const auto text{ this->termText(term) };
+
+			positions.clear();
+			for (auto pos{ text.find(word) }; pos != std::wstring_view::npos; pos = text.find(word, pos + word.size()))
+			{
+				positions.emplace_back(pos);
+			}
+			if (positions.empty())
+			{
+				continue;
+			}
+			exact = exact && !(term.length & Term::s_cInexact);
+			this->decode(term, [&hits, &pages, &positions, &word](u32 page, u32 offset)
+			{
+				for (auto pos : positions)
+				{
+					hits.push_back({ .page = page, .index = int(offset + pos), .count = int(word.size()) });
+				}
+				pages.emplace_back(page);
+			});
+		}
+		if (exact)
+		{
+			pages.clear();
+			return Result::hits;
+		}
+
+		// Positions inside words with dropped marks or surrogates are left to the matcher
+		hits.clear();
+		std::sort(pages.begin(), pages.end());
+		pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+		return Result::pages;
+	}
+
+	// Pages containing every word of the query
+	std::vector<u8> present(this->m_header->numPages + 1, 0);
+	std::vector<u8> seen(present.size());
+	for (std::size_t w = 0; w < words.size(); ++w)
+	{
+		std::fill(seen.begin(), seen.end(), u8(0));
+		for (u32 i = 0; i < numTerms; ++i)
+		{
+			const auto & term{ this->m_terms[i] };
+			if (this->termText(term).find(words[w]) == std::wstring_view::npos)
+			{
+				continue;
+			}
+			this->decode(term, [&seen](u32 page, u32)
+			{
+				if (page < seen.size()) [[likely]]
+				{
+					seen[page] = 1;
+				}
+			});
+		}
+		for (std::size_t p = 1; p < present.size(); ++p)
+		{
+			present[p] = (w == 0) ? seen[p] : u8(present[p] & seen[p]);
+		}
+	}
+	for (std::size_t p = 1; p < present.size(); ++p)
+	{
+		if (present[p])
+		{
+			pages.emplace_back(p);
+		}
+	}
+	return Result::pages;
+}
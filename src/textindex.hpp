@@ -0,0 +1,174 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pdfv
+{
+	struct SearchHit;
+
+	/**
+	 * @brief Persistent inverted index of document's text, stored per document fingerprint
+	 * in the cache directory and memory-mapped when used. Maps every word (case-folded)
+	 * to its occurrences as delta-coded variable-length (page, character offset) postings
+	 * 
+	 * File layout: header, term table sorted by term, term characters, postings
+	 * 
+	 */
+	class TextIndex
+	{
+	public:
+		static constexpr u32 s_cMagic  { 0x58495650 };	// "PVIX"
+		static constexpr u32 s_cVersion{ 3 };
+		/**
+		 * @brief Maximum number of index files kept in the cache, least recently built
+		 * ones are removed first
+		 * 
+		 */
+		static constexpr std::size_t s_cMaxFiles{ 256 };
+
+		/**
+		 * @brief Outcome of an index lookup
+		 * 
+		 */
+		enum class Result
+		{
+			// Query can't be answered from the index
+			unusable,
+			// All hits were produced by the index
+			hits,
+			// Index narrowed down the pages that may contain hits
+			pages
+		};
+
+	private:
+		struct Header
+		{
+			u32 magic;
+			u32 version;
+			u64 fingerprint;
+			u32 numPages;
+			u32 numTerms;
+			u64 termsOffset;
+			u64 charsOffset;
+			u64 postingsOffset;
+			u64 fileSize;
+		};
+		struct Term
+		{
+			/**
+			 * @brief Flag in length, set if some occurrence has units that aren't characters
+			 * of their own, e.g. surrogates or dropped combining marks, so that positions
+			 * inside the term can't be derived from the folded text
+			 * 
+			 */
+			static constexpr u32 s_cInexact{ 0x80000000 };
+
+			u32 charsOffset;
+			u32 length;
+			u32 count;
+			u32 postingsLength;
+			u64 postingsOffset;
+		};
+		static_assert(sizeof(Header) == 56);
+		static_assert(sizeof(Term) == 24);
+
+		HANDLE m_file{ INVALID_HANDLE_VALUE }, m_mapping{ nullptr };
+		const u8 * m_view{ nullptr };
+		std::size_t m_size{ 0 };
+
+		const Header * m_header{ nullptr };
+		const Term * m_terms{ nullptr };
+		const wchar_t * m_chars{ nullptr };
+		const u8 * m_postings{ nullptr };
+
+		/**
+		 * @brief Maps the index file to memory, validates its structure
+		 * 
+		 * @param path Index file path
+		 * @param fingerprint Expected document fingerprint
+		 * @return true Success
+		 */
+		bool map(const std::wstring & path, u64 fingerprint) noexcept;
+
+		/**
+		 * @param fingerprint Document fingerprint
+		 * @return std::wstring Path of the index file, empty if cache directory is not available
+		 */
+		[[nodiscard]] static std::wstring s_path(u64 fingerprint);
+		[[nodiscard]] std::wstring_view termText(const Term & term) const noexcept;
+		/**
+		 * @brief Decodes postings of a term
+		 * 
+		 * @tparam Fn Callable with signature void(u32 page, u32 offset)
+		 */
+		template<typename Fn>
+		void decode(const Term & term, Fn && fn) const noexcept;
+
+	public:
+		TextIndex() noexcept = default;
+		TextIndex(const TextIndex & other) = delete;
+		TextIndex(TextIndex && other) noexcept = delete;
+		TextIndex & operator=(const TextIndex & other) = delete;
+		TextIndex & operator=(TextIndex && other) noexcept = delete;
+		~TextIndex() noexcept;
+
+		/**
+		 * @brief Folds a character the same way for indexing and querying, case and
+		 * diacritics are folded like with the default search options
+		 * 
+		 */
+		[[nodiscard]] static wchar_t s_fold(wchar_t c) noexcept;
+		/**
+		 * @return true Character is a part of a word
+		 */
+		[[nodiscard]] static bool s_isWordChar(wchar_t c) noexcept;
+
+		/**
+		 * @brief Opens the index of a document if it exists
+		 * 
+		 * @param fingerprint Document fingerprint
+		 * @return std::shared_ptr<const TextIndex> Index, nullptr if it doesn't exist or is invalid
+		 */
+		[[nodiscard]] static std::shared_ptr<const TextIndex> open(u64 fingerprint) noexcept;
+		/**
+		 * @param fingerprint Document fingerprint
+		 * @return true Index of the document exists
+		 */
+		[[nodiscard]] static bool exists(u64 fingerprint) noexcept;
+		/**
+		 * @brief Builds the index of a document, extracts text of every page. Holds the library
+		 * lock only for one page at a time. Documents that need a password aren't indexed
+		 * 
+		 * @param fingerprint Document fingerprint
+		 * @param data Pointer to PDF file contents
+		 * @param length Length of the contents
+		 * @param cancel Reference to flag, building is abandoned when the flag is set
+		 * @return true Index was written
+		 */
+		static bool build(
+			u64 fingerprint, const u8 * data, std::size_t length, const std::atomic<bool> & cancel
+		) noexcept;
+
+		[[nodiscard]] u64 fingerprint() const noexcept;
+		[[nodiscard]] std::size_t numPages() const noexcept;
+		[[nodiscard]] std::size_t numTerms() const noexcept;
+
+		/**
+		 * @brief Answers a search query. Queries consisting of a single word are answered
+		 * directly, others narrow down the pages containing all words of the query
+		 * 
+		 * @param query Search query
+		 * @param hits Reference to vector of hits, receives the hits, if Result::hits is returned
+		 * @param pages Reference to vector of pages, receives ascending page numbers,
+		 * if Result::pages is returned
+		 * @return Result Outcome of the lookup
+		 */
+		Result lookup(std::wstring_view query, std::vector<SearchHit> & hits, std::vector<std::size_t> & pages) const;
+	};
+}
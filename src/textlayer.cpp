@@ -0,0 +1,264 @@
+#include "textlayer.hpp"
+#include "lib.hpp"
+#include "governor.hpp"
+#include <fpdf_text.h>
+
+#include <algorithm>
+#include <chrono>
+
+[[nodiscard]] std::size_t pdfv::TextLayer::bytes() const noexcept
+{
+	return sizeof(TextLayer) +
+		this->codepoints.capacity() * sizeof(u32) +
+		(this->left.capacity() + this->right.capacity() + this->bottom.capacity() + this->top.capacity()) * sizeof(f32) +
+		this->fontSize.capacity() * sizeof(f32) +
+		(this->line.capacity() + this->lineStart.capacity()) * sizeof(u32) +
+		this->grid.bytes() + this->layout.bytes();
+}
+[[nodiscard]] std::wstring pdfv::TextLayer::text(std::size_t first, std::size_t count) const
+{
+	std::wstring out;
+	if (first >= this->size())
+	{
+		return out;
+	}
+	count = std::min(count, this->size() - first);
+	out.reserve(count);
+
+	for (std::size_t i = first; i < first + count; ++i)
+	{
+		auto cp{ this->codepoints[i] };
+		if (cp >= 0x10000 && cp <= 0x10FFFF)
+		{
+			cp -= 0x10000;
+			out.push_back(wchar_t(0xD800 + (cp >> 10)));
+			out.push_back(wchar_t(0xDC00 + (cp & 0x3FF)));
+		}
+		else if (cp != 0)
+		{
+			out.push_back(wchar_t(cp));
+		}
+	}
+	return out;
+}
+[[nodiscard]] std::wstring pdfv::TextLayer::text(const std::vector<u32> & chars) const
+{
+	return this->layout.text(*this, chars);
+}
+[[nodiscard]] std::shared_ptr<pdfv::TextLayer> pdfv::TextLayer::s_extract(FPDF_PAGE page)
+{
+	DEBUGPRINT("pdfv::TextLayer::s_extract(%p)\n", static_cast<void *>(page));
+
+	auto tpage{ FPDFText_LoadPage(page) };
+	if (tpage == nullptr) [[unlikely]]
+	{
+		return nullptr;
+	}
+
+	auto layer{ std::make_shared<TextLayer>() };
+	layer->pageWidth  = f32(FPDF_GetPageWidthF(page));
+	layer->pageHeight = f32(FPDF_GetPageHeightF(page));
+
+	const auto count{ std::size_t(std::max(FPDFText_CountChars(tpage), 0)) };
+	layer->codepoints.resize(count);
+	layer->left.resize(count);
+	layer->right.resize(count);
+	layer->bottom.resize(count);
+	layer->top.resize(count);
+	layer->fontSize.resize(count);
+	layer->line.resize(count);
+
+	// Lines are split after explicit line breaks or when a glyph doesn't vertically overlap the current line
+	f32 lineBottom{ 0.0f }, lineTop{ 0.0f };
+	bool lineHasBox{ false };
+	u32 curLine{ 0 };
+	layer->lineStart.emplace_back(0);
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const auto idx{ int(i) };
+		layer->codepoints[i] = FPDFText_GetUnicode(tpage, idx);
+		layer->fontSize[i]   = f32(FPDFText_GetFontSize(tpage, idx));
+
+		FS_RECTF r{};
+		if (FPDFText_GetLooseCharBox(tpage, idx, &r))
+		{
+			layer->left[i]   = r.left;
+			layer->right[i]  = r.right;
+			layer->bottom[i] = r.bottom;
+			layer->top[i]    = r.top;
+		}
+		const bool hasBox{ r.right > r.left && r.top > r.bottom };
+		const auto center{ (r.top + r.bottom) * 0.5f };
+
+		if (i > 0 && (layer->codepoints[i - 1] == L'\n' ||
+			(hasBox && lineHasBox && (center < lineBottom || center > lineTop))))
+		{
+			++curLine;
+			layer->lineStart.emplace_back(u32(i));
+			lineHasBox = false;
+		}
+		if (hasBox)
+		{
+			lineBottom = lineHasBox ? std::min(lineBottom, r.bottom) : r.bottom;
+			lineTop    = lineHasBox ? std::max(lineTop,    r.top)    : r.top;
+			lineHasBox = true;
+		}
+		layer->line[i] = curLine;
+	}
+	layer->lineStart.emplace_back(u32(count));
+
+	FPDFText_ClosePage(tpage);
+
+	layer->grid.build(*layer);
+	layer->layout.build(*layer);
+	return layer;
+}
+
+pdfv::TextLayerCache::TextLayerCache() noexcept
+{
+	try
+	{
+		this->m_governorId = MemoryGovernor::instance().add({
+			.category  = MemoryGovernor::Category::textLayers,
+			.used      = [this]() noexcept { return this->used(); },
+			.candidate = [this](MemoryGovernor::Candidate & cand) noexcept
+			{
+				std::lock_guard lock{ this->m_mutex };
+				if (this->m_lru.empty())
+				{
+					return false;
+				}
+				const auto & entry{ this->m_lru.back() };
+				cand = { .lastUse = entry.lastUse, .bytes = entry.layer->bytes(), .cost = entry.cost };
+				return true;
+			},
+			.evict     = [this]() noexcept
+			{
+				std::lock_guard lock{ this->m_mutex };
+				return this->evictOldest();
+			}
+		});
+	}
+	catch (...)
+	{
+	}
+}
+pdfv::TextLayerCache::~TextLayerCache() noexcept
+{
+	MemoryGovernor::instance().remove(this->m_governorId);
+}
+
+void pdfv::TextLayerCache::trim() noexcept
+{
+	while (this->m_used > this->m_budget && !this->m_lru.empty())
+	{
+		this->evictOldest();
+	}
+}
+std::size_t pdfv::TextLayerCache::evictOldest() noexcept
+{
+	if (this->m_lru.empty())
+	{
+		return 0;
+	}
+	auto & victim{ this->m_lru.back() };
+	const auto bytes{ victim.layer->bytes() };
+	this->m_used -= bytes;
+	this->m_map.erase(victim.key);
+	this->m_lru.pop_back();
+	return bytes;
+}
+
+[[nodiscard]] std::shared_ptr<const pdfv::TextLayer> pdfv::TextLayerCache::get(FPDF_DOCUMENT doc, u64 fingerprint, std::size_t page)
+{
+	{
+		std::lock_guard lock{ this->m_mutex };
+		if (auto it{ this->m_map.find({ fingerprint, page }) }; it != this->m_map.end())
+		{
+			++this->m_hits;
+			this->m_lru.splice(this->m_lru.begin(), this->m_lru, it->second);
+			it->second->lastUse = MemoryGovernor::s_now();
+			return it->second->layer;
+		}
+	}
+
+	// Never hold the cache mutex while waiting for the library lock
+	auto lock{ Pdfium::lock() };
+	auto fpage{ FPDF_LoadPage(doc, int(page - 1)) };
+	if (fpage == nullptr) [[unlikely]]
+	{
+		return nullptr;
+	}
+	auto layer{ this->get(fpage, fingerprint, page) };
+	FPDF_ClosePage(fpage);
+	return layer;
+}
+[[nodiscard]] std::shared_ptr<const pdfv::TextLayer> pdfv::TextLayerCache::get(FPDF_PAGE fpage, u64 fingerprint, std::size_t page)
+{
+	{
+		std::lock_guard lock{ this->m_mutex };
+		if (auto it{ this->m_map.find({ fingerprint, page }) }; it != this->m_map.end())
+		{
+			++this->m_hits;
+			this->m_lru.splice(this->m_lru.begin(), this->m_lru, it->second);
+			it->second->lastUse = MemoryGovernor::s_now();
+			return it->second->layer;
+		}
+	}
+
+	std::shared_ptr<const TextLayer> layer;
+	const auto before{ std::chrono::steady_clock::now() };
+	{
+		auto lock{ Pdfium::lock() };
+		layer = TextLayer::s_extract(fpage);
+	}
+	const auto cost{ u64(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - before).count()) };
+	if (layer == nullptr) [[unlikely]]
+	{
+		return nullptr;
+	}
+
+	std::lock_guard lock{ this->m_mutex };
+	++this->m_misses;
+	// Another thread might have extracted the same page in the meantime
+	if (auto it{ this->m_map.find({ fingerprint, page }) }; it != this->m_map.end())
+	{
+		return it->second->layer;
+	}
+	this->m_lru.emplace_front(EntryT{ Key{ fingerprint, page }, layer, MemoryGovernor::s_now(), cost });
+	this->m_map.emplace(Key{ fingerprint, page }, this->m_lru.begin());
+	this->m_used += layer->bytes();
+	this->trim();
+
+	DEBUGPRINT("Text layer cache: %zu bytes used, %zu hits, %zu misses\n", this->m_used, this->m_hits, this->m_misses);
+	return layer;
+}
+void pdfv::TextLayerCache::evict(u64 fingerprint) noexcept
+{
+	std::lock_guard lock{ this->m_mutex };
+	for (auto it{ this->m_lru.begin() }; it != this->m_lru.end();)
+	{
+		if (it->key.fingerprint == fingerprint)
+		{
+			this->m_used -= it->layer->bytes();
+			this->m_map.erase(it->key);
+			it = this->m_lru.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+void pdfv::TextLayerCache::setBudget(std::size_t bytes) noexcept
+{
+	std::lock_guard lock{ this->m_mutex };
+	this->m_budget = bytes;
+	this->trim();
+}
+[[nodiscard]] std::size_t pdfv::TextLayerCache::used() const noexcept
+{
+	std::lock_guard lock{ this->m_mutex };
+	return this->m_used;
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "common.hpp"
+#include "chargrid.hpp"
+#include "layout.hpp"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pdfv
+{
+	/**
+	 * @brief Characters of a single page in structure-of-arrays layout, extracted once
+	 * per page. Boxes are in page coordinates, origin at the bottom-left corner
+	 * 
+	 */
+	struct TextLayer
+	{
+		std::vector<u32> codepoints;
+		std::vector<f32> left, right, bottom, top;
+		std::vector<f32> fontSize;
+		/**
+		 * @brief Line index of each character
+		 * 
+		 */
+		std::vector<u32> line;
+		/**
+		 * @brief Index of the first character of each line, followed by the total character count
+		 * 
+		 */
+		std::vector<u32> lineStart;
+		f32 pageWidth{ 0.0f }, pageHeight{ 0.0f };
+		/**
+		 * @brief Spatial index of the character boxes for point and rectangle queries
+		 * 
+		 */
+		CharGrid grid;
+		/**
+		 * @brief Reading-order segmentation of the characters into words, lines and blocks
+		 * 
+		 */
+		TextLayout layout;
+
+		/**
+		 * @return std::size_t Number of characters on the page
+		 */
+		[[nodiscard]] std::size_t size() const noexcept
+		{
+			return this->codepoints.size();
+		}
+		/**
+		 * @return std::size_t Number of lines on the page
+		 */
+		[[nodiscard]] std::size_t lines() const noexcept
+		{
+			return this->lineStart.empty() ? 0 : this->lineStart.size() - 1;
+		}
+		/**
+		 * @return std::size_t Approximate memory usage in bytes
+		 */
+		[[nodiscard]] std::size_t bytes() const noexcept;
+		/**
+		 * @brief Converts a range of characters to UTF-16 text
+		 * 
+		 * @param first Index of the first character
+		 * @param count Number of characters
+		 * @return std::wstring Text
+		 */
+		[[nodiscard]] std::wstring text(std::size_t first, std::size_t count) const;
+		/**
+		 * @brief Converts a set of characters to UTF-16 text in reading order, words are
+		 * separated by spaces, lines by line breaks and blocks by empty lines
+		 * 
+		 * @param chars Character indices
+		 * @return std::wstring Text
+		 */
+		[[nodiscard]] std::wstring text(const std::vector<u32> & chars) const;
+
+		/**
+		 * @brief Extracts characters of a page, caller has to hold the library lock
+		 * 
+		 * @param page Page handle
+		 * @return std::shared_ptr<TextLayer> Text layer, nullptr on failure
+		 */
+		[[nodiscard]] static std::shared_ptr<TextLayer> s_extract(FPDF_PAGE page);
+	};
+
+	/**
+	 * @brief Least-recently-used cache of text layers, bounded by memory budget. Keyed by
+	 * document fingerprint, so all handles of the same document share the entries
+	 * 
+	 */
+	class TextLayerCache
+	{
+	public:
+		static constexpr std::size_t s_cDefaultBudget{ 64 * 1024 * 1024 };
+
+	private:
+		struct Key
+		{
+			u64 fingerprint;
+			std::size_t page;
+
+			[[nodiscard]] constexpr bool operator==(const Key & rhs) const noexcept = default;
+		};
+		struct KeyHash
+		{
+			[[nodiscard]] std::size_t operator()(const Key & key) const noexcept
+			{
+				return std::size_t(key.fingerprint ^ (u64(key.page) * 0x9E3779B97F4A7C15ULL));
+			}
+		};
+		struct EntryT
+		{
+			Key key;
+			std::shared_ptr<const TextLayer> layer;
+			/**
+			 * @brief Tick count of the last use and extraction time in microseconds
+			 * 
+			 */
+			u64 lastUse{ 0 }, cost{ 0 };
+		};
+
+		mutable std::mutex m_mutex;
+		std::list<EntryT> m_lru;
+		std::unordered_map<Key, std::list<EntryT>::iterator, KeyHash> m_map;
+		std::size_t m_budget{ s_cDefaultBudget };
+		std::size_t m_used{ 0 };
+		std::size_t m_hits{ 0 }, m_misses{ 0 };
+		u64 m_governorId{ 0 };
+
+		/**
+		 * @brief Removes least recently used entries until the usage fits the budget,
+		 * caller has to hold the mutex
+		 * 
+		 */
+		void trim() noexcept;
+		/**
+		 * @brief Removes the least recently used entry, caller has to hold the mutex
+		 * 
+		 * @return std::size_t Bytes released
+		 */
+		std::size_t evictOldest() noexcept;
+
+	public:
+		/**
+		 * @brief Registers the cache with the memory governor, which may drop entries below
+		 * the cache's own budget
+		 * 
+		 */
+		TextLayerCache() noexcept;
+		TextLayerCache(const TextLayerCache & other) = delete;
+		TextLayerCache(TextLayerCache && other) noexcept = delete;
+		TextLayerCache & operator=(const TextLayerCache & other) = delete;
+		TextLayerCache & operator=(TextLayerCache && other) noexcept = delete;
+		~TextLayerCache() noexcept;
+
+		/**
+		 * @brief Returns the text layer of a page, extracts it on a cache miss
+		 * 
+		 * @param doc Document handle
+		 * @param fingerprint Document fingerprint
+		 * @param page Page number, starting from 1
+		 * @return std::shared_ptr<const TextLayer> Text layer, nullptr on failure
+		 */
+		[[nodiscard]] std::shared_ptr<const TextLayer> get(FPDF_DOCUMENT doc, u64 fingerprint, std::size_t page);
+		/**
+		 * @brief Returns the text layer of a page, extracts it on a cache miss
+		 * 
+		 * @param fpage Already loaded page handle
+		 * @param fingerprint Document fingerprint
+		 * @param page Page number, starting from 1
+		 * @return std::shared_ptr<const TextLayer> Text layer, nullptr on failure
+		 */
+		[[nodiscard]] std::shared_ptr<const TextLayer> get(FPDF_PAGE fpage, u64 fingerprint, std::size_t page);
+		/**
+		 * @brief Removes all layers of a document
+		 * 
+		 * @param fingerprint Document fingerprint
+		 */
+		void evict(u64 fingerprint) noexcept;
+		/**
+		 * @brief Sets a new memory budget, trims the cache if necessary
+		 * 
+		 * @param bytes Budget in bytes
+		 */
+		void setBudget(std::size_t bytes) noexcept;
+		/**
+		 * @return std::size_t Memory currently used by cached layers
+		 */
+		[[nodiscard]] std::size_t used() const noexcept;
+	};
+}
@@ -0,0 +1,291 @@
+#include "textmatch.hpp"
+#include "textlayer.hpp"
+#include "search.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+	#include <immintrin.h>
+	#define PDFV_HAS_SSE2_PATH 1
+#else
+	#define PDFV_HAS_SSE2_PATH 0
+#endif
+
+namespace pdfv
+{
+	/**
+	 * @brief Per code unit folding tables of the Basic Multilingual Plane, built on first use
+	 * 
+	 */
+	struct FoldTables
+	{
+		static constexpr std::size_t s_cSize{ 0x10000 };
+
+		wchar_t lower[s_cSize];
+		/**
+		 * @brief Base letter of every code unit, 0 for combining marks
+		 * 
+		 */
+		wchar_t base[s_cSize];
+
+		FoldTables() noexcept
+		{
+			for (std::size_t i = 0; i < s_cSize; ++i)
+			{
+				this->lower[i] = wchar_t(i);
+				this->base[i]  = wchar_t(i);
+			}
+
+			// Surrogates are mapped separately, so that they aren't paired up
+			auto mapLower{ [this](std::size_t first, std::size_t last) noexcept
+			{
+				const auto len{ int(last - first) };
+				if (::LCMapStringEx(
+					LOCALE_NAME_INVARIANT, LCMAP_LOWERCASE,
+					this->base + first, len, this->lower + first, len,
+					nullptr, nullptr, 0
+				) != len) [[unlikely]]
+				{
+					std::copy(this->base + first, this->base + last, this->lower + first);
+				}
+			} };
+			mapLower(1, 0xD800);
+			mapLower(0xE000, s_cSize);
+
+			std::vector<WORD> types(s_cSize);
+			if (!::GetStringTypeW(CT_CTYPE3, this->base, int(s_cSize), types.data())) [[unlikely]]
+			{
+				return;
+			}
+			for (std::size_t i = 0xC0; i < s_cSize; ++i)
+			{
+				if (i >= 0xD800 && i < 0xE000)
+				{
+					continue;
+				}
+				if (types[i] & C3_NONSPACING)
+				{
+					this->base[i] = L'\0';
+					continue;
+				}
+
+				// Decomposes to a base letter followed only by combining marks
+				const wchar_t c{ wchar_t(i) };
+				wchar_t out[8];
+				const auto len{ ::FoldStringW(MAP_COMPOSITE, &c, 1, out, 8) };
+				if (len < 2 || out[0] == c)
+				{
+					continue;
+				}
+				WORD outTypes[8]{};
+				if (::GetStringTypeW(CT_CTYPE3, out + 1, len - 1, outTypes) &&
+					std::all_of(outTypes, outTypes + len - 1, [](WORD t) noexcept { return (t & C3_NONSPACING) != 0; }))
+				{
+					this->base[i] = out[0];
+				}
+			}
+		}
+	};
+
+	[[nodiscard]] static const FoldTables & foldTables() noexcept
+	{
+		static const auto s_tables{ std::make_unique<const FoldTables>() };
+		return *s_tables;
+	}
+
+	[[nodiscard]] static std::size_t findScalar(
+		const wchar_t * hay, std::size_t lastStart, const wchar_t * needle, std::size_t m, std::size_t i
+	) noexcept
+	{
+		for (; i <= lastStart; ++i)
+		{
+			if (hay[i] == needle[0] && hay[i + m - 1] == needle[m - 1] &&
+				(m <= 2 || std::equal(needle + 1, needle + m - 1, hay + i + 1)))
+			{
+				return i;
+			}
+		}
+		return std::wstring_view::npos;
+	}
+
+#if PDFV_HAS_SSE2_PATH
+	/**
+	 * @brief Compares the first and the last needle unit against 8 candidate positions
+	 * at once, only candidates matching both are verified
+	 * 
+	 */
+	[[gnu::target("sse2")]] [[nodiscard]] static std::size_t findSse2(
+		const wchar_t * hay, std::size_t lastStart, const wchar_t * needle, std::size_t m, std::size_t i
+	) noexcept
+	{
+		static_assert(sizeof(wchar_t) == sizeof(u16));
+
+		const auto first{ _mm_set1_epi16(short(needle[0])) };
+		const auto last { _mm_set1_epi16(short(needle[m - 1])) };
+		for (; i + 8 <= lastStart + 1; i += 8)
+		{
+			const auto a{ _mm_loadu_si128(reinterpret_cast<const __m128i *>(hay + i)) };
+			const auto b{ _mm_loadu_si128(reinterpret_cast<const __m128i *>(hay + i + m - 1)) };
+			auto mask{ unsigned(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi16(a, first), _mm_cmpeq_epi16(b, last)))) };
+			while (mask != 0)
+			{
+				const auto bit{ unsigned(std::countr_zero(mask)) };
+				const auto pos{ i + bit / 2 };
+				if (m <= 2 || std::equal(needle + 1, needle + m - 1, hay + pos + 1))
+				{
+					return pos;
+				}
+				// Both bytes of the 16-bit lane are set
+				mask &= ~(3U << bit);
+			}
+		}
+		return findScalar(hay, lastStart, needle, m, i);
+	}
+#endif
+}
+
+[[nodiscard]] wchar_t pdfv::TextMatcher::s_fold(wchar_t c, const Options & options) noexcept
+{
+	if (options.matchCase && options.matchDiacritics)
+	{
+		return c;
+	}
+	const auto & tables{ foldTables() };
+	if (!options.matchDiacritics)
+	{
+		c = tables.base[u16(c)];
+	}
+	if (!options.matchCase)
+	{
+		c = tables.lower[u16(c)];
+	}
+	return c;
+}
+void pdfv::TextMatcher::s_foldText(
+	const TextLayer & layer, const Options & options,
+	std::wstring & text, std::vector<u32> & map
+)
+{
+	text.clear();
+	map.clear();
+	text.reserve(layer.size());
+	map.reserve(layer.size());
+
+	auto push{ [&text, &map](wchar_t c, std::size_t idx)
+	{
+		text.push_back(c);
+		map.push_back(u32(idx));
+	} };
+	for (std::size_t i = 0; i < layer.size(); ++i)
+	{
+		auto cp{ layer.codepoints[i] };
+		if (cp >= 0x10000 && cp <= 0x10FFFF)
+		{
+			// Characters outside of the Basic Multilingual Plane are matched as they are
+			cp -= 0x10000;
+			push(wchar_t(0xD800 + (cp >> 10)), i);
+			push(wchar_t(0xDC00 + (cp & 0x3FF)), i);
+		}
+		else if (cp != 0 && cp < 0x10000)
+		{
+			if (auto c{ s_fold(wchar_t(cp), options) }; c != L'\0')
+			{
+				push(c, i);
+			}
+		}
+	}
+}
+[[nodiscard]] std::size_t pdfv::TextMatcher::s_find(std::wstring_view haystack, std::wstring_view needle, std::size_t from) noexcept
+{
+	const auto m{ needle.size() };
+	if (m == 0 || haystack.size() < m || from > haystack.size() - m)
+	{
+		return std::wstring_view::npos;
+	}
+	const auto lastStart{ haystack.size() - m };
+
+#if PDFV_HAS_SSE2_PATH
+	static const bool s_sse2{ __builtin_cpu_supports("sse2") != 0 };
+	if (s_sse2) [[likely]]
+	{
+		return findSse2(haystack.data(), lastStart, needle.data(), m, from);
+	}
+#endif
+	return findScalar(haystack.data(), lastStart, needle.data(), m, from);
+}
+
+bool pdfv::TextMatcher::compile(std::wstring_view query, const Options & options)
+{
+	DEBUGPRINT("pdfv::TextMatcher::compile(%p, %u)\n", static_cast<const void *>(query.data()), options.pack());
+
+	this->m_options = options;
+	this->m_needle.clear();
+	this->m_regex.reset();
+
+	// Escaped characters keep their meaning, e.g. \W must not turn into \w
+	bool escaped{ false };
+	for (auto c : query)
+	{
+		auto folded{ escaped ? c : s_fold(c, options) };
+		if (folded != L'\0')
+		{
+			this->m_needle.push_back(folded);
+		}
+		escaped = options.regex && !escaped && c == L'\\';
+	}
+	if (this->m_needle.empty())
+	{
+		return false;
+	}
+
+	if (options.regex)
+	{
+		try
+		{
+			this->m_regex = std::make_unique<std::wregex>(this->m_needle, std::regex_constants::ECMAScript | std::regex_constants::optimize);
+		}
+		catch (const std::regex_error &)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+std::size_t pdfv::TextMatcher::find(const TextLayer & layer, std::size_t page, std::vector<SearchHit> & hits) const
+{
+	thread_local std::wstring text;
+	thread_local std::vector<u32> map;
+	s_foldText(layer, this->m_options, text, map);
+
+	auto emit{ [&hits, page](std::size_t pos, std::size_t len)
+	{
+		hits.push_back({
+			.page  = page,
+			.index = int(map[pos]),
+			.count = int(map[pos + len - 1] - map[pos] + 1)
+		});
+	} };
+
+	if (this->m_regex != nullptr)
+	{
+		for (std::wcregex_iterator it{ text.data(), text.data() + text.size(), *this->m_regex }, end; it != end; ++it)
+		{
+			// Empty matches can't be highlighted
+			if (it->length() > 0)
+			{
+				emit(std::size_t(it->position()), std::size_t(it->length()));
+			}
+		}
+	}
+	else if (!this->m_needle.empty())
+	{
+		const std::wstring_view hay{ text };
+		for (auto pos{ s_find(hay, this->m_needle, 0) }; pos != std::wstring_view::npos; pos = s_find(hay, this->m_needle, pos + this->m_needle.size()))
+		{
+			emit(pos, this->m_needle.size());
+		}
+	}
+
+	return text.size() * sizeof(wchar_t);
+}
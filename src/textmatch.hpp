@@ -0,0 +1,116 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <memory>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pdfv
+{
+	struct SearchHit;
+	struct TextLayer;
+
+	/**
+	 * @brief Matches a search query against extracted page text. Text and query are folded
+	 * the same way before matching: case folding, diacritic folding (characters are reduced
+	 * to their base letters, combining marks are dropped), either of them can be turned off.
+	 * Literal queries are located with a vectorised first/last character prefilter, regular
+	 * expressions use ECMAScript syntax
+	 * 
+	 */
+	class TextMatcher
+	{
+	public:
+		struct Options
+		{
+			bool matchCase{ false };
+			bool matchDiacritics{ false };
+			bool regex{ false };
+
+			[[nodiscard]] constexpr bool operator==(const Options & rhs) const noexcept = default;
+
+			/**
+			 * @return u32 Options packed into bit flags
+			 */
+			[[nodiscard]] constexpr u32 pack() const noexcept
+			{
+				return u32(this->matchCase) | (u32(this->matchDiacritics) << 1) | (u32(this->regex) << 2);
+			}
+			[[nodiscard]] static constexpr Options s_unpack(u32 flags) noexcept
+			{
+				return { .matchCase = (flags & 1) != 0, .matchDiacritics = (flags & 2) != 0, .regex = (flags & 4) != 0 };
+			}
+		};
+
+	private:
+		Options m_options;
+		std::wstring m_needle;
+		std::unique_ptr<std::wregex> m_regex;
+
+	public:
+		TextMatcher() noexcept = default;
+		TextMatcher(const TextMatcher & other) = delete;
+		TextMatcher(TextMatcher && other) noexcept = default;
+		TextMatcher & operator=(const TextMatcher & other) = delete;
+		TextMatcher & operator=(TextMatcher && other) noexcept = default;
+		~TextMatcher() noexcept = default;
+
+		/**
+		 * @brief Folds a single UTF-16 code unit
+		 * 
+		 * @param c Code unit
+		 * @param options Folding options
+		 * @return wchar_t Folded code unit, 0 if the unit is dropped
+		 */
+		[[nodiscard]] static wchar_t s_fold(wchar_t c, const Options & options) noexcept;
+		/**
+		 * @brief Folds text of a page
+		 * 
+		 * @param layer Text layer
+		 * @param options Folding options
+		 * @param text Reference to string, receives the folded text
+		 * @param map Reference to vector, receives the character index of every folded code unit
+		 */
+		static void s_foldText(
+			const TextLayer & layer, const Options & options,
+			std::wstring & text, std::vector<u32> & map
+		);
+		/**
+		 * @brief Finds the first occurrence of a needle
+		 * 
+		 * @param haystack Text to be searched
+		 * @param needle Text to be found, not empty
+		 * @param from Position to start from
+		 * @return std::size_t Position of the occurrence, std::wstring_view::npos if not found
+		 */
+		[[nodiscard]] static std::size_t s_find(std::wstring_view haystack, std::wstring_view needle, std::size_t from) noexcept;
+
+		/**
+		 * @brief Prepares the matcher for a query
+		 * 
+		 * @param query Search query
+		 * @param options Matching options
+		 * @return true Success
+		 * @return false Query is empty after folding or is an invalid regular expression
+		 */
+		bool compile(std::wstring_view query, const Options & options);
+
+		[[nodiscard]] constexpr const Options & options() const noexcept
+		{
+			return this->m_options;
+		}
+
+		/**
+		 * @brief Finds all matches on a page, thread-safe
+		 * 
+		 * @param layer Text layer of the page
+		 * @param page Page number, starting from 1
+		 * @param hits Reference to vector of hits, receives the hits found
+		 * @return std::size_t Number of bytes of folded text scanned
+		 */
+		std::size_t find(const TextLayer & layer, std::size_t page, std::vector<SearchHit> & hits) const;
+	};
+}
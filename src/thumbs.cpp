@@ -0,0 +1,302 @@
+#include "thumbs.hpp"
+#include "lib.hpp"
+#include "governor.hpp"
+#include <fpdf_thumbnail.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	/**
+	 * @brief Fits a page of given size into a thumbnail cell, preserving its aspect ratio
+	 * 
+	 */
+	[[nodiscard]] pdfv::xy<pdfv::u16> fitCell(double width, double height) noexcept
+	{
+		if (!(width > 0.0 && height > 0.0)) [[unlikely]]
+		{
+			return { pdfv::u16(pdfv::Thumbnails::s_cWidth), pdfv::u16(pdfv::Thumbnails::s_cHeight) };
+		}
+		const auto scale{ std::min(pdfv::Thumbnails::s_cWidth / width, pdfv::Thumbnails::s_cHeight / height) };
+		return {
+			pdfv::u16(std::clamp(int(std::lround(width  * scale)), 1, pdfv::Thumbnails::s_cWidth)),
+			pdfv::u16(std::clamp(int(std::lround(height * scale)), 1, pdfv::Thumbnails::s_cHeight))
+		};
+	}
+}
+
+pdfv::Thumbnails::Thumbnails(DocRef doc, std::size_t numPages)
+	: m_doc(std::move(doc)), m_state(numPages, State::none), m_size(numPages),
+	m_atlases((numPages + s_cPerAtlas - 1) / s_cPerAtlas),
+	m_atlasUse(m_atlases.size()), m_atlasCost(m_atlases.size())
+{
+	this->m_governorId = MemoryGovernor::instance().add({
+		.category  = MemoryGovernor::Category::thumbnails,
+		.used      = [this]() noexcept { return this->bytes(); },
+		.candidate = [this](MemoryGovernor::Candidate & cand) noexcept
+		{
+			std::lock_guard lock{ this->m_mutex };
+			const auto idx{ this->oldestAtlas() };
+			if (idx == this->m_atlases.size())
+			{
+				return false;
+			}
+			cand = { .lastUse = this->m_atlasUse[idx], .bytes = s_cPerAtlas * s_cCellBytes, .cost = this->m_atlasCost[idx] };
+			return true;
+		},
+		.evict     = [this]() noexcept -> std::size_t
+		{
+			std::lock_guard lock{ this->m_mutex };
+			const auto idx{ this->oldestAtlas() };
+			if (idx == this->m_atlases.size())
+			{
+				return 0;
+			}
+			// Strip asks for the pages again when they're scrolled to
+			const auto first{ idx * s_cPerAtlas }, last{ std::min(first + s_cPerAtlas, this->m_state.size()) };
+			std::fill(this->m_state.begin() + ssize_t(first), this->m_state.begin() + ssize_t(last), State::none);
+			this->m_atlases[idx]   = nullptr;
+			this->m_atlasCost[idx] = 0;
+			return s_cPerAtlas * s_cCellBytes;
+		}
+	});
+}
+pdfv::Thumbnails::~Thumbnails() noexcept
+{
+	MemoryGovernor::instance().remove(this->m_governorId);
+}
+
+[[nodiscard]] std::size_t pdfv::Thumbnails::oldestAtlas() const noexcept
+{
+	auto best{ this->m_atlases.size() };
+	for (std::size_t idx = 0; idx < this->m_atlases.size(); ++idx)
+	{
+		if (this->m_atlases[idx] == nullptr || (best != this->m_atlases.size() && this->m_atlasUse[idx] >= this->m_atlasUse[best]))
+		{
+			continue;
+		}
+		const auto first{ idx * s_cPerAtlas }, last{ std::min(first + s_cPerAtlas, this->m_state.size()) };
+		if (std::find(this->m_state.begin() + ssize_t(first), this->m_state.begin() + ssize_t(last), State::queued) ==
+			this->m_state.begin() + ssize_t(last))
+		{
+			best = idx;
+		}
+	}
+	return best;
+}
+
+[[nodiscard]] std::size_t pdfv::Thumbnails::next()
+{
+	const auto last{ std::min(this->m_wantLast, this->m_state.size()) };
+	for (auto page{ std::max<std::size_t>(this->m_wantFirst, 1) }; page <= last; ++page)
+	{
+		if (this->m_state[page - 1] != State::none)
+		{
+			continue;
+		}
+		auto & atlas{ this->m_atlases[(page - 1) / s_cPerAtlas] };
+		if (atlas == nullptr)
+		{
+			atlas = std::make_unique<u8[]>(s_cPerAtlas * s_cCellBytes);
+		}
+		this->m_state[page - 1] = State::queued;
+		return page;
+	}
+	this->m_building = false;
+	return 0;
+}
+[[nodiscard]] bool pdfv::Thumbnails::s_embedded(FPDF_PAGE page, u8 * cell, xy<u16> & size) noexcept
+{
+	auto bmp{ FPDFPage_GetThumbnailAsBitmap(page) };
+	if (bmp == nullptr)
+	{
+		return false;
+	}
+
+	const auto format{ FPDFBitmap_GetFormat(bmp) };
+	const auto srcW{ FPDFBitmap_GetWidth(bmp) }, srcH{ FPDFBitmap_GetHeight(bmp) };
+	const auto srcStride{ FPDFBitmap_GetStride(bmp) };
+	const auto src{ static_cast<const u8 *>(FPDFBitmap_GetBuffer(bmp)) };
+	const auto bpp{ (format == FPDFBitmap_Gray) ? 1 : (format == FPDFBitmap_BGR) ? 3 : (format == FPDFBitmap_BGRx || format == FPDFBitmap_BGRA) ? 4 : 0 };
+	if (src == nullptr || bpp == 0 || srcW <= 0 || srcH <= 0) [[unlikely]]
+	{
+		FPDFBitmap_Destroy(bmp);
+		return false;
+	}
+
+	// Every cell pixel averages the block of source pixels it covers
+	size = fitCell(srcW, srcH);
+	for (int y = 0; y < size.y; ++y)
+	{
+		const auto y0{ y * srcH / size.y }, y1{ std::max((y + 1) * srcH / size.y, y0 + 1) };
+		auto out{ cell + std::size_t(y) * s_cStride };
+		for (int x = 0; x < size.x; ++x)
+		{
+			const auto x0{ x * srcW / size.x }, x1{ std::max((x + 1) * srcW / size.x, x0 + 1) };
+			unsigned sum[3]{};
+			for (auto sy{ y0 }; sy < y1; ++sy)
+			{
+				auto in{ src + ssize_t(sy) * srcStride + ssize_t(x0) * bpp };
+				for (auto sx{ x0 }; sx < x1; ++sx, in += bpp)
+				{
+					sum[0] += in[0];
+					sum[1] += in[(bpp == 1) ? 0 : 1];
+					sum[2] += in[(bpp == 1) ? 0 : 2];
+				}
+			}
+			const auto n{ unsigned((y1 - y0) * (x1 - x0)) };
+			*out++ = u8(sum[0] / n);
+			*out++ = u8(sum[1] / n);
+			*out++ = u8(sum[2] / n);
+		}
+	}
+
+	FPDFBitmap_Destroy(bmp);
+	return true;
+}
+[[nodiscard]] bool pdfv::Thumbnails::s_render(FPDF_PAGE page, u8 * cell, xy<u16> & size) noexcept
+{
+	size = fitCell(FPDF_GetPageWidthF(page), FPDF_GetPageHeightF(page));
+	// Renders straight into the atlas, no intermediate bitmap
+	auto bmp{ FPDFBitmap_CreateEx(size.x, size.y, FPDFBitmap_BGR, cell, int(s_cStride)) };
+	if (bmp == nullptr) [[unlikely]]
+	{
+		return false;
+	}
+	FPDFBitmap_FillRect(bmp, 0, 0, size.x, size.y, 0xFFFFFFFF);
+	FPDF_RenderPageBitmap(bmp, page, 0, 0, size.x, size.y, 0, 0);
+	FPDFBitmap_Destroy(bmp);
+	return true;
+}
+
+[[nodiscard]] bool pdfv::Thumbnails::want(std::size_t first, std::size_t last) noexcept
+{
+	std::lock_guard lock{ this->m_mutex };
+	this->m_wantFirst = first;
+	this->m_wantLast  = last;
+	if (this->m_building)
+	{
+		return false;
+	}
+	for (auto page{ std::max<std::size_t>(first, 1) }; page <= std::min(last, this->m_state.size()); ++page)
+	{
+		if (this->m_state[page - 1] == State::none)
+		{
+			this->m_building = true;
+			return true;
+		}
+	}
+	return false;
+}
+void pdfv::Thumbnails::build(const std::atomic<bool> & cancel, const ReadyT & ready) noexcept
+{
+	DEBUGPRINT("pdfv::Thumbnails::build(%p)\n", static_cast<const void *>(&cancel));
+
+	while (true)
+	{
+		std::size_t page{ 0 };
+		u8 * cell{ nullptr };
+		{
+			std::lock_guard lock{ this->m_mutex };
+			if (cancel)
+			{
+				this->m_building = false;
+				return;
+			}
+			try
+			{
+				page = this->next();
+			}
+			catch (const std::bad_alloc &)
+			{
+				this->m_building = false;
+				return;
+			}
+			if (page == 0)
+			{
+				return;
+			}
+			const auto idx{ page - 1 };
+			cell = this->m_atlases[idx / s_cPerAtlas].get() + (idx % s_cPerAtlas) * s_cCellBytes;
+		}
+
+		// Cell is written while the page is queued, readers don't touch it until then
+		auto state{ State::failed };
+		xy<u16> size;
+		const auto before{ std::chrono::steady_clock::now() };
+		{
+			auto lock{ Pdfium::lock() };
+			if (this->m_doc->get() == nullptr)
+			{
+				std::lock_guard lock2{ this->m_mutex };
+				this->m_state[page - 1] = State::none;
+				this->m_building = false;
+				return;
+			}
+			if (auto fpage{ FPDF_LoadPage(this->m_doc->get(), int(page - 1)) }; fpage != nullptr) [[likely]]
+			{
+				if (s_embedded(fpage, cell, size))
+				{
+					state = State::embedded;
+				}
+				else if (s_render(fpage, cell, size))
+				{
+					state = State::rendered;
+				}
+				FPDF_ClosePage(fpage);
+			}
+		}
+
+		{
+			const auto cost{ u64(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - before).count()) };
+			std::lock_guard lock{ this->m_mutex };
+			this->m_size[page - 1]  = size;
+			this->m_state[page - 1] = state;
+			this->m_atlasUse[(page - 1) / s_cPerAtlas]   = MemoryGovernor::s_now();
+			this->m_atlasCost[(page - 1) / s_cPerAtlas] += cost;
+		}
+		if (state != State::failed) [[likely]]
+		{
+			try
+			{
+				ready(page);
+			}
+			catch (...)
+			{
+			}
+		}
+	}
+}
+[[nodiscard]] const pdfv::u8 * pdfv::Thumbnails::get(std::size_t page, xy<int> & size) const noexcept
+{
+	std::lock_guard lock{ this->m_mutex };
+	if (page < 1 || page > this->m_state.size())
+	{
+		return nullptr;
+	}
+	const auto state{ this->m_state[page - 1] };
+	if (state != State::embedded && state != State::rendered)
+	{
+		return nullptr;
+	}
+	size = this->m_size[page - 1];
+	const auto idx{ page - 1 };
+	this->m_atlasUse[idx / s_cPerAtlas] = MemoryGovernor::s_now();
+	return this->m_atlases[idx / s_cPerAtlas].get() + (idx % s_cPerAtlas) * s_cCellBytes;
+}
+[[nodiscard]] std::size_t pdfv::Thumbnails::bytes() const noexcept
+{
+	std::lock_guard lock{ this->m_mutex };
+	const auto atlases{ std::size_t(std::count_if(
+		this->m_atlases.begin(), this->m_atlases.end(),
+		[](const auto & atlas) noexcept { return atlas != nullptr; }
+	)) };
+	return sizeof(Thumbnails) +
+		this->m_state.capacity() * sizeof(State) +
+		this->m_size.capacity() * sizeof(xy<u16>) +
+		this->m_atlases.capacity() * sizeof(std::unique_ptr<u8[]>) +
+		(this->m_atlasUse.capacity() + this->m_atlasCost.capacity()) * sizeof(u64) +
+		atlases * s_cPerAtlas * s_cCellBytes;
+}
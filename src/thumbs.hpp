@@ -0,0 +1,157 @@
+#pragma once
+
+#include "common.hpp"
+#include "borrowed.hpp"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace pdfv
+{
+	/**
+	 * @brief Page thumbnails of a single document version, made in the background only for
+	 * the pages the thumbnail strip asks for. Embedded thumbnails are used when a page has
+	 * one, other pages are rendered at thumbnail size. Pixels are stored in atlases holding
+	 * s_cPerAtlas fixed-size cells each, stacked vertically, so a cell is a contiguous
+	 * top-down 24-bit DIB.
+	 * 
+	 */
+	class Thumbnails
+	{
+	public:
+		/**
+		 * @brief Cell size in pixels, thumbnails are fitted into it preserving aspect ratio
+		 * 
+		 */
+		static constexpr int s_cWidth{ 96 }, s_cHeight{ 128 };
+		/**
+		 * @brief Cell row length in bytes, 24-bit rows are already DWORD-aligned
+		 * 
+		 */
+		static constexpr std::size_t s_cStride{ std::size_t(s_cWidth) * 3 };
+		static_assert(s_cStride % 4 == 0);
+		static constexpr std::size_t s_cCellBytes{ s_cStride * std::size_t(s_cHeight) };
+		static constexpr std::size_t s_cPerAtlas{ 32 };
+
+		/**
+		 * @brief Receives the number of a page whose thumbnail just became ready
+		 * 
+		 */
+		using ReadyT = std::function<void (std::size_t)>;
+
+	private:
+		enum class State : u8
+		{
+			none,
+			queued,
+			embedded,
+			rendered,
+			failed
+		};
+
+		mutable std::mutex m_mutex;
+		DocRef m_doc;
+		std::vector<State> m_state;
+		std::vector<xy<u16>> m_size;
+		/**
+		 * @brief Allocated when the first thumbnail of the atlas is made
+		 * 
+		 */
+		std::vector<std::unique_ptr<u8[]>> m_atlases;
+		/**
+		 * @brief Tick count of the last use of each atlas
+		 * 
+		 */
+		mutable std::vector<u64> m_atlasUse;
+		/**
+		 * @brief Time it took to make the thumbnails of each atlas in microseconds
+		 * 
+		 */
+		std::vector<u64> m_atlasCost;
+		u64 m_governorId{ 0 };
+		/**
+		 * @brief Pages the strip currently asks for, starting from 1, inclusive
+		 * 
+		 */
+		std::size_t m_wantFirst{ 1 }, m_wantLast{ 0 };
+		bool m_building{ false };
+
+		/**
+		 * @brief Picks the next wanted page that has no thumbnail, marks it queued and
+		 * allocates its atlas, clears the building flag if there is none. Caller has to
+		 * hold m_mutex
+		 * 
+		 * @return std::size_t Page number, starting from 1, 0 if there is none
+		 */
+		[[nodiscard]] std::size_t next();
+		/**
+		 * @brief Scales an embedded thumbnail into a cell, caller has to hold the library lock
+		 * 
+		 * @param page Page handle
+		 * @param cell Pointer to cell
+		 * @param size Reference to size, receives the size of the thumbnail
+		 * @return true Page has an embedded thumbnail in a supported format
+		 */
+		[[nodiscard]] static bool s_embedded(FPDF_PAGE page, u8 * cell, xy<u16> & size) noexcept;
+		/**
+		 * @brief Renders a page into a cell, caller has to hold the library lock
+		 * 
+		 * @param page Page handle
+		 * @param cell Pointer to cell
+		 * @param size Reference to size, receives the size of the thumbnail
+		 * @return true Success
+		 */
+		[[nodiscard]] static bool s_render(FPDF_PAGE page, u8 * cell, xy<u16> & size) noexcept;
+		/**
+		 * @brief Finds the least recently used atlas, whose cells aren't being made, caller
+		 * has to hold m_mutex
+		 * 
+		 * @return std::size_t Atlas index, m_atlases.size() if there is none
+		 */
+		[[nodiscard]] std::size_t oldestAtlas() const noexcept;
+
+	public:
+		/**
+		 * @param doc Document of the owner
+		 * @param numPages Page count of the document
+		 */
+		Thumbnails(DocRef doc, std::size_t numPages);
+		Thumbnails(const Thumbnails & other) = delete;
+		Thumbnails(Thumbnails && other) noexcept = delete;
+		Thumbnails & operator=(const Thumbnails & other) = delete;
+		Thumbnails & operator=(Thumbnails && other) noexcept = delete;
+		~Thumbnails() noexcept;
+
+		/**
+		 * @brief Sets the pages the strip asks for, replacing the previous request. Pages
+		 * scrolled past before their turn are never made
+		 * 
+		 * @param first First page, starting from 1
+		 * @param last Last page, inclusive
+		 * @return true A build has to be started, false if one is running or nothing is missing
+		 */
+		[[nodiscard]] bool want(std::size_t first, std::size_t last) noexcept;
+		/**
+		 * @brief Makes thumbnails of the wanted pages until none is missing, takes the library
+		 * lock for every page
+		 * 
+		 * @param cancel Reference to cancellation flag
+		 * @param ready Called without any lock held after every finished thumbnail
+		 */
+		void build(const std::atomic<bool> & cancel, const ReadyT & ready) noexcept;
+		/**
+		 * @param page Page number, starting from 1
+		 * @param size Reference to size, receives the size of the thumbnail
+		 * @return const u8* Pointer to top-down 24-bit pixels with a row length of s_cStride,
+		 * nullptr if the thumbnail isn't ready
+		 */
+		[[nodiscard]] const u8 * get(std::size_t page, xy<int> & size) const noexcept;
+		/**
+		 * @return std::size_t Approximate memory usage in bytes
+		 */
+		[[nodiscard]] std::size_t bytes() const noexcept;
+	};
+}
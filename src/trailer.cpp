@@ -0,0 +1,256 @@
+#include "trailer.hpp"
+#include "debug.hpp"
+
+#include <string_view>
+
+namespace pdfv::trailer
+{
+	/**
+	 * @brief Size of the region at the start and the end of the file, where trailers are searched for
+	 * 
+	 */
+	static constexpr std::size_t s_cWindow{ 4096 };
+
+	[[nodiscard]] static constexpr bool isWhite(char c) noexcept
+	{
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\0';
+	}
+	[[nodiscard]] static constexpr bool isDelim(char c) noexcept
+	{
+		return isWhite(c) || c == '/' || c == '<' || c == '>' || c == '[' || c == ']' ||
+			c == '(' || c == ')' || c == '{' || c == '}' || c == '%';
+	}
+
+	static void appendHex(std::string & out, u8 byte)
+	{
+		constexpr const char digits[]{ "0123456789abcdef" };
+		out.push_back(digits[byte >> 4]);
+		out.push_back(digits[byte & 0x0F]);
+	}
+
+	/**
+	 * @brief Parses a dictionary starting at a given position, gathers top-level
+	 * /Encrypt and /ID entries
+	 * 
+	 * @param s File contents
+	 * @param pos Position of the opening "<<"
+	 * @param info Reference to information structure to be updated
+	 * @return true Dictionary was parsed until its end
+	 */
+	static bool parseDict(std::string_view s, std::size_t pos, Info & info)
+	{
+		if (s.substr(pos, 2) != "<<") [[unlikely]]
+		{
+			return false;
+		}
+
+		enum class IdState
+		{
+			none,
+			key,
+			array
+		} idState{ IdState::none };
+		bool idDone{ !info.id.empty() };
+
+		int depth{ 0 };
+		for (std::size_t i = pos; i < s.size();)
+		{
+			const auto c{ s[i] };
+			if (c == '<' && i + 1 < s.size() && s[i + 1] == '<')
+			{
+				++depth;
+				i += 2;
+			}
+			else if (c == '>' && i + 1 < s.size() && s[i + 1] == '>')
+			{
+				--depth;
+				i += 2;
+				if (depth == 0)
+				{
+					return true;
+				}
+			}
+			else if (c == '<')
+			{
+				// Hex string
+				auto end{ s.find('>', i + 1) };
+				if (end == std::string_view::npos) [[unlikely]]
+				{
+					return false;
+				}
+				if (idState == IdState::array && !idDone)
+				{
+					for (auto ch : s.substr(i + 1, end - i - 1))
+					{
+						if (!isWhite(ch))
+						{
+							info.id.push_back(char((ch >= 'A' && ch <= 'F') ? (ch - 'A' + 'a') : ch));
+						}
+					}
+					idDone = true;
+				}
+				idState = IdState::none;
+				i = end + 1;
+			}
+			else if (c == '(')
+			{
+				// Literal string, may contain balanced parentheses and escapes
+				std::string raw;
+				int parens{ 1 };
+				for (++i; i < s.size() && parens > 0; ++i)
+				{
+					if (s[i] == '\\' && i + 1 < s.size())
+					{
+						raw.push_back(s[++i]);
+						continue;
+					}
+					parens += (s[i] == '(') - (s[i] == ')');
+					if (parens > 0)
+					{
+						raw.push_back(s[i]);
+					}
+				}
+				if (idState == IdState::array && !idDone)
+				{
+					for (auto ch : raw)
+					{
+						appendHex(info.id, u8(ch));
+					}
+					idDone = true;
+				}
+				idState = IdState::none;
+			}
+			else if (c == '%')
+			{
+				// Comment until the end of line
+				for (; i < s.size() && s[i] != '\r' && s[i] != '\n'; ++i);
+			}
+			else if (c == '/')
+			{
+				auto start{ ++i };
+				for (; i < s.size() && !isDelim(s[i]); ++i);
+				auto name{ s.substr(start, i - start) };
+				if (depth == 1)
+				{
+					if (name == "Encrypt")
+					{
+						info.encrypted = true;
+					}
+					idState = (name == "ID") ? IdState::key : IdState::none;
+				}
+			}
+			else if (c == '[')
+			{
+				if (idState == IdState::key)
+				{
+					idState = IdState::array;
+				}
+				++i;
+			}
+			else
+			{
+				++i;
+			}
+		}
+
+		return false;
+	}
+
+	/**
+	 * @brief Parses the trailer dictionary following the "trailer" keyword at given position
+	 * 
+	 */
+	static bool parseTrailerKeyword(std::string_view s, std::size_t pos, Info & info)
+	{
+		pos += std::string_view("trailer").length();
+		for (; pos < s.size() && isWhite(s[pos]); ++pos);
+		return parseDict(s, pos, info);
+	}
+
+	/**
+	 * @brief Parses the cross-reference section at given offset, either a cross-reference
+	 * stream dictionary or a trailer of a cross-reference table
+	 * 
+	 */
+	static bool parseXref(std::string_view s, std::size_t offset, Info & info)
+	{
+		if (offset >= s.size()) [[unlikely]]
+		{
+			return false;
+		}
+		auto region{ s.substr(offset, s_cWindow) };
+		if (region.starts_with("xref"))
+		{
+			// The table itself may be arbitrarily long, trailer keyword is searched separately
+			return false;
+		}
+
+		// Cross-reference stream: "N G obj <<"
+		if (auto obj{ region.find("obj") }; obj != std::string_view::npos && obj < 32)
+		{
+			auto dict{ region.find("<<", obj) };
+			if (dict != std::string_view::npos)
+			{
+				return parseDict(s, offset + dict, info);
+			}
+		}
+		return false;
+	}
+}
+
+[[nodiscard]] pdfv::trailer::Info pdfv::trailer::scan(const u8 * data, std::size_t length) noexcept
+{
+	DEBUGPRINT("pdfv::trailer::scan(%p, %zu)\n", static_cast<const void *>(data), length);
+
+	Info info;
+	if (data == nullptr || length == 0) [[unlikely]]
+	{
+		return info;
+	}
+
+	try
+	{
+		std::string_view s(reinterpret_cast<const char *>(data), length);
+		const auto tailStart{ (length > s_cWindow) ? (length - s_cWindow) : 0 };
+		auto tail{ s.substr(tailStart) };
+
+		// Newest cross-reference section
+		if (auto sx{ tail.rfind("startxref") }; sx != std::string_view::npos)
+		{
+			std::size_t offset{ 0 }, i{ sx + std::string_view("startxref").length() };
+			for (; i < tail.size() && isWhite(tail[i]); ++i);
+			for (; i < tail.size() && tail[i] >= '0' && tail[i] <= '9'; ++i)
+			{
+				offset = offset * 10 + std::size_t(tail[i] - '0');
+			}
+			info.found |= parseXref(s, offset, info);
+		}
+		// Newest trailer of a cross-reference table
+		if (auto tr{ tail.rfind("trailer") }; tr != std::string_view::npos)
+		{
+			info.found |= parseTrailerKeyword(s, tailStart + tr, info);
+		}
+		// First-page trailer of linearized files
+		auto head{ s.substr(0, s_cWindow) };
+		if (head.find("/Linearized") != std::string_view::npos)
+		{
+			if (auto tr{ head.find("trailer") }; tr != std::string_view::npos)
+			{
+				info.found |= parseTrailerKeyword(s, tr, info);
+			}
+			else if (auto xr{ head.find("/XRef") }; xr != std::string_view::npos)
+			{
+				if (auto dict{ head.rfind("<<", xr) }; dict != std::string_view::npos)
+				{
+					info.found |= parseDict(s, dict, info);
+				}
+			}
+		}
+	}
+	catch (...)
+	{
+		info = {};
+	}
+
+	return info;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <cstddef>
+#include <string>
+
+namespace pdfv::trailer
+{
+	/**
+	 * @brief Information gathered from PDF trailer dictionaries without parsing the document
+	 * 
+	 */
+	struct Info
+	{
+		/**
+		 * @brief At least one trailer dictionary was found
+		 * 
+		 */
+		bool found{ false };
+		/**
+		 * @brief Trailer references an encryption dictionary
+		 * 
+		 */
+		bool encrypted{ false };
+		/**
+		 * @brief First element of file identifier array, hex-encoded, empty if not present
+		 * 
+		 */
+		std::string id;
+	};
+
+	/**
+	 * @brief Scans the trailer dictionaries of a PDF file in memory. Looks at the dictionary
+	 * pointed to by the last startxref, the last "trailer" keyword and the first-page trailer
+	 * of linearized files. Doesn't load any objects
+	 * 
+	 * @param data Pointer to PDF file contents
+	 * @param length Length of the contents
+	 * @return Info Gathered information, default-constructed if nothing was found
+	 */
+	[[nodiscard]] Info scan(const u8 * data, std::size_t length) noexcept;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+namespace pdfv
+{
+	// Some type aliases
+	using ssize_t = std::intptr_t;
+	using uchar   = unsigned char;
+	using ushort  = unsigned short;
+	using uint    = unsigned int;
+	using l       = long;
+	using ul      = unsigned long;
+	using ll      = long long;
+	using ull     = unsigned long long;
+	using f32     = float;
+	using f64     = double;
+	using f128    = long double;
+
+	using i8  = std::int8_t;
+	using u8  = std::uint8_t;
+	using i16 = std::int16_t;
+	using u16 = std::uint16_t;
+	using i32 = std::int32_t;
+	using u32 = std::uint32_t;
+	using i64 = std::int64_t;
+	using u64 = std::uint64_t;
+}
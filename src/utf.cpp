@@ -0,0 +1,458 @@
+#include "utf.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cwchar>
+
+// PDFV_UTF_SCALAR builds only the portable SWAR path, e.g. to measure it against SSE2
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && !defined(PDFV_UTF_SCALAR)
+	#include <immintrin.h>
+	#define PDFV_HAS_SSE2_PATH 1
+#else
+	#define PDFV_HAS_SSE2_PATH 0
+#endif
+
+namespace pdfv::utf
+{
+	static constexpr u64 s_cAsciiMask8{ 0x8080808080808080ULL };
+	static constexpr u64 s_cAsciiMask16{ 0xFF80FF80FF80FF80ULL };
+
+	[[nodiscard]] static inline u64 load64(const void * ptr) noexcept
+	{
+		u64 word;
+		std::memcpy(&word, ptr, sizeof word);
+		return word;
+	}
+
+#if PDFV_HAS_SSE2_PATH
+	[[nodiscard]] static bool hasSse2() noexcept
+	{
+		static const bool s_sse2{ __builtin_cpu_supports("sse2") != 0 };
+		return s_sse2;
+	}
+
+	[[gnu::target("sse2")]] [[nodiscard]] static std::size_t asciiPrefix8Sse2(const u8 * in, std::size_t n) noexcept
+	{
+		std::size_t i = 0;
+		for (; i + 32 <= n; i += 32)
+		{
+			const auto a{ _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)) };
+			const auto b{ _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 16)) };
+			if (_mm_movemask_epi8(_mm_or_si128(a, b)) != 0)
+			{
+				break;
+			}
+		}
+		for (; i + 16 <= n; i += 16)
+		{
+			if (_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i))) != 0)
+			{
+				break;
+			}
+		}
+		return i;
+	}
+	template<concepts::utf16_unit C>
+	[[gnu::target("sse2")]] [[nodiscard]] static std::size_t widenAsciiSse2(const u8 * in, std::size_t n, C * out) noexcept
+	{
+		const auto zero{ _mm_setzero_si128() };
+		std::size_t i = 0;
+		for (; i + 16 <= n; i += 16)
+		{
+			const auto v{ _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)) };
+			if (_mm_movemask_epi8(v) != 0)
+			{
+				break;
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),     _mm_unpacklo_epi8(v, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 8), _mm_unpackhi_epi8(v, zero));
+		}
+		return i;
+	}
+	template<concepts::utf16_unit C>
+	[[gnu::target("sse2")]] [[nodiscard]] static std::size_t asciiPrefix16Sse2(const C * in, std::size_t n) noexcept
+	{
+		const auto mask{ _mm_set1_epi16(short(0xFF80)) };
+		const auto zero{ _mm_setzero_si128() };
+		std::size_t i = 0;
+		for (; i + 16 <= n; i += 16)
+		{
+			const auto a{ _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)) };
+			const auto b{ _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 8)) };
+			const auto high{ _mm_and_si128(_mm_or_si128(a, b), mask) };
+			if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) != 0xFFFF)
+			{
+				break;
+			}
+		}
+		return i;
+	}
+	template<concepts::utf16_unit C>
+	[[gnu::target("sse2")]] [[nodiscard]] static std::size_t narrowAsciiSse2(const C * in, std::size_t n, char * out) noexcept
+	{
+		const auto mask{ _mm_set1_epi16(short(0xFF80)) };
+		const auto zero{ _mm_setzero_si128() };
+		std::size_t i = 0;
+		for (; i + 16 <= n; i += 16)
+		{
+			const auto a{ _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)) };
+			const auto b{ _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 8)) };
+			const auto high{ _mm_and_si128(_mm_or_si128(a, b), mask) };
+			if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) != 0xFFFF)
+			{
+				break;
+			}
+			// All units are below 0x80, saturation never kicks in
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packus_epi16(a, b));
+		}
+		return i;
+	}
+#endif
+
+	/**
+	 * @return std::size_t Length of the leading ASCII run
+	 */
+	[[nodiscard]] static std::size_t asciiPrefix8(const u8 * in, std::size_t n) noexcept
+	{
+		std::size_t i = 0;
+#if PDFV_HAS_SSE2_PATH
+		if (hasSse2()) [[likely]]
+		{
+			i = asciiPrefix8Sse2(in, n);
+		}
+#endif
+		for (; i + 8 <= n && (load64(in + i) & s_cAsciiMask8) == 0; i += 8);
+		for (; i < n && in[i] < 0x80; ++i);
+		return i;
+	}
+	/**
+	 * @brief Copies the leading ASCII run, widening every byte to a code unit
+	 * 
+	 * @return std::size_t Length of the run
+	 */
+	template<concepts::utf16_unit C>
+	[[nodiscard]] static std::size_t widenAscii(const u8 * in, std::size_t n, C * out) noexcept
+	{
+		std::size_t i = 0;
+#if PDFV_HAS_SSE2_PATH
+		if (hasSse2()) [[likely]]
+		{
+			i = widenAsciiSse2(in, n, out);
+		}
+#endif
+		for (; i + 8 <= n && (load64(in + i) & s_cAsciiMask8) == 0; i += 8)
+		{
+			for (std::size_t j = 0; j < 8; ++j)
+			{
+				out[i + j] = C(in[i + j]);
+			}
+		}
+		for (; i < n && in[i] < 0x80; ++i)
+		{
+			out[i] = C(in[i]);
+		}
+		return i;
+	}
+	template<concepts::utf16_unit C>
+	[[nodiscard]] static std::size_t asciiPrefix16(const C * in, std::size_t n) noexcept
+	{
+		std::size_t i = 0;
+#if PDFV_HAS_SSE2_PATH
+		if (hasSse2()) [[likely]]
+		{
+			i = asciiPrefix16Sse2(in, n);
+		}
+#endif
+		for (; i + 4 <= n && (load64(in + i) & s_cAsciiMask16) == 0; i += 4);
+		for (; i < n && u16(in[i]) < 0x80; ++i);
+		return i;
+	}
+	/**
+	 * @brief Copies the leading ASCII run, narrowing every code unit to a byte
+	 * 
+	 * @return std::size_t Length of the run
+	 */
+	template<concepts::utf16_unit C>
+	[[nodiscard]] static std::size_t narrowAscii(const C * in, std::size_t n, char * out) noexcept
+	{
+		std::size_t i = 0;
+#if PDFV_HAS_SSE2_PATH
+		if (hasSse2()) [[likely]]
+		{
+			i = narrowAsciiSse2(in, n, out);
+		}
+#endif
+		for (; i + 4 <= n && (load64(in + i) & s_cAsciiMask16) == 0; i += 4)
+		{
+			for (std::size_t j = 0; j < 4; ++j)
+			{
+				out[i + j] = char(in[i + j]);
+			}
+		}
+		for (; i < n && u16(in[i]) < 0x80; ++i)
+		{
+			out[i] = char(in[i]);
+		}
+		return i;
+	}
+
+	/**
+	 * @brief Decodes one UTF-8 sequence, ill-formed sequences are consumed as their
+	 * maximal subpart and decode to U+FFFD
+	 * 
+	 * @param in Input, at least one byte
+	 * @param n Input length
+	 * @param cp Decoded code point
+	 * @param valid Cleared if the sequence is ill-formed
+	 * @return std::size_t Number of bytes consumed
+	 */
+	[[nodiscard]] static inline std::size_t decode8(const u8 * in, std::size_t n, char32_t & cp, bool & valid) noexcept
+	{
+		const u8 lead{ in[0] };
+		if (lead < 0x80) [[likely]]
+		{
+			cp = lead;
+			return 1;
+		}
+
+		std::size_t need;
+		u8 lo{ 0x80 }, hi{ 0xBF };
+		if (lead >= 0xC2 && lead <= 0xDF)
+		{
+			need = 1;
+			cp   = lead & 0x1Fu;
+		}
+		else if (lead >= 0xE0 && lead <= 0xEF)
+		{
+			need = 2;
+			cp   = lead & 0x0Fu;
+			// Overlong forms and surrogates
+			if (lead == 0xE0)
+			{
+				lo = 0xA0;
+			}
+			else if (lead == 0xED)
+			{
+				hi = 0x9F;
+			}
+		}
+		else if (lead >= 0xF0 && lead <= 0xF4)
+		{
+			need = 3;
+			cp   = lead & 0x07u;
+			// Overlong forms and code points above U+10FFFF
+			if (lead == 0xF0)
+			{
+				lo = 0x90;
+			}
+			else if (lead == 0xF4)
+			{
+				hi = 0x8F;
+			}
+		}
+		else
+		{
+			cp    = s_cReplacement;
+			valid = false;
+			return 1;
+		}
+
+		std::size_t i = 1;
+		for (; i <= need; ++i)
+		{
+			if (i >= n || in[i] < lo || in[i] > hi)
+			{
+				cp    = s_cReplacement;
+				valid = false;
+				return i;
+			}
+			cp = (cp << 6) | (in[i] & 0x3Fu);
+			lo = 0x80;
+			hi = 0xBF;
+		}
+		return i;
+	}
+	/**
+	 * @brief Decodes one UTF-16 code point, unpaired surrogates decode to U+FFFD
+	 * 
+	 * @return std::size_t Number of code units consumed
+	 */
+	template<concepts::utf16_unit C>
+	[[nodiscard]] static inline std::size_t decode16(const C * in, std::size_t n, char32_t & cp, bool & valid) noexcept
+	{
+		const char32_t unit{ u16(in[0]) };
+		if (unit < 0xD800 || unit > 0xDFFF) [[likely]]
+		{
+			cp = unit;
+			return 1;
+		}
+		if (unit <= 0xDBFF && n > 1)
+		{
+			const char32_t next{ u16(in[1]) };
+			if (next >= 0xDC00 && next <= 0xDFFF) [[likely]]
+			{
+				cp = 0x10000 + ((unit - 0xD800) << 10) + (next - 0xDC00);
+				return 2;
+			}
+		}
+		cp    = s_cReplacement;
+		valid = false;
+		return 1;
+	}
+	[[nodiscard]] static inline std::size_t utf8Size(char32_t cp) noexcept
+	{
+		return (cp < 0x80) ? 1 : (cp < 0x800) ? 2 : (cp < 0x10000) ? 3 : 4;
+	}
+}
+
+[[nodiscard]] bool pdfv::utf::valid(std::string_view str) noexcept
+{
+	const auto in{ reinterpret_cast<const u8 *>(str.data()) };
+	const auto n{ str.size() };
+	bool ok{ true };
+	for (std::size_t i = asciiPrefix8(in, n); i < n && ok; i += asciiPrefix8(in + i, n - i))
+	{
+		for (char32_t cp; i < n && in[i] >= 0x80 && ok;)
+		{
+			i += decode8(in + i, n - i, cp, ok);
+		}
+	}
+	return ok;
+}
+[[nodiscard]] std::size_t pdfv::utf::utf16Length(std::string_view str) noexcept
+{
+	const auto in{ reinterpret_cast<const u8 *>(str.data()) };
+	const auto n{ str.size() };
+	bool ok{ true };
+	std::size_t units{ 0 };
+	for (std::size_t i = 0; i < n;)
+	{
+		const auto ascii{ asciiPrefix8(in + i, n - i) };
+		i     += ascii;
+		units += ascii;
+		for (char32_t cp; i < n && in[i] >= 0x80;)
+		{
+			i     += decode8(in + i, n - i, cp, ok);
+			units += (cp >= 0x10000) ? 2 : 1;
+		}
+	}
+	return units;
+}
+template<pdfv::concepts::utf16_unit C>
+[[nodiscard]] std::size_t pdfv::utf::utf8Length(const C * str, std::size_t length) noexcept
+{
+	bool ok{ true };
+	std::size_t units{ 0 };
+	for (std::size_t i = 0; i < length;)
+	{
+		const auto ascii{ asciiPrefix16(str + i, length - i) };
+		i     += ascii;
+		units += ascii;
+		for (char32_t cp; i < length && u16(str[i]) >= 0x80;)
+		{
+			i     += decode16(str + i, length - i, cp, ok);
+			units += utf8Size(cp);
+		}
+	}
+	return units;
+}
+
+template<pdfv::concepts::utf16_unit C>
+pdfv::utf::Result pdfv::utf::toUtf16(std::string_view str, C * out, std::size_t capacity) noexcept
+{
+	const auto in{ reinterpret_cast<const u8 *>(str.data()) };
+	const auto n{ str.size() };
+	Result res;
+	auto & i{ res.read };
+	auto & w{ res.written };
+	while (i < n && w < capacity)
+	{
+		const auto ascii{ widenAscii(in + i, std::min(n - i, capacity - w), out + w) };
+		i += ascii;
+		w += ascii;
+
+		for (char32_t cp; i < n && in[i] >= 0x80;)
+		{
+			bool ok{ true };
+			const auto used{ decode8(in + i, n - i, cp, ok) };
+			if (cp >= 0x10000)
+			{
+				if (w + 2 > capacity) [[unlikely]]
+				{
+					return res;
+				}
+				cp -= 0x10000;
+				out[w++] = C(0xD800 + (cp >> 10));
+				out[w++] = C(0xDC00 + (cp & 0x3FF));
+			}
+			else
+			{
+				if (w + 1 > capacity) [[unlikely]]
+				{
+					return res;
+				}
+				out[w++] = C(cp);
+			}
+			i += used;
+			res.valid = res.valid && ok;
+		}
+	}
+	return res;
+}
+template<pdfv::concepts::utf16_unit C>
+pdfv::utf::Result pdfv::utf::toUtf8(const C * str, std::size_t length, char * out, std::size_t capacity) noexcept
+{
+	Result res;
+	auto & i{ res.read };
+	auto & w{ res.written };
+	while (i < length && w < capacity)
+	{
+		const auto ascii{ narrowAscii(str + i, std::min(length - i, capacity - w), out + w) };
+		i += ascii;
+		w += ascii;
+
+		for (char32_t cp; i < length && u16(str[i]) >= 0x80;)
+		{
+			bool ok{ true };
+			const auto used{ decode16(str + i, length - i, cp, ok) };
+			const auto size{ utf8Size(cp) };
+			if (w + size > capacity) [[unlikely]]
+			{
+				return res;
+			}
+			switch (size)
+			{
+			case 2:
+				out[w++] = char(0xC0 | (cp >> 6));
+				break;
+			case 3:
+				out[w++] = char(0xE0 | (cp >> 12));
+				out[w++] = char(0x80 | ((cp >> 6) & 0x3F));
+				break;
+			default:
+				out[w++] = char(0xF0 | (cp >> 18));
+				out[w++] = char(0x80 | ((cp >> 12) & 0x3F));
+				out[w++] = char(0x80 | ((cp >> 6) & 0x3F));
+				break;
+			}
+			out[w++] = char(0x80 | (cp & 0x3F));
+			i += used;
+			res.valid = res.valid && ok;
+		}
+	}
+	return res;
+}
+
+// Code unit types in use: char16_t, PDFium's FPDF_WCHAR and wchar_t on Windows
+#define PDFV_UTF_INSTANTIATE(C) \
+	template std::size_t pdfv::utf::utf8Length<C>(const C *, std::size_t) noexcept; \
+	template pdfv::utf::Result pdfv::utf::toUtf16<C>(std::string_view, C *, std::size_t) noexcept; \
+	template pdfv::utf::Result pdfv::utf::toUtf8<C>(const C *, std::size_t, char *, std::size_t) noexcept;
+
+PDFV_UTF_INSTANTIATE(char16_t)
+PDFV_UTF_INSTANTIATE(unsigned short)
+#if WCHAR_MAX <= 0xFFFF
+PDFV_UTF_INSTANTIATE(wchar_t)
+#endif
+
+#undef PDFV_UTF_INSTANTIATE
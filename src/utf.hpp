@@ -0,0 +1,99 @@
+#pragma once
+
+#include "types.hpp"
+#include "concepts.hpp"
+
+#include <cstddef>
+#include <string_view>
+
+namespace pdfv::utf
+{
+	/**
+	 * @brief Outcome of a transcoding call
+	 * 
+	 */
+	struct Result
+	{
+		/**
+		 * @brief Number of input code units consumed, conversion can be resumed from here
+		 * 
+		 */
+		std::size_t read{ 0 };
+		/**
+		 * @brief Number of output code units written
+		 * 
+		 */
+		std::size_t written{ 0 };
+		/**
+		 * @brief false if the consumed input contained ill-formed sequences, each of them
+		 * was replaced by U+FFFD
+		 * 
+		 */
+		bool valid{ true };
+	};
+
+	/**
+	 * @brief Replacement character for ill-formed input
+	 * 
+	 */
+	inline constexpr char32_t s_cReplacement{ 0xFFFD };
+
+	/**
+	 * @return std::size_t Upper bound of UTF-16 code units needed for UTF-8 input of given size
+	 */
+	[[nodiscard]] constexpr std::size_t maxUtf16(std::size_t utf8Size) noexcept
+	{
+		return utf8Size;
+	}
+	/**
+	 * @return std::size_t Upper bound of UTF-8 code units needed for UTF-16 input of given size
+	 */
+	[[nodiscard]] constexpr std::size_t maxUtf8(std::size_t utf16Size) noexcept
+	{
+		return utf16Size * 3;
+	}
+
+	/**
+	 * @brief Checks whether the input is well-formed UTF-8: no overlong forms, surrogates
+	 * or code points above U+10FFFF
+	 * 
+	 */
+	[[nodiscard]] bool valid(std::string_view str) noexcept;
+	/**
+	 * @brief Exact number of UTF-16 code units the input transcodes to, ill-formed
+	 * sequences count as U+FFFD
+	 * 
+	 */
+	[[nodiscard]] std::size_t utf16Length(std::string_view str) noexcept;
+	/**
+	 * @brief Exact number of UTF-8 code units the input transcodes to, unpaired surrogates
+	 * count as U+FFFD
+	 * 
+	 */
+	template<concepts::utf16_unit C>
+	[[nodiscard]] std::size_t utf8Length(const C * str, std::size_t length) noexcept;
+
+	/**
+	 * @brief Transcodes UTF-8 to UTF-16 into a caller-provided buffer. Stops before the first
+	 * code point that does not fit, a buffer of maxUtf16(str.size()) units always suffices
+	 * 
+	 * @param str UTF-8 input
+	 * @param out Output buffer
+	 * @param capacity Size of output buffer in code units
+	 * @return Result Units consumed and written, validity of the input
+	 */
+	template<concepts::utf16_unit C>
+	Result toUtf16(std::string_view str, C * out, std::size_t capacity) noexcept;
+	/**
+	 * @brief Transcodes UTF-16 to UTF-8 into a caller-provided buffer. Stops before the first
+	 * code point that does not fit, a buffer of maxUtf8(length) units always suffices
+	 * 
+	 * @param str UTF-16 input
+	 * @param length Input length in code units
+	 * @param out Output buffer
+	 * @param capacity Size of output buffer in bytes
+	 * @return Result Units consumed and written, validity of the input
+	 */
+	template<concepts::utf16_unit C>
+	Result toUtf8(const C * str, std::size_t length, char * out, std::size_t capacity) noexcept;
+}
@@ -13,9 +13,29 @@
 	"Supports \"advanced\" tabulation:\n" \
 	"Ctrl+Tab\t    \t->  Tabulate forwards\n" \
 	"Ctrl+Shift+Tab\t->  Tabulate backwards\n\n" \
+	"Text selection:\n" \
+	"Drag\t    \t->  Select text in a rectangle\n" \
+	"Ctrl+A\t    \t->  Select all text of the page\n" \
+	"Ctrl+C\t    \t->  Copy selected text\n" \
+	"Ctrl+Shift+C\t->  Copy the tagged structure of the document\n\n" \
+	"Links:\n" \
+	"Click\t    \t->  Go to the linked page, the target is shown\n" \
+	"on the status bar while hovering\n\n" \
+	"Outline:\n" \
+	"Ctrl+B\t    \t->  Show/hide the outline panel\n" \
+	"Left / Right\t->  Collapse/expand an entry\n" \
+	"Ctrl+G\t    \t->  Go to a page by its label or number\n\n" \
+	"Thumbnails:\n" \
+	"Ctrl+T\t    \t->  Show/hide the thumbnail strip, click to go to a page\n\n" \
+	"Attachments:\n" \
+	"Ctrl+Shift+A\t->  Show/hide embedded files, Enter or double-click to save the selected ones\n\n" \
+	"Search:\n" \
+	"Ctrl+F\t    \t->  Find text\n" \
+	"F3 / Shift+F3\t->  Next/previous match\n" \
+	"Case and diacritics are ignored and regular expressions can be\n" \
+	"used, see the Edit menu\n\n" \
 	"Planned features:\n" \
 	" * Zooming capability\n" \
-	" * Search capability\n" \
 	" * Ability to open hyperlinks/websites\n\n" \
 	"The project is open for any feature requests. Post them under the Issues tab in GitHub."
 
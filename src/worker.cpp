@@ -0,0 +1,71 @@
+#include "worker.hpp"
+
+pdfv::Worker::~Worker() noexcept
+{
+	DEBUGPRINT("pdfv::Worker::~Worker()\n");
+	this->stop();
+}
+
+void pdfv::Worker::loop() noexcept
+{
+	DEBUGPRINT("pdfv::Worker::loop()\n");
+
+	while (true)
+	{
+		TaskT task;
+		{
+			std::unique_lock lock{ this->m_mutex };
+			this->m_cv.wait(lock, [this]{ return this->m_stop || !this->m_tasks.empty(); });
+			if (this->m_stop)
+			{
+				return;
+			}
+			task = std::move(this->m_tasks.front());
+			this->m_tasks.pop_front();
+		}
+
+		try
+		{
+			task();
+		}
+		catch (...)
+		{
+			DEBUGPRINT("Worker task threw an exception!\n");
+		}
+	}
+}
+
+void pdfv::Worker::post(TaskT task)
+{
+	std::lock_guard lock{ this->m_mutex };
+	this->m_tasks.emplace_back(std::move(task));
+	if (!this->m_thread.joinable()) [[unlikely]]
+	{
+		this->m_stop   = false;
+		this->m_thread = std::thread(&Worker::loop, this);
+	}
+	this->m_cv.notify_one();
+}
+void pdfv::Worker::clear() noexcept
+{
+	std::lock_guard lock{ this->m_mutex };
+	this->m_tasks.clear();
+}
+void pdfv::Worker::stop() noexcept
+{
+	{
+		std::lock_guard lock{ this->m_mutex };
+		this->m_tasks.clear();
+		this->m_stop = true;
+	}
+	this->m_cv.notify_all();
+	if (this->m_thread.joinable())
+	{
+		this->m_thread.join();
+	}
+}
+[[nodiscard]] std::size_t pdfv::Worker::pending() const noexcept
+{
+	std::lock_guard lock{ this->m_mutex };
+	return this->m_tasks.size();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+
+namespace pdfv
+{
+	/**
+	 * @brief Background worker thread, executes posted tasks one by one
+	 * in the order they were posted
+	 * 
+	 */
+	class Worker
+	{
+	public:
+		using TaskT = std::function<void ()>;
+
+	private:
+		std::thread m_thread;
+		mutable std::mutex m_mutex;
+		std::condition_variable m_cv;
+		std::deque<TaskT> m_tasks;
+		bool m_stop{ false };
+
+		/**
+		 * @brief Worker thread's main loop
+		 * 
+		 */
+		void loop() noexcept;
+
+	public:
+		Worker() noexcept = default;
+		Worker(const Worker & other) = delete;
+		Worker(Worker && other) noexcept = delete;
+		Worker & operator=(const Worker & other) = delete;
+		Worker & operator=(Worker && other) noexcept = delete;
+		~Worker() noexcept;
+
+		/**
+		 * @brief Posts a new task to the end of the task queue, starts the
+		 * worker thread if it isn't running yet
+		 * 
+		 * @param task Task to execute
+		 */
+		void post(TaskT task);
+		/**
+		 * @brief Removes all tasks that haven't been started yet
+		 * 
+		 */
+		void clear() noexcept;
+		/**
+		 * @brief Removes all pending tasks, waits for the current task to finish
+		 * and stops the worker thread
+		 * 
+		 */
+		void stop() noexcept;
+		/**
+		 * @return std::size_t Number of tasks waiting to be executed
+		 */
+		[[nodiscard]] std::size_t pending() const noexcept;
+	};
+}